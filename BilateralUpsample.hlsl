@@ -0,0 +1,64 @@
+// Kept finite where depths match exactly (BILATERAL_DEPTH_EPSILON in PostResample.h)
+#define BILATERAL_DEPTH_EPSILON 0.01
+
+#ifndef FUSE_COLOR
+#define FUSE_COLOR 0
+#endif
+
+#if FUSE_COLOR
+#include "ColorLUT.hlsli"
+#endif
+
+// Brings a reduced-resolution result back to full resolution.
+// The 2x2 nearest reduced texels are blended by their bilinear
+// weights, each divided by how far its depth is from this pixel's,
+// so near and far surfaces don't bleed into each other.  Matches
+// PostResample::BilateralUpsample().
+cbuffer externalData : register(b0)
+{
+    int downscale;
+    float2 depthParams; // Projection _33 and _43, to linearize depth
+}
+
+struct VertexToPixel
+{
+    float4 position : SV_POSITION;
+    float2 uv : TEXCOORD0;
+};
+
+Texture2D Pixels : register(t0);                // Reduced color
+Texture2D<float> ReducedDepth : register(t1);   // Reduced linear depth
+Texture2D<float> Depth : register(t2);          // Full resolution depth buffer
+
+float4 main(VertexToPixel input) : SV_TARGET
+{
+    int2 size;
+    Pixels.GetDimensions(size.x, size.y);
+
+    // This pixel's center, in reduced texels
+    float2 reduced = input.position.xy / downscale - 0.5;
+    float2 f = frac(reduced);
+    int2 base = (int2)floor(reduced);
+    float depth = depthParams.y / (Depth.Load(int3(input.position.xy, 0)) - depthParams.x);
+
+    float4 total = 0;
+    float totalWeight = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        int2 offset = int2(i & 1, i >> 1);
+        int2 texel = clamp(base + offset, 0, size - 1);
+
+        float bilinear = (offset.x ? f.x : 1 - f.x) * (offset.y ? f.y : 1 - f.y);
+        float difference = abs(ReducedDepth.Load(int3(texel, 0)) - depth) / depth;
+        float weight = bilinear / (BILATERAL_DEPTH_EPSILON + difference);
+
+        total += Pixels.Load(int3(texel, 0)) * weight;
+        totalWeight += weight;
+    }
+
+    float4 color = total / totalWeight;
+#if FUSE_COLOR
+    color = ApplyColor(color, input.position.xy);
+#endif
+    return color;
+}
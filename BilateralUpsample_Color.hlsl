@@ -0,0 +1,4 @@
+// Bilateral upsampling, then the color pipeline
+#define FUSE_COLOR 1
+
+#include "BilateralUpsample.hlsl"
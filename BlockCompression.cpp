@@ -0,0 +1,828 @@
+#include "BlockCompression.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <thread>
+
+// SSE2 is always there on x64, and on x86 when the compiler targets it
+#if !defined(BLOCK_COMPRESSION_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define BLOCK_COMPRESSION_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace BlockCompression
+{
+	namespace
+	{
+		// BC7 4-bit index interpolation weights, out of 64
+		const int bc7Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+		// Writes values into a block, least significant bit first
+		struct BitWriter
+		{
+			unsigned char* Bytes;
+			unsigned int Position;
+
+			void Write(unsigned int value, unsigned int bits)
+			{
+				for (unsigned int i = 0; i < bits; i++, Position++)
+				{
+					if (value & (1u << i))
+						Bytes[Position >> 3] |= (unsigned char)(1u << (Position & 7));
+				}
+			}
+		};
+
+		int Clamp(int v, int low, int high) { return v < low ? low : (v > high ? high : v); }
+
+#ifdef BLOCK_COMPRESSION_SSE2
+		// One point's channels in lanes, the rest 0
+		__m128 LoadPoint(const float* point, unsigned int channels)
+		{
+			return channels == 4 ? _mm_loadu_ps(point) : _mm_setr_ps(point[0], point[1], point[2], 0);
+		}
+
+		template<int Lane>
+		__m128 Splat(__m128 v)
+		{
+			return _mm_shuffle_ps(v, v, _MM_SHUFFLE(Lane, Lane, Lane, Lane));
+		}
+
+		float HorizontalMax(__m128 v)
+		{
+			v = _mm_max_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+			v = _mm_max_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+			return _mm_cvtss_f32(v);
+		}
+
+		float HorizontalMin(__m128 v)
+		{
+			v = _mm_min_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+			v = _mm_min_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+			return _mm_cvtss_f32(v);
+		}
+
+		// Exact, as the lanes only ever hold whole numbers under 2^24
+		int HorizontalSum(__m128 v)
+		{
+			v = _mm_add_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+			v = _mm_add_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+			return (int)_mm_cvtss_f32(v);
+		}
+
+		// Four RGBA8 pixels as one vector per channel, a pixel per lane
+		void LoadPixels(const unsigned char* pixels, __m128 channels[4])
+		{
+			__m128i zero = _mm_setzero_si128();
+			__m128i bytes = _mm_loadu_si128((const __m128i*)pixels);
+			__m128i low = _mm_unpacklo_epi8(bytes, zero);
+			__m128i high = _mm_unpackhi_epi8(bytes, zero);
+			channels[0] = _mm_cvtepi32_ps(_mm_unpacklo_epi16(low, zero));
+			channels[1] = _mm_cvtepi32_ps(_mm_unpackhi_epi16(low, zero));
+			channels[2] = _mm_cvtepi32_ps(_mm_unpacklo_epi16(high, zero));
+			channels[3] = _mm_cvtepi32_ps(_mm_unpackhi_epi16(high, zero));
+			_MM_TRANSPOSE4_PS(channels[0], channels[1], channels[2], channels[3]);
+		}
+
+		// Keeps the error and index of palette entry p in the lanes
+		// where it's strictly closer, so ties go to the lower index
+		// as in the plain loops
+		void KeepCloser(__m128 error, int p, __m128& bestError, __m128i& bestIndex)
+		{
+			__m128i closer = _mm_castps_si128(_mm_cmplt_ps(error, bestError));
+			bestError = _mm_min_ps(error, bestError);
+			bestIndex = _mm_or_si128(_mm_and_si128(closer, _mm_set1_epi32(p)), _mm_andnot_si128(closer, bestIndex));
+		}
+
+		void StoreIndices(__m128i bestIndex, unsigned char* indices)
+		{
+			alignas(16) int lanes[4];
+			_mm_store_si128((__m128i*)lanes, bestIndex);
+			for (int i = 0; i < 4; i++)
+				indices[i] = (unsigned char)lanes[i];
+		}
+#endif
+
+		// ----------------------------------------------------
+		// Finds the line through a set of points that best fits
+		// them (mean + principal axis, by power iteration) and
+		// returns its ends, the extreme projections onto it.
+		// The SSE2 path adds things up in the same order as the
+		// plain loops, so the two give the same ends exactly.
+		// ----------------------------------------------------
+		void FitLine(const float* points, unsigned int count, unsigned int channels, float* start, float* end)
+		{
+			float mean[4] = {};
+			float axis[4] = { 1, 1, 1, 1 };
+			float minT = 0, maxT = 0;
+
+#ifdef BLOCK_COMPRESSION_SSE2
+			__m128 sum = _mm_setzero_ps();
+			for (unsigned int i = 0; i < count; i++)
+				sum = _mm_add_ps(sum, LoadPoint(&points[i * channels], channels));
+			__m128 meanV = _mm_div_ps(sum, _mm_set1_ps((float)count));
+
+			// Row a of the covariance holds each channel times channel a
+			__m128 cov[4] = { _mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps() };
+			for (unsigned int i = 0; i < count; i++)
+			{
+				__m128 d = _mm_sub_ps(LoadPoint(&points[i * channels], channels), meanV);
+				cov[0] = _mm_add_ps(cov[0], _mm_mul_ps(d, Splat<0>(d)));
+				cov[1] = _mm_add_ps(cov[1], _mm_mul_ps(d, Splat<1>(d)));
+				cov[2] = _mm_add_ps(cov[2], _mm_mul_ps(d, Splat<2>(d)));
+				cov[3] = _mm_add_ps(cov[3], _mm_mul_ps(d, Splat<3>(d)));
+			}
+
+			__m128 axisV = channels == 4 ? _mm_set1_ps(1) : _mm_setr_ps(1, 1, 1, 0);
+			__m128 signBits = _mm_set1_ps(-0.0f);
+			for (int iteration = 0; iteration < 8; iteration++)
+			{
+				__m128 next = _mm_mul_ps(cov[0], Splat<0>(axisV));
+				next = _mm_add_ps(next, _mm_mul_ps(cov[1], Splat<1>(axisV)));
+				next = _mm_add_ps(next, _mm_mul_ps(cov[2], Splat<2>(axisV)));
+				if (channels == 4)
+					next = _mm_add_ps(next, _mm_mul_ps(cov[3], Splat<3>(axisV)));
+				float length = HorizontalMax(_mm_andnot_ps(signBits, next));
+
+				// Flat block: any axis will do
+				if (length == 0)
+					break;
+
+				axisV = _mm_div_ps(next, _mm_set1_ps(length));
+			}
+
+			// Projections four points at a time, a point per lane
+			__m128 minV = _mm_setzero_ps(), maxV = _mm_setzero_ps();
+			for (unsigned int i = 0; i < count; i += 4)
+			{
+				__m128 products[4];
+				for (unsigned int k = 0; k < 4; k++)
+				{
+					products[k] = i + k < count ?
+						_mm_mul_ps(_mm_sub_ps(LoadPoint(&points[(i + k) * channels], channels), meanV), axisV) :
+						_mm_setzero_ps();
+				}
+				_MM_TRANSPOSE4_PS(products[0], products[1], products[2], products[3]);
+				__m128 t = _mm_add_ps(_mm_add_ps(_mm_add_ps(products[0], products[1]), products[2]), products[3]);
+				minV = _mm_min_ps(minV, t);
+				maxV = _mm_max_ps(maxV, t);
+			}
+			minT = HorizontalMin(minV);
+			maxT = HorizontalMax(maxV);
+
+			_mm_storeu_ps(mean, meanV);
+			_mm_storeu_ps(axis, axisV);
+#else
+			for (unsigned int i = 0; i < count; i++)
+				for (unsigned int c = 0; c < channels; c++)
+					mean[c] += points[i * channels + c];
+			for (unsigned int c = 0; c < channels; c++)
+				mean[c] /= count;
+
+			float cov[4][4] = {};
+			for (unsigned int i = 0; i < count; i++)
+				for (unsigned int a = 0; a < channels; a++)
+					for (unsigned int b = 0; b < channels; b++)
+						cov[a][b] += (points[i * channels + a] - mean[a]) * (points[i * channels + b] - mean[b]);
+
+			for (int iteration = 0; iteration < 8; iteration++)
+			{
+				float next[4] = {};
+				float length = 0;
+				for (unsigned int a = 0; a < channels; a++)
+				{
+					for (unsigned int b = 0; b < channels; b++)
+						next[a] += cov[a][b] * axis[b];
+					length = std::max(length, std::fabs(next[a]));
+				}
+
+				// Flat block: any axis will do
+				if (length == 0)
+					break;
+
+				for (unsigned int a = 0; a < channels; a++)
+					axis[a] = next[a] / length;
+			}
+
+			for (unsigned int i = 0; i < count; i++)
+			{
+				float t = 0;
+				for (unsigned int c = 0; c < channels; c++)
+					t += (points[i * channels + c] - mean[c]) * axis[c];
+				minT = std::min(minT, t);
+				maxT = std::max(maxT, t);
+			}
+#endif
+
+			float lengthSq = 0;
+			for (unsigned int c = 0; c < channels; c++)
+				lengthSq += axis[c] * axis[c];
+			if (lengthSq > 0)
+			{
+				minT /= lengthSq;
+				maxT /= lengthSq;
+			}
+
+			for (unsigned int c = 0; c < channels; c++)
+			{
+				start[c] = std::clamp(mean[c] + axis[c] * minT, 0.0f, 255.0f);
+				end[c] = std::clamp(mean[c] + axis[c] * maxT, 0.0f, 255.0f);
+			}
+		}
+
+		// ----------------------------------------------------
+		// Least squares endpoints for fixed indices: each point
+		// is (1 - w) * start + w * end, for its index's weight.
+		// Returns false if the weights can't determine both ends.
+		// ----------------------------------------------------
+		bool RefineLine(const float* points, const float* weights, unsigned int count, unsigned int channels, float* start, float* end)
+		{
+			float aa = 0, ab = 0, bb = 0;
+			float ax[4] = {}, bx[4] = {};
+			for (unsigned int i = 0; i < count; i++)
+			{
+				float b = weights[i];
+				float a = 1 - b;
+				aa += a * a;
+				ab += a * b;
+				bb += b * b;
+				for (unsigned int c = 0; c < channels; c++)
+				{
+					ax[c] += a * points[i * channels + c];
+					bx[c] += b * points[i * channels + c];
+				}
+			}
+
+			float det = aa * bb - ab * ab;
+			if (std::fabs(det) < 1e-6f)
+				return false;
+
+			for (unsigned int c = 0; c < channels; c++)
+			{
+				start[c] = std::clamp((ax[c] * bb - bx[c] * ab) / det, 0.0f, 255.0f);
+				end[c] = std::clamp((bx[c] * aa - ax[c] * ab) / det, 0.0f, 255.0f);
+			}
+			return true;
+		}
+
+		// ----------------------------------------------------
+		// BC1
+		// ----------------------------------------------------
+		unsigned short Pack565(const float* c)
+		{
+			int r = Clamp((int)(c[0] * 31.0f / 255.0f + 0.5f), 0, 31);
+			int g = Clamp((int)(c[1] * 63.0f / 255.0f + 0.5f), 0, 63);
+			int b = Clamp((int)(c[2] * 31.0f / 255.0f + 0.5f), 0, 31);
+			return (unsigned short)((r << 11) | (g << 5) | b);
+		}
+
+		void Unpack565(unsigned short v, int* c)
+		{
+			int r = (v >> 11) & 31, g = (v >> 5) & 63, b = v & 31;
+			c[0] = (r << 3) | (r >> 2);
+			c[1] = (g << 2) | (g >> 4);
+			c[2] = (b << 3) | (b >> 2);
+		}
+
+		// Picks indices for a pair of 565 endpoints, returning the total error
+		int EncodeBC1Indices(const float* points, unsigned short c0, unsigned short c1, unsigned char* indices)
+		{
+			// Equal endpoints would switch to 3-color mode, where
+			// index 0 is still c0, so that's all that's needed
+			if (c0 == c1)
+			{
+				int c[3];
+				Unpack565(c0, c);
+				int error = 0;
+				for (int i = 0; i < 16; i++)
+				{
+					indices[i] = 0;
+					for (int ch = 0; ch < 3; ch++)
+					{
+						int d = (int)points[i * 3 + ch] - c[ch];
+						error += d * d;
+					}
+				}
+				return error;
+			}
+
+			int palette[4][3];
+			Unpack565(c0, palette[0]);
+			Unpack565(c1, palette[1]);
+			for (int ch = 0; ch < 3; ch++)
+			{
+				palette[2][ch] = (2 * palette[0][ch] + palette[1][ch]) / 3;
+				palette[3][ch] = (palette[0][ch] + 2 * palette[1][ch]) / 3;
+			}
+
+#ifdef BLOCK_COMPRESSION_SSE2
+			// Four pixels at a time, against each palette entry in turn
+			__m128 errors = _mm_setzero_ps();
+			for (int i = 0; i < 16; i += 4)
+			{
+				__m128 channels[3];
+				for (int ch = 0; ch < 3; ch++)
+					channels[ch] = _mm_setr_ps(points[i * 3 + ch], points[i * 3 + 3 + ch], points[i * 3 + 6 + ch], points[i * 3 + 9 + ch]);
+
+				__m128 bestError = _mm_set1_ps(1e30f);
+				__m128i bestIndex = _mm_setzero_si128();
+				for (int p = 0; p < 4; p++)
+				{
+					__m128 d = _mm_sub_ps(channels[0], _mm_set1_ps((float)palette[p][0]));
+					__m128 e = _mm_mul_ps(d, d);
+					d = _mm_sub_ps(channels[1], _mm_set1_ps((float)palette[p][1]));
+					e = _mm_add_ps(e, _mm_mul_ps(d, d));
+					d = _mm_sub_ps(channels[2], _mm_set1_ps((float)palette[p][2]));
+					e = _mm_add_ps(e, _mm_mul_ps(d, d));
+					KeepCloser(e, p, bestError, bestIndex);
+				}
+				StoreIndices(bestIndex, &indices[i]);
+				errors = _mm_add_ps(errors, bestError);
+			}
+			return HorizontalSum(errors);
+#else
+			int error = 0;
+			for (int i = 0; i < 16; i++)
+			{
+				int best = 0, bestError = INT32_MAX;
+				for (int p = 0; p < 4; p++)
+				{
+					int e = 0;
+					for (int ch = 0; ch < 3; ch++)
+					{
+						int d = (int)points[i * 3 + ch] - palette[p][ch];
+						e += d * d;
+					}
+					if (e < bestError) { bestError = e; best = p; }
+				}
+				indices[i] = (unsigned char)best;
+				error += bestError;
+			}
+			return error;
+#endif
+		}
+
+		// Quantizes a line to 565 in 4-color order (c0 > c1) and fits indices
+		int FitBC1(const float* points, const float* start, const float* end, unsigned short* c0, unsigned short* c1, unsigned char* indices)
+		{
+			unsigned short a = Pack565(end);
+			unsigned short b = Pack565(start);
+			if (a < b) std::swap(a, b);
+			*c0 = a;
+			*c1 = b;
+			return EncodeBC1Indices(points, a, b, indices);
+		}
+
+		void CompressBC1(const unsigned char* pixels, unsigned char* block)
+		{
+			float points[16 * 3];
+			for (int i = 0; i < 16; i++)
+				for (int c = 0; c < 3; c++)
+					points[i * 3 + c] = pixels[i * 4 + c];
+
+			float start[3], end[3];
+			FitLine(points, 16, 3, start, end);
+
+			unsigned short c0, c1;
+			unsigned char indices[16];
+			int error = FitBC1(points, start, end, &c0, &c1, indices);
+
+			// One refinement pass with the indices just chosen
+			if (c0 != c1)
+			{
+				const float bc1Weights[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+				float weights[16];
+				for (int i = 0; i < 16; i++)
+					weights[i] = bc1Weights[indices[i]];
+
+				if (RefineLine(points, weights, 16, 3, start, end))
+				{
+					unsigned short r0, r1;
+					unsigned char refined[16];
+					int refinedError = FitBC1(points, start, end, &r0, &r1, refined);
+					if (refinedError < error)
+					{
+						c0 = r0;
+						c1 = r1;
+						memcpy(indices, refined, sizeof(indices));
+					}
+				}
+			}
+
+			memset(block, 0, 8);
+			block[0] = (unsigned char)(c0 & 0xFF);
+			block[1] = (unsigned char)(c0 >> 8);
+			block[2] = (unsigned char)(c1 & 0xFF);
+			block[3] = (unsigned char)(c1 >> 8);
+
+			BitWriter bits = { block + 4, 0 };
+			for (int i = 0; i < 16; i++)
+				bits.Write(indices[i], 2);
+		}
+
+		// ----------------------------------------------------
+		// BC4 (and each half of BC5): one channel, 8 levels
+		// between the block's min and max
+		// ----------------------------------------------------
+		void CompressBC4(const unsigned char* pixels, unsigned int channel, unsigned char* block)
+		{
+#ifdef BLOCK_COMPRESSION_SSE2
+			__m128 values[4];
+			for (int i = 0; i < 4; i++)
+			{
+				__m128 channels[4];
+				LoadPixels(&pixels[i * 16], channels);
+				values[i] = channels[channel];
+			}
+			__m128 lowV = _mm_min_ps(_mm_min_ps(values[0], values[1]), _mm_min_ps(values[2], values[3]));
+			__m128 highV = _mm_max_ps(_mm_max_ps(values[0], values[1]), _mm_max_ps(values[2], values[3]));
+			int low = (int)HorizontalMin(lowV);
+			int high = (int)HorizontalMax(highV);
+#else
+			int low = 255, high = 0;
+			for (int i = 0; i < 16; i++)
+			{
+				low = std::min(low, (int)pixels[i * 4 + channel]);
+				high = std::max(high, (int)pixels[i * 4 + channel]);
+			}
+#endif
+
+			// With red0 > red1, index 0 is red0, 1 is red1 and
+			// 2-7 step evenly from red0 to red1
+			int palette[8];
+			palette[0] = high;
+			palette[1] = low;
+			for (int i = 2; i < 8; i++)
+				palette[i] = ((8 - i) * high + (i - 1) * low) / 7;
+
+			memset(block, 0, 8);
+			block[0] = (unsigned char)high;
+			block[1] = (unsigned char)low;
+
+			unsigned char indices[16] = {};
+#ifdef BLOCK_COMPRESSION_SSE2
+			__m128 signBits = _mm_set1_ps(-0.0f);
+			for (int i = 0; i < 4 && high != low; i++)
+			{
+				__m128 bestError = _mm_set1_ps(1e30f);
+				__m128i bestIndex = _mm_setzero_si128();
+				for (int p = 0; p < 8; p++)
+					KeepCloser(_mm_andnot_ps(signBits, _mm_sub_ps(values[i], _mm_set1_ps((float)palette[p]))), p, bestError, bestIndex);
+				StoreIndices(bestIndex, &indices[i * 4]);
+			}
+#else
+			for (int i = 0; i < 16; i++)
+			{
+				int v = pixels[i * 4 + channel];
+				int best = 0, bestError = INT32_MAX;
+				for (int p = 0; p < 8 && high != low; p++)
+				{
+					int e = std::abs(v - palette[p]);
+					if (e < bestError) { bestError = e; best = p; }
+				}
+				indices[i] = (unsigned char)best;
+			}
+#endif
+
+			BitWriter bits = { block + 2, 0 };
+			for (int i = 0; i < 16; i++)
+				bits.Write(indices[i], 3);
+		}
+
+		// ----------------------------------------------------
+		// BC7 mode 6
+		// ----------------------------------------------------
+		struct BC7Endpoint
+		{
+			int Color[4];	// 7 bits per channel
+			int P;			// Shared low bit
+		};
+
+		// Quantizes to 7 bits plus whichever P bit lands closer
+		BC7Endpoint QuantizeBC7(const float* c)
+		{
+			BC7Endpoint best = {};
+			float bestError = 1e30f;
+			for (int p = 0; p < 2; p++)
+			{
+				BC7Endpoint e = {};
+				e.P = p;
+				float error = 0;
+				for (int ch = 0; ch < 4; ch++)
+				{
+					e.Color[ch] = Clamp((int)std::floor((c[ch] - p) / 2.0f + 0.5f), 0, 127);
+					float d = (float)((e.Color[ch] << 1) | p) - c[ch];
+					error += d * d;
+				}
+				if (error < bestError) { bestError = error; best = e; }
+			}
+			return best;
+		}
+
+		int FitBC7Indices(const unsigned char* pixels, const BC7Endpoint& e0, const BC7Endpoint& e1, unsigned char* indices)
+		{
+			int palette[16][4];
+			for (int ch = 0; ch < 4; ch++)
+			{
+				int a = (e0.Color[ch] << 1) | e0.P;
+				int b = (e1.Color[ch] << 1) | e1.P;
+				for (int i = 0; i < 16; i++)
+					palette[i][ch] = ((64 - bc7Weights[i]) * a + bc7Weights[i] * b + 32) >> 6;
+			}
+
+#ifdef BLOCK_COMPRESSION_SSE2
+			// Four pixels at a time, against each palette entry in turn
+			__m128 paletteV[16][4];
+			for (int p = 0; p < 16; p++)
+				for (int ch = 0; ch < 4; ch++)
+					paletteV[p][ch] = _mm_set1_ps((float)palette[p][ch]);
+
+			__m128 errors = _mm_setzero_ps();
+			for (int i = 0; i < 16; i += 4)
+			{
+				__m128 channels[4];
+				LoadPixels(&pixels[i * 4], channels);
+
+				__m128 bestError = _mm_set1_ps(1e30f);
+				__m128i bestIndex = _mm_setzero_si128();
+				for (int p = 0; p < 16; p++)
+				{
+					__m128 d = _mm_sub_ps(channels[0], paletteV[p][0]);
+					__m128 e = _mm_mul_ps(d, d);
+					d = _mm_sub_ps(channels[1], paletteV[p][1]);
+					e = _mm_add_ps(e, _mm_mul_ps(d, d));
+					d = _mm_sub_ps(channels[2], paletteV[p][2]);
+					e = _mm_add_ps(e, _mm_mul_ps(d, d));
+					d = _mm_sub_ps(channels[3], paletteV[p][3]);
+					e = _mm_add_ps(e, _mm_mul_ps(d, d));
+					KeepCloser(e, p, bestError, bestIndex);
+				}
+				StoreIndices(bestIndex, &indices[i]);
+				errors = _mm_add_ps(errors, bestError);
+			}
+			return HorizontalSum(errors);
+#else
+			int error = 0;
+			for (int i = 0; i < 16; i++)
+			{
+				int best = 0, bestError = INT32_MAX;
+				for (int p = 0; p < 16; p++)
+				{
+					int e = 0;
+					for (int ch = 0; ch < 4; ch++)
+					{
+						int d = (int)pixels[i * 4 + ch] - palette[p][ch];
+						e += d * d;
+					}
+					if (e < bestError) { bestError = e; best = p; }
+				}
+				indices[i] = (unsigned char)best;
+				error += bestError;
+			}
+			return error;
+#endif
+		}
+
+		void CompressBC7(const unsigned char* pixels, unsigned char* block)
+		{
+			float points[16 * 4];
+			for (int i = 0; i < 64; i++)
+				points[i] = pixels[i];
+
+			float start[4], end[4];
+			FitLine(points, 16, 4, start, end);
+
+			BC7Endpoint e0 = QuantizeBC7(start);
+			BC7Endpoint e1 = QuantizeBC7(end);
+			unsigned char indices[16];
+			int error = FitBC7Indices(pixels, e0, e1, indices);
+
+			// One refinement pass with the indices just chosen
+			float weights[16];
+			for (int i = 0; i < 16; i++)
+				weights[i] = bc7Weights[indices[i]] / 64.0f;
+
+			if (RefineLine(points, weights, 16, 4, start, end))
+			{
+				BC7Endpoint r0 = QuantizeBC7(start);
+				BC7Endpoint r1 = QuantizeBC7(end);
+				unsigned char refined[16];
+				int refinedError = FitBC7Indices(pixels, r0, r1, refined);
+				if (refinedError < error)
+				{
+					e0 = r0;
+					e1 = r1;
+					memcpy(indices, refined, sizeof(indices));
+				}
+			}
+
+			// The first index is stored without its top bit, so it
+			// must be under 8.  Swapping the ends flips every index.
+			if (indices[0] & 8)
+			{
+				std::swap(e0, e1);
+				for (int i = 0; i < 16; i++)
+					indices[i] = 15 - indices[i];
+			}
+
+			memset(block, 0, 16);
+			BitWriter bits = { block, 0 };
+			bits.Write(1 << 6, 7); // Mode 6
+			for (int ch = 0; ch < 4; ch++)
+			{
+				bits.Write(e0.Color[ch], 7);
+				bits.Write(e1.Color[ch], 7);
+			}
+			bits.Write(e0.P, 1);
+			bits.Write(e1.P, 1);
+			bits.Write(indices[0], 3);
+			for (int i = 1; i < 16; i++)
+				bits.Write(indices[i], 4);
+		}
+
+		// Gathers a 4x4 block, repeating edge pixels past the image bounds
+		void ReadBlock(const BlockImage& image, unsigned int bx, unsigned int by, unsigned char* pixels)
+		{
+			for (unsigned int y = 0; y < 4; y++)
+			{
+				unsigned int sy = std::min(by * 4 + y, image.Height - 1);
+				for (unsigned int x = 0; x < 4; x++)
+				{
+					unsigned int sx = std::min(bx * 4 + x, image.Width - 1);
+					memcpy(&pixels[(y * 4 + x) * 4], &image.Pixels[((size_t)sy * image.Width + sx) * 4], 4);
+				}
+			}
+		}
+	}
+}
+
+unsigned int BlockCompression::GetBlockBytes(BlockCompressionFormat format)
+{
+	return (format == BLOCK_COMPRESSION_BC1 || format == BLOCK_COMPRESSION_BC4) ? 8 : 16;
+}
+
+unsigned int BlockCompression::GetDXGIFormat(BlockCompressionFormat format)
+{
+	switch (format)
+	{
+	case BLOCK_COMPRESSION_BC1: return 71; // DXGI_FORMAT_BC1_UNORM
+	case BLOCK_COMPRESSION_BC4: return 80; // DXGI_FORMAT_BC4_UNORM
+	case BLOCK_COMPRESSION_BC5: return 83; // DXGI_FORMAT_BC5_UNORM
+	case BLOCK_COMPRESSION_BC7: return 98; // DXGI_FORMAT_BC7_UNORM
+	default: return 0;
+	}
+}
+
+size_t BlockCompression::GetCompressedSize(BlockCompressionFormat format, unsigned int width, unsigned int height)
+{
+	size_t blocksWide = std::max(1u, (width + 3) / 4);
+	size_t blocksHigh = std::max(1u, (height + 3) / 4);
+	return blocksWide * blocksHigh * GetBlockBytes(format);
+}
+
+void BlockCompression::CompressBlock(BlockCompressionFormat format, const unsigned char pixels[64], unsigned char* block)
+{
+	switch (format)
+	{
+	case BLOCK_COMPRESSION_BC1: CompressBC1(pixels, block); break;
+	case BLOCK_COMPRESSION_BC4: CompressBC4(pixels, 0, block); break;
+	case BLOCK_COMPRESSION_BC5:
+		CompressBC4(pixels, 0, block);
+		CompressBC4(pixels, 1, block + 8);
+		break;
+	case BLOCK_COMPRESSION_BC7: CompressBC7(pixels, block); break;
+	}
+}
+
+// --------------------------------------------------------
+// Blocks are independent, so each thread takes its own
+// range of block rows and writes straight into the output
+// --------------------------------------------------------
+std::vector<unsigned char> BlockCompression::CompressImage(BlockCompressionFormat format, const BlockImage& image, unsigned int threadCount)
+{
+	unsigned int blocksWide = std::max(1u, (image.Width + 3) / 4);
+	unsigned int blocksHigh = std::max(1u, (image.Height + 3) / 4);
+	unsigned int blockBytes = GetBlockBytes(format);
+
+	std::vector<unsigned char> output((size_t)blocksWide * blocksHigh * blockBytes);
+	if (image.Width == 0 || image.Height == 0)
+		return output;
+
+	auto compressRows = [&](unsigned int firstRow, unsigned int endRow)
+	{
+		unsigned char pixels[64];
+		for (unsigned int by = firstRow; by < endRow; by++)
+		{
+			for (unsigned int bx = 0; bx < blocksWide; bx++)
+			{
+				ReadBlock(image, bx, by, pixels);
+				CompressBlock(format, pixels, &output[((size_t)by * blocksWide + bx) * blockBytes]);
+			}
+		}
+	};
+
+	threadCount = std::clamp(threadCount, 1u, blocksHigh);
+	if (threadCount == 1)
+	{
+		compressRows(0, blocksHigh);
+		return output;
+	}
+
+	std::vector<std::thread> threads;
+	unsigned int rowsPerThread = (blocksHigh + threadCount - 1) / threadCount;
+	for (unsigned int first = 0; first < blocksHigh; first += rowsPerThread)
+		threads.emplace_back(compressRows, first, std::min(first + rowsPerThread, blocksHigh));
+
+	for (std::thread& t : threads)
+		t.join();
+
+	return output;
+}
+
+// --------------------------------------------------------
+// The "DDS " magic, the legacy header with a DX10 fourCC,
+// then the DX10 header naming the DXGI format, then each
+// mip's blocks.  Always the DX10 form, so the format is
+// never ambiguous (BC4/BC5 have no unique legacy fourCC).
+// --------------------------------------------------------
+bool BlockCompression::SaveDDS(
+	const std::filesystem::path& path,
+	BlockCompressionFormat format,
+	unsigned int width,
+	unsigned int height,
+	const std::vector<std::vector<unsigned char>>& mips)
+{
+	uint32_t header[1 + 31 + 5] = {};
+	header[0] = 0x20534444;							// "DDS "
+	header[1] = 124;								// Header size
+	header[2] = 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000 | 0x80000; // Caps, height, width, pixel format, mip count, linear size
+	header[3] = height;
+	header[4] = width;
+	header[5] = (uint32_t)GetCompressedSize(format, width, height);
+	header[7] = (uint32_t)mips.size();
+	header[19] = 32;								// Pixel format size
+	header[20] = 0x4;								// FourCC
+	header[21] = 0x30315844;						// "DX10"
+	header[27] = 0x1000 | (mips.size() > 1 ? 0x8 | 0x400000 : 0); // Texture, complex & mipmap
+	header[32] = GetDXGIFormat(format);
+	header[33] = 3;									// Texture2D
+	header[35] = 1;									// Array size
+
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file)
+		return false;
+
+	file.write((const char*)header, sizeof(header));
+	for (const std::vector<unsigned char>& mip : mips)
+		file.write((const char*)mip.data(), (std::streamsize)mip.size());
+	return file.good();
+}
+
+bool BlockCompression::ReadDDSLayout(const std::filesystem::path& path, BlockDDSLayout* layout)
+{
+	std::ifstream file(path, std::ios::binary | std::ios::ate);
+	if (!file)
+		return false;
+	size_t fileSize = (size_t)file.tellg();
+
+	uint32_t header[1 + 31 + 5] = {};
+	file.seekg(0);
+	if (!file.read((char*)header, sizeof(header)) ||
+		header[0] != 0x20534444 ||		// "DDS "
+		header[21] != 0x30315844 ||		// "DX10"
+		header[33] != 3 ||				// Texture2D
+		header[35] != 1)				// Array size
+		return false;
+
+	// Only the formats this encoder writes
+	BlockCompressionFormat formats[] = { BLOCK_COMPRESSION_BC1, BLOCK_COMPRESSION_BC4, BLOCK_COMPRESSION_BC5, BLOCK_COMPRESSION_BC7 };
+	bool known = false;
+	for (BlockCompressionFormat format : formats)
+	{
+		if (GetDXGIFormat(format) == header[32])
+		{
+			layout->Format = format;
+			known = true;
+		}
+	}
+	if (!known)
+		return false;
+
+	layout->Width = header[4];
+	layout->Height = header[3];
+	layout->MipLevels = std::max(1u, header[7]);
+	if (layout->Width == 0 || layout->Height == 0 || layout->MipLevels > 32)
+		return false;
+
+	// Mips follow the headers back to back, largest first
+	layout->MipOffsets.resize(layout->MipLevels);
+	size_t offset = sizeof(header);
+	for (unsigned int mip = 0; mip < layout->MipLevels; mip++)
+	{
+		layout->MipOffsets[mip] = offset;
+		offset += GetCompressedSize(layout->Format, std::max(1u, layout->Width >> mip), std::max(1u, layout->Height >> mip));
+	}
+	return offset <= fileSize;
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <filesystem>
+#include <vector>
+
+// --------------------------------------------------------
+// Block compressed formats the encoder can write
+//  - BC1: RGB, 4 bits per pixel (alpha is ignored)
+//  - BC4: one channel (red), 4 bits per pixel
+//  - BC5: two channels (red & green), 8 bits per pixel
+//  - BC7: RGBA, 8 bits per pixel, best quality for color
+// --------------------------------------------------------
+enum BlockCompressionFormat
+{
+	BLOCK_COMPRESSION_BC1,
+	BLOCK_COMPRESSION_BC4,
+	BLOCK_COMPRESSION_BC5,
+	BLOCK_COMPRESSION_BC7
+};
+
+// --------------------------------------------------------
+// An uncompressed RGBA8 image, rows tightly packed
+// --------------------------------------------------------
+struct BlockImage
+{
+	unsigned int Width;
+	unsigned int Height;
+	std::vector<unsigned char> Pixels;
+};
+
+// --------------------------------------------------------
+// Where things are in a DDS file that SaveDDS wrote
+// --------------------------------------------------------
+struct BlockDDSLayout
+{
+	BlockCompressionFormat Format;
+	unsigned int Width;
+	unsigned int Height;
+	unsigned int MipLevels;
+	std::vector<size_t> MipOffsets; // From the start of the file
+};
+
+// --------------------------------------------------------
+// CPU encoder for BC1/4/5/7 textures, plus DDS files
+// for the results (see MipGenerator for the mip chains).
+// None of it depends on the graphics API, so it can run
+// offline as well as while importing textures.
+//
+// Each 4x4 block is fitted on its own: endpoints from the
+// block's principal axis, refined once by least squares.
+// BC7 only uses mode 6 (one subset, 7777.1 endpoints, 4 bit
+// indices), which is fast and does well on smooth textures.
+// The line fit and the palette searches run four pixels at
+// a time with SSE2 where the target has it, and give the
+// same blocks as the plain loops (which defining
+// BLOCK_COMPRESSION_NO_SIMD switches back to).
+// --------------------------------------------------------
+namespace BlockCompression
+{
+	// Bytes per 4x4 block (8 or 16) and the matching DXGI_FORMAT
+	unsigned int GetBlockBytes(BlockCompressionFormat format);
+	unsigned int GetDXGIFormat(BlockCompressionFormat format);
+	size_t GetCompressedSize(BlockCompressionFormat format, unsigned int width, unsigned int height);
+
+	// Encodes one block from 16 RGBA8 pixels, in rows
+	void CompressBlock(BlockCompressionFormat format, const unsigned char pixels[64], unsigned char* block);
+
+	// Encodes a whole image, rows of blocks split across threads.
+	// Partial blocks at the right & bottom edges repeat the edge pixels.
+	std::vector<unsigned char> CompressImage(BlockCompressionFormat format, const BlockImage& image, unsigned int threadCount);
+
+	// Writes compressed mips (largest first) as a DX10 DDS file
+	bool SaveDDS(
+		const std::filesystem::path& path,
+		BlockCompressionFormat format,
+		unsigned int width,
+		unsigned int height,
+		const std::vector<std::vector<unsigned char>>& mips);
+
+	// Reads just the header of a DDS file in the form SaveDDS
+	// writes, so single mips can be read from it later
+	bool ReadDDSLayout(const std::filesystem::path& path, BlockDDSLayout* layout);
+}
@@ -1,8 +1,23 @@
+// Taps for the largest radius (MAX_BLUR_TAPS in GaussianBlur.h)
+#define MAX_BLUR_TAPS 17
+
+#ifndef FUSE_COLOR
+#define FUSE_COLOR 0
+#endif
+
+#if FUSE_COLOR
+#include "ColorLUT.hlsli"
+#endif
+
+// One pass of a separable Gaussian blur, run once across and once
+// down.  Taps come from GaussianBlur::GetLinearTaps(), and each one
+// after the first reads two texels at once on both sides of the
+// center, placed between them so bilinear filtering weights them.
 cbuffer externalData : register(b0)
 {
-    int blurRadius;
-    float pixelWidth;
-    float pixelHeight;
+    float4 taps[MAX_BLUR_TAPS]; // x: offset in texels, y: weight
+    float2 texelStep;           // One texel along the pass, in UVs
+    int tapCount;
 }
 struct VertexToPixel
 {
@@ -14,22 +29,15 @@ SamplerState ClampSampler : register(s0);
 
 float4 main(VertexToPixel input) : SV_TARGET
 {
-    // Track the total color and number of samples
-    float4 total = 0;
-    int sampleCount = 0;
-    // Loop through the "box"
-    for (int x = -blurRadius; x <= blurRadius; x++)
+    float4 total = Pixels.Sample(ClampSampler, input.uv) * taps[0].y;
+    for (int i = 1; i < tapCount; i++)
     {
-        for (int y = -blurRadius; y <= blurRadius; y++)
-        {
-            // Calculate the uv for this sample
-            float2 uv = input.uv;
-            uv += float2(x * pixelWidth, y * pixelHeight);
-            // Add this color to the running total
-            total += Pixels.Sample(ClampSampler, uv);
-            sampleCount++;
-        }
+        float2 offset = texelStep * taps[i].x;
+        total += (Pixels.Sample(ClampSampler, input.uv + offset) +
+            Pixels.Sample(ClampSampler, input.uv - offset)) * taps[i].y;
     }
-    // Return the average
-    return total / sampleCount;
-}
\ No newline at end of file
+#if FUSE_COLOR
+    total = ApplyColor(total, input.position.xy);
+#endif
+    return total;
+}
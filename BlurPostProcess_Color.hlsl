@@ -0,0 +1,4 @@
+// A blur pass, then the color pipeline
+#define FUSE_COLOR 1
+
+#include "BlurPostProcess.hlsl"
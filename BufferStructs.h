@@ -1,9 +1,53 @@
 #pragma once
 #include <DirectXMath.h>
+#include "Lights.h"
+#include "SphericalHarmonics.h"
 
-struct VertexShaderData 
-{   
-	DirectX::XMFLOAT4X4 world;
+// --------------------------------------------------------
+// C++ mirror of the PerFrame cbuffer (register b0) in
+// ShaderBuffers.hlsli, which the game uploads once per
+// frame.  Members must keep HLSL packing: nothing may
+// straddle a 16-byte boundary.
+// --------------------------------------------------------
+struct PerFrameData
+{
 	DirectX::XMFLOAT4X4 view;
 	DirectX::XMFLOAT4X4 proj;
-};
\ No newline at end of file
+	DirectX::XMFLOAT4X4 lightView;
+	DirectX::XMFLOAT4X4 lightProj;
+	DirectX::XMFLOAT3 camPosition;
+	float time;
+	int lightCount;
+	float specularMipCount; // Roughness levels in the prefiltered sky
+	DirectX::XMFLOAT2 padding;
+	DirectX::XMFLOAT4 ambientSH[SH_COEFFICIENT_COUNT]; // See SphericalHarmonics::PackForShader()
+	Light lights[MAX_LIGHTS]; // Only the first lightCount are uploaded
+};
+
+// --------------------------------------------------------
+// C++ mirror of the PerObject cbuffer (register b2), used
+// when every object's data goes into the constant ring.
+// Exactly 256 bytes, so objects pack with no padding.
+// --------------------------------------------------------
+struct PerObjectData
+{
+	DirectX::XMFLOAT4X4 world;
+	DirectX::XMFLOAT4X4 worldInvTrans;
+	DirectX::XMFLOAT4X4 wvp;
+	DirectX::XMFLOAT4X4 lightWVP;
+};
+// --------------------------------------------------------
+// C++ mirror of the PerMaterial cbuffer (register b1).
+// Each material keeps one of these along with its own GPU
+// copy, which is only rewritten when the values change.
+// --------------------------------------------------------
+struct PerMaterialData
+{
+	DirectX::XMFLOAT4 colorTint;
+	DirectX::XMFLOAT2 textureScale;
+	DirectX::XMFLOAT2 textureOffset;
+	float roughness;
+	unsigned int albedoSlice;
+	unsigned int normalSlice;
+	unsigned int surfaceSlice;
+};
@@ -0,0 +1,137 @@
+#include "ChannelPacker.h"
+#include "PNGDecoder.h"
+#include <DirectXMath.h>
+#include <DirectXPackedVector.h>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+using namespace DirectX;
+using namespace DirectX::PackedVector;
+
+namespace
+{
+	XMVECTOR LoadPixel(const BlockImage& image, unsigned int x, unsigned int y)
+	{
+		return XMLoadUByteN4((const XMUBYTEN4*)&image.Pixels[((size_t)y * image.Width + x) * 4]);
+	}
+
+	// Bilinear sample of image at the center of pixel (x, y) of
+	// a width x height image covering the same area
+	XMVECTOR SamplePixel(const BlockImage& image, unsigned int x, unsigned int y, unsigned int width, unsigned int height)
+	{
+		float u = std::clamp((x + 0.5f) * image.Width / width - 0.5f, 0.0f, image.Width - 1.0f);
+		float v = std::clamp((y + 0.5f) * image.Height / height - 0.5f, 0.0f, image.Height - 1.0f);
+		unsigned int x0 = (unsigned int)u, y0 = (unsigned int)v;
+		unsigned int x1 = std::min(x0 + 1, image.Width - 1), y1 = std::min(y0 + 1, image.Height - 1);
+
+		XMVECTOR top = XMVectorLerp(LoadPixel(image, x0, y0), LoadPixel(image, x1, y0), u - x0);
+		XMVECTOR bottom = XMVectorLerp(LoadPixel(image, x0, y1), LoadPixel(image, x1, y1), u - x0);
+		return XMVectorLerp(top, bottom, v - y0);
+	}
+}
+
+// --------------------------------------------------------
+// Each pixel starts as the defaults, then takes the red of
+// each source in its own lane.  Converting through floats
+// and back is exact for 8-bit values.  Sources smaller than
+// the largest (often flat metalness maps) are stretched to
+// fit, bilinearly.
+// --------------------------------------------------------
+bool ChannelPacker::Pack(const BlockImage* sources[PACK_CHANNEL_COUNT], const unsigned char defaults[PACK_CHANNEL_COUNT], BlockImage* result)
+{
+	// With no sources at all, a single pixel of the defaults
+	result->Width = 1;
+	result->Height = 1;
+	for (int c = 0; c < PACK_CHANNEL_COUNT; c++)
+	{
+		if (!sources[c])
+			continue;
+		if (sources[c]->Width == 0 || sources[c]->Height == 0)
+			return false;
+		result->Width = std::max(result->Width, sources[c]->Width);
+		result->Height = std::max(result->Height, sources[c]->Height);
+	}
+	result->Pixels.resize((size_t)result->Width * result->Height * 4);
+
+	XMVECTOR masks[PACK_CHANNEL_COUNT] =
+	{
+		XMVectorSelectControl(1, 0, 0, 0),
+		XMVectorSelectControl(0, 1, 0, 0),
+		XMVectorSelectControl(0, 0, 1, 0),
+		XMVectorSelectControl(0, 0, 0, 1)
+	};
+	XMVECTOR base = XMVectorScale(XMVectorSet(defaults[0], defaults[1], defaults[2], defaults[3]), 1.0f / 255.0f);
+
+	for (unsigned int y = 0; y < result->Height; y++)
+	{
+		for (unsigned int x = 0; x < result->Width; x++)
+		{
+			XMVECTOR packed = base;
+			for (int c = 0; c < PACK_CHANNEL_COUNT; c++)
+			{
+				const BlockImage* source = sources[c];
+				if (!source)
+					continue;
+
+				XMVECTOR pixel = source->Width == result->Width && source->Height == result->Height ?
+					LoadPixel(*source, x, y) :
+					SamplePixel(*source, x, y, result->Width, result->Height);
+				packed = XMVectorSelect(packed, XMVectorSplatX(pixel), masks[c]);
+			}
+			XMStoreUByteN4((XMUBYTEN4*)&result->Pixels[((size_t)y * result->Width + x) * 4], packed);
+		}
+	}
+	return true;
+}
+
+bool ChannelPacker::Load(const ChannelPack& pack, BlockImage* result)
+{
+	BlockImage images[PACK_CHANNEL_COUNT] = {};
+	const BlockImage* sources[PACK_CHANNEL_COUNT] = {};
+	for (int c = 0; c < PACK_CHANNEL_COUNT; c++)
+	{
+		if (pack.Sources[c].empty())
+			continue;
+		if (!PNGDecoder::Load(pack.Sources[c], &images[c]))
+			return false;
+		sources[c] = &images[c];
+	}
+	return Pack(sources, pack.Defaults, result);
+}
+
+std::vector<ChannelPack> ChannelPacker::LoadManifest(const std::filesystem::path& path)
+{
+	std::vector<ChannelPack> packs;
+	std::ifstream file(path);
+	if (!file)
+		return packs;
+
+	std::filesystem::path folder = path.parent_path();
+	std::string line;
+	while (std::getline(file, line))
+	{
+		line = line.substr(0, line.find('#'));
+
+		std::istringstream columns(line);
+		std::string output;
+		if (!(columns >> output))
+			continue;
+
+		// Rough, not metal, not occluded
+		ChannelPack pack = {};
+		pack.Output = (folder / output).wstring();
+		pack.Defaults[PACK_CHANNEL_ROUGHNESS] = 255;
+		pack.Defaults[PACK_CHANNEL_METALNESS] = 0;
+		pack.Defaults[PACK_CHANNEL_OCCLUSION] = 255;
+		pack.Defaults[PACK_CHANNEL_UNUSED] = 255;
+
+		std::string source;
+		for (int c = 0; c < PACK_CHANNEL_UNUSED && columns >> source; c++)
+			if (source != "-")
+				pack.Sources[c] = (folder / source).wstring();
+
+		packs.push_back(pack);
+	}
+	return packs;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <filesystem>
+#include <string>
+#include <vector>
+#include "BlockCompression.h"
+
+// --------------------------------------------------------
+// What goes in each channel of a packed surface map
+//  - RED: roughness (also where Toksvig adjusts, see
+//    MipSettings::NormalMap)
+//  - GREEN: metalness
+//  - BLUE: ambient occlusion
+//  - ALPHA: unused, always opaque
+// --------------------------------------------------------
+enum PackChannel
+{
+	PACK_CHANNEL_ROUGHNESS,
+	PACK_CHANNEL_METALNESS,
+	PACK_CHANNEL_OCCLUSION,
+	PACK_CHANNEL_UNUSED,
+	PACK_CHANNEL_COUNT
+};
+
+// --------------------------------------------------------
+// One packed texture: the image each channel comes from
+// (its red channel), or, with no image, a constant value
+// --------------------------------------------------------
+struct ChannelPack
+{
+	std::wstring Output;
+	std::wstring Sources[PACK_CHANNEL_COUNT];
+	unsigned char Defaults[PACK_CHANNEL_COUNT];
+};
+
+// --------------------------------------------------------
+// Combines single channel maps into one texture, so the
+// shader reads them with one fetch instead of one each.
+//
+// Packs are listed in a manifest, one per line:
+//
+//   # packed              roughness             metalness        occlusion
+//   stone_surface.dds     stone_roughness.png   stone_metal.png  -
+//
+// Paths are relative to the manifest and can't hold spaces.
+// "-" (or leaving the column off) means no map, and # starts
+// a comment.  Maps left out are rough, not metal and not
+// occluded.
+//
+// Packing works on whole RGBA8 pixels with DirectXMath
+// vectors, and nothing here needs a graphics device, so
+// packs can be built by the game or by a batch tool (see
+// Tools/PackChannels.cpp).
+// --------------------------------------------------------
+namespace ChannelPacker
+{
+	// Sources are in channel order, null for channels that use
+	// their default.  The result is the size of the largest.
+	bool Pack(const BlockImage* sources[PACK_CHANNEL_COUNT], const unsigned char defaults[PACK_CHANNEL_COUNT], BlockImage* result);
+
+	// Loads each of the pack's sources (see PNGDecoder), then packs them
+	bool Load(const ChannelPack& pack, BlockImage* result);
+
+	// Reads a manifest, returning an empty list if it can't be opened
+	std::vector<ChannelPack> LoadManifest(const std::filesystem::path& path);
+}
@@ -0,0 +1,147 @@
+#include "ColorLUT.h"
+#include <DirectXPackedVector.h>
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <thread>
+
+using namespace DirectX;
+using namespace DirectX::PackedVector;
+
+namespace
+{
+	// Rec. 709 luminance weights, for saturation
+	const XMVECTORF32 Luminance = { { { 0.2126f, 0.7152f, 0.0722f, 0.0f } } };
+
+	XMVECTOR LoadTexel(const ColorLUTImage& lut, unsigned int r, unsigned int g, unsigned int b)
+	{
+		size_t index = ((size_t)b * lut.Size + g) * lut.Size + r;
+		return XMLoadUByteN4((const XMUBYTEN4*)&lut.Pixels[index * 4]);
+	}
+}
+
+XMVECTOR ColorLUT::Evaluate(const std::vector<ColorStep>& steps, FXMVECTOR linear)
+{
+	XMVECTOR color = XMVectorSaturate(linear);
+	for (const ColorStep& step : steps)
+	{
+		switch (step.Type)
+		{
+		case COLOR_STEP_SATURATION:
+			color = XMVectorLerp(XMVector3Dot(color, Luminance), color, step.Amount);
+			break;
+
+		case COLOR_STEP_GAMMA:
+			color = XMVectorPow(XMVectorMax(color, XMVectorZero()), XMVectorReplicate(step.Amount));
+			break;
+
+		case COLOR_STEP_PALETTE:
+		{
+			// First of equally near colors wins, as in the old shader loop
+			XMVECTOR nearest = color;
+			float shortest = FLT_MAX;
+			for (const XMFLOAT3& entry : step.Palette)
+			{
+				XMVECTOR candidate = XMLoadFloat3(&entry);
+				float distance = XMVectorGetX(XMVector3LengthSq(XMVectorSubtract(color, candidate)));
+				if (distance < shortest)
+				{
+					shortest = distance;
+					nearest = candidate;
+				}
+			}
+			color = nearest;
+			break;
+		}
+		}
+	}
+
+	// Opaque, in display range
+	return XMVectorSelect(g_XMOne, XMVectorSaturate(color), g_XMSelect1110);
+}
+
+// --------------------------------------------------------
+// Lattice point (r, g, b) holds the pipeline applied to
+// the linear color whose square root is (r, g, b) / (n - 1)
+// --------------------------------------------------------
+ColorLUTImage ColorLUT::Bake(const std::vector<ColorStep>& steps, unsigned int size, unsigned int threadCount)
+{
+	ColorLUTImage lut = {};
+	lut.Size = std::max(size, 2u);
+	lut.Pixels.resize((size_t)lut.Size * lut.Size * lut.Size * 4);
+
+	float scale = 1.0f / (lut.Size - 1);
+	auto bakeSlices = [&](unsigned int first, unsigned int end)
+	{
+		for (unsigned int b = first; b < end; b++)
+		{
+			for (unsigned int g = 0; g < lut.Size; g++)
+			{
+				for (unsigned int r = 0; r < lut.Size; r++)
+				{
+					XMVECTOR shaped = XMVectorScale(XMVectorSet((float)r, (float)g, (float)b, 0), scale);
+					XMVECTOR color = Evaluate(steps, XMVectorMultiply(shaped, shaped));
+					size_t index = ((size_t)b * lut.Size + g) * lut.Size + r;
+					XMStoreUByteN4((XMUBYTEN4*)&lut.Pixels[index * 4], color);
+				}
+			}
+		}
+	};
+
+	// Each thread takes a run of blue slices
+	threadCount = std::clamp(threadCount, 1u, lut.Size);
+	if (threadCount == 1)
+	{
+		bakeSlices(0, lut.Size);
+		return lut;
+	}
+
+	std::vector<std::thread> threads;
+	unsigned int slicesPerThread = (lut.Size + threadCount - 1) / threadCount;
+	for (unsigned int first = 0; first < lut.Size; first += slicesPerThread)
+		threads.emplace_back(bakeSlices, first, std::min(first + slicesPerThread, lut.Size));
+	for (std::thread& t : threads)
+		t.join();
+	return lut;
+}
+
+bool ColorLUT::IsDiscrete(const std::vector<ColorStep>& steps)
+{
+	return !steps.empty() && steps.back().Type == COLOR_STEP_PALETTE;
+}
+
+// --------------------------------------------------------
+// Matches ColorLUT.hlsli: a point sampler finds the nearest
+// lattice point, and a linear one blends the 8 around it
+// --------------------------------------------------------
+XMVECTOR ColorLUT::Lookup(const ColorLUTImage& lut, FXMVECTOR linear, float exposureScale, float offset, bool nearest)
+{
+	XMVECTOR shaped = XMVectorSqrt(XMVectorSaturate(XMVectorScale(linear, exposureScale)));
+	shaped = XMVectorSaturate(XMVectorAdd(shaped, XMVectorReplicate(offset)));
+	XMFLOAT3 position;
+	XMStoreFloat3(&position, XMVectorScale(shaped, (float)(lut.Size - 1)));
+
+	if (nearest)
+	{
+		return LoadTexel(lut,
+			(unsigned int)(position.x + 0.5f),
+			(unsigned int)(position.y + 0.5f),
+			(unsigned int)(position.z + 0.5f));
+	}
+
+	unsigned int r = std::min((unsigned int)position.x, lut.Size - 2);
+	unsigned int g = std::min((unsigned int)position.y, lut.Size - 2);
+	unsigned int b = std::min((unsigned int)position.z, lut.Size - 2);
+	float fr = position.x - r;
+	float fg = position.y - g;
+	float fb = position.z - b;
+
+	XMVECTOR slices[2];
+	for (unsigned int z = 0; z < 2; z++)
+	{
+		XMVECTOR lower = XMVectorLerp(LoadTexel(lut, r, g, b + z), LoadTexel(lut, r + 1, g, b + z), fr);
+		XMVECTOR upper = XMVectorLerp(LoadTexel(lut, r, g + 1, b + z), LoadTexel(lut, r + 1, g + 1, b + z), fr);
+		slices[z] = XMVectorLerp(lower, upper, fg);
+	}
+	return XMVectorLerp(slices[0], slices[1], fb);
+}
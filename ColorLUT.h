@@ -0,0 +1,76 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <vector>
+
+// Lattice points along each side of the LUT (must match ColorLUT.hlsli)
+#define COLOR_LUT_SIZE 32
+
+// --------------------------------------------------------
+// One step of the color pipeline, applied in order
+//  - SATURATION: mixed with its luminance by Amount; 0 is
+//    grey, 1 leaves it as it is
+//  - GAMMA: each channel to the power Amount (1 / 2.2
+//    encodes linear light for display)
+//  - PALETTE: the nearest of Palette's colors
+// --------------------------------------------------------
+enum ColorStepType
+{
+	COLOR_STEP_SATURATION,
+	COLOR_STEP_GAMMA,
+	COLOR_STEP_PALETTE
+};
+
+struct ColorStep
+{
+	ColorStepType Type;
+	float Amount;
+	std::vector<DirectX::XMFLOAT3> Palette;
+};
+
+// --------------------------------------------------------
+// A baked LUT: Size^3 RGBA8 texels, red varying fastest,
+// then green, then blue (a 3D texture's layout)
+// --------------------------------------------------------
+struct ColorLUTImage
+{
+	unsigned int Size;
+	std::vector<unsigned char> Pixels;
+};
+
+// --------------------------------------------------------
+// The display color pipeline, baked into a 3D LUT so the
+// post process does one volume fetch however many steps
+// there are.
+//
+// The lattice is spaced by the square root of linear color,
+// spending more of it on darks, where gamma is steepest, at
+// the cost of one sqrt in the shader.  Ordered dithering
+// offsets colors in that same space before the fetch.
+//
+// A pipeline ending in a palette has discrete results that
+// must not be blended, so its LUT is point sampled; others
+// are sampled trilinearly.
+//
+// Exposure isn't baked: the LUT only covers 0-1, so the
+// shader scales the scene's HDR color before clamping it
+// into that range, and a darker exposure can still bring
+// back highlights above 1.
+// --------------------------------------------------------
+namespace ColorLUT
+{
+	// The pipeline applied directly to one linear color (clamped to 0-1)
+	DirectX::XMVECTOR Evaluate(const std::vector<ColorStep>& steps, DirectX::FXMVECTOR linear);
+
+	// Evaluates every lattice point; blue slices are split across threads
+	ColorLUTImage Bake(const std::vector<ColorStep>& steps, unsigned int size, unsigned int threadCount);
+
+	// Whether a LUT of these steps should be point sampled
+	bool IsDiscrete(const std::vector<ColorStep>& steps);
+
+	// The shader's fetch, on the CPU, for checking a LUT against
+	// Evaluate(): color is scaled by exposureScale (2 to the power
+	// of the exposure) first, and offset is added in the lattice's
+	// space, as the dither does
+	DirectX::XMVECTOR Lookup(const ColorLUTImage& lut, DirectX::FXMVECTOR linear, float exposureScale, float offset, bool nearest);
+}
@@ -0,0 +1,51 @@
+#ifndef GGP_COLOR_LUT
+#define GGP_COLOR_LUT
+
+// Credit to Nikki Murello for helping me figure out dithering
+
+// The display color pipeline (gamma, grading and the dither
+// palette), baked by ColorLUT::Bake() into one volume, with
+// exposure and ordered dithering ahead of it.  As a function
+// so any post process can end with it (see PostProcessChain.h).
+cbuffer ColorData : register(b1)
+{
+    int ditherPixelSize; // Bayer cells cover blocks this many pixels wide
+    float ditherSpread;  // 0 for no dithering
+    float exposureScale; // 2 to the power of the exposure
+}
+
+// Lattice points along each side (COLOR_LUT_SIZE in ColorLUT.h)
+#define COLOR_LUT_SIZE 32
+
+// Point sampled when the pipeline ends in a palette
+Texture3D ColorLUT : register(t3);
+SamplerState ColorLUTSampler : register(s1);
+
+// Bayer array for dithering
+static const int Bayer4[4 * 4] =
+{
+    0, 8, 2, 10,
+    12, 4, 14, 6,
+    3, 11, 1, 9,
+    15, 7, 13, 5,
+};
+
+// Grades a linear color for display, given its pixel's coordinate
+// (SV_POSITION's xy).  Matches ColorLUT::Lookup().
+float4 ApplyColor(float4 color, float2 pixelCoord)
+{
+    // Get dither value, will be between -0.5 and 0.5
+    uint2 cell = uint2(pixelCoord / ditherPixelSize) % 4;
+    float ditherValue = Bayer4[4 * cell.y + cell.x];
+    ditherValue *= 1.0 / 16.0;
+    ditherValue -= 0.5;
+
+    // Exposure goes on the HDR color, before the LUT's 0-1 clamp.
+    // The lattice is spaced by the square root of linear color,
+    // close enough to display gamma for the dither to work in.
+    float3 shaped = saturate(sqrt(saturate(color.rgb * exposureScale)) + ditherValue * ditherSpread);
+    float3 coord = shaped * ((COLOR_LUT_SIZE - 1.0) / COLOR_LUT_SIZE) + 0.5 / COLOR_LUT_SIZE;
+    return float4(ColorLUT.SampleLevel(ColorLUTSampler, coord, 0).rgb, 1);
+}
+
+#endif
@@ -0,0 +1,15 @@
+#include "ColorLUT.hlsli"
+
+// The color pipeline on its own, when there's no pass before it to join
+struct VertexToPixel
+{
+    float4 position : SV_POSITION;
+    float2 uv : TEXCOORD0;
+};
+
+Texture2D Pixels : register(t0);
+
+float4 main(VertexToPixel input) : SV_TARGET
+{
+    return ApplyColor(Pixels.Load(int3(input.position.xy, 0)), input.position.xy);
+}
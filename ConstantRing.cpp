@@ -0,0 +1,185 @@
+#include "ConstantRing.h"
+#include <string.h>
+
+// --------------------------------------------------------
+// Creates the shared buffer and the queries used as fences
+// --------------------------------------------------------
+ConstantRing::ConstantRing(
+	Microsoft::WRL::ComPtr<ID3D11Device> device,
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
+	std::shared_ptr<StateCache> state,
+	unsigned int size) :
+	device(device),
+	context(context),
+	state(state),
+	allocator(size, CONSTANT_RING_ALIGNMENT),
+	uploadOffset(0),
+	uploadBytes(0),
+	frameIndex(1),
+	completedFrame(0)
+{
+	CreateBuffer(allocator.GetCapacity());
+
+	D3D11_QUERY_DESC queryDesc = {};
+	queryDesc.Query = D3D11_QUERY_EVENT;
+	for (unsigned int i = 0; i < CONSTANT_RING_MAX_FRAMES; i++)
+		device->CreateQuery(&queryDesc, frameQueries[i].GetAddressOf());
+}
+
+// --------------------------------------------------------
+// Binding by offset and appending to a dynamic constant
+// buffer while it's in use both need driver support
+// --------------------------------------------------------
+bool ConstantRing::IsSupported(Microsoft::WRL::ComPtr<ID3D11Device> device)
+{
+	D3D11_FEATURE_DATA_D3D11_OPTIONS options = {};
+	if (FAILED(device->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS, &options, sizeof(options))))
+		return false;
+
+	return options.ConstantBufferOffsetting && options.MapNoOverwriteOnDynamicConstantBuffer;
+}
+
+// --------------------------------------------------------
+// (Re)creates the GPU buffer.  A new buffer holds nothing the
+// GPU is waiting on, so the first write to it can discard.
+// --------------------------------------------------------
+void ConstantRing::CreateBuffer(unsigned int size)
+{
+	D3D11_BUFFER_DESC desc = {};
+	desc.Usage = D3D11_USAGE_DYNAMIC;
+	desc.ByteWidth = size;
+	desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	device->CreateBuffer(&desc, 0, buffer.ReleaseAndGetAddressOf());
+
+	discardNext = true;
+}
+
+// --------------------------------------------------------
+// Appends a block to this frame's staging data.  Each block
+// starts on its own 256-byte boundary so it can be bound by
+// offset, which means small blocks waste some space.
+// --------------------------------------------------------
+unsigned int ConstantRing::Push(const void* data, unsigned int size)
+{
+	Block block = {};
+	block.Offset = (unsigned int)staging.size();
+	block.Size = size;
+	blocks.push_back(block);
+
+	unsigned int aligned = (size + CONSTANT_RING_ALIGNMENT - 1) & ~(CONSTANT_RING_ALIGNMENT - 1);
+	staging.resize(staging.size() + aligned);
+	memcpy(&staging[block.Offset], data, size);
+
+	return (unsigned int)blocks.size() - 1;
+}
+
+// --------------------------------------------------------
+// Finds room for the whole frame and writes it in one Map().
+// When the ring is full the buffer is discarded instead,
+// which lets the driver hand back fresh memory rather than
+// waiting on the GPU.  A frame too big for the buffer grows it.
+// --------------------------------------------------------
+void ConstantRing::Upload()
+{
+	uploadBytes = 0;
+	if (staging.empty())
+		return;
+
+	unsigned int size = (unsigned int)staging.size();
+	if (size > allocator.GetCapacity())
+	{
+		unsigned int capacity = max(size, allocator.GetCapacity() * 2);
+		allocator = RingAllocator(capacity, CONSTANT_RING_ALIGNMENT);
+		CreateBuffer(allocator.GetCapacity());
+	}
+
+	PollCompletedFrames(false);
+	if (!allocator.Allocate(size, &uploadOffset))
+	{
+		allocator.Reset();
+		allocator.Allocate(size, &uploadOffset);
+		discardNext = true;
+	}
+
+	D3D11_MAP mapType = discardNext ? D3D11_MAP_WRITE_DISCARD : D3D11_MAP_WRITE_NO_OVERWRITE;
+	D3D11_MAPPED_SUBRESOURCE mapped = {};
+	if (FAILED(context->Map(buffer.Get(), 0, mapType, 0, &mapped)))
+		return;
+	memcpy((unsigned char*)mapped.pData + uploadOffset, &staging[0], size);
+	context->Unmap(buffer.Get(), 0);
+
+	discardNext = false;
+	uploadBytes = size;
+}
+
+// --------------------------------------------------------
+// Converts a handle into the constant range the 11.1 binding
+// calls expect.  Both values are in 16-byte constants and the
+// count is rounded up to a multiple of 16, as required.
+// --------------------------------------------------------
+void ConstantRing::GetRange(unsigned int handle, unsigned int* firstConstant, unsigned int* numConstants)
+{
+	const Block& block = blocks[handle];
+	*firstConstant = (uploadOffset + block.Offset) / 16;
+	*numConstants = ((block.Size + CONSTANT_RING_ALIGNMENT - 1) / CONSTANT_RING_ALIGNMENT) * (CONSTANT_RING_ALIGNMENT / 16);
+}
+
+void ConstantRing::BindVS(unsigned int slot, unsigned int handle)
+{
+	if (handle >= blocks.size()) return;
+	unsigned int first, count;
+	GetRange(handle, &first, &count);
+	state->SetVSConstantBuffer1(slot, buffer.Get(), first, count);
+}
+
+void ConstantRing::BindPS(unsigned int slot, unsigned int handle)
+{
+	if (handle >= blocks.size()) return;
+	unsigned int first, count;
+	GetRange(handle, &first, &count);
+	state->SetPSConstantBuffer1(slot, buffer.Get(), first, count);
+}
+
+// --------------------------------------------------------
+// Fences the frame's region with an event query and starts
+// a new frame.  If the GPU is so far behind that the oldest
+// query is still pending, this waits for it before reuse.
+// --------------------------------------------------------
+void ConstantRing::EndFrame()
+{
+	if (frameIndex - completedFrame > CONSTANT_RING_MAX_FRAMES)
+		PollCompletedFrames(true);
+
+	allocator.EndFrame(frameIndex);
+	context->End(frameQueries[frameIndex % CONSTANT_RING_MAX_FRAMES].Get());
+	frameIndex++;
+
+	staging.clear();
+	blocks.clear();
+}
+
+// --------------------------------------------------------
+// Walks the pending queries oldest first and frees the ring
+// space of every frame the GPU has finished with.  When
+// waiting, spins until the oldest pending frame is done.
+// --------------------------------------------------------
+void ConstantRing::PollCompletedFrames(bool wait)
+{
+	while (completedFrame + 1 < frameIndex)
+	{
+		ID3D11Query* query = frameQueries[(completedFrame + 1) % CONSTANT_RING_MAX_FRAMES].Get();
+		if (wait)
+		{
+			while (context->GetData(query, 0, 0, 0) == S_FALSE) {}
+			wait = false;
+		}
+		else if (context->GetData(query, 0, 0, D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK)
+		{
+			break;
+		}
+		completedFrame++;
+	}
+
+	allocator.Retire(completedFrame);
+}
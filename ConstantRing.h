@@ -0,0 +1,83 @@
+#pragma once
+
+#include <d3d11.h>
+#include <wrl/client.h>
+#include <memory>
+#include <vector>
+#include "RingAllocator.h"
+#include "StateCache.h"
+
+// Offsets passed to *SetConstantBuffers1() must be multiples of 16 constants
+#define CONSTANT_RING_ALIGNMENT		256
+
+// Frames the GPU may fall behind before the CPU waits on it
+#define CONSTANT_RING_MAX_FRAMES	4
+
+// --------------------------------------------------------
+// One large dynamic constant buffer that per-draw data is
+// appended to, instead of each shader owning a small buffer
+// that's rewritten before every draw.
+//
+// Each frame, constants are pushed on the CPU, sent to the
+// GPU with a single Map() in Upload(), then bound by offset.
+// Regions are reused once an event query shows the GPU has
+// finished the frame that used them, so writes are
+// NO_OVERWRITE and never stall.
+//
+// Needs D3D 11.1 constant buffer offsetting, see IsSupported()
+// --------------------------------------------------------
+class ConstantRing
+{
+public:
+	ConstantRing(
+		Microsoft::WRL::ComPtr<ID3D11Device> device,
+		Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
+		std::shared_ptr<StateCache> state,
+		unsigned int size);
+
+	static bool IsSupported(Microsoft::WRL::ComPtr<ID3D11Device> device);
+
+	// Stages data for this frame and returns a handle for binding
+	unsigned int Push(const void* data, unsigned int size);
+
+	// Copies everything staged this frame to the GPU
+	void Upload();
+
+	// Binds a pushed block (only valid after Upload)
+	void BindVS(unsigned int slot, unsigned int handle);
+	void BindPS(unsigned int slot, unsigned int handle);
+
+	// Call once per frame, after the last draw that uses the ring
+	void EndFrame();
+
+	unsigned int GetUploadBytes() { return uploadBytes; }
+
+private:
+	Microsoft::WRL::ComPtr<ID3D11Device> device;
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context;
+	std::shared_ptr<StateCache> state;
+
+	Microsoft::WRL::ComPtr<ID3D11Buffer> buffer;
+	RingAllocator allocator;
+	bool discardNext;
+
+	// This frame's data, uploaded as one contiguous block
+	struct Block
+	{
+		unsigned int Offset; // Into staging
+		unsigned int Size;
+	};
+	std::vector<unsigned char> staging;
+	std::vector<Block> blocks;
+	unsigned int uploadOffset; // Where staging landed in the buffer
+	unsigned int uploadBytes;
+
+	// Fences: one event query per frame in flight
+	Microsoft::WRL::ComPtr<ID3D11Query> frameQueries[CONSTANT_RING_MAX_FRAMES];
+	unsigned long long frameIndex;
+	unsigned long long completedFrame;
+
+	void CreateBuffer(unsigned int size);
+	void PollCompletedFrames(bool wait);
+	void GetRange(unsigned int handle, unsigned int* firstConstant, unsigned int* numConstants);
+};
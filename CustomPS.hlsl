@@ -1,10 +1,4 @@
-#include "ShaderStructs.hlsli"
-
-cbuffer ExternalData : register(b0)
-{
-    float4 colorTint;
-    float time;
-}
+#include "ShaderBuffers.hlsli"
 
 float4 main(VertexToPixel input) : SV_TARGET
 {        
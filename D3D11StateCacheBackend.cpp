@@ -0,0 +1,92 @@
+#include "D3D11StateCacheBackend.h"
+
+D3D11StateCacheBackend::D3D11StateCacheBackend(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context) :
+	context(context)
+{
+	context.As(&context1);
+}
+
+bool D3D11StateCacheBackend::SupportsConstantBufferOffsets()
+{
+	return context1 != 0;
+}
+
+void D3D11StateCacheBackend::VSSetShader(ID3D11VertexShader* shader)
+{
+	context->VSSetShader(shader, 0, 0);
+}
+
+void D3D11StateCacheBackend::PSSetShader(ID3D11PixelShader* shader)
+{
+	context->PSSetShader(shader, 0, 0);
+}
+
+void D3D11StateCacheBackend::IASetInputLayout(ID3D11InputLayout* layout)
+{
+	context->IASetInputLayout(layout);
+}
+
+void D3D11StateCacheBackend::IASetPrimitiveTopology(unsigned int topology)
+{
+	context->IASetPrimitiveTopology((D3D11_PRIMITIVE_TOPOLOGY)topology);
+}
+
+void D3D11StateCacheBackend::IASetVertexBuffer(unsigned int slot, ID3D11Buffer* buffer, unsigned int stride, unsigned int offset)
+{
+	context->IASetVertexBuffers(slot, 1, &buffer, &stride, &offset);
+}
+
+void D3D11StateCacheBackend::IASetIndexBuffer(ID3D11Buffer* buffer, unsigned int format, unsigned int offset)
+{
+	context->IASetIndexBuffer(buffer, (DXGI_FORMAT)format, offset);
+}
+
+void D3D11StateCacheBackend::VSSetConstantBuffer(unsigned int slot, ID3D11Buffer* buffer)
+{
+	context->VSSetConstantBuffers(slot, 1, &buffer);
+}
+
+void D3D11StateCacheBackend::PSSetConstantBuffer(unsigned int slot, ID3D11Buffer* buffer)
+{
+	context->PSSetConstantBuffers(slot, 1, &buffer);
+}
+
+void D3D11StateCacheBackend::VSSetConstantBuffer1(unsigned int slot, ID3D11Buffer* buffer, unsigned int firstConstant, unsigned int numConstants)
+{
+	context1->VSSetConstantBuffers1(slot, 1, &buffer, &firstConstant, &numConstants);
+}
+
+void D3D11StateCacheBackend::PSSetConstantBuffer1(unsigned int slot, ID3D11Buffer* buffer, unsigned int firstConstant, unsigned int numConstants)
+{
+	context1->PSSetConstantBuffers1(slot, 1, &buffer, &firstConstant, &numConstants);
+}
+
+void D3D11StateCacheBackend::VSSetShaderResources(unsigned int startSlot, unsigned int count, ID3D11ShaderResourceView* const* srvs)
+{
+	context->VSSetShaderResources(startSlot, count, srvs);
+}
+
+void D3D11StateCacheBackend::PSSetShaderResources(unsigned int startSlot, unsigned int count, ID3D11ShaderResourceView* const* srvs)
+{
+	context->PSSetShaderResources(startSlot, count, srvs);
+}
+
+void D3D11StateCacheBackend::VSSetSampler(unsigned int slot, ID3D11SamplerState* sampler)
+{
+	context->VSSetSamplers(slot, 1, &sampler);
+}
+
+void D3D11StateCacheBackend::PSSetSampler(unsigned int slot, ID3D11SamplerState* sampler)
+{
+	context->PSSetSamplers(slot, 1, &sampler);
+}
+
+void D3D11StateCacheBackend::RSSetState(ID3D11RasterizerState* state)
+{
+	context->RSSetState(state);
+}
+
+void D3D11StateCacheBackend::OMSetDepthStencilState(ID3D11DepthStencilState* state, unsigned int stencilRef)
+{
+	context->OMSetDepthStencilState(state, stencilRef);
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <d3d11.h>
+#include <d3d11_1.h>
+#include <wrl/client.h>
+#include "StateCache.h"
+
+// --------------------------------------------------------
+// Sends a StateCache's binds straight to a device context
+// --------------------------------------------------------
+class D3D11StateCacheBackend : public StateCacheBackend
+{
+public:
+	D3D11StateCacheBackend(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context);
+
+	bool SupportsConstantBufferOffsets();
+
+	void VSSetShader(ID3D11VertexShader* shader);
+	void PSSetShader(ID3D11PixelShader* shader);
+	void IASetInputLayout(ID3D11InputLayout* layout);
+	void IASetPrimitiveTopology(unsigned int topology);
+	void IASetVertexBuffer(unsigned int slot, ID3D11Buffer* buffer, unsigned int stride, unsigned int offset);
+	void IASetIndexBuffer(ID3D11Buffer* buffer, unsigned int format, unsigned int offset);
+
+	void VSSetConstantBuffer(unsigned int slot, ID3D11Buffer* buffer);
+	void PSSetConstantBuffer(unsigned int slot, ID3D11Buffer* buffer);
+	void VSSetConstantBuffer1(unsigned int slot, ID3D11Buffer* buffer, unsigned int firstConstant, unsigned int numConstants);
+	void PSSetConstantBuffer1(unsigned int slot, ID3D11Buffer* buffer, unsigned int firstConstant, unsigned int numConstants);
+	void VSSetShaderResources(unsigned int startSlot, unsigned int count, ID3D11ShaderResourceView* const* srvs);
+	void PSSetShaderResources(unsigned int startSlot, unsigned int count, ID3D11ShaderResourceView* const* srvs);
+	void VSSetSampler(unsigned int slot, ID3D11SamplerState* sampler);
+	void PSSetSampler(unsigned int slot, ID3D11SamplerState* sampler);
+
+	void RSSetState(ID3D11RasterizerState* state);
+	void OMSetDepthStencilState(ID3D11DepthStencilState* state, unsigned int stencilRef);
+
+private:
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context;
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext1> context1; // For constant buffer offsets, if available
+};
@@ -0,0 +1,51 @@
+// Averages each downscale x downscale block of the scene into one
+// texel of a reduced target, along with its linear depth, which
+// BilateralUpsample.hlsl compares against on the way back up.
+// Matches PostResample::Downsample() and DownsampleDepth().
+cbuffer externalData : register(b0)
+{
+    int downscale;
+    float2 depthParams; // Projection _33 and _43, to linearize depth
+}
+
+struct VertexToPixel
+{
+    float4 position : SV_POSITION;
+    float2 uv : TEXCOORD0;
+};
+
+struct PixelOutput
+{
+    float4 color : SV_TARGET0;
+    float depth : SV_TARGET1;
+};
+
+Texture2D Pixels : register(t0);
+Texture2D<float> Depth : register(t1);
+
+PixelOutput main(VertexToPixel input)
+{
+    uint2 size;
+    Pixels.GetDimensions(size.x, size.y);
+
+    // This texel's block, clipped at the right and bottom edges
+    uint2 start = uint2(input.position.xy) * downscale;
+    uint2 end = min(start + downscale, size);
+
+    PixelOutput output;
+    output.color = 0;
+    output.depth = 0;
+    for (uint y = start.y; y < end.y; y++)
+    {
+        for (uint x = start.x; x < end.x; x++)
+        {
+            output.color += Pixels.Load(int3(x, y, 0));
+            output.depth += depthParams.y / (Depth.Load(int3(x, y, 0)) - depthParams.x);
+        }
+    }
+
+    float count = (end.x - start.x) * (end.y - start.y);
+    output.color /= count;
+    output.depth /= count;
+    return output;
+}
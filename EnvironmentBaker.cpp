@@ -0,0 +1,435 @@
+#include "EnvironmentBaker.h"
+#include "MipGenerator.h"
+#include <DirectXMath.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <thread>
+
+using namespace DirectX;
+
+namespace
+{
+	// DXGI_FORMAT values, without needing the graphics API's headers
+	const uint32_t formatRGBA8SRGB = 29;	// DXGI_FORMAT_R8G8B8A8_UNORM_SRGB
+	const uint32_t formatRG16 = 35;			// DXGI_FORMAT_R16G16_UNORM
+
+	// Built on first use (thread safe, as a function-local static)
+	struct SRGBTable
+	{
+		float ToLinear[256];
+
+		SRGBTable()
+		{
+			for (int i = 0; i < 256; i++)
+			{
+				float c = i / 255.0f;
+				ToLinear[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+			}
+		}
+	};
+	const float* SRGBToLinearTable() { static const SRGBTable table; return table.ToLinear; }
+
+	unsigned char LinearToSRGB(float c)
+	{
+		c = std::clamp(c, 0.0f, 1.0f);
+		c = c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1 / 2.4f) - 0.055f;
+		return (unsigned char)(c * 255 + 0.5f);
+	}
+
+	// Runs fn over [first, end) row ranges, on several threads when it's worth it
+	template<typename Fn>
+	void ForRows(unsigned int rows, unsigned int threadCount, Fn fn)
+	{
+		const unsigned int minRowsPerThread = 8;
+		threadCount = std::clamp(rows / minRowsPerThread, 1u, std::max(1u, threadCount));
+		if (threadCount == 1)
+		{
+			fn(0u, rows);
+			return;
+		}
+
+		std::vector<std::thread> threads;
+		unsigned int rowsPerThread = (rows + threadCount - 1) / threadCount;
+		for (unsigned int first = 0; first < rows; first += rowsPerThread)
+			threads.emplace_back(fn, first, std::min(first + rowsPerThread, rows));
+		for (std::thread& t : threads)
+			t.join();
+	}
+
+	// Point i of n in the Hammersley set, well spread over the unit square
+	XMFLOAT2 Hammersley(unsigned int i, unsigned int n)
+	{
+		uint32_t bits = i;
+		bits = (bits << 16) | (bits >> 16);
+		bits = ((bits & 0x55555555u) << 1) | ((bits & 0xAAAAAAAAu) >> 1);
+		bits = ((bits & 0x33333333u) << 2) | ((bits & 0xCCCCCCCCu) >> 2);
+		bits = ((bits & 0x0F0F0F0Fu) << 4) | ((bits & 0xF0F0F0F0u) >> 4);
+		bits = ((bits & 0x00FF00FFu) << 8) | ((bits & 0xFF00FF00u) >> 8);
+		return XMFLOAT2((float)i / n, bits * 2.3283064365386963e-10f);
+	}
+
+	// A half vector around +Z, distributed like GGX with
+	// alpha = roughness^2 (as in D_GGX() in PBRFuncs.hlsli)
+	XMVECTOR ImportanceSampleGGX(XMFLOAT2 xi, float alpha)
+	{
+		float phi = XM_2PI * xi.x;
+		float cosTheta = std::sqrt((1 - xi.y) / (1 + (alpha * alpha - 1) * xi.y));
+		float sinTheta = std::sqrt(1 - cosTheta * cosTheta);
+		return XMVectorSet(sinTheta * std::cos(phi), sinTheta * std::sin(phi), cosTheta, 0);
+	}
+
+	float DistributionGGX(float NdotH, float alpha)
+	{
+		float a2 = alpha * alpha;
+		float denom = NdotH * NdotH * (a2 - 1) + 1;
+		return a2 / (XM_PI * denom * denom);
+	}
+
+	// Direction through (u, v), each -1 to 1 across the face
+	// (v downward), in the D3D cube map convention
+	XMVECTOR FaceDirection(int face, float u, float v)
+	{
+		switch (face)
+		{
+		case 0: return XMVectorSet(1, -v, -u, 0);
+		case 1: return XMVectorSet(-1, -v, u, 0);
+		case 2: return XMVectorSet(u, 1, v, 0);
+		case 3: return XMVectorSet(u, -1, -v, 0);
+		case 4: return XMVectorSet(u, -v, 1, 0);
+		default: return XMVectorSet(-u, -v, -1, 0);
+		}
+	}
+
+	// --------------------------------------------------------
+	// The source cube map with a box filtered mip chain per
+	// face, sampled trilinearly.  Bilinear filtering clamps at
+	// each face's edges rather than reaching across seams.
+	// --------------------------------------------------------
+	struct SourceCube
+	{
+		unsigned int Size;
+		std::vector<BlockImage> Levels[6];
+
+		XMVECTOR Fetch(int face, unsigned int level, int x, int y) const
+		{
+			const BlockImage& image = Levels[face][level];
+			x = std::clamp(x, 0, (int)image.Width - 1);
+			y = std::clamp(y, 0, (int)image.Height - 1);
+			const unsigned char* texel = &image.Pixels[((size_t)y * image.Width + x) * 4];
+			const float* srgb = SRGBToLinearTable();
+			return XMVectorSet(srgb[texel[0]], srgb[texel[1]], srgb[texel[2]], 1);
+		}
+
+		XMVECTOR SampleLevel(int face, unsigned int level, float u, float v) const
+		{
+			const BlockImage& image = Levels[face][level];
+			float x = (u + 1) * 0.5f * image.Width - 0.5f;
+			float y = (v + 1) * 0.5f * image.Height - 0.5f;
+			float x0 = std::floor(x), y0 = std::floor(y);
+			int ix = (int)x0, iy = (int)y0;
+
+			XMVECTOR top = XMVectorLerp(Fetch(face, level, ix, iy), Fetch(face, level, ix + 1, iy), x - x0);
+			XMVECTOR bottom = XMVectorLerp(Fetch(face, level, ix, iy + 1), Fetch(face, level, ix + 1, iy + 1), x - x0);
+			return XMVectorLerp(top, bottom, y - y0);
+		}
+
+		XMVECTOR Sample(XMVECTOR direction, float lod) const
+		{
+			XMFLOAT3 d;
+			XMStoreFloat3(&d, direction);
+			float ax = std::abs(d.x), ay = std::abs(d.y), az = std::abs(d.z);
+
+			// The inverse of FaceDirection()
+			int face;
+			float u, v;
+			if (ax >= ay && ax >= az)
+			{
+				face = d.x > 0 ? 0 : 1;
+				u = (d.x > 0 ? -d.z : d.z) / ax;
+				v = -d.y / ax;
+			}
+			else if (ay >= az)
+			{
+				face = d.y > 0 ? 2 : 3;
+				u = d.x / ay;
+				v = (d.y > 0 ? d.z : -d.z) / ay;
+			}
+			else
+			{
+				face = d.z > 0 ? 4 : 5;
+				u = (d.z > 0 ? d.x : -d.x) / az;
+				v = -d.y / az;
+			}
+
+			unsigned int levelCount = (unsigned int)Levels[face].size();
+			lod = std::clamp(lod, 0.0f, levelCount - 1.0f);
+			unsigned int level = (unsigned int)lod;
+			XMVECTOR color = SampleLevel(face, level, u, v);
+			if (level + 1 < levelCount && lod > level)
+				color = XMVectorLerp(color, SampleLevel(face, level + 1, u, v), lod - level);
+			return color;
+		}
+	};
+
+	// One GGX sample for a mip, in tangent space (N = V = +Z),
+	// which doesn't depend on the texel
+	struct LobeSample
+	{
+		XMFLOAT3 L;
+		float NdotL;
+		float Lod;	// Source mip to read, from the sample's solid angle
+	};
+
+	// --------------------------------------------------------
+	// Writes an uncompressed .dds with a DX10 header: a 2D
+	// texture, or a cube map whose images go face by face
+	// --------------------------------------------------------
+	bool WriteDDS(const std::filesystem::path& path, uint32_t format, uint32_t bytesPerPixel, unsigned int width, unsigned int height, unsigned int mipCount, bool cube, const std::vector<const std::vector<unsigned char>*>& images)
+	{
+		uint32_t header[1 + 31 + 5] = {};
+		header[0] = 0x20534444;							// "DDS "
+		header[1] = 124;								// Header size
+		header[2] = 0x1 | 0x2 | 0x4 | 0x8 | 0x1000 | 0x20000; // Caps, height, width, pitch, pixel format, mip count
+		header[3] = height;
+		header[4] = width;
+		header[5] = width * bytesPerPixel;
+		header[7] = mipCount;
+		header[19] = 32;								// Pixel format size
+		header[20] = 0x4;								// FourCC
+		header[21] = 0x30315844;						// "DX10"
+		header[27] = 0x1000 | (mipCount > 1 || cube ? 0x8 : 0) | (mipCount > 1 ? 0x400000 : 0); // Texture, complex & mipmap
+		header[28] = cube ? 0x200 | 0xFC00 : 0;			// Cube map, with all six faces
+		header[32] = format;
+		header[33] = 3;									// Texture2D
+		header[34] = cube ? 0x4 : 0;					// Texture cube
+		header[35] = 1;									// Array size
+
+		std::ofstream file(path, std::ios::binary | std::ios::trunc);
+		if (!file)
+			return false;
+
+		file.write((const char*)header, sizeof(header));
+		for (const std::vector<unsigned char>* image : images)
+			file.write((const char*)image->data(), (std::streamsize)image->size());
+		return file.good();
+	}
+}
+
+// --------------------------------------------------------
+// Every texel of mip m gathers SampleCount GGX samples
+// around its own direction, at roughness m / (MipLevels-1),
+// weighted by n dot l.  With n = v = r, the samples are the
+// same for every texel up to rotation, so they're worked out
+// once per mip.  Mip 0 is a mirror, so just reads the source
+// at the matching resolution.
+// --------------------------------------------------------
+PrefilteredEnvironment EnvironmentBaker::Prefilter(const BlockImage* faces[6], const EnvironmentSettings& settings, unsigned int threadCount)
+{
+	PrefilteredEnvironment result = {};
+	result.Size = std::max(settings.Size, 1u);
+	result.MipLevels = std::clamp(settings.MipLevels, 1u, MipGenerator::GetMipCount(result.Size, result.Size));
+	result.Images.resize(6 * (size_t)result.MipLevels);
+
+	// Every face takes its size from the first one there
+	SourceCube source = {};
+	for (int f = 0; f < 6 && source.Size == 0; f++)
+		if (faces[f] && faces[f]->Width > 0 && faces[f]->Width == faces[f]->Height)
+			source.Size = faces[f]->Width;
+	if (source.Size == 0)
+		source.Size = 1;
+
+	BlockImage black = {};
+	black.Width = black.Height = source.Size;
+	black.Pixels.resize((size_t)source.Size * source.Size * 4, 0);
+
+	MipSettings mipSettings = { MIP_FILTER_BOX, MIP_CONTENT_SRGB, 0 };
+	for (int f = 0; f < 6; f++)
+	{
+		bool usable = faces[f] && faces[f]->Width == source.Size && faces[f]->Height == source.Size;
+		source.Levels[f] = MipGenerator::Generate(usable ? *faces[f] : black, mipSettings, threadCount);
+	}
+
+	unsigned int sampleCount = std::max(settings.SampleCount, 1u);
+	float sourceTexelAngle = 4 * XM_PI / (6.0f * source.Size * source.Size);
+
+	for (unsigned int mip = 0; mip < result.MipLevels; mip++)
+	{
+		unsigned int size = std::max(result.Size >> mip, 1u);
+		float roughness = result.MipLevels > 1 ? (float)mip / (result.MipLevels - 1) : 0.0f;
+		float alpha = roughness * roughness;
+
+		std::vector<LobeSample> lobe;
+		if (mip > 0)
+		{
+			for (unsigned int i = 0; i < sampleCount; i++)
+			{
+				XMVECTOR H = ImportanceSampleGGX(Hammersley(i, sampleCount), alpha);
+				float NdotH = XMVectorGetZ(H);
+				XMVECTOR L = XMVectorSubtract(XMVectorScale(H, 2 * NdotH), XMVectorSet(0, 0, 1, 0));
+
+				LobeSample s = {};
+				XMStoreFloat3(&s.L, L);
+				s.NdotL = s.L.z;
+				if (s.NdotL <= 0)
+					continue;
+
+				// pdf of l is D * NdotH / (4 VdotH), and v = n
+				float pdf = DistributionGGX(NdotH, alpha) / 4;
+				float sampleAngle = 1 / (sampleCount * pdf + 0.0001f);
+				s.Lod = std::max(0.5f * std::log2(sampleAngle / sourceTexelAngle) + 1, 0.0f);
+				lobe.push_back(s);
+			}
+		}
+
+		// The mirror mip reads the source mip closest to its own size
+		float mirrorLod = std::log2((float)source.Size / size);
+
+		for (int f = 0; f < 6; f++)
+		{
+			BlockImage& image = result.Images[f * (size_t)result.MipLevels + mip];
+			image.Width = image.Height = size;
+			image.Pixels.resize((size_t)size * size * 4);
+		}
+
+		ForRows(size * 6, threadCount, [&](unsigned int first, unsigned int end)
+		{
+			for (unsigned int row = first; row < end; row++)
+			{
+				int f = row / size;
+				unsigned int y = row % size;
+				BlockImage& image = result.Images[f * (size_t)result.MipLevels + mip];
+
+				for (unsigned int x = 0; x < size; x++)
+				{
+					XMVECTOR N = XMVector3Normalize(FaceDirection(f, (x + 0.5f) * 2 / size - 1, (y + 0.5f) * 2 / size - 1));
+
+					XMVECTOR color;
+					if (lobe.empty())
+					{
+						color = source.Sample(N, mirrorLod);
+					}
+					else
+					{
+						// Tangent space around N
+						XMVECTOR up = std::abs(XMVectorGetZ(N)) < 0.999f ? XMVectorSet(0, 0, 1, 0) : XMVectorSet(1, 0, 0, 0);
+						XMVECTOR T = XMVector3Normalize(XMVector3Cross(up, N));
+						XMVECTOR B = XMVector3Cross(N, T);
+
+						color = XMVectorZero();
+						float weight = 0;
+						for (const LobeSample& s : lobe)
+						{
+							XMVECTOR L = XMVectorMultiplyAdd(T, XMVectorReplicate(s.L.x),
+								XMVectorMultiplyAdd(B, XMVectorReplicate(s.L.y), XMVectorScale(N, s.L.z)));
+							color = XMVectorMultiplyAdd(source.Sample(L, s.Lod), XMVectorReplicate(s.NdotL), color);
+							weight += s.NdotL;
+						}
+						color = XMVectorScale(color, 1 / weight);
+					}
+
+					XMFLOAT4 c;
+					XMStoreFloat4(&c, color);
+					unsigned char* texel = &image.Pixels[((size_t)y * size + x) * 4];
+					texel[0] = LinearToSRGB(c.x);
+					texel[1] = LinearToSRGB(c.y);
+					texel[2] = LinearToSRGB(c.z);
+					texel[3] = 255;
+				}
+			}
+		});
+	}
+	return result;
+}
+
+// --------------------------------------------------------
+// Integrates the specular BRDF, less F0, over the GGX lobe
+// for a view at each n dot v and roughness.  Schlick's
+// Fresnel splits it into a scale and a bias to F0.  The
+// geometry term uses k = alpha / 2, the remap for image
+// based light, not the (r + 1)^2 / 8 one for lights.
+// --------------------------------------------------------
+std::vector<unsigned short> EnvironmentBaker::BakeBRDF(const EnvironmentSettings& settings, unsigned int threadCount)
+{
+	unsigned int size = std::max(settings.LUTSize, 1u);
+	unsigned int sampleCount = std::max(settings.SampleCount, 1u);
+	std::vector<unsigned short> lut((size_t)size * size * 2);
+
+	ForRows(size, threadCount, [&](unsigned int first, unsigned int end)
+	{
+		for (unsigned int y = first; y < end; y++)
+		{
+			float roughness = (y + 0.5f) / size;
+			float alpha = roughness * roughness;
+			float k = alpha / 2;
+
+			for (unsigned int x = 0; x < size; x++)
+			{
+				float NdotV = (x + 0.5f) / size;
+				XMVECTOR V = XMVectorSet(std::sqrt(1 - NdotV * NdotV), 0, NdotV, 0);
+
+				float scale = 0, bias = 0;
+				for (unsigned int i = 0; i < sampleCount; i++)
+				{
+					XMVECTOR H = ImportanceSampleGGX(Hammersley(i, sampleCount), alpha);
+					float VdotH = XMVectorGetX(XMVector3Dot(V, H));
+					float NdotL = 2 * VdotH * XMVectorGetZ(H) - NdotV;
+					if (NdotL <= 0)
+						continue;
+
+					float NdotH = XMVectorGetZ(H);
+					float G = (NdotV / (NdotV * (1 - k) + k)) * (NdotL / (NdotL * (1 - k) + k));
+					float visibility = G * std::max(VdotH, 0.0f) / (NdotH * NdotV);
+					float fresnel = std::pow(1 - std::max(VdotH, 0.0f), 5.0f);
+					scale += (1 - fresnel) * visibility;
+					bias += fresnel * visibility;
+				}
+
+				unsigned short* texel = &lut[((size_t)y * size + x) * 2];
+				texel[0] = (unsigned short)(std::clamp(scale / sampleCount, 0.0f, 1.0f) * 65535 + 0.5f);
+				texel[1] = (unsigned short)(std::clamp(bias / sampleCount, 0.0f, 1.0f) * 65535 + 0.5f);
+			}
+		}
+	});
+	return lut;
+}
+
+bool EnvironmentBaker::SaveEnvironment(const std::filesystem::path& path, const PrefilteredEnvironment& environment)
+{
+	if (environment.Images.size() != 6 * (size_t)environment.MipLevels)
+		return false;
+
+	std::vector<const std::vector<unsigned char>*> images;
+	for (const BlockImage& image : environment.Images)
+		images.push_back(&image.Pixels);
+	return WriteDDS(path, formatRGBA8SRGB, 4, environment.Size, environment.Size, environment.MipLevels, true, images);
+}
+
+bool EnvironmentBaker::SaveBRDF(const std::filesystem::path& path, unsigned int size, const std::vector<unsigned short>& lut)
+{
+	if (lut.size() != (size_t)size * size * 2)
+		return false;
+
+	std::vector<unsigned char> bytes(lut.size() * sizeof(unsigned short));
+	memcpy(bytes.data(), lut.data(), bytes.size());
+	return WriteDDS(path, formatRG16, 4, size, size, 1, false, { &bytes });
+}
+
+bool EnvironmentBaker::IsCurrent(const std::filesystem::path& cache, const std::vector<std::wstring>& sources)
+{
+	std::error_code error;
+	auto cacheTime = std::filesystem::last_write_time(cache, error);
+	if (error)
+		return false;
+
+	for (const std::wstring& source : sources)
+	{
+		std::error_code sourceError;
+		auto sourceTime = std::filesystem::last_write_time(source, sourceError);
+		if (!source.empty() && !sourceError && sourceTime > cacheTime)
+			return false;
+	}
+	return true;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <filesystem>
+#include <string>
+#include <vector>
+#include "BlockCompression.h"
+
+struct EnvironmentSettings
+{
+	unsigned int Size;			// Prefiltered face size at mip 0 (a power of two)
+	unsigned int MipLevels;		// One roughness per mip, 0 at the top to 1 at the last
+	unsigned int SampleCount;	// GGX samples per texel, for both maps
+	unsigned int LUTSize;		// BRDF lookup table width & height
+};
+
+// --------------------------------------------------------
+// A GGX prefiltered cube map, as sRGB RGBA8 images in the
+// order a cube .dds stores them: each face's whole mip
+// chain, faces in D3D order (+X, -X, +Y, -Y, +Z, -Z)
+// --------------------------------------------------------
+struct PrefilteredEnvironment
+{
+	unsigned int Size;
+	unsigned int MipLevels;
+	std::vector<BlockImage> Images;	// [face * MipLevels + mip]
+};
+
+// --------------------------------------------------------
+// Bakes image based specular for the split sum
+// approximation, so the lit shader gets reflections of the
+// sky from two fetches (see IndirectSpecular() in
+// PBRFuncs.hlsli) with no convolution at runtime:
+//  - The sky, prefiltered with the GGX lobe by importance
+//    sampling, one roughness per mip.  Samples read the
+//    source's mips by how much sphere each one stands for,
+//    so few are needed without fireflies.
+//  - A lookup table of the scale (r) and bias (g) to F0
+//    for each n dot v (u) and roughness (v).  It depends on
+//    nothing but the BRDF, so any sky can share it.
+//
+// Texels are split across threads.  Results are cached as
+// .dds files that the DDS loader reads as is (the cube as
+// sRGB, so it's sampled as linear light), and there's no
+// graphics API, so they can be baked headless (see
+// Tools/BakeEnvironment.cpp).
+// --------------------------------------------------------
+namespace EnvironmentBaker
+{
+	// Faces as sRGB RGBA8, all the same square size, with missing ones (null) black
+	PrefilteredEnvironment Prefilter(const BlockImage* faces[6], const EnvironmentSettings& settings, unsigned int threadCount);
+
+	// LUTSize x LUTSize pairs of 16-bit UNORM scale & bias
+	std::vector<unsigned short> BakeBRDF(const EnvironmentSettings& settings, unsigned int threadCount);
+
+	bool SaveEnvironment(const std::filesystem::path& path, const PrefilteredEnvironment& environment);
+	bool SaveBRDF(const std::filesystem::path& path, unsigned int size, const std::vector<unsigned short>& lut);
+
+	// Whether the cache exists and is at least as new as every
+	// source that does (empty or missing sources are ignored)
+	bool IsCurrent(const std::filesystem::path& cache, const std::vector<std::wstring>& sources);
+}
@@ -5,10 +5,19 @@
 #include "PathHelpers.h"
 #include "Window.h"
 #include <string>
+#include <algorithm>
+#include <cmath>
+#include <chrono>
+#include <thread>
 #include "BufferStructs.h"
 #include "Material.h"
+#include "TextureImporter.h"
+#include "EnvironmentBaker.h"
+#include "GaussianBlur.h"
+#include "ColorLUT.h"
 
 #include "WICTextureLoader.h"
+#include "DDSTextureLoader.h"
 
 // Needed for a helper function to load pre-compiled shader files
 #pragma comment(lib, "d3dcompiler.lib")
@@ -29,10 +38,44 @@ using namespace DirectX;
 // --------------------------------------------------------
 void Game::Initialize()
 {
+	// Route shader binds through the shared state cache
+	ISimpleShader::SharedStateCache = Graphics::State;
+
+	// Per-frame data is shared by every shader, so the game owns
+	// that buffer rather than each shader keeping its own copy.
+	// Materials likewise own their PerMaterial buffers.
+	ISimpleShader::ExternalBuffers = { "PerFrame", "PerMaterial" };
+	{
+		D3D11_BUFFER_DESC perFrameDesc = {};
+		perFrameDesc.Usage = D3D11_USAGE_DYNAMIC;
+		perFrameDesc.ByteWidth = sizeof(PerFrameData);
+		perFrameDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+		perFrameDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+		Graphics::Device->CreateBuffer(&perFrameDesc, 0, perFrameBuffer.GetAddressOf());
+	}
+	perFrameData = {};
+	perFrameUploadBytes = 0;
+
+	// Per-object data can all go up in one ring buffer and be bound
+	// by offset, replacing the PerObject buffer in each vertex shader
+	if (ConstantRing::IsSupported(Graphics::Device))
+	{
+		constantRing = std::make_shared<ConstantRing>(Graphics::Device, Graphics::Context, Graphics::State, 1024 * 1024);
+		ISimpleShader::ExternalBuffers.push_back("PerObject");
+	}
+
+	// No instance buffer until there's something to put in it
+	instanceBufferCapacity = 0;
+	sceneDrawCount = 0;
+
+	auto loadStart = std::chrono::high_resolution_clock::now();
 	LoadAssets();
+	assetLoadTime = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - loadStart).count();
 	LightSetup();
 	ShadowSetup();
 	PostProcessSetup();
+	SelectShaderPermutations();
+	SortDrawOrder();
 
 	// Set initial graphics API state
 	//  - These settings persist until we change them
@@ -42,7 +85,7 @@ void Game::Initialize()
 		// Tell the input assembler (IA) stage of the pipeline what kind of
 		// geometric primitives (points, lines or triangles) we want to draw.  
 		// Essentially: "What kind of shape should the GPU draw with our vertices?"
-		Graphics::Context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+		Graphics::State->SetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 	}
 
 	// Initialize ImGui itself & platform/renderer backends
@@ -105,10 +148,16 @@ void Game::LoadAssets()
 	// Load Shaders
 	std::shared_ptr<SimpleVertexShader> vs = std::make_shared<SimpleVertexShader>(
 		Graphics::Device, Graphics::Context, FixPath(L"VertexShader.cso").c_str());
+	// No custom layout, so one is still reflected (with the per-instance
+	// matrices on slot 1), but the shader is marked for instancing
+	std::shared_ptr<SimpleVertexShader> instancedVS = std::make_shared<SimpleVertexShader>(
+		Graphics::Device, Graphics::Context, FixPath(L"VertexShaderInstanced.cso").c_str(), nullptr, true);
 	std::shared_ptr<SimpleVertexShader> wobbleVS = std::make_shared<SimpleVertexShader>(
 		Graphics::Device, Graphics::Context, FixPath(L"WobbleVS.cso").c_str());
-	std::shared_ptr<SimplePixelShader> basicPS = std::make_shared<SimplePixelShader>(
-		Graphics::Device, Graphics::Context, FixPath(L"PixelShader.cso").c_str());
+	litShaders = std::make_shared<ShaderPermutations>(
+		Graphics::Device, Graphics::Context,
+		ShaderPermutations::LitManifest, ShaderPermutations::LitManifestCount);
+	std::shared_ptr<SimplePixelShader> basicPS = litShaders->GetGeneral();
 	std::shared_ptr<SimplePixelShader> uvPS = std::make_shared<SimplePixelShader>(
 		Graphics::Device, Graphics::Context, FixPath(L"DebugUVsPS.cso").c_str());
 	std::shared_ptr<SimplePixelShader> normalPS = std::make_shared<SimplePixelShader>(
@@ -121,20 +170,8 @@ void Game::LoadAssets()
 	// Shadow shader
 	shadowVS = std::make_shared<SimpleVertexShader>(
 		Graphics::Device, Graphics::Context, FixPath(L"ShadowVS.cso").c_str());
-
-	// Shader Resource View for textures
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> cobbleAlbedoSRV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> cobbleRoughnessSRV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> cobbleMetalSRV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> cobbleNormalSRV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> floorAlbedoSRV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> floorRoughnessSRV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> floorMetalSRV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> floorNormalSRV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> woodAlbedoSRV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> woodRoughnessSRV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> woodMetalSRV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> woodNormalSRV;
+	shadowLightWVPParam = shadowVS->GetVariableParam(SimpleShaderHash("lightWVP"));
+	shadowPerObjectParam = shadowVS->GetBufferParam(SimpleShaderHash("PerObject"));
 
 	// Sampler state
 	Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState;
@@ -147,48 +184,173 @@ void Game::LoadAssets()
 	stateDesc.MaxAnisotropy = 15;
 	stateDesc.MaxLOD = D3D11_FLOAT32_MAX;
 
-	Graphics::Device.Get()->CreateSamplerState(&stateDesc, &samplerState);
-
-	// Load textures
-	CreateWICTextureFromFile(Graphics::Device.Get(), Graphics::Context.Get(), FixPath(L"../../Assets/Textures/PBR/cobblestone_albedo.png").c_str(), 0, &cobbleAlbedoSRV);
-	CreateWICTextureFromFile(Graphics::Device.Get(), Graphics::Context.Get(), FixPath(L"../../Assets/Textures/PBR/cobblestone_normals.png").c_str(), 0, &cobbleNormalSRV);
-	CreateWICTextureFromFile(Graphics::Device.Get(), Graphics::Context.Get(), FixPath(L"../../Assets/Textures/PBR/cobblestone_metal.png").c_str(), 0, &cobbleMetalSRV);
-	CreateWICTextureFromFile(Graphics::Device.Get(), Graphics::Context.Get(), FixPath(L"../../Assets/Textures/PBR/cobblestone_roughness.png").c_str(), 0, &cobbleRoughnessSRV);
-	CreateWICTextureFromFile(Graphics::Device.Get(), Graphics::Context.Get(), FixPath(L"../../Assets/Textures/PBR/floor_albedo.png").c_str(), 0, &floorAlbedoSRV);
-	CreateWICTextureFromFile(Graphics::Device.Get(), Graphics::Context.Get(), FixPath(L"../../Assets/Textures/PBR/floor_normals.png").c_str(), 0, &floorNormalSRV);
-	CreateWICTextureFromFile(Graphics::Device.Get(), Graphics::Context.Get(), FixPath(L"../../Assets/Textures/PBR/floor_metal.png").c_str(), 0, &floorMetalSRV);
-	CreateWICTextureFromFile(Graphics::Device.Get(), Graphics::Context.Get(), FixPath(L"../../Assets/Textures/PBR/floor_roughness.png").c_str(), 0, &floorRoughnessSRV);
-	CreateWICTextureFromFile(Graphics::Device.Get(), Graphics::Context.Get(), FixPath(L"../../Assets/Textures/PBR/wood_albedo.png").c_str(), 0, &woodAlbedoSRV);
-	CreateWICTextureFromFile(Graphics::Device.Get(), Graphics::Context.Get(), FixPath(L"../../Assets/Textures/PBR/wood_normals.png").c_str(), 0, &woodNormalSRV);
-	CreateWICTextureFromFile(Graphics::Device.Get(), Graphics::Context.Get(), FixPath(L"../../Assets/Textures/PBR/wood_metal.png").c_str(), 0, &woodMetalSRV);
-	CreateWICTextureFromFile(Graphics::Device.Get(), Graphics::Context.Get(), FixPath(L"../../Assets/Textures/PBR/wood_roughness.png").c_str(), 0, &woodRoughnessSRV);
+	samplerState = Graphics::Pipelines->GetSamplerState(stateDesc);
+
+	// Load textures, block compressed: BC7 for color, BC5 for
+	// normals (z is rebuilt in the shader).  Roughness, metalness
+	// and occlusion are packed into one BC7 surface map, as listed
+	// in the PBR folder's manifest.  Color mips are filtered as
+	// linear light, normal mips are renormalized and roughness rises
+	// where the normals diverge.  The maps are streamed from their
+	// .dds caches, so those are only brought up to date here.
+	TextureImportSettings albedoSettings = { BLOCK_COMPRESSION_BC7, MIP_FILTER_KAISER, MIP_CONTENT_SRGB, L"", true };
+	TextureImportSettings normalSettings = { BLOCK_COMPRESSION_BC5, MIP_FILTER_KAISER, MIP_CONTENT_NORMAL, L"", true };
+	std::vector<ChannelPack> surfacePacks = ChannelPacker::LoadManifest(FixPath(L"../../Assets/Textures/PBR/ChannelPacks.txt"));
+
+	// Every image (the sky's faces too) is decoded at once on worker
+	// threads, then the textures are created here in one go.  Maps
+	// are queued in material order: albedo, normals, surface.
+	TextureDecodeQueue textureQueue;
+	auto queueMaps = [&](const std::wstring& name, unsigned int handles[3])
+	{
+		std::wstring path = FixPath(L"../../Assets/Textures/PBR/" + name);
+		TextureImportSettings surfaceSettings = { BLOCK_COMPRESSION_BC7, MIP_FILTER_KAISER, MIP_CONTENT_LINEAR, path + L"_normals.png", true };
+
+		// Without a manifest entry there's nothing to pack, and no map
+		ChannelPack surface = {};
+		surface.Output = path + L"_surface.dds";
+		for (const ChannelPack& pack : surfacePacks)
+			if (std::filesystem::path(pack.Output).filename() == std::filesystem::path(surface.Output).filename())
+				surface = pack;
+
+		handles[0] = textureQueue.AddCompressed(path + L"_albedo.png", albedoSettings);
+		handles[1] = textureQueue.AddCompressed(path + L"_normals.png", normalSettings);
+		handles[2] = textureQueue.AddPacked(surface, surfaceSettings);
+	};
+	unsigned int cobbleImages[3], floorImages[3], woodImages[3];
+	queueMaps(L"cobblestone", cobbleImages);
+	queueMaps(L"floor", floorImages);
+	queueMaps(L"wood", woodImages);
+
+	// Cube map faces, in order: +X, -X, +Y, -Y, +Z, -Z
+	const wchar_t* skyFaceNames[6] = { L"right.png", L"left.png", L"up.png", L"down.png", L"front.png", L"back.png" };
+	std::wstring skyFolder = FixPath(L"../../Assets/Textures/Skies/Clouds Pink/");
+	std::vector<std::wstring> skyPaths;
+	unsigned int skyImages[6];
+	for (int i = 0; i < 6; i++)
+	{
+		skyPaths.push_back(skyFolder + skyFaceNames[i]);
+		skyImages[i] = textureQueue.AddImage(skyPaths[i]);
+	}
+
+	textureQueue.Decode(max(1u, std::thread::hardware_concurrency()));
+	textureDecodeTime = (float)textureQueue.GetDecodeTime();
+
+	// Maps that match in size and format share arrays, which start out
+	// with only their small mips; the rest stream in as the camera nears
+	auto uploadStart = std::chrono::high_resolution_clock::now();
+	textureBudgetMB = 16;
+	textureStreamer = std::make_shared<TextureStreamer>(Graphics::Device, Graphics::Context, textureBudgetMB * 1024ull * 1024, 64);
+	auto streamMaps = [&](unsigned int images[3], unsigned int handles[3])
+	{
+		for (int i = 0; i < 3; i++)
+			handles[i] = textureStreamer->Add(textureQueue.Get(images[i]).CachePath);
+	};
+	unsigned int cobbleHandles[3], floorHandles[3], woodHandles[3];
+	streamMaps(cobbleImages, cobbleHandles);
+	streamMaps(floorImages, floorHandles);
+	streamMaps(woodImages, woodHandles);
+	textureStreamer->Build();
+
+	const DecodedTexture* skyFaces[6];
+	for (int i = 0; i < 6; i++)
+		skyFaces[i] = &textureQueue.Get(skyImages[i]);
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> skySRV = CreateDecodedCubemap(Graphics::Device, skyFaces);
+
+	// The same faces, projected onto SH once, are the ambient light.
+	// Faces that didn't decode are black, as they are in the cube map.
+	auto ambientStart = std::chrono::high_resolution_clock::now();
+	const BlockImage* skyFaceImages[6] = {};
+	for (int i = 0; i < 6; i++)
+		if (skyFaces[i]->Decoded && !skyFaces[i]->Compressed)
+			skyFaceImages[i] = &skyFaces[i]->Image;
+	skyIrradiance = SphericalHarmonics::ConvolveIrradiance(
+		SphericalHarmonics::ProjectCubemap(skyFaceImages, max(1u, std::thread::hardware_concurrency())));
+	ambientIntensity = 1.0f;
+
+	// Its reflections: the faces prefiltered for each roughness, and
+	// the BRDF lookup table, both rebaked only if their .dds is stale
+	EnvironmentSettings environmentSettings = { 128, 6, 256, 128 };
+	std::wstring environmentPath = skyFolder + L"specular.dds";
+	std::wstring brdfPath = FixPath(L"../../Assets/Textures/brdf.dds");
+	unsigned int bakeThreads = max(1u, std::thread::hardware_concurrency());
+	if (!EnvironmentBaker::IsCurrent(environmentPath, skyPaths))
+		EnvironmentBaker::SaveEnvironment(environmentPath, EnvironmentBaker::Prefilter(skyFaceImages, environmentSettings, bakeThreads));
+	if (!EnvironmentBaker::IsCurrent(brdfPath, {}))
+		EnvironmentBaker::SaveBRDF(brdfPath, environmentSettings.LUTSize, EnvironmentBaker::BakeBRDF(environmentSettings, bakeThreads));
+
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> environmentSRV;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> brdfSRV;
+	CreateDDSTextureFromFile(Graphics::Device.Get(), environmentPath.c_str(), 0, environmentSRV.GetAddressOf());
+	CreateDDSTextureFromFile(Graphics::Device.Get(), brdfPath.c_str(), 0, brdfSRV.GetAddressOf());
+	perFrameData.specularMipCount = (float)environmentSettings.MipLevels;
+
+	printf("Sky lighting: ambient and reflections ready in %.1f ms\n",
+		std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - ambientStart).count());
+
+	// A material only streams if every map it has does, since the
+	// shader declares them all as arrays or none of them.  The rest
+	// load whole, from the .dds or through WIC.
+	const char* mapNames[] = { "Albedo", "NormalMap", "SurfaceMap" };
+	auto addMaps = [&](std::shared_ptr<Material> mat, unsigned int images[3], unsigned int handles[3])
+	{
+		bool streamed = true;
+		for (int i = 0; i < 3; i++)
+			if (!textureStreamer->IsStreamed(handles[i]))
+				streamed = false;
+
+		for (int i = 0; i < 3; i++)
+		{
+			if (streamed)
+				mat->AddTextureArray(mapNames[i], textureStreamer->GetArray(handles[i]), textureStreamer->GetSlice(handles[i]));
+			else
+				mat->AddTextureSRV(mapNames[i], CreateDecodedTexture(Graphics::Device, Graphics::Context, textureQueue.Get(images[i])));
+		}
+
+		if (streamed)
+			streamedMaps[mat.get()] = std::vector<unsigned int>(handles, handles + 3);
+	};
 
 	// Create materials
 	std::shared_ptr<Material> mat1 = std::make_shared<Material>(white, 0.8f, vs, basicPS);
-	mat1->AddTextureSRV("Albedo", cobbleAlbedoSRV);
-	mat1->AddTextureSRV("NormalMap", cobbleNormalSRV);
-	mat1->AddTextureSRV("RoughnessMap", cobbleRoughnessSRV);
-	mat1->AddTextureSRV("MetalnessMap", cobbleMetalSRV);
+	addMaps(mat1, cobbleImages, cobbleHandles);
 	mat1->AddSampler("BasicSampler", samplerState);
+	mat1->SetInstancedVS(instancedVS);
 	materials.push_back(mat1);
 	
 	std::shared_ptr<Material> mat2 = std::make_shared<Material>(white, 0.1f, vs, basicPS);
-	mat2->AddTextureSRV("Albedo", floorAlbedoSRV);
-	mat2->AddTextureSRV("NormalMap", floorNormalSRV);
-	mat2->AddTextureSRV("RoughnessMap", floorRoughnessSRV);
-	mat2->AddTextureSRV("MetalnessMap", floorMetalSRV);
+	addMaps(mat2, floorImages, floorHandles);
 	mat2->AddSampler("BasicSampler", samplerState);
+	mat2->SetInstancedVS(instancedVS);
 	//mat2->SetScale(XMFLOAT2(3, 3));
 	materials.push_back(mat2);
 
 	std::shared_ptr<Material> mat3 = std::make_shared<Material>(white, 0.8f, vs, basicPS);
-	mat3->AddTextureSRV("Albedo", woodAlbedoSRV);
-	mat3->AddTextureSRV("NormalMap", woodNormalSRV);
-	mat3->AddTextureSRV("RoughnessMap", woodRoughnessSRV);
-	mat3->AddTextureSRV("MetalnessMap", woodMetalSRV);
+	addMaps(mat3, woodImages, woodHandles);
 	mat3->AddSampler("BasicSampler", samplerState);
+	mat3->SetInstancedVS(instancedVS);
 	materials.push_back(mat3);
 
+	// Every lit material reflects the sky.  The lookup table
+	// is sampled right to its edges, so mustn't wrap.
+	D3D11_SAMPLER_DESC clampDesc = {};
+	clampDesc.AddressU = D3D11_TEXTURE_ADDRESS_CLAMP;
+	clampDesc.AddressV = D3D11_TEXTURE_ADDRESS_CLAMP;
+	clampDesc.AddressW = D3D11_TEXTURE_ADDRESS_CLAMP;
+	clampDesc.Filter = D3D11_FILTER_MIN_MAG_MIP_LINEAR;
+	clampDesc.MaxLOD = D3D11_FLOAT32_MAX;
+	Microsoft::WRL::ComPtr<ID3D11SamplerState> clampSampler = Graphics::Pipelines->GetSamplerState(clampDesc);
+	for (auto& m : materials)
+	{
+		m->AddTextureSRV("SpecularMap", environmentSRV);
+		m->AddTextureSRV("BrdfLUT", brdfSRV);
+		m->AddSampler("ClampSampler", clampSampler);
+	}
+
+	textureUploadTime = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - uploadStart).count();
+	printf("Textures: %u images decoded in %.1f ms, uploaded in %.1f ms (%.1f MB streamed in)\n",
+		textureQueue.GetCount(), textureDecodeTime, textureUploadTime, textureStreamer->GetResidentBytes() / (1024.0f * 1024.0f));
+
 	// Create meshes
 	std::shared_ptr<Mesh> cube = std::make_shared<Mesh>(FixPath("../../Assets/Meshes/cube.obj").c_str(), "Cube");
 	std::shared_ptr<Mesh> sphere = std::make_shared<Mesh>(FixPath("../../Assets/Meshes/sphere.obj").c_str(), "Sphere");
@@ -214,7 +376,7 @@ void Game::LoadAssets()
 	entities[2].GetTransform()->MoveAbsolute(0, -20, 5);
 
 	// Load sky
-	skybox = std::make_shared<Sky>(cube, samplerState, (wchar_t*)FixPath(L"../../Assets/Textures/Skies/Clouds Pink").c_str(), (wchar_t*)FixPath(L"SkyboxPixelShader.cso").c_str(), (wchar_t*)FixPath(L"SkyboxVertexShader.cso").c_str());
+	skybox = std::make_shared<Sky>(cube, samplerState, skySRV, (wchar_t*)FixPath(L"SkyboxPixelShader.cso").c_str(), (wchar_t*)FixPath(L"SkyboxVertexShader.cso").c_str());
 }
 
 void Game::LightSetup() {
@@ -258,6 +420,65 @@ void Game::LightSetup() {
 	lights.push_back(dirLight3);
 	lights.push_back(spotLight);
 	lights.push_back(pointLight);
+
+	// Shader permutations with fixed light counts expect the lights
+	// grouped by type.  The sort is stable, so the first directional
+	// light (the one that casts shadows) stays at the front.
+	std::stable_sort(lights.begin(), lights.end(),
+		[](const Light& a, const Light& b) { return a.Type < b.Type; });
+}
+
+// --------------------------------------------------------
+// Moves each material that uses the lit pixel shader onto
+// the variant built for its textures and the scene's lights,
+// so pixels skip work the general shader would do.  Must run
+// after lights and shadows are set up.
+// --------------------------------------------------------
+void Game::SelectShaderPermutations()
+{
+	ShaderPermutationKey key = {};
+	for (const Light& light : lights)
+	{
+		if (light.Type == LIGHT_TYPE_DIRECTIONAL) key.DirLights++;
+		else if (light.Type == LIGHT_TYPE_POINT) key.PointLights++;
+		else if (light.Type == LIGHT_TYPE_SPOT) key.SpotLights++;
+	}
+
+	for (auto& m : materials)
+	{
+		if (!litShaders->Owns(m->GetPS().get()))
+			continue;
+
+		key.Features = m->GetFeatures();
+		m->SetPS(litShaders->Find(key));
+	}
+}
+
+// --------------------------------------------------------
+// Orders entities so ones sharing shaders and states are
+// drawn back to back, with materials grouped within those.
+// Must run again whenever an entity's material or a
+// material's shaders change.
+// --------------------------------------------------------
+void Game::SortDrawOrder()
+{
+	std::vector<unsigned long long> keys(entities.size());
+	drawOrder.resize(entities.size());
+
+	for (unsigned int i = 0; i < entities.size(); i++)
+	{
+		std::shared_ptr<Material> mat = entities[i].GetMat();
+		keys[i] = Graphics::Pipelines->MakeKey(
+			mat->GetVS()->GetDirectXShader().Get(),
+			mat->GetPS()->GetDirectXShader().Get(),
+			mat->GetVS()->GetInputLayout().Get(),
+			0, 0, // The main pass uses default states
+			mat.get());
+		drawOrder[i] = i;
+	}
+
+	std::stable_sort(drawOrder.begin(), drawOrder.end(),
+		[&](unsigned int a, unsigned int b) { return keys[a] < keys[b]; });
 }
 
 void Game::ShadowSetup() {
@@ -324,7 +545,7 @@ void Game::ShadowSetup() {
 	shadowRastDesc.DepthClipEnable = true;
 	shadowRastDesc.DepthBias = 1000; // Min. precision units, not world units!
 	shadowRastDesc.SlopeScaledDepthBias = 1.0f; // Bias more based on slope
-	Graphics::Device->CreateRasterizerState(&shadowRastDesc, &shadowRasterizer);
+	shadowRasterizer = Graphics::Pipelines->GetRasterizerState(shadowRastDesc);
 
 	// Set up shadow sampler
 	D3D11_SAMPLER_DESC shadowSampDesc = {};
@@ -334,7 +555,14 @@ void Game::ShadowSetup() {
 	shadowSampDesc.AddressV = D3D11_TEXTURE_ADDRESS_BORDER;
 	shadowSampDesc.AddressW = D3D11_TEXTURE_ADDRESS_BORDER;
 	shadowSampDesc.BorderColor[0] = 1.0f; // Only need the first component
-	Graphics::Device->CreateSamplerState(&shadowSampDesc, &shadowSampler);
+	shadowSampler = Graphics::Pipelines->GetSamplerState(shadowSampDesc);
+
+	// Every material receives shadows
+	for (auto& m : materials)
+	{
+		m->AddTextureSRV("ShadowMap", shadowSRV);
+		m->AddSampler("ShadowSampler", shadowSampler);
+	}
 }
 
 void Game::PostProcessSetup() 
@@ -345,9 +573,23 @@ void Game::PostProcessSetup()
 
 	blurPS = std::make_shared<SimplePixelShader>(
 		Graphics::Device, Graphics::Context, FixPath(L"BlurPostProcess.cso").c_str());
+	blurColorPS = std::make_shared<SimplePixelShader>(
+		Graphics::Device, Graphics::Context, FixPath(L"BlurPostProcess_Color.cso").c_str());
+
+	pixelatePS = std::make_shared<SimplePixelShader>(
+		Graphics::Device, Graphics::Context, FixPath(L"PixelatePostProcess.cso").c_str());
+	pixelateColorPS = std::make_shared<SimplePixelShader>(
+		Graphics::Device, Graphics::Context, FixPath(L"PixelatePostProcess_Color.cso").c_str());
 
-	ditherPS = std::make_shared<SimplePixelShader>(
-		Graphics::Device, Graphics::Context, FixPath(L"DitherPostProcess.cso").c_str());
+	colorPS = std::make_shared<SimplePixelShader>(
+		Graphics::Device, Graphics::Context, FixPath(L"ColorPostProcess.cso").c_str());
+
+	downsamplePS = std::make_shared<SimplePixelShader>(
+		Graphics::Device, Graphics::Context, FixPath(L"DownsamplePostProcess.cso").c_str());
+	upsamplePS = std::make_shared<SimplePixelShader>(
+		Graphics::Device, Graphics::Context, FixPath(L"BilateralUpsample.cso").c_str());
+	upsampleColorPS = std::make_shared<SimplePixelShader>(
+		Graphics::Device, Graphics::Context, FixPath(L"BilateralUpsample_Color.cso").c_str());
 
 	// Sampler state for post processing
 	D3D11_SAMPLER_DESC ppSampDesc = {};
@@ -356,82 +598,78 @@ void Game::PostProcessSetup()
 	ppSampDesc.AddressW = D3D11_TEXTURE_ADDRESS_CLAMP;
 	ppSampDesc.Filter = D3D11_FILTER_MIN_MAG_MIP_LINEAR;
 	ppSampDesc.MaxLOD = D3D11_FLOAT32_MAX;
-	Graphics::Device->CreateSamplerState(&ppSampDesc, ppSampler.GetAddressOf());
-
-	// Blur
-	// Describe the texture we're creating
-	D3D11_TEXTURE2D_DESC blurTextureDesc = {};
-	blurTextureDesc.Width = Window::Width();
-	blurTextureDesc.Height = Window::Height();
-	blurTextureDesc.ArraySize = 1;
-	blurTextureDesc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
-	blurTextureDesc.CPUAccessFlags = 0;
-	blurTextureDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
-	blurTextureDesc.MipLevels = 1;
-	blurTextureDesc.MiscFlags = 0;
-	blurTextureDesc.SampleDesc.Count = 1;
-	blurTextureDesc.SampleDesc.Quality = 0;
-	blurTextureDesc.Usage = D3D11_USAGE_DEFAULT;
-	// Create the resource (no need to track it after the views are created below)
-	Microsoft::WRL::ComPtr<ID3D11Texture2D> blurTexture;
-	Graphics::Device->CreateTexture2D(&blurTextureDesc, 0, blurTexture.GetAddressOf());
-
-	// Create the Render Target View
-	D3D11_RENDER_TARGET_VIEW_DESC blurRTVDesc = {};
-	blurRTVDesc.Format = blurTextureDesc.Format;
-	blurRTVDesc.Texture2D.MipSlice = 0;
-	blurRTVDesc.ViewDimension = D3D11_RTV_DIMENSION_TEXTURE2D;
-	Graphics::Device->CreateRenderTargetView(
-		blurTexture.Get(),
-		&blurRTVDesc,
-		blurRTV.ReleaseAndGetAddressOf());
-	// Create the Shader Resource View
-	// By passing it a null description for the SRV, we
-	// get a "default" SRV that has access to the entire resource
-	Graphics::Device->CreateShaderResourceView(
-		blurTexture.Get(),
-		0,
-		blurSRV.ReleaseAndGetAddressOf());
-
-	// Start with no blur
+	ppSampler = Graphics::Pipelines->GetSamplerState(ppSampDesc);
+
+	// The chain, in the order effects apply.  Each is skipped
+	// while its settings would leave the image as it is, and the
+	// color LUT, which always runs as the scene is linear, joins
+	// whichever pass comes before it.  Both blur passes share a
+	// downscale, so one downsample and upsample surround them.
+	blurAcrossEffect = postChain.Add("Blur across", POST_EFFECT_NEIGHBORHOOD, [&]() { return blurRadius > 0; },
+		[&]() { return (unsigned int)blurDownscale; });
+	blurDownEffect = postChain.Add("Blur down", POST_EFFECT_NEIGHBORHOOD, [&]() { return blurRadius > 0; },
+		[&]() { return (unsigned int)blurDownscale; });
+	pixelateEffect = postChain.Add("Pixelate", POST_EFFECT_NEIGHBORHOOD, [&]() { return pixelSize > 1; });
+	colorEffect = postChain.Add("Color", POST_EFFECT_PIXEL, nullptr);
+
+	// Start with no blur, pixelization or grading, but dithered
 	blurRadius = 0;
+	blurDownscale = 1;
+	pixelSize = 1;
+	ditherEnabled = true;
+	exposure = 0.0f;
+	saturation = 1.0f;
+	BakeColorLUT();
+	graphDirty = true;
+}
 
-	// Dither
-	D3D11_TEXTURE2D_DESC ditherTextureDesc = {};
-	ditherTextureDesc.Width = Window::Width();
-	ditherTextureDesc.Height = Window::Height();
-	ditherTextureDesc.ArraySize = 1;
-	ditherTextureDesc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
-	ditherTextureDesc.CPUAccessFlags = 0;
-	ditherTextureDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
-	ditherTextureDesc.MipLevels = 1;
-	ditherTextureDesc.MiscFlags = 0;
-	ditherTextureDesc.SampleDesc.Count = 1;
-	ditherTextureDesc.SampleDesc.Quality = 0;
-	ditherTextureDesc.Usage = D3D11_USAGE_DEFAULT;
-	// Create the resource (no need to track it after the views are created below)
-	Microsoft::WRL::ComPtr<ID3D11Texture2D> ditherTexture;
-	Graphics::Device->CreateTexture2D(&ditherTextureDesc, 0, ditherTexture.GetAddressOf());
-
-	// Create the Render Target View
-	D3D11_RENDER_TARGET_VIEW_DESC ditherRTVDesc = {};
-	ditherRTVDesc.Format = blurTextureDesc.Format;
-	ditherRTVDesc.Texture2D.MipSlice = 0;
-	ditherRTVDesc.ViewDimension = D3D11_RTV_DIMENSION_TEXTURE2D;
-	Graphics::Device->CreateRenderTargetView(
-		ditherTexture.Get(),
-		&ditherRTVDesc,
-		ditherRTV.ReleaseAndGetAddressOf());
-	// Create the Shader Resource View
-	// By passing it a null description for the SRV, we
-	// get a "default" SRV that has access to the entire resource
-	Graphics::Device->CreateShaderResourceView(
-		ditherTexture.Get(),
-		0,
-		ditherSRV.ReleaseAndGetAddressOf());
+// --------------------------------------------------------
+// Bakes every per-pixel color step into one 3D texture.
+// Cheap enough to redo whenever a color setting changes.
+// --------------------------------------------------------
+void Game::BakeColorLUT()
+{
+	std::vector<ColorStep> steps;
+	steps.push_back({ COLOR_STEP_SATURATION, saturation });
+	steps.push_back({ COLOR_STEP_GAMMA, 1.0f / 2.2f });
+	if (ditherEnabled)
+	{
+		steps.push_back({ COLOR_STEP_PALETTE, 0, {
+			XMFLOAT3(0, 0, 0),
+			XMFLOAT3(0.25f, 0.25f, 0.25f),
+			XMFLOAT3(0.50f, 0.50f, 0.50f),
+			XMFLOAT3(0.75f, 0.75f, 0.75f),
+			XMFLOAT3(1, 1, 1) } });
+	}
 
-	// Start with no pixelization
-	pixelSize = 1;
+	ColorLUTImage lut = ColorLUT::Bake(steps, COLOR_LUT_SIZE, max(1u, std::thread::hardware_concurrency()));
+
+	D3D11_TEXTURE3D_DESC lutDesc = {};
+	lutDesc.Width = lut.Size;
+	lutDesc.Height = lut.Size;
+	lutDesc.Depth = lut.Size;
+	lutDesc.MipLevels = 1;
+	lutDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+	lutDesc.Usage = D3D11_USAGE_IMMUTABLE;
+	lutDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+	D3D11_SUBRESOURCE_DATA lutData = {};
+	lutData.pSysMem = &lut.Pixels[0];
+	lutData.SysMemPitch = lut.Size * 4;
+	lutData.SysMemSlicePitch = lut.Size * lut.Size * 4;
+
+	Microsoft::WRL::ComPtr<ID3D11Texture3D> lutTexture;
+	Graphics::Device->CreateTexture3D(&lutDesc, &lutData, lutTexture.GetAddressOf());
+	Graphics::Device->CreateShaderResourceView(lutTexture.Get(), 0, colorLUTSRV.ReleaseAndGetAddressOf());
+
+	// Palette colors can't be blended, so those LUTs are point sampled
+	D3D11_SAMPLER_DESC lutSampDesc = {};
+	lutSampDesc.AddressU = D3D11_TEXTURE_ADDRESS_CLAMP;
+	lutSampDesc.AddressV = D3D11_TEXTURE_ADDRESS_CLAMP;
+	lutSampDesc.AddressW = D3D11_TEXTURE_ADDRESS_CLAMP;
+	lutSampDesc.Filter = ColorLUT::IsDiscrete(steps) ? D3D11_FILTER_MIN_MAG_MIP_POINT : D3D11_FILTER_MIN_MAG_MIP_LINEAR;
+	lutSampDesc.MaxLOD = D3D11_FLOAT32_MAX;
+	colorLUTSampler = Graphics::Pipelines->GetSamplerState(lutSampDesc);
 }
 
 
@@ -451,85 +689,83 @@ void Game::OnResize()
 		}
 	}
 
-	if (Graphics::Device != NULL)
-	ResetPostProcess();
+	// Targets in the graph's pool are sized to the window
+	graphDirty = true;
 }
 
-void Game::ResetPostProcess() 
+// --------------------------------------------------------
+// Declares the frame's passes: the scene, then whatever
+// post passes the chain needs, ending in the back buffer.
+// Passes are added in any order; compiling sorts them and
+// maps their textures onto as few pooled targets as it can.
+// --------------------------------------------------------
+void Game::BuildRenderGraph()
 {
-	blurRTV.Reset();
-	blurSRV.Reset();
-	ditherRTV.Reset();
-	ditherSRV.Reset();
-
-	// Blur
-    // Describe the texture we're creating
-	D3D11_TEXTURE2D_DESC blurTextureDesc = {};
-	blurTextureDesc.Width = Window::Width();
-	blurTextureDesc.Height = Window::Height();
-	blurTextureDesc.ArraySize = 1;
-	blurTextureDesc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
-	blurTextureDesc.CPUAccessFlags = 0;
-	blurTextureDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
-	blurTextureDesc.MipLevels = 1;
-	blurTextureDesc.MiscFlags = 0;
-	blurTextureDesc.SampleDesc.Count = 1;
-	blurTextureDesc.SampleDesc.Quality = 0;
-	blurTextureDesc.Usage = D3D11_USAGE_DEFAULT;
-	// Create the resource (no need to track it after the views are created below)
-	Microsoft::WRL::ComPtr<ID3D11Texture2D> blurTexture;
-	Graphics::Device->CreateTexture2D(&blurTextureDesc, 0, blurTexture.GetAddressOf());
-
-	// Create the Render Target View
-	D3D11_RENDER_TARGET_VIEW_DESC blurRTVDesc = {};
-	blurRTVDesc.Format = blurTextureDesc.Format;
-	blurRTVDesc.Texture2D.MipSlice = 0;
-	blurRTVDesc.ViewDimension = D3D11_RTV_DIMENSION_TEXTURE2D;
-	Graphics::Device->CreateRenderTargetView(
-		blurTexture.Get(),
-		&blurRTVDesc,
-		blurRTV.ReleaseAndGetAddressOf());
-	// Create the Shader Resource View
-	// By passing it a null description for the SRV, we
-	// get a "default" SRV that has access to the entire resource
-	Graphics::Device->CreateShaderResourceView(
-		blurTexture.Get(),
-		0,
-		blurSRV.ReleaseAndGetAddressOf());
-
-	// Dither
-	D3D11_TEXTURE2D_DESC ditherTextureDesc = {};
-	ditherTextureDesc.Width = Window::Width();
-	ditherTextureDesc.Height = Window::Height();
-	ditherTextureDesc.ArraySize = 1;
-	ditherTextureDesc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
-	ditherTextureDesc.CPUAccessFlags = 0;
-	ditherTextureDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
-	ditherTextureDesc.MipLevels = 1;
-	ditherTextureDesc.MiscFlags = 0;
-	ditherTextureDesc.SampleDesc.Count = 1;
-	ditherTextureDesc.SampleDesc.Quality = 0;
-	ditherTextureDesc.Usage = D3D11_USAGE_DEFAULT;
-	// Create the resource (no need to track it after the views are created below)
-	Microsoft::WRL::ComPtr<ID3D11Texture2D> ditherTexture;
-	Graphics::Device->CreateTexture2D(&ditherTextureDesc, 0, ditherTexture.GetAddressOf());
-
-	// Create the Render Target View
-	D3D11_RENDER_TARGET_VIEW_DESC ditherRTVDesc = {};
-	ditherRTVDesc.Format = blurTextureDesc.Format;
-	ditherRTVDesc.Texture2D.MipSlice = 0;
-	ditherRTVDesc.ViewDimension = D3D11_RTV_DIMENSION_TEXTURE2D;
-	Graphics::Device->CreateRenderTargetView(
-		ditherTexture.Get(),
-		&ditherRTVDesc,
-		ditherRTV.ReleaseAndGetAddressOf());
-	// Create the Shader Resource View
-	// By passing it a null description for the SRV, we
-	// get a "default" SRV that has access to the entire resource
-	Graphics::Device->CreateShaderResourceView(
-		ditherTexture.Get(),
-		0,
-		ditherSRV.ReleaseAndGetAddressOf());
+	renderGraph.Clear();
+	graphBackBuffer = renderGraph.ImportTexture("Back buffer");
+	graphDepth = renderGraph.ImportTexture("Depth");
+
+	RenderGraphTextureDesc postDesc = {};
+	postDesc.Width = Window::Width();
+	postDesc.Height = Window::Height();
+	postDesc.Format = DXGI_FORMAT_R16G16B16A16_FLOAT; // Linear, until the color LUT
+	unsigned int sceneColor = postChain.AddToGraph(
+		renderGraph, graphBackBuffer, graphDepth, postDesc, DXGI_FORMAT_R32_FLOAT, *this);
+
+	unsigned int scenePass = renderGraph.AddPass("Scene", [this, sceneColor]() { DrawScene(sceneColor); });
+	renderGraph.Write(scenePass, sceneColor);
+	renderGraph.Write(scenePass, graphDepth);
+	renderGraph.Compile();
+	graphDirty = false;
+
+	// Targets only change when the pool does: a pass being
+	// turned on or off, or a resize
+	if (renderGraph.GetPool() != graphPool)
+		CreateGraphTargets();
+}
+
+// --------------------------------------------------------
+// Creates one render target per slot in the graph's pool
+// --------------------------------------------------------
+void Game::CreateGraphTargets()
+{
+	graphPool = renderGraph.GetPool();
+	graphRTVs.clear();
+	graphSRVs.clear();
+	graphRTVs.resize(graphPool.size());
+	graphSRVs.resize(graphPool.size());
+
+	for (size_t i = 0; i < graphPool.size(); i++)
+	{
+		// Describe the texture we're creating
+		D3D11_TEXTURE2D_DESC textureDesc = {};
+		textureDesc.Width = graphPool[i].Width;
+		textureDesc.Height = graphPool[i].Height;
+		textureDesc.ArraySize = 1;
+		textureDesc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
+		textureDesc.CPUAccessFlags = 0;
+		textureDesc.Format = (DXGI_FORMAT)graphPool[i].Format;
+		textureDesc.MipLevels = 1;
+		textureDesc.MiscFlags = 0;
+		textureDesc.SampleDesc.Count = 1;
+		textureDesc.SampleDesc.Quality = 0;
+		textureDesc.Usage = D3D11_USAGE_DEFAULT;
+		// Create the resource (no need to track it after the views are created below)
+		Microsoft::WRL::ComPtr<ID3D11Texture2D> texture;
+		Graphics::Device->CreateTexture2D(&textureDesc, 0, texture.GetAddressOf());
+
+		// Create the Render Target View
+		D3D11_RENDER_TARGET_VIEW_DESC rtvDesc = {};
+		rtvDesc.Format = textureDesc.Format;
+		rtvDesc.Texture2D.MipSlice = 0;
+		rtvDesc.ViewDimension = D3D11_RTV_DIMENSION_TEXTURE2D;
+		Graphics::Device->CreateRenderTargetView(texture.Get(), &rtvDesc, graphRTVs[i].GetAddressOf());
+
+		// Create the Shader Resource View
+		// By passing it a null description for the SRV, we
+		// get a "default" SRV that has access to the entire resource
+		Graphics::Device->CreateShaderResourceView(texture.Get(), 0, graphSRVs[i].GetAddressOf());
+	}
 }
 
 
@@ -571,6 +807,41 @@ void Game::UpdateInspector(float deltaTime, float totalTime) {
 		// Display elapsed time
 		ImGui::Text("Elapsed time: %f", totalTime);
 
+		// How long startup spent on assets, textures broken out
+		ImGui::Text("Startup: %.1f ms assets (textures: %.1f ms decode, %.1f ms upload)",
+			assetLoadTime, textureDecodeTime, textureUploadTime);
+
+		// State changes from the last frame
+		StateCacheStats stateStats = Graphics::State->GetStats();
+		ImGui::Text("State changes: %u issued, %u skipped", stateStats.Issued, stateStats.Skipped);
+		ImGui::Text("State objects: %u unique, %u reused",
+			Graphics::Pipelines->GetStateCount(),
+			Graphics::Pipelines->GetReuseCount());
+
+		// Instancing collapses entities that share a mesh and material
+		ImGui::Text("Scene draws: %u for %d entities", sceneDrawCount, (int)entities.size());
+
+		// Constant data sent to the GPU last frame
+		SimpleShaderUploadStats uploadStats = ISimpleShader::UploadStats;
+		unsigned int ringBytes = constantRing ? constantRing->GetUploadBytes() : 0;
+		ImGui::Text("Constant data: %u bytes in %u uploads",
+			uploadStats.Bytes + perFrameUploadBytes + ringBytes,
+			uploadStats.Uploads + 1 + (ringBytes > 0 ? 1 : 0));
+		ImGui::Text("Skipped: %u clean uploads, %u unchanged sets",
+			uploadStats.CleanSkips,
+			uploadStats.SameWrites);
+
+		// Streamed texture memory, against its budget
+		TextureResidencyStats streamStats = textureStreamer->GetStats();
+		ImGui::Text("Streamed textures: %.1f of %.1f MB resident, %u loading",
+			textureStreamer->GetResidentBytes() / (1024.0f * 1024.0f),
+			streamStats.Budget / (1024.0f * 1024.0f),
+			textureStreamer->GetPendingLoads());
+		ImGui::Text("Mip levels: %u granted, %u evicted, %u textures starved",
+			streamStats.Upgrades, streamStats.Evictions, streamStats.Starved);
+		if (ImGui::SliderInt("Texture Budget (MB)", &textureBudgetMB, 1, 64))
+			textureStreamer->SetBudget(textureBudgetMB * 1024ull * 1024);
+
 		// Button to display demo window
 		if (ImGui::Button("Toggle Demo Window")) {
 			imGuiDemoVisible = !imGuiDemoVisible;
@@ -687,6 +958,9 @@ void Game::UpdateInspector(float deltaTime, float totalTime) {
 	// Light details
 	if (ImGui::CollapsingHeader("Lights")) 
 	{
+		// Scales the sky's ambient light
+		ImGui::SliderFloat("Ambient", &ambientIntensity, 0.0f, 2.0f);
+
 		for (int i = 0; i < lights.size(); i++) 
 		{
 			// Make basic name string
@@ -718,13 +992,55 @@ void Game::UpdateInspector(float deltaTime, float totalTime) {
 	{
 		if (ImGui::TreeNode("Blur")) 
 		{
-			ImGui::SliderInt("Blur Radius", &blurRadius, 0, 5);
+			// Post settings decide which passes the graph has
+			graphDirty |= ImGui::SliderInt("Blur Radius", &blurRadius, 0, MAX_BLUR_RADIUS);
+
+			// Trades sharpness at edges for fewer pixels blurred
+			ImGui::Text("Resolution");
+			graphDirty |= ImGui::RadioButton("Full", &blurDownscale, 1); ImGui::SameLine();
+			graphDirty |= ImGui::RadioButton("Half", &blurDownscale, 2); ImGui::SameLine();
+			graphDirty |= ImGui::RadioButton("Quarter", &blurDownscale, 4);
 			ImGui::TreePop();
 		}
 
 		if (ImGui::TreeNode("Dither/Pixelation"))
 		{
-			ImGui::SliderInt("Pixel Size", &pixelSize, 1, 10);
+			graphDirty |= ImGui::SliderInt("Pixel Size", &pixelSize, 1, 10);
+			if (ImGui::Checkbox("Dither", &ditherEnabled))
+				BakeColorLUT();
+			ImGui::TreePop();
+		}
+
+		// Saturation is baked into the color LUT along with gamma and
+		// the dither palette; exposure is applied ahead of it
+		if (ImGui::TreeNode("Color"))
+		{
+			ImGui::SliderFloat("Exposure", &exposure, -4.0f, 4.0f);
+			if (ImGui::SliderFloat("Saturation", &saturation, 0.0f, 2.0f))
+				BakeColorLUT();
+			ImGui::TreePop();
+		}
+
+		// What last frame's render graph ran, and the pooled
+		// target (#) each of its textures was aliased onto
+		if (ImGui::TreeNode("Render Graph"))
+		{
+			ImGui::Text("Pooled targets: %u", (unsigned int)graphPool.size());
+			for (unsigned int p : renderGraph.GetOrder())
+			{
+				const RenderGraphPass& pass = renderGraph.GetPass(p);
+				std::string line = pass.Name + ":";
+				for (unsigned int t : pass.Reads)
+					line += " " + renderGraph.GetTexture(t).Name + " #" + std::to_string(renderGraph.GetSlot(t));
+				line += " ->";
+				for (unsigned int t : pass.Writes)
+				{
+					line += " " + renderGraph.GetTexture(t).Name;
+					if (!renderGraph.GetTexture(t).Imported)
+						line += " #" + std::to_string(renderGraph.GetSlot(t));
+				}
+				ImGui::BulletText("%s", line.c_str());
+			}
 			ImGui::TreePop();
 		}
 	}
@@ -758,71 +1074,74 @@ void Game::Update(float deltaTime, float totalTime)
 
 	entities[0].GetTransform()->SetPosition(-2, sin(totalTime), 5);
 	entities[1].GetTransform()->SetPosition(2 + sin(totalTime), 0, 5);
-}
 
+	UpdateTextureStreaming();
+}
 
 // --------------------------------------------------------
-// Clear the screen, redraw everything, present to the user
+// Asks for the mips each streamed material needs, judged by
+// how large its entities' texels appear from the camera at
+// their nearest point, then points the materials at any
+// arrays the streamer recreated
 // --------------------------------------------------------
-void Game::Draw(float deltaTime, float totalTime)
+void Game::UpdateTextureStreaming()
 {
-	DrawShadowMap();
-
-	// After shadow map, can draw from the camera
+	XMFLOAT3 camPosition = activeCam->GetTransform()->GetPosition();
+	XMVECTOR camPos = XMLoadFloat3(&camPosition);
+	for (GameEntity& e : entities)
 	{
-		Graphics::Context->ClearRenderTargetView(Graphics::BackBufferRTV.Get(),	color);
-		Graphics::Context->ClearDepthStencilView(Graphics::DepthBufferDSV.Get(), D3D11_CLEAR_DEPTH, 1.0f, 0);
-		Graphics::Context->ClearRenderTargetView(blurRTV.Get(), color);
-		Graphics::Context->OMSetRenderTargets(1, blurRTV.GetAddressOf(), Graphics::DepthBufferDSV.Get());
-	}
-
-	// DRAW geometry
-	{
-		for (int i = 0; i < entities.size(); i++) {
-			entities[i].GetMat()->GetPS()->SetFloat("time", totalTime);
-			entities[i].GetMat()->GetVS()->SetFloat("time", totalTime);
-			entities[i].GetMat()->GetPS()->SetFloat3("camPosition", activeCam->GetTransform()->GetPosition());
-			entities[i].GetMat()->GetPS()->SetData("lights", &lights[0], sizeof(Light) * (int)lights.size());
-			entities[i].GetMat()->GetPS()->SetInt("lightCount",(int)lights.size());
-			entities[i].GetMat()->GetVS()->SetMatrix4x4("lightView", lightViewMatrix);
-			entities[i].GetMat()->GetVS()->SetMatrix4x4("lightProj", lightProjectionMatrix);
-			entities[i].GetMat()->GetPS()->SetInt("lightCount", (int)lights.size());
-			entities[i].GetMat()->AddTextureSRV("ShadowMap", shadowSRV);
-			entities[i].GetMat()->AddSampler("ShadowSampler", shadowSampler);
-
-			entities[i].Draw(activeCam);
+		auto maps = streamedMaps.find(e.GetMat().get());
+		if (maps == streamedMaps.end())
+			continue;
+
+		// Entity scale stretches the mesh, and material scale the UVs
+		std::shared_ptr<Mesh> mesh = e.GetMesh();
+		XMFLOAT3 scale = e.GetTransform()->GetScale();
+		XMFLOAT2 uvScale = e.GetMat()->GetScale();
+		float maxScale = max(scale.x, max(scale.y, scale.z));
+		float uvPerUnit = mesh->GetUVDensity() * max(uvScale.x, uvScale.y) / max(maxScale, 0.0001f);
+
+		XMFLOAT3 center = mesh->GetBoundsCenter();
+		XMFLOAT4X4 world = e.GetTransform()->GetWorldMatrix();
+		XMVECTOR worldCenter = XMVector3Transform(XMLoadFloat3(&center), XMLoadFloat4x4(&world));
+		float distance = XMVectorGetX(XMVector3Length(worldCenter - camPos)) - mesh->GetBoundsRadius() * maxScale;
+
+		for (unsigned int handle : maps->second)
+		{
+			float mip = TextureResidency::EstimateMip(
+				textureStreamer->GetWidth(handle) * uvPerUnit,
+				max(distance, 0.01f),
+				activeCam->GetFOV(),
+				(float)Window::Height());
+			textureStreamer->Request(handle, mip);
 		}
 	}
 
-	skybox->Draw(activeCam);
-
-	// Now move to dither RTV
-	Graphics::Context->OMSetRenderTargets(1, ditherRTV.GetAddressOf(), 0);
+	for (TextureStreamerSwap& swap : textureStreamer->Update())
+		for (std::shared_ptr<Material>& m : materials)
+			m->ReplaceTextureSRV(swap.Old.Get(), swap.New);
+}
 
-	// Activate shaders and bind resources
-	// Also set any required cbuffer data
-	ppVS->SetShader();
-	blurPS->SetShader();
-	blurPS->SetShaderResourceView("Pixels", blurSRV.Get());
-	blurPS->SetSamplerState("ClampSampler", ppSampler.Get());
-	blurPS->SetInt("blurRadius", blurRadius);
-	blurPS->SetFloat("pixelWidth", (float)1.0/Window::Width());
-	blurPS->SetFloat("pixelHeight", (float)1.0/Window::Height());
-	blurPS->CopyAllBufferData();
-	Graphics::Context->Draw(3, 0); // Draw exactly 3 vertices (one triangle)
 
-	// Move to back buffer
-	Graphics::Context->OMSetRenderTargets(1, Graphics::BackBufferRTV.GetAddressOf(), 0);
+// --------------------------------------------------------
+// Clear the screen, redraw everything, present to the user
+// --------------------------------------------------------
+void Game::Draw(float deltaTime, float totalTime)
+{
+	// Count state changes and uploads for this frame only
+	Graphics::State->ResetStats();
+	ISimpleShader::ResetUploadStats();
 
-	ditherPS->SetShader();
-	ditherPS->SetShaderResourceView("Pixels", ditherSRV.Get());
-	ditherPS->SetSamplerState("ClampSampler", ppSampler.Get());
-	ditherPS->SetInt("pixelSize", pixelSize);
-	ditherPS->SetFloat("width", (float)Window::Width());
-	ditherPS->SetFloat("height", (float)Window::Height());
-	ditherPS->CopyAllBufferData();
-	Graphics::Context->Draw(3, 0); // Draw exactly 3 vertices (one triangle)
+	UpdatePerFrameData(totalTime);
+	UpdateObjectMatrices();
+	UpdateObjectConstants();
+	DrawShadowMap();
 
+	// After shadow map, draw the scene from the camera, then
+	// whichever post passes are needed to reach the back buffer
+	if (graphDirty)
+		BuildRenderGraph();
+	renderGraph.Execute();
 
 	ImGui::Render(); // Turns this frames UI into renderable triangles
 	ImGui_ImplDX11_RenderDrawData(ImGui::GetDrawData()); // Draws it to the screen
@@ -837,17 +1156,325 @@ void Game::Draw(float deltaTime, float totalTime)
 			vsync ? 1 : 0,
 			vsync ? 0 : DXGI_PRESENT_ALLOW_TEARING);
 
+		// Fence off this frame's per-object constants
+		if (constantRing)
+			constantRing->EndFrame();
+
 		// Re-bind back buffer and depth buffer after presenting
 		Graphics::Context->OMSetRenderTargets(
 			1,
 			Graphics::BackBufferRTV.GetAddressOf(),
 			Graphics::DepthBufferDSV.Get());
 
-		ID3D11ShaderResourceView* nullSRVs[128] = {};
-		Graphics::Context->PSSetShaderResources(0, 128, nullSRVs);
+		Graphics::State->UnbindPSShaderResources();
 	}
 }
 
+// --------------------------------------------------------
+// Draws everything queued in the instance batcher, one
+// DrawIndexedInstanced() per unique mesh/material pair
+// --------------------------------------------------------
+void Game::DrawInstances()
+{
+	instanceBatcher.Build();
+	unsigned int instanceCount = instanceBatcher.GetInstanceCount();
+	if (instanceCount == 0)
+		return;
+
+	// Grow the instance buffer if this frame needs more room
+	if (instanceCount > instanceBufferCapacity)
+	{
+		instanceBufferCapacity = max(instanceCount, instanceBufferCapacity * 2);
+
+		D3D11_BUFFER_DESC instDesc = {};
+		instDesc.Usage = D3D11_USAGE_DYNAMIC;
+		instDesc.ByteWidth = sizeof(InstanceData) * instanceBufferCapacity;
+		instDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+		instDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+		Graphics::Device->CreateBuffer(&instDesc, 0, instanceBuffer.ReleaseAndGetAddressOf());
+	}
+
+	// Upload every instance for the frame at once
+	D3D11_MAPPED_SUBRESOURCE mapped = {};
+	Graphics::Context->Map(instanceBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped);
+	memcpy(mapped.pData, &instanceBatcher.GetInstanceData()[0], sizeof(InstanceData) * instanceCount);
+	Graphics::Context->Unmap(instanceBuffer.Get(), 0);
+
+	// Groups pick their range with a start instance, so one bind covers all of them
+	Graphics::State->SetVertexBuffer(1, instanceBuffer.Get(), sizeof(InstanceData), 0);
+
+	// Groups are sorted by material, so each one is prepared once.
+	// Everything else the instanced shader needs is per-frame data.
+	Material* lastMaterial = 0;
+	for (const InstanceGroup& group : instanceBatcher.GetGroups())
+	{
+		Mesh* mesh = (Mesh*)group.Mesh;
+		Material* mat = (Material*)group.Material;
+
+		mat->GetInstancedVS()->SetShader();
+		mat->GetPS()->SetShader();
+		if (mat != lastMaterial)
+		{
+			mat->PrepareMaterial();
+			lastMaterial = mat;
+		}
+
+		mesh->DrawInstanced(group.InstanceCount, group.FirstInstance);
+		sceneDrawCount++;
+	}
+}
+
+// --------------------------------------------------------
+// Draws the geometry, instances and sky into the given
+// target: the back buffer when no post pass will run
+// --------------------------------------------------------
+void Game::DrawScene(unsigned int target)
+{
+	ID3D11RenderTargetView* rtv = GetGraphRTV(target);
+	Graphics::Context->ClearRenderTargetView(rtv, color);
+	Graphics::Context->ClearDepthStencilView(Graphics::DepthBufferDSV.Get(), D3D11_CLEAR_DEPTH, 1.0f, 0);
+	Graphics::Context->OMSetRenderTargets(1, &rtv, Graphics::DepthBufferDSV.Get());
+
+	// DRAW geometry
+	{
+		sceneDrawCount = 0;
+		instanceBatcher.Clear();
+
+		// Material data is only uploaded when the material changes
+		Material* lastMaterial = 0;
+
+		for (unsigned int i : drawOrder) {
+			// Entities that can be instanced are drawn in groups afterwards
+			std::shared_ptr<SimpleVertexShader> instancedVS = entities[i].GetMat()->GetInstancedVS();
+			if (instancedVS && instancedVS->GetPerInstanceCompatible())
+			{
+				InstanceData data = {};
+				data.World = entities[i].GetTransform()->GetWorldMatrix();
+				data.WorldInvTrans = entities[i].GetTransform()->GetWorldInverseTransposeMatrix();
+				data.WVP = objectMatrices.Get(i).WVP;
+				data.LightWVP = objectMatrices.Get(i).LightWVP;
+				instanceBatcher.Add(entities[i].GetMesh().get(), entities[i].GetMat().get(), data);
+				continue;
+			}
+
+			if (entities[i].GetMat().get() != lastMaterial)
+			{
+				lastMaterial = entities[i].GetMat().get();
+				lastMaterial->PrepareMaterial();
+			}
+
+			if (constantRing)
+			{
+				constantRing->BindVS(2, objectConstants[i]);
+				entities[i].DrawPrebound();
+			}
+			else
+			{
+				entities[i].Draw(objectMatrices.Get(i).WVP, objectMatrices.Get(i).LightWVP);
+			}
+			sceneDrawCount++;
+		}
+
+		DrawInstances();
+	}
+
+	skybox->Draw();
+}
+
+// --------------------------------------------------------
+// Draws one full-screen pass of the post chain.  Passes led
+// by a blur or pixelation use that effect's shader, or its
+// _Color variant when the color LUT is fused in; a pass with
+// no such effect is the color LUT on its own.  Reduced passes
+// draw with a viewport the size of their target.
+// --------------------------------------------------------
+void Game::DrawPostPass(const PostPass& pass)
+{
+	bool color = !pass.Fused.empty();
+	std::shared_ptr<SimplePixelShader> ps = colorPS;
+	ID3D11RenderTargetView* rtvs[2] = { GetGraphRTV(pass.Output), 0 };
+	if (pass.Type == POST_PASS_DOWNSAMPLE)
+		rtvs[1] = GetGraphRTV(pass.ReducedDepth);
+
+	// Size of what this pass draws
+	float width = (float)Window::Width();
+	float height = (float)Window::Height();
+	if (pass.Output != graphBackBuffer)
+	{
+		width = (float)renderGraph.GetTexture(pass.Output).Desc.Width;
+		height = (float)renderGraph.GetTexture(pass.Output).Desc.Height;
+	}
+
+	// Output first, which unbinds the input from being a target,
+	// and the scene's depth buffer, so it can then be read
+	Graphics::Context->OMSetRenderTargets(rtvs[1] ? 2 : 1, rtvs, 0);
+
+	D3D11_VIEWPORT viewport = {};
+	viewport.Width = width;
+	viewport.Height = height;
+	viewport.MaxDepth = 1.0f;
+	Graphics::Context->RSSetViewports(1, &viewport);
+
+	// Both resampling passes linearize depth with the projection
+	XMFLOAT4X4 proj = activeCam->GetProjection();
+	XMFLOAT2 depthParams(proj._33, proj._43);
+
+	if (pass.Type == POST_PASS_DOWNSAMPLE)
+	{
+		ps = downsamplePS;
+		ps->SetInt("downscale", pass.Downscale);
+		ps->SetFloat2("depthParams", depthParams);
+		ps->SetShaderResourceView("Depth", Graphics::DepthBufferSRV);
+	}
+	else if (pass.Type == POST_PASS_UPSAMPLE)
+	{
+		ps = color ? upsampleColorPS : upsamplePS;
+		ps->SetInt("downscale", pass.Downscale);
+		ps->SetFloat2("depthParams", depthParams);
+		ps->SetShaderResourceView("ReducedDepth", GetGraphSRV(pass.ReducedDepth));
+		ps->SetShaderResourceView("Depth", Graphics::DepthBufferSRV);
+	}
+	else if (pass.Effect == (int)blurAcrossEffect || pass.Effect == (int)blurDownEffect)
+	{
+		ps = color ? blurColorPS : blurPS;
+
+		// The radius is in full resolution pixels, so shrinks with the target
+		int radius = (blurRadius + pass.Downscale - 1) / pass.Downscale;
+		std::vector<BlurTap> blurTaps = GaussianBlur::GetLinearTaps(radius);
+		XMFLOAT4 tapData[MAX_BLUR_TAPS] = {};
+		for (size_t i = 0; i < blurTaps.size(); i++)
+			tapData[i] = XMFLOAT4(blurTaps[i].Offset, blurTaps[i].Weight, 0, 0);
+		ps->SetData("taps", tapData, sizeof(tapData));
+		ps->SetInt("tapCount", (int)blurTaps.size());
+		ps->SetFloat2("texelStep", pass.Effect == (int)blurAcrossEffect ?
+			XMFLOAT2(1.0f / width, 0) :
+			XMFLOAT2(0, 1.0f / height));
+	}
+	else if (pass.Effect == (int)pixelateEffect)
+	{
+		ps = color ? pixelateColorPS : pixelatePS;
+		ps->SetInt("pixelSize", pixelSize);
+		ps->SetFloat("width", width);
+		ps->SetFloat("height", height);
+	}
+
+	if (color)
+	{
+		ps->SetInt("ditherPixelSize", pixelSize);
+		ps->SetFloat("ditherSpread", ditherEnabled ? 0.2f : 0.0f);
+		ps->SetFloat("exposureScale", std::exp2(exposure));
+		ps->SetShaderResourceView("ColorLUT", colorLUTSRV);
+		ps->SetSamplerState("ColorLUTSampler", colorLUTSampler);
+	}
+
+	ppVS->SetShader();
+	ps->SetShader();
+	ps->SetShaderResourceView("Pixels", GetGraphSRV(pass.Input));
+	if (ps->HasSamplerState("ClampSampler")) // Others load texels directly
+		ps->SetSamplerState("ClampSampler", ppSampler.Get());
+	ps->CopyAllBufferData();
+	Graphics::Context->Draw(3, 0); // Draw exactly 3 vertices (one triangle)
+
+	// Reset viewport
+	viewport.Width = (float)Window::Width();
+	viewport.Height = (float)Window::Height();
+	Graphics::Context->RSSetViewports(1, &viewport);
+
+	// The next pass may draw into what this one read, and the
+	// scene draws into the depth buffer
+	Graphics::State->UnbindPSShaderResources();
+}
+
+// --------------------------------------------------------
+// Views of the pooled target a graph texture was given
+// --------------------------------------------------------
+ID3D11RenderTargetView* Game::GetGraphRTV(unsigned int texture)
+{
+	if (texture == graphBackBuffer)
+		return Graphics::BackBufferRTV.Get();
+	return graphRTVs[renderGraph.GetSlot(texture)].Get();
+}
+
+ID3D11ShaderResourceView* Game::GetGraphSRV(unsigned int texture)
+{
+	if (texture == graphDepth)
+		return Graphics::DepthBufferSRV.Get();
+	return graphSRVs[renderGraph.GetSlot(texture)].Get();
+}
+
+// --------------------------------------------------------
+// Uploads everything that stays the same for the whole frame
+// and binds it to b0 for both vertex and pixel shaders.
+// Only the lights in use are written, so the upload size
+// scales with the light count rather than MAX_LIGHTS.
+// --------------------------------------------------------
+void Game::UpdatePerFrameData(float totalTime)
+{
+	perFrameData.view = activeCam->GetView();
+	perFrameData.proj = activeCam->GetProjection();
+	perFrameData.lightView = lightViewMatrix;
+	perFrameData.lightProj = lightProjectionMatrix;
+	perFrameData.camPosition = activeCam->GetTransform()->GetPosition();
+	perFrameData.time = totalTime;
+	perFrameData.lightCount = (int)min(lights.size(), (size_t)MAX_LIGHTS);
+	SphericalHarmonics::PackForShader(skyIrradiance, ambientIntensity, perFrameData.ambientSH);
+	if (perFrameData.lightCount > 0)
+		memcpy(perFrameData.lights, &lights[0], sizeof(Light) * perFrameData.lightCount);
+
+	perFrameUploadBytes = (unsigned int)(offsetof(PerFrameData, lights) + sizeof(Light) * perFrameData.lightCount);
+
+	D3D11_MAPPED_SUBRESOURCE mapped = {};
+	Graphics::Context->Map(perFrameBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped);
+	memcpy(mapped.pData, &perFrameData, perFrameUploadBytes);
+	Graphics::Context->Unmap(perFrameBuffer.Get(), 0);
+
+	// Post processing may have put something else in b0 last frame
+	Graphics::State->SetVSConstantBuffer(0, perFrameBuffer.Get());
+	Graphics::State->SetPSConstantBuffer(0, perFrameBuffer.Get());
+}
+
+// --------------------------------------------------------
+// Combines every entity's world matrix with the camera and
+// the light in a single pass, so vertex shaders only need
+// one matrix multiply per position
+// --------------------------------------------------------
+void Game::UpdateObjectMatrices()
+{
+	objectMatrices.Clear();
+	for (auto& e : entities)
+		objectMatrices.Add(e.GetTransform()->GetWorldMatrix());
+
+	objectMatrices.Compute(
+		activeCam->GetView(),
+		activeCam->GetProjection(),
+		lightViewMatrix,
+		lightProjectionMatrix);
+}
+
+// --------------------------------------------------------
+// Writes every entity's PerObject data into the constant
+// ring with a single upload.  Both the shadow and camera
+// passes then bind each entity's block by offset.
+// --------------------------------------------------------
+void Game::UpdateObjectConstants()
+{
+	if (!constantRing)
+		return;
+
+	objectConstants.clear();
+	for (int i = 0; i < entities.size(); i++)
+	{
+		PerObjectData data = {};
+		data.world = entities[i].GetTransform()->GetWorldMatrix();
+		data.worldInvTrans = entities[i].GetTransform()->GetWorldInverseTransposeMatrix();
+		data.wvp = objectMatrices.Get(i).WVP;
+		data.lightWVP = objectMatrices.Get(i).LightWVP;
+		objectConstants.push_back(constantRing->Push(&data, sizeof(PerObjectData)));
+	}
+
+	constantRing->Upload();
+}
+
 void Game::DrawShadowMap() 
 {
 	Graphics::Context->ClearDepthStencilView(shadowDSV.Get(), D3D11_CLEAR_DEPTH, 1.0f, 0);
@@ -856,9 +1483,9 @@ void Game::DrawShadowMap()
 	Graphics::Context->OMSetRenderTargets(1, &nullRTV, shadowDSV.Get());
 
 	// Disable pixel shader
-	Graphics::Context->PSSetShader(0, 0, 0);
+	Graphics::State->SetPixelShader(0);
 
-	Graphics::Context->RSSetState(shadowRasterizer.Get());
+	Graphics::State->SetRasterizerState(shadowRasterizer.Get());
 
 	// Use viewport with our shadow map dimensions
 	D3D11_VIEWPORT viewport = {};
@@ -868,17 +1495,22 @@ void Game::DrawShadowMap()
 	Graphics::Context->RSSetViewports(1, &viewport);
 
 	shadowVS->SetShader();
-	shadowVS->SetMatrix4x4("view", lightViewMatrix);
-	shadowVS->SetMatrix4x4("projection", lightProjectionMatrix);
 
 	// Loop and draw all entities
-	for (auto& e : entities)
+	for (int i = 0; i < entities.size(); i++)
 	{
-		shadowVS->SetMatrix4x4("world", e.GetTransform()->GetWorldMatrix());
-		shadowVS->CopyAllBufferData();
+		if (constantRing)
+		{
+			constantRing->BindVS(2, objectConstants[i]);
+		}
+		else
+		{
+			shadowVS->SetMatrix4x4(shadowLightWVPParam, objectMatrices.Get(i).LightWVP);
+			shadowVS->CopyBufferData(shadowPerObjectParam);
+		}
 
 		// Draw the mesh directly to avoid the entity's material
-		e.GetMesh()->Draw();
+		entities[i].GetMesh()->Draw();
 	}
 
 	// Reset viewport
@@ -890,7 +1522,7 @@ void Game::DrawShadowMap()
 		Graphics::BackBufferRTV.GetAddressOf(),
 		Graphics::DepthBufferDSV.Get());
 
-	Graphics::Context->RSSetState(0);
+	Graphics::State->SetRasterizerState(0);
 }
 
 
@@ -10,8 +10,18 @@
 #include "Camera.h"
 #include "Lights.h"
 #include "Sky.h"
-
-class Game
+#include "InstanceBatcher.h"
+#include "MatrixBatch.h"
+#include "ConstantRing.h"
+#include "ShaderPermutations.h"
+#include "BufferStructs.h"
+#include "TextureStreamer.h"
+#include "PostProcessChain.h"
+#include "RenderGraph.h"
+#include <unordered_map>
+
+// Draws the passes its post chain adds to the frame's render graph
+class Game : public PostProcessBackend
 {
 public:
 	// Basic OOP setup
@@ -33,16 +43,35 @@ private:
 	void LightSetup();
 	void ShadowSetup();
 	void PostProcessSetup();
+	void SelectShaderPermutations();
+	void SortDrawOrder();
+	void UpdateTextureStreaming();
+
+	// Render graph: built once, then rebuilt only when the post
+	// chain's passes or the window size change, and its pooled
+	// targets recreated whenever the pool changes
+	void BuildRenderGraph();
+	void CreateGraphTargets();
 
-	// Post-Process reset
-	void ResetPostProcess();
+	// Rebakes the color LUT from the current color settings
+	void BakeColorLUT();
 
 	// ImGui helper functions
 	void UpdateImGui(float deltaTime);
 	void UpdateInspector(float deltaTime, float totalTime);
 
 	// Draw helpers
+	void UpdatePerFrameData(float totalTime);
+	void UpdateObjectMatrices();
+	void UpdateObjectConstants();
 	void DrawShadowMap();
+	void DrawInstances();
+
+	// Graph passes, given the graph textures they draw into and read
+	void DrawScene(unsigned int target);
+	void DrawPostPass(const PostPass& pass) override;
+	ID3D11RenderTargetView* GetGraphRTV(unsigned int texture);
+	ID3D11ShaderResourceView* GetGraphSRV(unsigned int texture);
 
 	// Note the usage of ComPtr below
 	//  - This is a smart pointer for objects that abide by the
@@ -53,15 +82,51 @@ private:
 	std::vector<std::shared_ptr<Mesh>> meshes;
 	std::vector<GameEntity> entities;
 	std::vector<std::shared_ptr<Material>> materials;
+
+	// Entity indices sorted by pipeline, then material
+	std::vector<unsigned int> drawOrder;
+
+	std::shared_ptr<ShaderPermutations> litShaders;
 	std::vector<std::shared_ptr<Camera>> cameras;
 	std::shared_ptr<Camera> activeCam;
 	int activeCamIndex;
 
+	// Camera & light transforms for each entity, indexed like entities
+	MatrixBatch objectMatrices;
+
+	// Per-object constants for the whole frame, when 11.1 is available.
+	// Handles into the ring are indexed like entities.
+	std::shared_ptr<ConstantRing> constantRing;
+	std::vector<unsigned int> objectConstants;
+
+	// Instancing
+	InstanceBatcher instanceBatcher;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> instanceBuffer;
+	unsigned int instanceBufferCapacity;
+	unsigned int sceneDrawCount;
+
 	// Lights
 	std::vector<Light> lights;
 
-	// Sky
+	// Per-frame constant data, shared by every shader
+	PerFrameData perFrameData;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> perFrameBuffer;
+	unsigned int perFrameUploadBytes;
+
+	// Material maps streamed by mip, as handles into textureStreamer
+	std::shared_ptr<TextureStreamer> textureStreamer;
+	std::unordered_map<Material*, std::vector<unsigned int>> streamedMaps;
+	int textureBudgetMB;
+
+	// Startup timings, in milliseconds
+	float textureDecodeTime;
+	float textureUploadTime;
+	float assetLoadTime;
+
+	// Sky, which also lights the scene as ambient diffuse
 	std::shared_ptr<Sky> skybox;
+	SHColor skyIrradiance;
+	float ambientIntensity;
 
 	// Shadow variables
 	Microsoft::WRL::ComPtr<ID3D11DepthStencilView> shadowDSV;
@@ -69,6 +134,8 @@ private:
 	DirectX::XMFLOAT4X4 lightViewMatrix;
 	DirectX::XMFLOAT4X4 lightProjectionMatrix;
 	std::shared_ptr<SimpleVertexShader> shadowVS;
+	SimpleShaderParam shadowLightWVPParam;
+	SimpleShaderParam shadowPerObjectParam;
 	Microsoft::WRL::ComPtr<ID3D11SamplerState> shadowSampler;
 	Microsoft::WRL::ComPtr<ID3D11RasterizerState> shadowRasterizer;
 	int shadowMapSize;
@@ -78,19 +145,50 @@ private:
 	Microsoft::WRL::ComPtr<ID3D11SamplerState> ppSampler;
 	std::shared_ptr<SimpleVertexShader> ppVS;
 
-	// Resources that are tied to a particular post process
+	// The effects, in order
+	PostProcessChain postChain;
+	unsigned int blurAcrossEffect;
+	unsigned int blurDownEffect;
+	unsigned int pixelateEffect;
+	unsigned int colorEffect;
+
+	// The compiled passes, executed as is each frame until a post
+	// setting or resize marks them dirty, and one target per pool
+	// slot, shared by the graph textures aliased onto it
+	RenderGraph renderGraph;
+	bool graphDirty;
+	unsigned int graphBackBuffer;
+	unsigned int graphDepth;
+	std::vector<RenderGraphTextureDesc> graphPool;
+	std::vector<Microsoft::WRL::ComPtr<ID3D11RenderTargetView>> graphRTVs;
+	std::vector<Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>> graphSRVs;
+
+	// Resources that are tied to a particular post process.  The
+	// _Color shaders end with the color LUT, fused into the same pass.
 	// 
 	// Blur
 	std::shared_ptr<SimplePixelShader> blurPS;
-	Microsoft::WRL::ComPtr<ID3D11RenderTargetView> blurRTV; // For rendering
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> blurSRV; // For sampling
+	std::shared_ptr<SimplePixelShader> blurColorPS;
 	int blurRadius;
+	int blurDownscale; // 1, 2 or 4
+
+	// Reduced resolution: into it, and back up by depth
+	std::shared_ptr<SimplePixelShader> downsamplePS;
+	std::shared_ptr<SimplePixelShader> upsamplePS;
+	std::shared_ptr<SimplePixelShader> upsampleColorPS;
 
 	// Pixel/Dither
-	std::shared_ptr<SimplePixelShader> ditherPS;
-	Microsoft::WRL::ComPtr<ID3D11RenderTargetView> ditherRTV; 
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> ditherSRV; 
+	std::shared_ptr<SimplePixelShader> pixelatePS;
+	std::shared_ptr<SimplePixelShader> pixelateColorPS;
 	int pixelSize;
+	bool ditherEnabled;
+
+	// Color: gamma, grading and the dither palette, baked into a LUT
+	std::shared_ptr<SimplePixelShader> colorPS;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> colorLUTSRV;
+	Microsoft::WRL::ComPtr<ID3D11SamplerState> colorLUTSampler;
+	float exposure;	// In stops, applied ahead of the LUT
+	float saturation;
 
 	// Additional variables
 	bool imGuiDemoVisible;
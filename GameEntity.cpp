@@ -6,7 +6,8 @@ using namespace DirectX;
 
 GameEntity::GameEntity(std::shared_ptr<Mesh> mesh, std::shared_ptr<Material> mat) :
 	mesh(mesh),
-	material(mat)
+	material(mat),
+	paramShader(0)
 {
 	transform = std::make_shared<Transform>();
 }
@@ -19,26 +20,57 @@ void GameEntity::SetMat(std::shared_ptr<Material> mat) { material = mat; }
 
 std::shared_ptr<Transform> GameEntity::GetTransform() { return transform; }
 
-void GameEntity::Draw(std::shared_ptr<Camera> camera)
+// --------------------------------------------------------
+// Looks up the per-object variables in the current vertex
+// shader, so drawing sets them without any name lookups
+// --------------------------------------------------------
+void GameEntity::ResolveParams()
+{
+	paramShader = material->GetVS().get();
+	worldParam = paramShader->GetVariableParam(SimpleShaderHash("world"));
+	worldInvTransParam = paramShader->GetVariableParam(SimpleShaderHash("worldInvTrans"));
+	wvpParam = paramShader->GetVariableParam(SimpleShaderHash("wvp"));
+	lightWVPParam = paramShader->GetVariableParam(SimpleShaderHash("lightWVP"));
+	perObjectParam = paramShader->GetBufferParam(SimpleShaderHash("PerObject"));
+}
+
+// --------------------------------------------------------
+// Draws with this entity's material.  Per-frame data and the
+// material itself (Material::PrepareMaterial) must already be
+// set up, leaving only the per-object buffer to upload here.
+// The combined matrices come from a MatrixBatch.
+// --------------------------------------------------------
+void GameEntity::Draw(const XMFLOAT4X4& wvp, const XMFLOAT4X4& lightWVP)
 {
 	material->GetVS()->SetShader();
 	material->GetPS()->SetShader();
 
-	// Handles certain parts of draw setup internally, such as setting pixel shader info
-	material->PrepareMaterial();
-
 	// Copy data to cbuffers
 	
 	// vertex shader
 	std::shared_ptr<SimpleVertexShader> vs = material->GetVS();
+	if (vs.get() != paramShader)
+		ResolveParams();
 
-	vs->SetMatrix4x4("world", transform->GetWorldMatrix()); 
-	vs->SetMatrix4x4("worldInvTrans", transform->GetWorldInverseTransposeMatrix());
-	vs->SetMatrix4x4("view", camera->GetView()); 
-	vs->SetMatrix4x4("proj", camera->GetProjection()); 
+	vs->SetMatrix4x4(worldParam, transform->GetWorldMatrix());
+	vs->SetMatrix4x4(worldInvTransParam, transform->GetWorldInverseTransposeMatrix());
+	vs->SetMatrix4x4(wvpParam, wvp);
+	vs->SetMatrix4x4(lightWVPParam, lightWVP);
 
-	vs->CopyAllBufferData();
+	vs->CopyBufferData(perObjectParam);
 
 	// Draw mesh
 	mesh.get()->Draw();
 }
+
+// --------------------------------------------------------
+// Draws with this entity's material when the caller has
+// already bound the per-object data (see ConstantRing)
+// --------------------------------------------------------
+void GameEntity::DrawPrebound()
+{
+	material->GetVS()->SetShader();
+	material->GetPS()->SetShader();
+
+	mesh.get()->Draw();
+}
@@ -12,6 +12,16 @@ private:
 	std::shared_ptr<Transform> transform;
 	std::shared_ptr<Mesh> mesh;
 	std::shared_ptr<Material> material;
+
+	// Per-object handles into the material's vertex shader,
+	// resolved again whenever that shader changes
+	SimpleVertexShader* paramShader;
+	SimpleShaderParam worldParam;
+	SimpleShaderParam worldInvTransParam;
+	SimpleShaderParam wvpParam;
+	SimpleShaderParam lightWVPParam;
+	SimpleShaderParam perObjectParam;
+	void ResolveParams();
 // Public data
 public:
 	GameEntity(std::shared_ptr<Mesh> mesh, std::shared_ptr<Material> mat);
@@ -19,5 +29,6 @@ public:
 	std::shared_ptr<Material> GetMat();
 	void SetMat(std::shared_ptr<Material> mat);
 	std::shared_ptr<Transform> GetTransform();
-	void Draw(std::shared_ptr<Camera> camera);
+	void Draw(const DirectX::XMFLOAT4X4& wvp, const DirectX::XMFLOAT4X4& lightWVP);
+	void DrawPrebound();
 };
\ No newline at end of file
@@ -0,0 +1,97 @@
+#include "GaussianBlur.h"
+#include <DirectXMath.h>
+#include <DirectXPackedVector.h>
+#include <algorithm>
+#include <cmath>
+
+using namespace DirectX;
+using namespace DirectX::PackedVector;
+
+namespace
+{
+	XMVECTOR LoadPixel(const BlockImage& image, int x, int y)
+	{
+		x = std::clamp(x, 0, (int)image.Width - 1);
+		y = std::clamp(y, 0, (int)image.Height - 1);
+		return XMLoadUByteN4((const XMUBYTEN4*)&image.Pixels[((size_t)y * image.Width + x) * 4]);
+	}
+
+	// One pass, stepping (dx, dy) texels per weight
+	BlockImage BlurPass(const BlockImage& image, const std::vector<float>& weights, int dx, int dy)
+	{
+		BlockImage result = {};
+		result.Width = image.Width;
+		result.Height = image.Height;
+		result.Pixels.resize(image.Pixels.size());
+
+		int radius = (int)weights.size() - 1;
+		for (int y = 0; y < (int)image.Height; y++)
+		{
+			for (int x = 0; x < (int)image.Width; x++)
+			{
+				XMVECTOR total = XMVectorScale(LoadPixel(image, x, y), weights[0]);
+				for (int i = 1; i <= radius; i++)
+				{
+					XMVECTOR pair = XMVectorAdd(
+						LoadPixel(image, x + dx * i, y + dy * i),
+						LoadPixel(image, x - dx * i, y - dy * i));
+					total = XMVectorMultiplyAdd(pair, XMVectorReplicate(weights[i]), total);
+				}
+				XMStoreUByteN4((XMUBYTEN4*)&result.Pixels[((size_t)y * image.Width + x) * 4], total);
+			}
+		}
+		return result;
+	}
+}
+
+std::vector<float> GaussianBlur::GetWeights(int radius)
+{
+	radius = std::clamp(radius, 0, MAX_BLUR_RADIUS);
+	std::vector<float> weights(radius + 1, 1.0f);
+	if (radius == 0)
+		return weights;
+
+	float sigma = radius / 3.0f;
+	float total = 0;
+	for (int i = 0; i <= radius; i++)
+	{
+		weights[i] = std::exp(-(float)(i * i) / (2 * sigma * sigma));
+		total += i == 0 ? weights[i] : weights[i] * 2;
+	}
+	for (float& w : weights)
+		w /= total;
+	return weights;
+}
+
+// --------------------------------------------------------
+// Texels 1 & 2, 3 & 4 and so on share a tap, placed so a
+// bilinear sample weights each by its own share.  With an
+// odd radius the last texel is left over, so gets a tap
+// of its own.
+// --------------------------------------------------------
+std::vector<BlurTap> GaussianBlur::GetLinearTaps(int radius)
+{
+	std::vector<float> weights = GetWeights(radius);
+	radius = (int)weights.size() - 1;
+
+	std::vector<BlurTap> taps;
+	taps.push_back({ 0.0f, weights[0] });
+	for (int i = 1; i <= radius; i += 2)
+	{
+		if (i == radius)
+		{
+			taps.push_back({ (float)i, weights[i] });
+			break;
+		}
+
+		float weight = weights[i] + weights[i + 1];
+		taps.push_back({ (i * weights[i] + (i + 1) * weights[i + 1]) / weight, weight });
+	}
+	return taps;
+}
+
+BlockImage GaussianBlur::Blur(const BlockImage& image, int radius)
+{
+	std::vector<float> weights = GetWeights(radius);
+	return BlurPass(BlurPass(image, weights, 1, 0), weights, 0, 1);
+}
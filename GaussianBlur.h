@@ -0,0 +1,47 @@
+#pragma once
+
+#include <vector>
+#include "BlockCompression.h"
+
+// Largest radius the blur shader has room for
+#define MAX_BLUR_RADIUS 32
+
+// Taps a MAX_BLUR_RADIUS kernel takes (must match BlurPostProcess.hlsl)
+#define MAX_BLUR_TAPS (1 + (MAX_BLUR_RADIUS + 1) / 2)
+
+// --------------------------------------------------------
+// One sample of a bilinear blur pass: an offset from the
+// center, in texels, and its weight.  Every tap but the
+// first is taken on both sides of the center.
+// --------------------------------------------------------
+struct BlurTap
+{
+	float Offset;
+	float Weight;
+};
+
+// --------------------------------------------------------
+// The Gaussian blur post process, as separable passes:
+// horizontal, then vertical, so a radius r costs O(r) per
+// pixel rather than O(r^2).  The kernel reaches 3 standard
+// deviations, and is normalized over its 2r + 1 texels.
+//
+// On the GPU, each pair of neighbouring texels is read with
+// one bilinear sample placed between them by their weights,
+// roughly halving the taps.  Blur() is the same filter on
+// the CPU with the texels' own weights, for comparing GPU
+// output against.
+// --------------------------------------------------------
+namespace GaussianBlur
+{
+	// Weights of the center texel and those to one side (radius + 1)
+	std::vector<float> GetWeights(int radius);
+
+	// Taps for the blur shader, center first
+	std::vector<BlurTap> GetLinearTaps(int radius);
+
+	// Both passes over an RGBA8 image, clamping at its edges.  The
+	// horizontal pass is rounded to 8 bits, where the GPU keeps half
+	// floats, so results can differ by that rounding.
+	BlockImage Blur(const BlockImage& image, int radius);
+}
@@ -1,5 +1,6 @@
 #include "Graphics.h"
 #include <dxgi1_6.h>
+#include "D3D11StateCacheBackend.h"
 
 // Tell the drivers to use high-performance GPU in multi-GPU systems (like laptops)
 extern "C"
@@ -122,6 +123,10 @@ HRESULT Graphics::Initialize(unsigned int windowWidth, unsigned int windowHeight
 		Context.GetAddressOf());	// Pointer to our Device Context pointer
 	if (FAILED(hr)) return hr;
 
+	// Track bound state so repeated binds can be skipped
+	State = std::make_shared<StateCache>(std::make_shared<D3D11StateCacheBackend>(Context));
+	Pipelines = std::make_shared<PipelineStates>(Device);
+
 	// We're set up
 	apiInitialized = true;
 
@@ -174,6 +179,7 @@ void Graphics::ResizeBuffers(unsigned int width, unsigned int height)
 
 	BackBufferRTV.Reset();
 	DepthBufferDSV.Reset();
+	DepthBufferSRV.Reset();
 
 	// Resize the swap chain buffers
 	SwapChain->ResizeBuffers(
@@ -203,9 +209,9 @@ void Graphics::ResizeBuffers(unsigned int width, unsigned int height)
 	depthStencilDesc.Height = height;
 	depthStencilDesc.MipLevels = 1;
 	depthStencilDesc.ArraySize = 1;
-	depthStencilDesc.Format = DXGI_FORMAT_D24_UNORM_S8_UINT;
+	depthStencilDesc.Format = DXGI_FORMAT_R24G8_TYPELESS; // Typeless so it can also be read
 	depthStencilDesc.Usage = D3D11_USAGE_DEFAULT;
-	depthStencilDesc.BindFlags = D3D11_BIND_DEPTH_STENCIL;
+	depthStencilDesc.BindFlags = D3D11_BIND_DEPTH_STENCIL | D3D11_BIND_SHADER_RESOURCE;
 	depthStencilDesc.CPUAccessFlags = 0;
 	depthStencilDesc.MiscFlags = 0;
 	depthStencilDesc.SampleDesc.Count = 1;
@@ -215,11 +221,24 @@ void Graphics::ResizeBuffers(unsigned int width, unsigned int height)
 	// release our reference to the texture
 	Microsoft::WRL::ComPtr<ID3D11Texture2D> depthBufferTexture;
 	Device->CreateTexture2D(&depthStencilDesc, 0, &depthBufferTexture);
+	D3D11_DEPTH_STENCIL_VIEW_DESC dsvDesc = {};
+	dsvDesc.Format = DXGI_FORMAT_D24_UNORM_S8_UINT;
+	dsvDesc.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2D;
 	Device->CreateDepthStencilView(
 		depthBufferTexture.Get(),
-		0,
+		&dsvDesc,
 		DepthBufferDSV.GetAddressOf()); 
 
+	// Post processes read depth through its own view
+	D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+	srvDesc.Format = DXGI_FORMAT_R24_UNORM_X8_TYPELESS;
+	srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+	srvDesc.Texture2D.MipLevels = 1;
+	Device->CreateShaderResourceView(
+		depthBufferTexture.Get(),
+		&srvDesc,
+		DepthBufferSRV.GetAddressOf());
+
 	// Bind the views to the pipeline, so rendering properly 
 	// uses their underlying textures
 	Context->OMSetRenderTargets(
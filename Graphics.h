@@ -4,6 +4,9 @@
 #include <d3d11.h>
 #include <string>
 #include <wrl/client.h>
+#include <memory>
+#include "StateCache.h"
+#include "PipelineStates.h"
 
 #pragma comment(lib, "d3d11.lib")
 #pragma comment(lib, "dxgi.lib")
@@ -17,9 +20,16 @@ namespace Graphics
 	inline Microsoft::WRL::ComPtr<ID3D11DeviceContext> Context;
 	inline Microsoft::WRL::ComPtr<IDXGISwapChain> SwapChain;
 
+	// Filters redundant binds before they reach the Context
+	inline std::shared_ptr<StateCache> State;
+
+	// Shared rasterizer, depth and sampler states, one per description
+	inline std::shared_ptr<PipelineStates> Pipelines;
+
 	// Rendering buffers
 	inline Microsoft::WRL::ComPtr<ID3D11RenderTargetView> BackBufferRTV;
 	inline Microsoft::WRL::ComPtr<ID3D11DepthStencilView> DepthBufferDSV;
+	inline Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> DepthBufferSRV; // Depth only, for post processing
 
 	// --- FUNCTIONS ---
 
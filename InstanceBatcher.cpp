@@ -0,0 +1,67 @@
+#include "InstanceBatcher.h"
+#include <algorithm>
+#include <functional>
+
+// --------------------------------------------------------
+// Removes everything added this frame (capacity is kept)
+// --------------------------------------------------------
+void InstanceBatcher::Clear()
+{
+	entries.clear();
+	unsortedData.clear();
+	groups.clear();
+	packedData.clear();
+}
+
+// --------------------------------------------------------
+// Queues one object to be drawn
+// --------------------------------------------------------
+void InstanceBatcher::Add(const void* mesh, const void* material, const InstanceData& data)
+{
+	Entry entry = {};
+	entry.Mesh = mesh;
+	entry.Material = material;
+	entry.Index = (unsigned int)unsortedData.size();
+	entries.push_back(entry);
+
+	unsortedData.push_back(data);
+}
+
+// --------------------------------------------------------
+// Sorts the queued objects by material, then mesh, and
+// writes out one group per unique pair.  Sorting by material
+// first keeps material changes to a minimum between groups.
+// The sort is stable so instances keep their submission order.
+// --------------------------------------------------------
+void InstanceBatcher::Build()
+{
+	groups.clear();
+	packedData.clear();
+	packedData.reserve(entries.size());
+
+	std::less<const void*> before;
+	std::stable_sort(entries.begin(), entries.end(),
+		[&](const Entry& a, const Entry& b)
+		{
+			if (a.Material != b.Material) return before(a.Material, b.Material);
+			return before(a.Mesh, b.Mesh);
+		});
+
+	for (const Entry& e : entries)
+	{
+		// Start a new group whenever the pair changes
+		if (groups.empty() ||
+			groups.back().Mesh != e.Mesh ||
+			groups.back().Material != e.Material)
+		{
+			InstanceGroup group = {};
+			group.Mesh = e.Mesh;
+			group.Material = e.Material;
+			group.FirstInstance = (unsigned int)packedData.size();
+			groups.push_back(group);
+		}
+
+		packedData.push_back(unsortedData[e.Index]);
+		groups.back().InstanceCount++;
+	}
+}
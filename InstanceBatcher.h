@@ -0,0 +1,62 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <vector>
+
+// --------------------------------------------------------
+// Per-instance vertex data, read from input slot 1 by
+// VertexShaderInstanced.hlsl (one row per semantic index)
+// --------------------------------------------------------
+struct InstanceData
+{
+	DirectX::XMFLOAT4X4 World;
+	DirectX::XMFLOAT4X4 WorldInvTrans;
+	DirectX::XMFLOAT4X4 WVP;
+	DirectX::XMFLOAT4X4 LightWVP;
+};
+
+// --------------------------------------------------------
+// A run of instances that share a mesh and a material and
+// can therefore go out in a single instanced draw
+// --------------------------------------------------------
+struct InstanceGroup
+{
+	const void* Mesh;
+	const void* Material;
+	unsigned int FirstInstance;
+	unsigned int InstanceCount;
+};
+
+// --------------------------------------------------------
+// Groups objects by mesh & material and packs their
+// matrices so each group is contiguous in one buffer.
+//
+// Meshes and materials are only used as identities, so
+// this has no dependency on the graphics API.
+// --------------------------------------------------------
+class InstanceBatcher
+{
+public:
+	void Clear();
+	void Add(const void* mesh, const void* material, const InstanceData& data);
+	void Build();
+
+	const std::vector<InstanceGroup>& GetGroups() { return groups; }
+	const std::vector<InstanceData>& GetInstanceData() { return packedData; }
+	unsigned int GetInstanceCount() { return (unsigned int)packedData.size(); }
+
+private:
+	struct Entry
+	{
+		const void* Mesh;
+		const void* Material;
+		unsigned int Index; // Into unsortedData
+	};
+
+	std::vector<Entry> entries;
+	std::vector<InstanceData> unsortedData;
+
+	// Results of Build()
+	std::vector<InstanceGroup> groups;
+	std::vector<InstanceData> packedData;
+};
@@ -6,6 +6,9 @@
 #define LIGHT_TYPE_POINT		1
 #define LIGHT_TYPE_SPOT			2
 
+// Must match MAX_LIGHTS in ShaderStructs.hlsli
+#define MAX_LIGHTS				128
+
 
 struct Light 
 {
@@ -1,4 +1,6 @@
 #include "Material.h"
+#include "ShaderPermutations.h"
+#include "Graphics.h"
 #include "ImGui/imgui.h"
 #include "ImGui/imgui_impl_dx11.h"
 #include "ImGui/imgui_impl_win32.h"
@@ -6,51 +8,179 @@
 using namespace DirectX;
 
 Material::Material(DirectX::XMFLOAT4 colorTint, float roughness, std::shared_ptr<SimpleVertexShader> vertexShader, std::shared_ptr<SimplePixelShader> pixelShader) :
-	tint(colorTint),
 	vs(vertexShader),
-	ps(pixelShader),
-	roughness(roughness)
+	ps(pixelShader)
 {
-	scale = XMFLOAT2(1, 1);
-	offset = XMFLOAT2(0, 0);
+	params = {};
+	params.colorTint = colorTint;
+	params.textureScale = XMFLOAT2(1, 1);
+	params.textureOffset = XMFLOAT2(0, 0);
+	params.roughness = roughness;
+
+	// Nothing has reached the GPU yet
+	paramsVersion = 1;
+	uploadedVersion = 0;
+	textureArrays = false;
+
+	D3D11_BUFFER_DESC desc = {};
+	desc.Usage = D3D11_USAGE_DEFAULT;
+	desc.ByteWidth = sizeof(PerMaterialData);
+	desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	Graphics::Device->CreateBuffer(&desc, 0, paramsBuffer.GetAddressOf());
+
+	ResolveSlots();
 }
 
-XMFLOAT4 Material::GetTint(){ return tint;}
+// --------------------------------------------------------
+// Looks up the register of every input in the current
+// pixel shader
+// --------------------------------------------------------
+void Material::ResolveSlots()
+{
+	const SimpleConstantBuffer* cb = ps->GetBufferInfo("PerMaterial");
+	paramsSlot = cb ? cb->BindIndex : (unsigned int)-1;
+
+	textureSlots.clear();
+	for (auto& t : textureSRVs)
+		AddTextureSlot(t.first, t.second);
 
-XMFLOAT2 Material::GetScale() { return scale; }
+	samplerSlots.clear();
+	for (auto& s : samplers)
+		AddSamplerSlot(s.first, s.second);
+}
+
+// Inputs the shader doesn't use are left out of the table
+void Material::AddTextureSlot(const std::string& name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
+{
+	const SimpleSRV* info = ps->GetShaderResourceViewInfo(name);
+	if (info)
+		textureSlots.push_back({ info->BindIndex, srv });
+}
+
+void Material::AddSamplerSlot(const std::string& name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState)
+{
+	const SimpleSampler* info = ps->GetSamplerInfo(name);
+	if (info)
+		samplerSlots.push_back({ info->BindIndex, samplerState });
+}
 
-XMFLOAT2 Material::GetOffset() { return offset; }
+XMFLOAT4 Material::GetTint(){ return params.colorTint;}
+
+XMFLOAT2 Material::GetScale() { return params.textureScale; }
+
+XMFLOAT2 Material::GetOffset() { return params.textureOffset; }
+
+float Material::GetRoughness() { return params.roughness; }
 
 std::shared_ptr<SimpleVertexShader> Material::GetVS() { return vs; }
 
 std::shared_ptr<SimplePixelShader> Material::GetPS() { return ps; }
 
-void Material::SetTint(DirectX::XMFLOAT4 newTint) { tint = newTint; }
+std::shared_ptr<SimpleVertexShader> Material::GetInstancedVS() { return instancedVS; }
+
+void Material::SetTint(DirectX::XMFLOAT4 newTint) { params.colorTint = newTint; paramsVersion++; }
+
+void Material::SetScale(DirectX::XMFLOAT2 newScale){ params.textureScale = newScale; paramsVersion++; }
+
+void Material::SetOffset(DirectX::XMFLOAT2 newOffset) { params.textureOffset = newOffset; paramsVersion++; }
+
+void Material::SetRoughness(float newRoughness) { params.roughness = newRoughness; paramsVersion++; }
+
+// Optional vertex shader that reads world matrices per instance,
+// letting entities that share this material be drawn together
+void Material::SetInstancedVS(std::shared_ptr<SimpleVertexShader> vertexShader) { instancedVS = vertexShader; }
 
-void Material::SetScale(DirectX::XMFLOAT2 newScale){ scale = newScale; }
+// Swapping shaders (to another permutation, say) needs every slot resolved again
+void Material::SetPS(std::shared_ptr<SimplePixelShader> pixelShader)
+{
+	ps = pixelShader;
+	ResolveSlots();
+}
 
-void Material::SetOffset(DirectX::XMFLOAT2 newOffset) { offset = newOffset; }
+// --------------------------------------------------------
+// Shader features this material can feed, based on which
+// textures it has (see ShaderPermutationTable.h)
+// --------------------------------------------------------
+unsigned int Material::GetFeatures()
+{
+	unsigned int features = 0;
+	if (textureSRVs.count("NormalMap"))
+		features |= SHADER_FEATURE_NORMAL_MAP;
+	if (textureSRVs.count("SurfaceMap"))
+		features |= SHADER_FEATURE_PBR_MAPS;
+	if (textureSRVs.count("ShadowMap"))
+		features |= SHADER_FEATURE_SHADOWS;
+	if (textureArrays)
+		features |= SHADER_FEATURE_TEXTURE_ARRAYS;
+	return features;
+}
 
 void Material::AddTextureSRV(std::string shaderVariableName, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
 {
-	textureSRVs.insert({ shaderVariableName, srv });
+	if (textureSRVs.insert({ shaderVariableName, srv }).second)
+		AddTextureSlot(shaderVariableName, srv);
+}
+
+// --------------------------------------------------------
+// Uses one slice of a texture array (see TextureArrayImporter)
+// for a map.  The slice goes in the parameter block, so
+// materials sharing arrays differ only in their constants.
+// Needs a pixel shader built with PERM_TEXTURE_ARRAYS.
+// --------------------------------------------------------
+void Material::AddTextureArray(std::string shaderVariableName, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> arraySRV, unsigned int slice)
+{
+	if (shaderVariableName == "Albedo") params.albedoSlice = slice;
+	else if (shaderVariableName == "NormalMap") params.normalSlice = slice;
+	else if (shaderVariableName == "SurfaceMap") params.surfaceSlice = slice;
+	paramsVersion++;
+
+	textureArrays = true;
+	AddTextureSRV(shaderVariableName, arraySRV);
+}
+
+// --------------------------------------------------------
+// Swaps every use of a view for another, such as when
+// TextureStreamer recreates an array with more or fewer mips
+// --------------------------------------------------------
+void Material::ReplaceTextureSRV(ID3D11ShaderResourceView* oldSRV, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> newSRV)
+{
+	for (auto& t : textureSRVs)
+		if (t.second.Get() == oldSRV)
+			t.second = newSRV;
+	for (auto& t : textureSlots)
+		if (t.second.Get() == oldSRV)
+			t.second = newSRV;
 }
 
 void Material::AddSampler(std::string shaderVariableName, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState)
 {
-	samplers.insert({ shaderVariableName, samplerState });
+	if (samplers.insert({ shaderVariableName, samplerState }).second)
+		AddSamplerSlot(shaderVariableName, samplerState);
 }
 
+// --------------------------------------------------------
+// Binds this material's inputs to the pixel shader stage,
+// uploading its parameters first if they've changed since
+// the last upload.  Binds go through the state cache, so
+// preparing the same material twice in a row is nearly free.
+// --------------------------------------------------------
 void Material::PrepareMaterial()
 {
-	for (auto& t : textureSRVs) { ps->SetShaderResourceView(t.first.c_str(), t.second); }
-	for (auto& s : samplers) { ps->SetSamplerState(s.first.c_str(), s.second); }
-
-	ps->SetFloat4("colorTint", tint);
-	ps->SetFloat2("textureScale", scale);
-	ps->SetFloat2("textureOffset", offset);
-	ps->SetFloat("roughness", roughness);
-	ps->CopyAllBufferData();
+	if (uploadedVersion != paramsVersion)
+	{
+		Graphics::Context->UpdateSubresource(paramsBuffer.Get(), 0, 0, &params, 0, 0);
+		uploadedVersion = paramsVersion;
+
+		// Counted with the shaders' own uploads so the totals stay complete
+		ISimpleShader::UploadStats.Uploads++;
+		ISimpleShader::UploadStats.Bytes += sizeof(PerMaterialData);
+	}
+
+	if (paramsSlot != (unsigned int)-1)
+		Graphics::State->SetPSConstantBuffer(paramsSlot, paramsBuffer.Get());
+
+	for (auto& t : textureSlots) { Graphics::State->SetPSShaderResource(t.first, t.second.Get()); }
+	for (auto& s : samplerSlots) { Graphics::State->SetPSSampler(s.first, s.second.Get()); }
 }
 
 // Helper function for building ImGui menu
@@ -59,10 +189,19 @@ void Material::CreateGUI()
 {
 	for (auto& t : textureSRVs) 
 	{
+		// ImGui can only show plain 2D textures
+		if (t.second)
+		{
+			D3D11_SHADER_RESOURCE_VIEW_DESC desc = {};
+			t.second->GetDesc(&desc);
+			if (desc.ViewDimension != D3D11_SRV_DIMENSION_TEXTURE2D)
+				continue;
+		}
+
 		ImGui::Image((ImTextureID)t.second.Get(), ImVec2(64,64));
 	}
 
-	(ImGui::ColorEdit4("Tint", &tint.x));
-	(ImGui::SliderFloat2("Scale", &scale.x, 0.5f, 5.0f));
-	(ImGui::SliderFloat2("Offset", &offset.x, -1.0f, 1.0f));
+	if (ImGui::ColorEdit4("Tint", &params.colorTint.x)) paramsVersion++;
+	if (ImGui::SliderFloat2("Scale", &params.textureScale.x, 0.5f, 5.0f)) paramsVersion++;
+	if (ImGui::SliderFloat2("Offset", &params.textureOffset.x, -1.0f, 1.0f)) paramsVersion++;
 }
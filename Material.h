@@ -3,21 +3,41 @@
 #include <DirectXMath.h>
 #include <memory>
 #include "SimpleShader.h"
+#include "BufferStructs.h"
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 class Material 
 {
 private:
-	DirectX::XMFLOAT4 tint;
-	DirectX::XMFLOAT2 scale;
-	DirectX::XMFLOAT2 offset;
-	float roughness;
 	std::shared_ptr<SimpleVertexShader> vs;
 	std::shared_ptr<SimplePixelShader> ps;
+	std::shared_ptr<SimpleVertexShader> instancedVS;
 	std::unordered_map<std::string, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>> textureSRVs;
 	std::unordered_map<std::string, Microsoft::WRL::ComPtr<ID3D11SamplerState>> samplers;
 
+	// Values for the PerMaterial cbuffer.  Every change bumps
+	// paramsVersion, and the GPU copy is only rewritten when
+	// it no longer matches uploadedVersion.
+	PerMaterialData params;
+	unsigned int paramsVersion;
+	unsigned int uploadedVersion;
+
+	// Whether textures are slices of arrays rather than whole textures
+	bool textureArrays;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> paramsBuffer;
+
+	// Pixel shader registers, resolved up front so preparing
+	// the material is just a run of binds.  A slot of -1 means
+	// the shader doesn't use that input.
+	unsigned int paramsSlot;
+	std::vector<std::pair<unsigned int, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>>> textureSlots;
+	std::vector<std::pair<unsigned int, Microsoft::WRL::ComPtr<ID3D11SamplerState>>> samplerSlots;
+	void ResolveSlots();
+	void AddTextureSlot(const std::string& name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv);
+	void AddSamplerSlot(const std::string& name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState);
+
 public:
 	Material(DirectX::XMFLOAT4 colorTint, float roughness, std::shared_ptr<SimpleVertexShader> vertexShader, std::shared_ptr<SimplePixelShader> pixelShader);
 
@@ -25,13 +45,21 @@ public:
 	DirectX::XMFLOAT4 GetTint();
 	DirectX::XMFLOAT2 GetScale();
 	DirectX::XMFLOAT2 GetOffset();
+	float GetRoughness();
 	std::shared_ptr<SimpleVertexShader> GetVS();
 	std::shared_ptr<SimplePixelShader> GetPS();
+	std::shared_ptr<SimpleVertexShader> GetInstancedVS();
 
 	void SetTint(DirectX::XMFLOAT4 tint);
 	void SetScale(DirectX::XMFLOAT2 scale);
 	void SetOffset(DirectX::XMFLOAT2 offset);
+	void SetRoughness(float roughness);
+	void SetInstancedVS(std::shared_ptr<SimpleVertexShader> vertexShader);
+	void SetPS(std::shared_ptr<SimplePixelShader> pixelShader);
+	unsigned int GetFeatures();
 	void AddTextureSRV(std::string shaderVariableName, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv);
+	void AddTextureArray(std::string shaderVariableName, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> arraySRV, unsigned int slice);
+	void ReplaceTextureSRV(ID3D11ShaderResourceView* oldSRV, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> newSRV);
 	void AddSampler(std::string shaderVariableName, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState);
 	void PrepareMaterial();
 	void CreateGUI();
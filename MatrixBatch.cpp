@@ -0,0 +1,43 @@
+#include "MatrixBatch.h"
+
+using namespace DirectX;
+
+// --------------------------------------------------------
+// Removes all objects (capacity is kept)
+// --------------------------------------------------------
+void MatrixBatch::Clear()
+{
+	worlds.clear();
+	results.clear();
+}
+
+// --------------------------------------------------------
+// Queues an object's world matrix and returns its index
+// --------------------------------------------------------
+unsigned int MatrixBatch::Add(const XMFLOAT4X4& world)
+{
+	worlds.push_back(world);
+	return (unsigned int)worlds.size() - 1;
+}
+
+// --------------------------------------------------------
+// Transforms every queued world matrix by the camera and
+// the light.  Matrices stay in DirectXMath's row-vector
+// order, which is what the shaders expect once the
+// column-major cbuffer/vertex layout is accounted for.
+// --------------------------------------------------------
+void MatrixBatch::Compute(const XMFLOAT4X4& view, const XMFLOAT4X4& proj, const XMFLOAT4X4& lightView, const XMFLOAT4X4& lightProj)
+{
+	XMMATRIX viewProj = XMMatrixMultiply(XMLoadFloat4x4(&view), XMLoadFloat4x4(&proj));
+	XMMATRIX lightViewProj = XMMatrixMultiply(XMLoadFloat4x4(&lightView), XMLoadFloat4x4(&lightProj));
+
+	size_t count = worlds.size();
+	results.resize(count);
+
+	for (size_t i = 0; i < count; i++)
+	{
+		XMMATRIX world = XMLoadFloat4x4(&worlds[i]);
+		XMStoreFloat4x4(&results[i].WVP, XMMatrixMultiply(world, viewProj));
+		XMStoreFloat4x4(&results[i].LightWVP, XMMatrixMultiply(world, lightViewProj));
+	}
+}
\ No newline at end of file
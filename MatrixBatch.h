@@ -0,0 +1,40 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <vector>
+
+// --------------------------------------------------------
+// Camera and light transforms for a single object, ready
+// to upload: shaders apply each with one multiply
+// --------------------------------------------------------
+struct ObjectMatrices
+{
+	DirectX::XMFLOAT4X4 WVP;
+	DirectX::XMFLOAT4X4 LightWVP;
+};
+
+// --------------------------------------------------------
+// Builds world-view-projection matrices for many objects in
+// one pass.  The view-projection products are formed once,
+// leaving two SIMD matrix multiplies per object instead of
+// four multiplies per vertex in the vertex shader.
+// --------------------------------------------------------
+class MatrixBatch
+{
+public:
+	void Clear();
+	unsigned int Add(const DirectX::XMFLOAT4X4& world);
+	void Compute(
+		const DirectX::XMFLOAT4X4& view,
+		const DirectX::XMFLOAT4X4& proj,
+		const DirectX::XMFLOAT4X4& lightView,
+		const DirectX::XMFLOAT4X4& lightProj);
+
+	// Valid after Compute(), using the index returned by Add()
+	const ObjectMatrices& Get(unsigned int index) { return results[index]; }
+	unsigned int GetCount() { return (unsigned int)worlds.size(); }
+
+private:
+	std::vector<DirectX::XMFLOAT4X4> worlds;
+	std::vector<ObjectMatrices> results;
+};
\ No newline at end of file
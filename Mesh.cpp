@@ -1,6 +1,7 @@
 #include "Mesh.h"
 #include <fstream>
 #include <stdexcept>
+#include <cfloat>
 #include <vector>
 #include <DirectXMath.h>
 
@@ -13,6 +14,7 @@ Mesh::Mesh(Vertex vertices[], unsigned int indices[], int newVertexCount, int ne
 	name(newName)
 {
 	CalculateTangents(&vertices[0], vertexCount, &indices[0], indexCount);
+	CalculateBounds(&vertices[0], vertexCount, &indices[0], indexCount);
 	CreateBuffers(&vertices[0], &indices[0], vertexCount, indexCount);
 }
 
@@ -277,6 +279,7 @@ Mesh::Mesh(const char* objFile, std::string newName) :
 	indexCount = indexCounter;
 
 	CalculateTangents(&verts[0], vertexCount, &indices[0], indexCount);
+	CalculateBounds(&verts[0], vertexCount, &indices[0], indexCount);
 	CreateBuffers(&verts[0], &indices[0], vertexCount, indexCount);
 }
 
@@ -307,6 +310,18 @@ std::string Mesh::GetName() {
 	return name;
 }
 
+XMFLOAT3 Mesh::GetBoundsCenter() {
+	return boundsCenter;
+}
+
+float Mesh::GetBoundsRadius() {
+	return boundsRadius;
+}
+
+float Mesh::GetUVDensity() {
+	return uvDensity;
+}
+
 
 /// <summary>
 /// Draws mesh
@@ -314,12 +329,25 @@ std::string Mesh::GetName() {
 void Mesh::Draw() {
 	UINT stride = sizeof(Vertex);
 	UINT offset = 0;
-	Graphics::Context->IASetVertexBuffers(0, 1, vertexBuffer.GetAddressOf(), &stride, &offset);
-	Graphics::Context->IASetIndexBuffer(indexBuffer.Get(), DXGI_FORMAT_R32_UINT, 0);
+	Graphics::State->SetVertexBuffer(0, vertexBuffer.Get(), stride, offset);
+	Graphics::State->SetIndexBuffer(indexBuffer.Get(), DXGI_FORMAT_R32_UINT, 0);
 
 	Graphics::Context->DrawIndexed(indexCount,0,0);    
 }
 
+/// <summary>
+/// Draws several copies of the mesh, reading per-instance data
+/// from whatever buffer is already bound to input slot 1
+/// </summary>
+void Mesh::DrawInstanced(unsigned int instanceCount, unsigned int firstInstance) {
+	UINT stride = sizeof(Vertex);
+	UINT offset = 0;
+	Graphics::State->SetVertexBuffer(0, vertexBuffer.Get(), stride, offset);
+	Graphics::State->SetIndexBuffer(indexBuffer.Get(), DXGI_FORMAT_R32_UINT, 0);
+
+	Graphics::Context->DrawIndexedInstanced(indexCount, instanceCount, 0, 0, firstInstance);
+}
+
 void Mesh::CreateBuffers(Vertex vertices[], unsigned int indices[], int vertexCount, int indexCount) 
 {
 	// Create vertex buffer
@@ -448,4 +476,50 @@ void Mesh::CalculateTangents(Vertex* verts, int numVerts, unsigned int* indices,
 		// Store the tangent
 		XMStoreFloat3(&verts[i].Tangent, tangent);
 	}
-}
\ No newline at end of file
+}
+
+// --------------------------------------------------------
+// Finds a bounding sphere around the box's center, and the
+// surface's UV density: total UV area over total model
+// space area, square rooted to get a length ratio.  Used to
+// judge how many texels end up on screen.
+// --------------------------------------------------------
+void Mesh::CalculateBounds(Vertex* verts, int numVerts, unsigned int* indices, int numIndices)
+{
+	XMVECTOR minPos = XMVectorReplicate(FLT_MAX);
+	XMVECTOR maxPos = XMVectorReplicate(-FLT_MAX);
+	for (int i = 0; i < numVerts; i++)
+	{
+		XMVECTOR pos = XMLoadFloat3(&verts[i].Position);
+		minPos = XMVectorMin(minPos, pos);
+		maxPos = XMVectorMax(maxPos, pos);
+	}
+
+	XMVECTOR center = (minPos + maxPos) * 0.5f;
+	float radiusSq = 0;
+	for (int i = 0; i < numVerts; i++)
+	{
+		XMVECTOR offset = XMLoadFloat3(&verts[i].Position) - center;
+		radiusSq = max(radiusSq, XMVectorGetX(XMVector3LengthSq(offset)));
+	}
+	XMStoreFloat3(&boundsCenter, center);
+	boundsRadius = sqrtf(radiusSq);
+
+	float uvArea = 0;
+	float area = 0;
+	for (int i = 0; i + 2 < numIndices; i += 3)
+	{
+		Vertex& v0 = verts[indices[i]];
+		Vertex& v1 = verts[indices[i + 1]];
+		Vertex& v2 = verts[indices[i + 2]];
+
+		XMVECTOR e1 = XMLoadFloat3(&v1.Position) - XMLoadFloat3(&v0.Position);
+		XMVECTOR e2 = XMLoadFloat3(&v2.Position) - XMLoadFloat3(&v0.Position);
+		area += XMVectorGetX(XMVector3Length(XMVector3Cross(e1, e2))) * 0.5f;
+
+		float u1 = v1.UV.x - v0.UV.x, w1 = v1.UV.y - v0.UV.y;
+		float u2 = v2.UV.x - v0.UV.x, w2 = v2.UV.y - v0.UV.y;
+		uvArea += fabsf(u1 * w2 - u2 * w1) * 0.5f;
+	}
+	uvDensity = area > 0 ? sqrtf(uvArea / area) : 0;
+}
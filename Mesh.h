@@ -20,6 +20,13 @@ private:
 
 	std::string name;
 
+	// Bounding sphere, in model space
+	DirectX::XMFLOAT3 boundsCenter;
+	float boundsRadius;
+
+	// UV units per model space unit, averaged over the surface
+	float uvDensity;
+
 	void CreateBuffers(Vertex vertices[], unsigned int indices[], int newVertexCount, int newIndexCount);
 
 // Public methods
@@ -32,6 +39,11 @@ public:
 	int GetIndexCount();
 	int GetVertexCount();
 	std::string GetName();
+	DirectX::XMFLOAT3 GetBoundsCenter();
+	float GetBoundsRadius();
+	float GetUVDensity();
 	void Draw();
+	void DrawInstanced(unsigned int instanceCount, unsigned int firstInstance);
 	void CalculateTangents(Vertex* verts, int numVerts, unsigned int* indices, int numIndices);
+	void CalculateBounds(Vertex* verts, int numVerts, unsigned int* indices, int numIndices);
 };
\ No newline at end of file
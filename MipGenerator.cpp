@@ -0,0 +1,351 @@
+#include "MipGenerator.h"
+#include <DirectXMath.h>
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+using namespace DirectX;
+
+namespace MipGenerator
+{
+	namespace
+	{
+		// One level while it's being filtered
+		struct FloatImage
+		{
+			unsigned int Width;
+			unsigned int Height;
+			std::vector<XMFLOAT4> Pixels;
+		};
+
+		// Images smaller than this many rows aren't worth extra threads
+		const unsigned int minRowsPerThread = 32;
+
+		// Kaiser window shape, and the taps for a 2x reduction:
+		// source pixels sit 0.5, 1.5 and 2.5 pixels either side
+		// of each destination pixel's center
+		const float kaiserAlpha = 4.0f;
+		const unsigned int kaiserTaps = 6;
+
+		float BesselI0(float x)
+		{
+			float sum = 1, term = 1;
+			for (int k = 1; k < 16; k++)
+			{
+				term *= (x / (2 * k)) * (x / (2 * k));
+				sum += term;
+			}
+			return sum;
+		}
+
+		// Built on first use (thread safe, as a function-local static)
+		struct KaiserTable
+		{
+			float Weights[kaiserTaps];
+
+			KaiserTable()
+			{
+				float total = 0;
+				for (unsigned int i = 0; i < kaiserTaps; i++)
+				{
+					float d = (float)i - kaiserTaps / 2 + 0.5f;	// -2.5 ... 2.5
+					float x = d / 2.0f;							// In destination pixels
+					float sinc = std::sin(XM_PI * x) / (XM_PI * x);
+					float t = d / (kaiserTaps / 2);
+					float window = BesselI0(kaiserAlpha * std::sqrt(std::max(0.0f, 1 - t * t))) / BesselI0(kaiserAlpha);
+					Weights[i] = sinc * window;
+					total += Weights[i];
+				}
+				for (unsigned int i = 0; i < kaiserTaps; i++)
+					Weights[i] /= total;
+			}
+		};
+
+		struct SRGBTable
+		{
+			float ToLinear[256];
+
+			SRGBTable()
+			{
+				for (int i = 0; i < 256; i++)
+				{
+					float c = i / 255.0f;
+					ToLinear[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+				}
+			}
+		};
+
+		const float* KaiserWeights() { static const KaiserTable table; return table.Weights; }
+		const float* SRGBToLinearTable() { static const SRGBTable table; return table.ToLinear; }
+
+		float LinearToSRGB(float c)
+		{
+			return c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1 / 2.4f) - 0.055f;
+		}
+
+		unsigned char ToByte(float v)
+		{
+			return (unsigned char)std::clamp((int)(v * 255.0f + 0.5f), 0, 255);
+		}
+
+		// Runs fn over [first, end) row ranges, on several threads when it's worth it
+		template<typename Fn>
+		void ForRows(unsigned int rows, unsigned int threadCount, Fn fn)
+		{
+			threadCount = std::clamp(rows / minRowsPerThread, 1u, std::max(1u, threadCount));
+			if (threadCount == 1)
+			{
+				fn(0u, rows);
+				return;
+			}
+
+			std::vector<std::thread> threads;
+			unsigned int rowsPerThread = (rows + threadCount - 1) / threadCount;
+			for (unsigned int first = 0; first < rows; first += rowsPerThread)
+				threads.emplace_back(fn, first, std::min(first + rowsPerThread, rows));
+			for (std::thread& t : threads)
+				t.join();
+		}
+
+		// ----------------------------------------------------
+		// 8-bit to float.  Normals become unit vectors, so
+		// their averaged lengths measure how much they diverge.
+		// ----------------------------------------------------
+		FloatImage Decode(const BlockImage& image, MipContent content)
+		{
+			FloatImage result = {};
+			result.Width = image.Width;
+			result.Height = image.Height;
+			result.Pixels.resize((size_t)image.Width * image.Height);
+
+			const float* srgb = SRGBToLinearTable();
+			for (size_t i = 0; i < result.Pixels.size(); i++)
+			{
+				const unsigned char* p = &image.Pixels[i * 4];
+				XMFLOAT4& out = result.Pixels[i];
+				if (content == MIP_CONTENT_SRGB)
+				{
+					out = XMFLOAT4(srgb[p[0]], srgb[p[1]], srgb[p[2]], p[3] / 255.0f);
+				}
+				else if (content == MIP_CONTENT_NORMAL)
+				{
+					XMVECTOR n = XMVectorSet(p[0] / 127.5f - 1, p[1] / 127.5f - 1, p[2] / 127.5f - 1, 0);
+					XMStoreFloat4(&out, XMVector3Normalize(n));
+					out.w = p[3] / 255.0f;
+				}
+				else
+				{
+					out = XMFLOAT4(p[0] / 255.0f, p[1] / 255.0f, p[2] / 255.0f, p[3] / 255.0f);
+				}
+			}
+			return result;
+		}
+
+		BlockImage Encode(const FloatImage& image, MipContent content)
+		{
+			BlockImage result = {};
+			result.Width = image.Width;
+			result.Height = image.Height;
+			result.Pixels.resize((size_t)image.Width * image.Height * 4);
+
+			for (size_t i = 0; i < image.Pixels.size(); i++)
+			{
+				XMFLOAT4 c = image.Pixels[i];
+				unsigned char* out = &result.Pixels[i * 4];
+				if (content == MIP_CONTENT_SRGB)
+				{
+					c.x = LinearToSRGB(std::clamp(c.x, 0.0f, 1.0f));
+					c.y = LinearToSRGB(std::clamp(c.y, 0.0f, 1.0f));
+					c.z = LinearToSRGB(std::clamp(c.z, 0.0f, 1.0f));
+				}
+				else if (content == MIP_CONTENT_NORMAL)
+				{
+					// Stored normals must be unit length again
+					float w = c.w;
+					XMVECTOR n = XMVector3Normalize(XMVectorSet(c.x, c.y, c.z, 0));
+					XMStoreFloat4(&c, XMVectorMultiplyAdd(n, XMVectorReplicate(0.5f), XMVectorReplicate(0.5f)));
+					c.w = w;
+				}
+
+				out[0] = ToByte(c.x);
+				out[1] = ToByte(c.y);
+				out[2] = ToByte(c.z);
+				out[3] = ToByte(c.w);
+			}
+			return result;
+		}
+
+		FloatImage ReduceBox(const FloatImage& src, unsigned int threadCount)
+		{
+			FloatImage dst = {};
+			dst.Width = std::max(1u, src.Width / 2);
+			dst.Height = std::max(1u, src.Height / 2);
+			dst.Pixels.resize((size_t)dst.Width * dst.Height);
+
+			ForRows(dst.Height, threadCount, [&](unsigned int first, unsigned int end)
+			{
+				for (unsigned int y = first; y < end; y++)
+				{
+					const XMFLOAT4* row0 = &src.Pixels[(size_t)std::min(y * 2, src.Height - 1) * src.Width];
+					const XMFLOAT4* row1 = &src.Pixels[(size_t)std::min(y * 2 + 1, src.Height - 1) * src.Width];
+					for (unsigned int x = 0; x < dst.Width; x++)
+					{
+						unsigned int x0 = std::min(x * 2, src.Width - 1);
+						unsigned int x1 = std::min(x * 2 + 1, src.Width - 1);
+						XMVECTOR sum = XMVectorAdd(
+							XMVectorAdd(XMLoadFloat4(&row0[x0]), XMLoadFloat4(&row0[x1])),
+							XMVectorAdd(XMLoadFloat4(&row1[x0]), XMLoadFloat4(&row1[x1])));
+						XMStoreFloat4(&dst.Pixels[(size_t)y * dst.Width + x], XMVectorScale(sum, 0.25f));
+					}
+				}
+			});
+			return dst;
+		}
+
+		// ----------------------------------------------------
+		// Separable Kaiser reduction: rows first into a half
+		// width image, then columns.  Edges are clamped.
+		// ----------------------------------------------------
+		FloatImage ReduceKaiser(const FloatImage& src, unsigned int threadCount)
+		{
+			const float* weights = KaiserWeights();
+			const int half = kaiserTaps / 2;
+
+			FloatImage wide = {};
+			wide.Width = std::max(1u, src.Width / 2);
+			wide.Height = src.Height;
+			wide.Pixels.resize((size_t)wide.Width * wide.Height);
+
+			ForRows(wide.Height, threadCount, [&](unsigned int first, unsigned int end)
+			{
+				for (unsigned int y = first; y < end; y++)
+				{
+					const XMFLOAT4* row = &src.Pixels[(size_t)y * src.Width];
+					for (unsigned int x = 0; x < wide.Width; x++)
+					{
+						XMVECTOR sum = XMVectorZero();
+						for (int t = 0; t < (int)kaiserTaps; t++)
+						{
+							int sx = std::clamp((int)x * 2 - half + 1 + t, 0, (int)src.Width - 1);
+							sum = XMVectorMultiplyAdd(XMLoadFloat4(&row[sx]), XMVectorReplicate(weights[t]), sum);
+						}
+						XMStoreFloat4(&wide.Pixels[(size_t)y * wide.Width + x], sum);
+					}
+				}
+			});
+
+			FloatImage dst = {};
+			dst.Width = wide.Width;
+			dst.Height = std::max(1u, src.Height / 2);
+			dst.Pixels.resize((size_t)dst.Width * dst.Height);
+
+			ForRows(dst.Height, threadCount, [&](unsigned int first, unsigned int end)
+			{
+				for (unsigned int y = first; y < end; y++)
+				{
+					for (unsigned int x = 0; x < dst.Width; x++)
+					{
+						XMVECTOR sum = XMVectorZero();
+						for (int t = 0; t < (int)kaiserTaps; t++)
+						{
+							int sy = std::clamp((int)y * 2 - half + 1 + t, 0, (int)wide.Height - 1);
+							sum = XMVectorMultiplyAdd(XMLoadFloat4(&wide.Pixels[(size_t)sy * wide.Width + x]), XMVectorReplicate(weights[t]), sum);
+						}
+						XMStoreFloat4(&dst.Pixels[(size_t)y * dst.Width + x], sum);
+					}
+				}
+			});
+
+			return dst;
+		}
+
+		FloatImage Reduce(const FloatImage& src, MipFilter filter, unsigned int threadCount)
+		{
+			return filter == MIP_FILTER_KAISER ?
+				ReduceKaiser(src, threadCount) :
+				ReduceBox(src, threadCount);
+		}
+
+		// ----------------------------------------------------
+		// Toksvig: a normal that has shrunk to length len after
+		// filtering stands for a spread of directions, which
+		// lowers the equivalent Blinn-Phong power s by the
+		// factor len / (len + s * (1 - len)).  Roughness (GGX
+		// alpha = roughness^2) is mapped to a power and back.
+		// ----------------------------------------------------
+		float ToksvigRoughness(float roughness, float len)
+		{
+			len = std::clamp(len, 0.0f, 1.0f);
+			float alpha = std::max(roughness * roughness, 0.01f);
+			float power = 2 / (alpha * alpha) - 2;
+			float factor = len / (len + power * (1 - len));
+			float alphaSq = 2 / (factor * power + 2);
+			return std::max(roughness, std::pow(alphaSq, 0.25f));
+		}
+	}
+}
+
+unsigned int MipGenerator::GetMipCount(unsigned int width, unsigned int height)
+{
+	unsigned int count = 1;
+	while (width > 1 || height > 1)
+	{
+		width = std::max(1u, width / 2);
+		height = std::max(1u, height / 2);
+		count++;
+	}
+	return count;
+}
+
+// --------------------------------------------------------
+// Each level is filtered from the float copy of the level
+// above, never from the rounded 8-bit result, so error
+// doesn't build up down the chain.  For normals the float
+// copies stay unnormalized for the same reason.
+// --------------------------------------------------------
+std::vector<BlockImage> MipGenerator::Generate(const BlockImage& image, const MipSettings& settings, unsigned int threadCount)
+{
+	std::vector<BlockImage> levels;
+	if (image.Width == 0 || image.Height == 0)
+		return levels;
+
+	unsigned int count = GetMipCount(image.Width, image.Height);
+	levels.reserve(count);
+	levels.push_back(image);
+
+	// Toksvig needs the normal map's matching levels
+	bool toksvig =
+		settings.NormalMap &&
+		settings.Content != MIP_CONTENT_NORMAL &&
+		settings.NormalMap->Width == image.Width &&
+		settings.NormalMap->Height == image.Height;
+
+	FloatImage current = Decode(image, settings.Content);
+	FloatImage normals;
+	if (toksvig)
+		normals = Decode(*settings.NormalMap, MIP_CONTENT_NORMAL);
+
+	for (unsigned int level = 1; level < count; level++)
+	{
+		current = Reduce(current, settings.Filter, threadCount);
+
+		if (!toksvig)
+		{
+			levels.push_back(Encode(current, settings.Content));
+			continue;
+		}
+
+		// Adjust a copy, so the next level still filters the
+		// original roughness (which lives in red)
+		normals = Reduce(normals, settings.Filter, threadCount);
+		FloatImage adjusted = current;
+		for (size_t i = 0; i < adjusted.Pixels.size(); i++)
+		{
+			float len = XMVectorGetX(XMVector3Length(XMLoadFloat4(&normals.Pixels[i])));
+			adjusted.Pixels[i].x = ToksvigRoughness(std::clamp(adjusted.Pixels[i].x, 0.0f, 1.0f), len);
+		}
+		levels.push_back(Encode(adjusted, settings.Content));
+	}
+
+	return levels;
+}
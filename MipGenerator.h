@@ -0,0 +1,56 @@
+#pragma once
+
+#include <vector>
+#include "BlockCompression.h"
+
+// --------------------------------------------------------
+// How each level is reduced from the one above it
+//  - BOX: average of 2x2 pixels, fast and soft
+//  - KAISER: Kaiser-windowed sinc over 6x6 pixels, which
+//    keeps more detail with less aliasing
+// --------------------------------------------------------
+enum MipFilter
+{
+	MIP_FILTER_BOX,
+	MIP_FILTER_KAISER
+};
+
+// --------------------------------------------------------
+// What the pixels hold, which decides how they're averaged
+//  - LINEAR: data (roughness, metalness, ...) as is
+//  - SRGB: gamma encoded color, averaged as linear light
+//  - NORMAL: tangent space normals, renormalized per level
+// --------------------------------------------------------
+enum MipContent
+{
+	MIP_CONTENT_LINEAR,
+	MIP_CONTENT_SRGB,
+	MIP_CONTENT_NORMAL
+};
+
+struct MipSettings
+{
+	MipFilter Filter;
+	MipContent Content;
+
+	// Optional, for roughness maps: a normal map the same size.
+	// Where its normals diverge, averaging them shortens them,
+	// and roughness is raised to match (Toksvig), so distant
+	// bumpy surfaces don't turn unnaturally shiny.
+	const BlockImage* NormalMap;
+};
+
+// --------------------------------------------------------
+// Builds full mip chains (down to 1x1) for RGBA8 images on
+// the CPU.  Filtering happens in float, four channels at a
+// time with DirectXMath vectors, and each level is split
+// across threads by rows.  Generate() shares no state, so
+// several images can also be processed at once.
+// --------------------------------------------------------
+namespace MipGenerator
+{
+	unsigned int GetMipCount(unsigned int width, unsigned int height);
+
+	// Every level, the image itself first
+	std::vector<BlockImage> Generate(const BlockImage& image, const MipSettings& settings, unsigned int threadCount);
+}
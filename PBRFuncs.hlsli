@@ -20,6 +20,48 @@ static const float PI = 3.14159265359f;
 
 // PBR FUNCTIONS ================
 
+// Ambient diffuse from 9 spherical harmonics coefficients, with the
+// basis constants and 1/pi already folded in on the CPU (see
+// SphericalHarmonics.h), so this is the light a white Lambertian
+// surface facing n reflects
+//
+// sh - Coefficients in order (0,0), (1,-1), (1,0), (1,1), (2,-2) ... (2,2)
+// n  - Normal, which must be NORMALIZED
+float3 AmbientSH(float4 sh[9], float3 n)
+{
+    return sh[0].rgb
+        + sh[1].rgb * n.y
+        + sh[2].rgb * n.z
+        + sh[3].rgb * n.x
+        + sh[4].rgb * (n.x * n.y)
+        + sh[5].rgb * (n.y * n.z)
+        + sh[6].rgb * (3 * n.z * n.z - 1)
+        + sh[7].rgb * (n.x * n.z)
+        + sh[8].rgb * (n.x * n.x - n.y * n.y);
+}
+
+
+// Ambient specular from the environment, by the split sum approximation:
+// the environment prefiltered with the GGX lobe (one roughness per mip),
+// times the BRDF's scale & bias to F0 from a lookup table, both baked on
+// the CPU (see EnvironmentBaker.h).  Just these two fetches per pixel.
+//
+// envMap     - Prefiltered cube map, roughness 0 at mip 0 to 1 at the last
+// brdfLUT    - Scale (r) & bias (g) by n dot v (u) and roughness (v)
+// lutSampler - Must clamp
+// mipCount   - Mips in envMap
+// n, v       - Normal and view vector, which must be NORMALIZED
+float3 IndirectSpecular(TextureCube envMap, Texture2D brdfLUT, SamplerState envSampler, SamplerState lutSampler,
+    float mipCount, float3 n, float3 v, float roughness, float3 specColor)
+{
+    float NdotV = saturate(dot(n, v));
+    float3 prefiltered = envMap.SampleLevel(envSampler, reflect(-v, n), roughness * (mipCount - 1)).rgb;
+    float2 brdf = brdfLUT.SampleLevel(lutSampler, float2(NdotV, roughness), 0).rg;
+    return prefiltered * (specColor * brdf.x + brdf.y);
+}
+
+
+
 // Lambert diffuse BRDF - Same as the basic lighting diffuse calculation!
 // - NOTE: this function assumes the vectors are already NORMALIZED!
 float DiffusePBR(float3 normal, float3 dirToLight)
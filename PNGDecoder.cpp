@@ -0,0 +1,665 @@
+#include "PNGDecoder.h"
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+
+namespace PNGDecoder
+{
+	namespace
+	{
+		// Larger images are refused rather than allocated
+		const unsigned int maxDimension = 16384;
+
+		// Codes this long or shorter are decoded with one table lookup
+		const int fastBits = 9;
+
+		// ----------------------------------------------------
+		// Reads a deflate stream's bits, least significant
+		// first.  Reading past the end gives zeros, so the
+		// decoder never touches memory it doesn't own; the
+		// padding is counted so real overruns are caught.
+		// ----------------------------------------------------
+		struct BitReader
+		{
+			const unsigned char* Data;
+			size_t Size;
+			size_t Position;
+			unsigned int Buffer;
+			int Count;
+			unsigned int Padding;
+
+			void Fill(int bits)
+			{
+				while (Count < bits)
+				{
+					unsigned int byte = 0;
+					if (Position < Size) byte = Data[Position++];
+					else Padding++;
+					Buffer |= byte << Count;
+					Count += 8;
+				}
+			}
+
+			unsigned int Bits(int bits)
+			{
+				Fill(bits);
+				unsigned int value = Buffer & ((1u << bits) - 1);
+				Buffer >>= bits;
+				Count -= bits;
+				return value;
+			}
+
+			// Fewer than 8 bits are ever buffered between reads,
+			// so this only drops the rest of the current byte
+			void AlignToByte()
+			{
+				Buffer = 0;
+				Count = 0;
+			}
+
+			bool Overrun() const { return Padding > 4; }
+		};
+
+		// ----------------------------------------------------
+		// A canonical Huffman code: symbols sorted by code,
+		// how many codes there are of each length, and a table
+		// for the short codes indexed by their next bits
+		// ----------------------------------------------------
+		struct Huffman
+		{
+			unsigned short Counts[16];
+			unsigned short Symbols[288];
+			unsigned short Fast[1 << fastBits]; // (length << 9) | symbol, 0 if not short
+		};
+
+		bool BuildHuffman(Huffman* h, const unsigned char* lengths, int count)
+		{
+			memset(h->Counts, 0, sizeof(h->Counts));
+			for (int i = 0; i < count; i++)
+				h->Counts[lengths[i]]++;
+			h->Counts[0] = 0;
+
+			// More codes than the lengths can hold is an error
+			// (fewer is allowed, e.g. a single distance code)
+			int left = 1;
+			for (int len = 1; len < 16; len++)
+			{
+				left = (left << 1) - h->Counts[len];
+				if (left < 0)
+					return false;
+			}
+
+			unsigned short offsets[16] = {};
+			unsigned short nextCode[16] = {};
+			for (int len = 1; len < 15; len++)
+				offsets[len + 1] = offsets[len] + h->Counts[len];
+			for (int len = 1; len < 16; len++)
+				nextCode[len] = (unsigned short)((nextCode[len - 1] + h->Counts[len - 1]) << 1);
+
+			memset(h->Fast, 0, sizeof(h->Fast));
+			for (int symbol = 0; symbol < count; symbol++)
+			{
+				int len = lengths[symbol];
+				if (len == 0)
+					continue;
+
+				h->Symbols[offsets[len]++] = (unsigned short)symbol;
+				unsigned int code = nextCode[len]++;
+				if (len > fastBits)
+					continue;
+
+				// Codes are stored most significant bit first
+				unsigned int reversed = 0;
+				for (int i = 0; i < len; i++)
+					reversed |= ((code >> i) & 1) << (len - 1 - i);
+				for (unsigned int i = reversed; i < (1u << fastBits); i += 1u << len)
+					h->Fast[i] = (unsigned short)((len << 9) | symbol);
+			}
+			return true;
+		}
+
+		// Returns the next symbol, or -1 for a code that doesn't exist
+		int DecodeSymbol(BitReader& in, const Huffman& h)
+		{
+			in.Fill(fastBits);
+			unsigned short entry = h.Fast[in.Buffer & ((1u << fastBits) - 1)];
+			if (entry)
+			{
+				in.Bits(entry >> 9);
+				return entry & 511;
+			}
+
+			// Longer codes, one bit at a time
+			int code = 0, first = 0, index = 0;
+			for (int len = 1; len < 16; len++)
+			{
+				code |= in.Bits(1);
+				int count = h.Counts[len];
+				if (code - count < first)
+					return h.Symbols[index + (code - first)];
+				index += count;
+				first = (first + count) << 1;
+				code <<= 1;
+			}
+			return -1;
+		}
+
+		const unsigned short lengthBase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+		const unsigned char lengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+		const unsigned short distanceBase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+		const unsigned char distanceExtra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+		// The fixed codes (block type 1), built on first use
+		struct FixedCodes
+		{
+			Huffman Literals;
+			Huffman Distances;
+
+			FixedCodes()
+			{
+				unsigned char lengths[288];
+				for (int i = 0; i < 288; i++)
+					lengths[i] = i < 144 ? 8 : i < 256 ? 9 : i < 280 ? 7 : 8;
+				BuildHuffman(&Literals, lengths, 288);
+				memset(lengths, 5, 30);
+				BuildHuffman(&Distances, lengths, 30);
+			}
+		};
+
+		bool InflateCodes(BitReader& in, const Huffman& literals, const Huffman& distances, unsigned char* out, size_t outSize, size_t& outPos)
+		{
+			for (;;)
+			{
+				int symbol = DecodeSymbol(in, literals);
+				if (symbol < 0 || in.Overrun())
+					return false;
+
+				if (symbol < 256)
+				{
+					if (outPos >= outSize)
+						return false;
+					out[outPos++] = (unsigned char)symbol;
+					continue;
+				}
+				if (symbol == 256)
+					return true;
+
+				symbol -= 257;
+				if (symbol >= 29)
+					return false;
+				size_t length = lengthBase[symbol] + in.Bits(lengthExtra[symbol]);
+
+				int code = DecodeSymbol(in, distances);
+				if (code < 0 || code >= 30)
+					return false;
+				size_t distance = distanceBase[code] + in.Bits(distanceExtra[code]);
+				if (distance > outPos || length > outSize - outPos)
+					return false;
+
+				// Byte by byte, since a match may overlap itself
+				unsigned char* dst = out + outPos;
+				const unsigned char* src = dst - distance;
+				for (size_t i = 0; i < length; i++)
+					dst[i] = src[i];
+				outPos += length;
+			}
+		}
+
+		bool ReadDynamicCodes(BitReader& in, Huffman* literals, Huffman* distances)
+		{
+			static const unsigned char order[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+			int literalCount = in.Bits(5) + 257;
+			int distanceCount = in.Bits(5) + 1;
+			int lengthCount = in.Bits(4) + 4;
+			if (literalCount > 286 || distanceCount > 30)
+				return false;
+
+			// First the code that the code lengths are written with
+			unsigned char lengths[286 + 30] = {};
+			for (int i = 0; i < lengthCount; i++)
+				lengths[order[i]] = (unsigned char)in.Bits(3);
+			Huffman lengthCode;
+			if (!BuildHuffman(&lengthCode, lengths, 19))
+				return false;
+
+			// Then the lengths themselves, with runs
+			memset(lengths, 0, sizeof(lengths));
+			int total = literalCount + distanceCount;
+			for (int i = 0; i < total;)
+			{
+				int symbol = DecodeSymbol(in, lengthCode);
+				if (symbol < 0 || in.Overrun())
+					return false;
+
+				if (symbol < 16)
+				{
+					lengths[i++] = (unsigned char)symbol;
+					continue;
+				}
+
+				unsigned char value = 0;
+				int repeat;
+				if (symbol == 16)
+				{
+					if (i == 0)
+						return false;
+					value = lengths[i - 1];
+					repeat = 3 + in.Bits(2);
+				}
+				else if (symbol == 17) repeat = 3 + in.Bits(3);
+				else repeat = 11 + in.Bits(7);
+
+				if (i + repeat > total)
+					return false;
+				while (repeat--)
+					lengths[i++] = value;
+			}
+
+			// A block must be able to end
+			if (lengths[256] == 0)
+				return false;
+
+			return
+				BuildHuffman(literals, lengths, literalCount) &&
+				BuildHuffman(distances, lengths + literalCount, distanceCount);
+		}
+
+		// ----------------------------------------------------
+		// Inflates a zlib stream into a buffer of exactly the
+		// expected size (known up front from the PNG header)
+		// ----------------------------------------------------
+		bool Inflate(const unsigned char* data, size_t size, unsigned char* out, size_t outSize)
+		{
+			// zlib header: deflate, no preset dictionary
+			if (size < 2 || (data[0] & 15) != 8 || (data[1] & 32) || ((data[0] << 8) | data[1]) % 31 != 0)
+				return false;
+
+			static const FixedCodes fixed;
+			BitReader in = { data + 2, size - 2, 0, 0, 0, 0 };
+			size_t outPos = 0;
+
+			bool last;
+			do
+			{
+				last = in.Bits(1) == 1;
+				unsigned int type = in.Bits(2);
+				if (type == 0)
+				{
+					// Stored: a length, its complement, then raw bytes
+					in.AlignToByte();
+					if (in.Size - in.Position < 4)
+						return false;
+					const unsigned char* p = in.Data + in.Position;
+					size_t length = p[0] | (p[1] << 8);
+					size_t complement = p[2] | (p[3] << 8);
+					in.Position += 4;
+					if (length != (~complement & 0xFFFF) ||
+						length > in.Size - in.Position ||
+						length > outSize - outPos)
+						return false;
+					memcpy(out + outPos, in.Data + in.Position, length);
+					in.Position += length;
+					outPos += length;
+				}
+				else if (type == 1)
+				{
+					if (!InflateCodes(in, fixed.Literals, fixed.Distances, out, outSize, outPos))
+						return false;
+				}
+				else if (type == 2)
+				{
+					Huffman literals, distances;
+					if (!ReadDynamicCodes(in, &literals, &distances) ||
+						!InflateCodes(in, literals, distances, out, outSize, outPos))
+						return false;
+				}
+				else
+				{
+					return false;
+				}
+			} while (!last);
+
+			return outPos == outSize;
+		}
+
+		// ----------------------------------------------------
+		// What IHDR says about the pixels
+		// ----------------------------------------------------
+		struct Header
+		{
+			unsigned int Width;
+			unsigned int Height;
+			unsigned int Depth;
+			unsigned int ColorType;
+			unsigned int Channels;
+			bool Interlaced;
+		};
+
+		unsigned int ReadBigEndian(const unsigned char* p)
+		{
+			return ((unsigned int)p[0] << 24) | ((unsigned int)p[1] << 16) | ((unsigned int)p[2] << 8) | p[3];
+		}
+
+		bool ReadHeader(const unsigned char* data, unsigned int length, Header* header)
+		{
+			if (length != 13)
+				return false;
+
+			header->Width = ReadBigEndian(data);
+			header->Height = ReadBigEndian(data + 4);
+			header->Depth = data[8];
+			header->ColorType = data[9];
+			header->Interlaced = data[12] == 1;
+			if (header->Width == 0 || header->Width > maxDimension ||
+				header->Height == 0 || header->Height > maxDimension ||
+				data[10] != 0 || data[11] != 0 || data[12] > 1)
+				return false;
+
+			// Which depths each color type may use
+			unsigned int depth = header->Depth;
+			bool depth8or16 = depth == 8 || depth == 16;
+			switch (header->ColorType)
+			{
+			case 0: header->Channels = 1; return depth8or16 || depth == 1 || depth == 2 || depth == 4;
+			case 2: header->Channels = 3; return depth8or16;
+			case 3: header->Channels = 1; return depth == 1 || depth == 2 || depth == 4 || depth == 8;
+			case 4: header->Channels = 2; return depth8or16;
+			case 6: header->Channels = 4; return depth8or16;
+			default: return false;
+			}
+		}
+
+		// Bytes in one row of width pixels, without the filter byte
+		size_t RowBytes(const Header& header, unsigned int width)
+		{
+			return ((size_t)width * header.Channels * header.Depth + 7) / 8;
+		}
+
+		unsigned char Paeth(int a, int b, int c)
+		{
+			int p = a + b - c;
+			int pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+			return (unsigned char)(pa <= pb && pa <= pc ? a : pb <= pc ? b : c);
+		}
+
+		// ----------------------------------------------------
+		// Undoes one row's filter in place.  bpp is the bytes
+		// per pixel (at least 1) and prev the unfiltered row
+		// above, or null for a first row.
+		// ----------------------------------------------------
+		bool Unfilter(unsigned int filter, unsigned char* row, const unsigned char* prev, size_t length, size_t bpp)
+		{
+			switch (filter)
+			{
+			case 0:
+				return true;
+			case 1:
+				for (size_t i = bpp; i < length; i++)
+					row[i] += row[i - bpp];
+				return true;
+			case 2:
+				if (prev)
+					for (size_t i = 0; i < length; i++)
+						row[i] += prev[i];
+				return true;
+			case 3:
+				for (size_t i = 0; i < length; i++)
+				{
+					int left = i >= bpp ? row[i - bpp] : 0;
+					int up = prev ? prev[i] : 0;
+					row[i] += (unsigned char)((left + up) / 2);
+				}
+				return true;
+			case 4:
+				for (size_t i = 0; i < length; i++)
+				{
+					int left = i >= bpp ? row[i - bpp] : 0;
+					int up = prev ? prev[i] : 0;
+					int upLeft = prev && i >= bpp ? prev[i - bpp] : 0;
+					row[i] += Paeth(left, up, upLeft);
+				}
+				return true;
+			default:
+				return false;
+			}
+		}
+
+		// One sample from an unfiltered row, at its full depth
+		unsigned int ReadSample(const unsigned char* row, size_t index, unsigned int depth)
+		{
+			switch (depth)
+			{
+			case 16: return (row[index * 2] << 8) | row[index * 2 + 1];
+			case 8: return row[index];
+			default:
+			{
+				size_t bit = index * depth;
+				unsigned int shift = 8 - depth - (unsigned int)(bit & 7);
+				return (row[bit >> 3] >> shift) & ((1u << depth) - 1);
+			}
+			}
+		}
+
+		// ----------------------------------------------------
+		// Everything but the pixels needed to turn samples
+		// into RGBA8
+		// ----------------------------------------------------
+		struct Palette
+		{
+			unsigned char Colors[256][4];
+			unsigned int Count;
+			bool HasKey;			// tRNS for gray or RGB: one fully transparent color
+			unsigned int Key[3];
+		};
+
+		void WriteRow(const Header& header, const Palette& palette, const unsigned char* row, unsigned int width, unsigned char* out, size_t outStride)
+		{
+			unsigned int depth = header.Depth;
+			unsigned int maxValue = (1u << depth) - 1;
+			auto toByte = [=](unsigned int v) { return (unsigned char)(depth == 16 ? v >> 8 : v * 255 / maxValue); };
+
+			for (unsigned int x = 0; x < width; x++, out += outStride)
+			{
+				size_t first = (size_t)x * header.Channels;
+				switch (header.ColorType)
+				{
+				case 0:
+				{
+					unsigned int gray = ReadSample(row, first, depth);
+					out[0] = out[1] = out[2] = toByte(gray);
+					out[3] = palette.HasKey && gray == palette.Key[0] ? 0 : 255;
+					break;
+				}
+				case 2:
+				{
+					unsigned int r = ReadSample(row, first, depth);
+					unsigned int g = ReadSample(row, first + 1, depth);
+					unsigned int b = ReadSample(row, first + 2, depth);
+					out[0] = toByte(r);
+					out[1] = toByte(g);
+					out[2] = toByte(b);
+					out[3] = palette.HasKey && r == palette.Key[0] && g == palette.Key[1] && b == palette.Key[2] ? 0 : 255;
+					break;
+				}
+				case 3:
+				{
+					// Indices past the palette come out black
+					unsigned int index = ReadSample(row, first, depth);
+					static const unsigned char black[4] = { 0, 0, 0, 255 };
+					memcpy(out, index < palette.Count ? palette.Colors[index] : black, 4);
+					break;
+				}
+				case 4:
+					out[0] = out[1] = out[2] = toByte(ReadSample(row, first, depth));
+					out[3] = toByte(ReadSample(row, first + 1, depth));
+					break;
+				case 6:
+					for (unsigned int c = 0; c < 4; c++)
+						out[c] = toByte(ReadSample(row, first + c, depth));
+					break;
+				}
+			}
+		}
+
+		// Adam7: where each of the seven passes starts and how far it steps
+		const unsigned int adam7StartX[7] = { 0, 4, 0, 2, 0, 1, 0 };
+		const unsigned int adam7StartY[7] = { 0, 0, 4, 0, 2, 0, 1 };
+		const unsigned int adam7StepX[7] = { 8, 8, 4, 4, 2, 2, 1 };
+		const unsigned int adam7StepY[7] = { 8, 8, 8, 4, 4, 2, 2 };
+
+		// A pass (or the whole image) as a sub-grid of the image
+		struct Pass
+		{
+			unsigned int StartX, StartY;
+			unsigned int StepX, StepY;
+			unsigned int Width, Height;
+		};
+
+		std::vector<Pass> GetPasses(const Header& header)
+		{
+			std::vector<Pass> passes;
+			if (!header.Interlaced)
+			{
+				passes.push_back({ 0, 0, 1, 1, header.Width, header.Height });
+				return passes;
+			}
+
+			for (int i = 0; i < 7; i++)
+			{
+				Pass pass = { adam7StartX[i], adam7StartY[i], adam7StepX[i], adam7StepY[i], 0, 0 };
+				if (header.Width > pass.StartX) pass.Width = (header.Width - pass.StartX + pass.StepX - 1) / pass.StepX;
+				if (header.Height > pass.StartY) pass.Height = (header.Height - pass.StartY + pass.StepY - 1) / pass.StepY;
+				if (pass.Width && pass.Height)
+					passes.push_back(pass);
+			}
+			return passes;
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Collects the chunks the pixels depend on, inflates every
+// IDAT at once, then unfilters and expands row by row
+// --------------------------------------------------------
+bool PNGDecoder::Decode(const unsigned char* data, size_t size, BlockImage* image)
+{
+	static const unsigned char signature[8] = { 137, 80, 78, 71, 13, 10, 26, 10 };
+	if (size < 8 || memcmp(data, signature, 8) != 0)
+		return false;
+
+	Header header = {};
+	Palette palette = {};
+	bool hasHeader = false;
+	std::vector<unsigned char> compressed;
+
+	for (size_t pos = 8; ; )
+	{
+		if (size - pos < 12)
+			return false;
+		unsigned int length = ReadBigEndian(data + pos);
+		const unsigned char* type = data + pos + 4;
+		const unsigned char* chunk = data + pos + 8;
+		if (length > size - pos - 12)
+			return false;
+		pos += 12 + (size_t)length;
+
+		if (memcmp(type, "IHDR", 4) == 0)
+		{
+			if (!ReadHeader(chunk, length, &header))
+				return false;
+			hasHeader = true;
+		}
+		else if (memcmp(type, "PLTE", 4) == 0)
+		{
+			if (length % 3 != 0 || length > 768)
+				return false;
+			palette.Count = length / 3;
+			for (unsigned int i = 0; i < palette.Count; i++)
+			{
+				memcpy(palette.Colors[i], chunk + i * 3, 3);
+				palette.Colors[i][3] = 255;
+			}
+		}
+		else if (memcmp(type, "tRNS", 4) == 0 && hasHeader)
+		{
+			if (header.ColorType == 3)
+			{
+				for (unsigned int i = 0; i < length && i < 256; i++)
+					palette.Colors[i][3] = chunk[i];
+			}
+			else if ((header.ColorType == 0 && length >= 2) || (header.ColorType == 2 && length >= 6))
+			{
+				palette.HasKey = true;
+				for (unsigned int c = 0; c < length / 2 && c < 3; c++)
+					palette.Key[c] = (chunk[c * 2] << 8) | chunk[c * 2 + 1];
+			}
+		}
+		else if (memcmp(type, "IDAT", 4) == 0)
+		{
+			compressed.insert(compressed.end(), chunk, chunk + length);
+		}
+		else if (memcmp(type, "IEND", 4) == 0)
+		{
+			break;
+		}
+	}
+
+	if (!hasHeader || compressed.empty() || (header.ColorType == 3 && palette.Count == 0))
+		return false;
+
+	// Each row of each pass is a filter byte and its samples
+	std::vector<Pass> passes = GetPasses(header);
+	size_t filteredSize = 0;
+	for (const Pass& pass : passes)
+		filteredSize += (RowBytes(header, pass.Width) + 1) * pass.Height;
+
+	std::vector<unsigned char> filtered(filteredSize);
+	if (!Inflate(compressed.data(), compressed.size(), filtered.data(), filteredSize))
+		return false;
+
+	image->Width = header.Width;
+	image->Height = header.Height;
+	image->Pixels.assign((size_t)header.Width * header.Height * 4, 0);
+
+	size_t bpp = (header.Channels * header.Depth + 7) / 8;
+	unsigned char* row = filtered.data();
+	for (const Pass& pass : passes)
+	{
+		size_t rowBytes = RowBytes(header, pass.Width);
+		const unsigned char* prev = 0;
+		for (unsigned int y = 0; y < pass.Height; y++)
+		{
+			unsigned char* samples = row + 1;
+			if (!Unfilter(row[0], samples, prev, rowBytes, bpp))
+				return false;
+
+			size_t outY = pass.StartY + (size_t)y * pass.StepY;
+			unsigned char* out = &image->Pixels[(outY * header.Width + pass.StartX) * 4];
+			WriteRow(header, palette, samples, pass.Width, out, (size_t)pass.StepX * 4);
+
+			prev = samples;
+			row += rowBytes + 1;
+		}
+	}
+
+	return true;
+}
+
+bool PNGDecoder::Load(const std::filesystem::path& path, BlockImage* image)
+{
+	std::ifstream file(path, std::ios::binary | std::ios::ate);
+	if (!file)
+		return false;
+
+	std::streamoff size = file.tellg();
+	if (size <= 0)
+		return false;
+
+	std::vector<unsigned char> data((size_t)size);
+	file.seekg(0);
+	if (!file.read((char*)data.data(), size))
+		return false;
+
+	return Decode(data.data(), data.size(), image);
+}
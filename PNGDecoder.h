@@ -0,0 +1,25 @@
+#pragma once
+
+#include <filesystem>
+#include "BlockCompression.h"
+
+// --------------------------------------------------------
+// A small, self contained PNG decoder (inflate included),
+// so images can be decoded on any thread without WIC or a
+// graphics device.
+//
+// Every color type, bit depth and interlacing is accepted,
+// and the result is always RGBA8: grayscale is copied to
+// red, green and blue, 16 bit samples keep their high byte
+// and palette or tRNS transparency becomes alpha.  Ancillary
+// chunks (gamma, color profiles, ...) are ignored and CRCs
+// aren't checked, as damaged data fails to inflate anyway.
+// --------------------------------------------------------
+namespace PNGDecoder
+{
+	// Decodes a PNG file that's already in memory
+	bool Decode(const unsigned char* data, size_t size, BlockImage* image);
+
+	// Reads and decodes a PNG file
+	bool Load(const std::filesystem::path& path, BlockImage* image);
+}
@@ -0,0 +1,85 @@
+#include "PipelineStates.h"
+
+using namespace Microsoft::WRL;
+
+PipelineStates::PipelineStates(ComPtr<ID3D11Device> device) :
+	device(device),
+	rasterizerStates([this](const D3D11_RASTERIZER_DESC& desc)
+		{
+			ComPtr<ID3D11RasterizerState> state;
+			this->device->CreateRasterizerState(&desc, state.GetAddressOf());
+			return state;
+		}),
+	depthStencilStates([this](const D3D11_DEPTH_STENCIL_DESC& desc)
+		{
+			ComPtr<ID3D11DepthStencilState> state;
+			this->device->CreateDepthStencilState(&desc, state.GetAddressOf());
+			return state;
+		}),
+	samplerStates([this](const D3D11_SAMPLER_DESC& desc)
+		{
+			ComPtr<ID3D11SamplerState> state;
+			this->device->CreateSamplerState(&desc, state.GetAddressOf());
+			return state;
+		})
+{
+}
+
+ComPtr<ID3D11RasterizerState> PipelineStates::GetRasterizerState(const D3D11_RASTERIZER_DESC& desc)
+{
+	// Every member is 4 bytes, so there's no padding to clear
+	return rasterizerStates.Get(desc);
+}
+
+// --------------------------------------------------------
+// The two stencil masks leave padding before the face ops,
+// which "= {}" isn't guaranteed to zero.  Copy member by
+// member into a cleared struct so the bytes always match.
+// --------------------------------------------------------
+ComPtr<ID3D11DepthStencilState> PipelineStates::GetDepthStencilState(const D3D11_DEPTH_STENCIL_DESC& desc)
+{
+	D3D11_DEPTH_STENCIL_DESC key;
+	memset(&key, 0, sizeof(key));
+	key.DepthEnable = desc.DepthEnable;
+	key.DepthWriteMask = desc.DepthWriteMask;
+	key.DepthFunc = desc.DepthFunc;
+	key.StencilEnable = desc.StencilEnable;
+	key.StencilReadMask = desc.StencilReadMask;
+	key.StencilWriteMask = desc.StencilWriteMask;
+	key.FrontFace = desc.FrontFace;
+	key.BackFace = desc.BackFace;
+	return depthStencilStates.Get(key);
+}
+
+ComPtr<ID3D11SamplerState> PipelineStates::GetSamplerState(const D3D11_SAMPLER_DESC& desc)
+{
+	// Every member is 4 bytes, so there's no padding to clear
+	return samplerStates.Get(desc);
+}
+
+unsigned long long PipelineStates::MakeKey(
+	ID3D11VertexShader* vs,
+	ID3D11PixelShader* ps,
+	ID3D11InputLayout* layout,
+	ID3D11RasterizerState* rasterizer,
+	ID3D11DepthStencilState* depthStencil,
+	const void* user)
+{
+	return keys.MakeKey(vs, ps, layout, rasterizer, depthStencil, user);
+}
+
+unsigned int PipelineStates::GetStateCount()
+{
+	return
+		rasterizerStates.GetCount() +
+		depthStencilStates.GetCount() +
+		samplerStates.GetCount();
+}
+
+unsigned int PipelineStates::GetReuseCount()
+{
+	return
+		rasterizerStates.GetStats().Hits +
+		depthStencilStates.GetStats().Hits +
+		samplerStates.GetStats().Hits;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <d3d11.h>
+#include <wrl/client.h>
+#include "StateObjectCache.h"
+
+// --------------------------------------------------------
+// Shared, immutable rasterizer, depth-stencil and sampler
+// states.  Anything asking for a state with the same
+// description gets the same object back, so identical
+// states set up in different places aren't duplicated and
+// can be recognized by pointer when sorting draws.
+//
+// D3D already returns an existing object for a repeated
+// description, but only after a trip through the runtime;
+// this avoids the call and counts how often it happens.
+// --------------------------------------------------------
+class PipelineStates
+{
+public:
+	PipelineStates(Microsoft::WRL::ComPtr<ID3D11Device> device);
+
+	Microsoft::WRL::ComPtr<ID3D11RasterizerState> GetRasterizerState(const D3D11_RASTERIZER_DESC& desc);
+	Microsoft::WRL::ComPtr<ID3D11DepthStencilState> GetDepthStencilState(const D3D11_DEPTH_STENCIL_DESC& desc);
+	Microsoft::WRL::ComPtr<ID3D11SamplerState> GetSamplerState(const D3D11_SAMPLER_DESC& desc);
+
+	// Sort key for the given pipeline, with user as the tie breaker
+	unsigned long long MakeKey(
+		ID3D11VertexShader* vs,
+		ID3D11PixelShader* ps,
+		ID3D11InputLayout* layout,
+		ID3D11RasterizerState* rasterizer,
+		ID3D11DepthStencilState* depthStencil,
+		const void* user = 0);
+
+	// Unique objects created, and lookups that reused one
+	unsigned int GetStateCount();
+	unsigned int GetReuseCount();
+
+private:
+	Microsoft::WRL::ComPtr<ID3D11Device> device;
+
+	StateObjectCache<D3D11_RASTERIZER_DESC, Microsoft::WRL::ComPtr<ID3D11RasterizerState>> rasterizerStates;
+	StateObjectCache<D3D11_DEPTH_STENCIL_DESC, Microsoft::WRL::ComPtr<ID3D11DepthStencilState>> depthStencilStates;
+	StateObjectCache<D3D11_SAMPLER_DESC, Microsoft::WRL::ComPtr<ID3D11SamplerState>> samplerStates;
+
+	PipelineKeyBuilder keys;
+};
@@ -1,23 +1,54 @@
-#include "ShaderStructs.hlsli"
+#include "ShaderBuffers.hlsli"
 #include "PBRFuncs.hlsli"
 
-cbuffer ExternalData : register(b0)
-{
-    Light lights[MAX_LIGHTS];
-    float4 colorTint;
-    float2 textureScale;
-    float2 textureOffset;
-    float3 camPosition;
-    int lightCount;
-}
+// Permutation switches, set by the PixelShader_*.hlsl wrappers that
+// Tools/GeneratePermutations.cpp writes.  The defaults build the
+// general shader, which uses every map and handles any mix of lights.
+#ifndef PERM_NORMAL_MAP
+#define PERM_NORMAL_MAP 1
+#endif
+#ifndef PERM_PBR_MAPS
+#define PERM_PBR_MAPS 1
+#endif
+#ifndef PERM_SHADOWS
+#define PERM_SHADOWS 1
+#endif
+
+// Material textures as slices of shared Texture2DArrays, picked
+// by the slice indices in PerMaterial, instead of one texture each
+#ifndef PERM_TEXTURE_ARRAYS
+#define PERM_TEXTURE_ARRAYS 0
+#endif
+
+// Fixed light counts per type.  Lights must then be sorted by type
+// (directional, point, spot) so each type is a known range of the
+// array, and the loops unroll with no per-light branching.
+// Without them, the loop runs to lightCount and switches on type.
+#if defined(PERM_DIR_LIGHTS) && defined(PERM_POINT_LIGHTS) && defined(PERM_SPOT_LIGHTS)
+#define PERM_FIXED_LIGHTS 1
+#else
+#define PERM_FIXED_LIGHTS 0
+#endif
 
+// SurfaceMap packs roughness (r), metalness (g) and ambient
+// occlusion (b), so one fetch covers all three (see ChannelPacker.h)
+#if PERM_TEXTURE_ARRAYS
+Texture2DArray Albedo : register(t0);
+Texture2DArray NormalMap : register(t1);
+Texture2DArray SurfaceMap : register(t2);
+#define SAMPLE_MAP(map, slice, uv) map.Sample(BasicSampler, float3(uv, slice))
+#else
 Texture2D Albedo : register(t0);
 Texture2D NormalMap : register(t1);
-Texture2D RoughnessMap : register(t2);
-Texture2D MetalnessMap : register(t3);
+Texture2D SurfaceMap : register(t2);
+#define SAMPLE_MAP(map, slice, uv) map.Sample(BasicSampler, uv)
+#endif
+TextureCube SpecularMap : register(t3);     // The sky, prefiltered by roughness
 Texture2D ShadowMap : register(t4);
+Texture2D BrdfLUT : register(t5);
 SamplerState BasicSampler : register(s0);
 SamplerComparisonState ShadowSampler : register(s1);
+SamplerState ClampSampler : register(s2);
 
 float Attenuate(Light light, float3 worldPos)
 {
@@ -75,6 +106,7 @@ float3 spotLight(Light light, float3 normal, float3 V, float3 surfaceColor, floa
 
 float4 main(VertexToPixel input) : SV_TARGET
 {   
+#if PERM_SHADOWS
     // Perform the perspective divide (divide by W) ourselves
     input.shadowMapPos /= input.shadowMapPos.w;
     // Convert the normalized device coordinates to UVs for sampling
@@ -87,17 +119,24 @@ float4 main(VertexToPixel input) : SV_TARGET
         ShadowSampler,
         shadowUV,
         distToLight).r;
+#else
+    float shadowAmount = 1.0f;
+#endif
     
     
     float2 uv = input.uv * textureScale + textureOffset;
-    float4 surfaceColor = pow(Albedo.Sample(BasicSampler, uv), 2.2f) * colorTint;
-    
-    // Unpack normal map
-    float3 unpackedNormal = NormalMap.Sample(BasicSampler, uv).rgb * 2 - 1;
-    unpackedNormal = normalize(unpackedNormal);
+    float4 surfaceColor = pow(SAMPLE_MAP(Albedo, albedoSlice, uv), 2.2f) * colorTint;
     
     // Normalize input vectors
     input.normal = normalize(input.normal);
+
+#if PERM_NORMAL_MAP
+    // Unpack normal map.  Only x & y are read, since two channel
+    // (BC5) maps have no z, which is rebuilt from the unit length.
+    float2 normalXY = SAMPLE_MAP(NormalMap, normalSlice, uv).rg * 2 - 1;
+    float3 unpackedNormal = float3(normalXY, sqrt(saturate(1 - dot(normalXY, normalXY))));
+    unpackedNormal = normalize(unpackedNormal);
+    
     input.tangent = normalize(input.tangent);
     
     // Calculate TBN
@@ -107,12 +146,23 @@ float4 main(VertexToPixel input) : SV_TARGET
 
     // Transform normal from map
     input.normal = mul(unpackedNormal, TBN);
+#endif
     
     float3 totalLight = float3(0, 0, 0);
     
     // Roughness and metallic
-    float roughness = RoughnessMap.Sample(BasicSampler, uv).r;
-    float metalness = MetalnessMap.Sample(BasicSampler, uv).r;
+#if PERM_PBR_MAPS
+    // Occlusion (blue) only dims ambient light
+    float3 surface = SAMPLE_MAP(SurfaceMap, surfaceSlice, uv).rgb;
+    float roughnessValue = surface.r;
+    float metalness = surface.g;
+    float occlusion = surface.b;
+#else
+    // Materials without maps use their roughness value and aren't metals
+    float roughnessValue = roughness;
+    float metalness = 0.0f;
+    float occlusion = 1.0f;
+#endif
     
     // Specular color determination 
     float3 specularColor = lerp(F0_NON_METAL, surfaceColor.rgb, metalness);
@@ -120,6 +170,23 @@ float4 main(VertexToPixel input) : SV_TARGET
     // Light calculation
     float3 V = normalize(camPosition - input.worldPos);
     
+#if PERM_FIXED_LIGHTS
+    // Only the first directional light casts shadows
+    [unroll]
+    for (int d = 0; d < PERM_DIR_LIGHTS; d++)
+    {
+        float3 lightResult = directionalLight(lights[d], input.normal, V, surfaceColor.xyz, lights[d].Direction, roughnessValue, specularColor, metalness);
+        totalLight += (d == 0) ? lightResult * shadowAmount : lightResult;
+    }
+    
+    [unroll]
+    for (int p = PERM_DIR_LIGHTS; p < PERM_DIR_LIGHTS + PERM_POINT_LIGHTS; p++)
+        totalLight += pointLight(lights[p], input.normal, V, surfaceColor.xyz, input.worldPos, roughnessValue, specularColor, metalness);
+    
+    [unroll]
+    for (int s = PERM_DIR_LIGHTS + PERM_POINT_LIGHTS; s < PERM_DIR_LIGHTS + PERM_POINT_LIGHTS + PERM_SPOT_LIGHTS; s++)
+        totalLight += spotLight(lights[s], input.normal, V, surfaceColor.xyz, input.worldPos, roughnessValue, specularColor, metalness);
+#else
     for (int i = 0; i < lightCount; i++)
     {
         float3 lightResult = 0;
@@ -127,13 +194,13 @@ float4 main(VertexToPixel input) : SV_TARGET
         switch (lights[i].Type)
         {
             case LIGHT_TYPE_DIRECTIONAL:
-                lightResult = directionalLight(lights[i], input.normal, V, surfaceColor.xyz, lights[i].Direction, roughness, specularColor, metalness);
+                lightResult = directionalLight(lights[i], input.normal, V, surfaceColor.xyz, lights[i].Direction, roughnessValue, specularColor, metalness);
                 break;
             case LIGHT_TYPE_POINT:
-                lightResult = pointLight(lights[i], input.normal, V, surfaceColor.xyz, input.worldPos, roughness, specularColor, metalness);
+                lightResult = pointLight(lights[i], input.normal, V, surfaceColor.xyz, input.worldPos, roughnessValue, specularColor, metalness);
                 break;
             case LIGHT_TYPE_SPOT:
-                lightResult = spotLight(lights[i], input.normal, V, surfaceColor.xyz, input.worldPos, roughness, specularColor, metalness);
+                lightResult = spotLight(lights[i], input.normal, V, surfaceColor.xyz, input.worldPos, roughnessValue, specularColor, metalness);
                 break;
         }
         
@@ -144,7 +211,14 @@ float4 main(VertexToPixel input) : SV_TARGET
         
         totalLight += lightResult;
     }
+#endif
+
+    // Ambient light from the sky: diffuse, which metals don't have,
+    // and its reflection
+    totalLight += AmbientSH(ambientSH, input.normal) * surfaceColor.rgb * (1 - metalness) * occlusion;
+    totalLight += IndirectSpecular(SpecularMap, BrdfLUT, BasicSampler, ClampSampler,
+        specularMipCount, input.normal, V, roughnessValue, specularColor) * occlusion;
 
-    	
-    return float4(pow(totalLight, 1.0f/2.2f), 1);
+    // Linear; gamma is applied by the color LUT post process
+    return float4(totalLight, 1);
 }
\ No newline at end of file
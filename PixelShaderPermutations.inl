@@ -0,0 +1,12 @@
+// Generated by Tools/GeneratePermutations.cpp: every compiled
+// variant of PixelShader.hlsl, the general one first
+{ { SHADER_FEATURE_ALL, SHADER_ANY_LIGHTS, SHADER_ANY_LIGHTS, SHADER_ANY_LIGHTS }, L"PixelShader.cso" },
+{ { SHADER_FEATURE_ALL, 3, 1, 1 }, L"PixelShader_NMS_D3P1S1.cso" },
+{ { SHADER_FEATURE_NORMAL_MAP | SHADER_FEATURE_PBR_MAPS, SHADER_ANY_LIGHTS, SHADER_ANY_LIGHTS, SHADER_ANY_LIGHTS }, L"PixelShader_NM.cso" },
+{ { SHADER_FEATURE_NORMAL_MAP | SHADER_FEATURE_PBR_MAPS, 3, 1, 1 }, L"PixelShader_NM_D3P1S1.cso" },
+{ { SHADER_FEATURE_PBR_MAPS | SHADER_FEATURE_SHADOWS, SHADER_ANY_LIGHTS, SHADER_ANY_LIGHTS, SHADER_ANY_LIGHTS }, L"PixelShader_MS.cso" },
+{ { SHADER_FEATURE_PBR_MAPS | SHADER_FEATURE_SHADOWS, 3, 1, 1 }, L"PixelShader_MS_D3P1S1.cso" },
+{ { SHADER_FEATURE_SHADOWS, SHADER_ANY_LIGHTS, SHADER_ANY_LIGHTS, SHADER_ANY_LIGHTS }, L"PixelShader_S.cso" },
+{ { SHADER_FEATURE_SHADOWS, 3, 1, 1 }, L"PixelShader_S_D3P1S1.cso" },
+{ { SHADER_FEATURE_NORMAL_MAP | SHADER_FEATURE_PBR_MAPS | SHADER_FEATURE_SHADOWS | SHADER_FEATURE_TEXTURE_ARRAYS, SHADER_ANY_LIGHTS, SHADER_ANY_LIGHTS, SHADER_ANY_LIGHTS }, L"PixelShader_A.cso" },
+{ { SHADER_FEATURE_NORMAL_MAP | SHADER_FEATURE_PBR_MAPS | SHADER_FEATURE_SHADOWS | SHADER_FEATURE_TEXTURE_ARRAYS, 3, 1, 1 }, L"PixelShader_ANMS_D3P1S1.cso" },
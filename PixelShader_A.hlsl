@@ -0,0 +1,5 @@
+// Normal map, PBR maps and shadows, with any lights, and material textures in arrays
+// Generated by Tools/GeneratePermutations.cpp, and listed in PixelShaderPermutations.inl
+#define PERM_TEXTURE_ARRAYS 1
+
+#include "PixelShader.hlsl"
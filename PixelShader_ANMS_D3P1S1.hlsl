@@ -0,0 +1,11 @@
+// Normal map, PBR maps and shadows, with 3 directional, 1 point & 1 spot light, and material textures in arrays
+// Generated by Tools/GeneratePermutations.cpp, and listed in PixelShaderPermutations.inl
+#define PERM_TEXTURE_ARRAYS 1
+#define PERM_NORMAL_MAP 1
+#define PERM_PBR_MAPS 1
+#define PERM_SHADOWS 1
+#define PERM_DIR_LIGHTS 3
+#define PERM_POINT_LIGHTS 1
+#define PERM_SPOT_LIGHTS 1
+
+#include "PixelShader.hlsl"
@@ -0,0 +1,7 @@
+// PBR maps and shadows without a normal map, with any lights
+// Generated by Tools/GeneratePermutations.cpp, and listed in PixelShaderPermutations.inl
+#define PERM_NORMAL_MAP 0
+#define PERM_PBR_MAPS 1
+#define PERM_SHADOWS 1
+
+#include "PixelShader.hlsl"
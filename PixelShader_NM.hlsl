@@ -0,0 +1,7 @@
+// Normal map and PBR maps without shadows, with any lights
+// Generated by Tools/GeneratePermutations.cpp, and listed in PixelShaderPermutations.inl
+#define PERM_NORMAL_MAP 1
+#define PERM_PBR_MAPS 1
+#define PERM_SHADOWS 0
+
+#include "PixelShader.hlsl"
@@ -0,0 +1,7 @@
+// Shadows without a normal map or PBR maps, with any lights
+// Generated by Tools/GeneratePermutations.cpp, and listed in PixelShaderPermutations.inl
+#define PERM_NORMAL_MAP 0
+#define PERM_PBR_MAPS 0
+#define PERM_SHADOWS 1
+
+#include "PixelShader.hlsl"
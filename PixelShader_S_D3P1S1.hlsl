@@ -0,0 +1,10 @@
+// Shadows without a normal map or PBR maps, with 3 directional, 1 point & 1 spot light
+// Generated by Tools/GeneratePermutations.cpp, and listed in PixelShaderPermutations.inl
+#define PERM_NORMAL_MAP 0
+#define PERM_PBR_MAPS 0
+#define PERM_SHADOWS 1
+#define PERM_DIR_LIGHTS 3
+#define PERM_POINT_LIGHTS 1
+#define PERM_SPOT_LIGHTS 1
+
+#include "PixelShader.hlsl"
@@ -0,0 +1,46 @@
+// Pixelation, optionally color graded in the same pass
+#ifndef FUSE_COLOR
+#define FUSE_COLOR 0
+#endif
+
+#if FUSE_COLOR
+#include "ColorLUT.hlsli"
+#endif
+
+cbuffer externalData : register(b0)
+{
+    int pixelSize;
+    float width;
+    float height;
+}
+
+struct VertexToPixel
+{
+    float4 position : SV_POSITION;
+    float2 uv : TEXCOORD0;
+};
+
+Texture2D Pixels : register(t0);
+SamplerState ClampSampler : register(s0);
+
+float4 main(VertexToPixel input) : SV_TARGET
+{   
+    // Coordinate of the current pixel
+    float2 pixelCoord = float2(input.uv.x * width, input.uv.y * height);
+    
+    // Get the "new" coordinate of the pixel using the pixel size
+    float x = uint(pixelCoord.x) % pixelSize;
+    float y = uint(pixelCoord.y) % pixelSize;
+
+    x = floor(pixelSize / 2.0) - x;
+    y = floor(pixelSize / 2.0) - y;
+
+    x = pixelCoord.x + x;
+    y = pixelCoord.y + y;
+    
+    float4 color = Pixels.Sample(ClampSampler, float2(x, y) / float2(width, height));
+#if FUSE_COLOR
+    color = ApplyColor(color, pixelCoord);
+#endif
+    return color;
+}
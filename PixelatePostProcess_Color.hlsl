@@ -0,0 +1,4 @@
+// Pixelation, then the color pipeline
+#define FUSE_COLOR 1
+
+#include "PixelatePostProcess.hlsl"
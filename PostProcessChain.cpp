@@ -0,0 +1,126 @@
+#include "PostProcessChain.h"
+#include "PostResample.h"
+#include <algorithm>
+
+unsigned int PostProcessChain::Add(const std::string& name, PostEffectKind kind, std::function<bool()> enabled,
+	std::function<unsigned int()> downscale)
+{
+	effects.push_back({ name, kind, enabled, downscale });
+	return (unsigned int)effects.size() - 1;
+}
+
+const PostEffect& PostProcessChain::GetEffect(unsigned int index) const
+{
+	return effects[index];
+}
+
+unsigned int PostProcessChain::GetEffectCount() const
+{
+	return (unsigned int)effects.size();
+}
+
+// --------------------------------------------------------
+// Pixel effects with no pass before them (nothing enabled
+// ahead of them, or only other pixel effects) get a pass of
+// their own, reading the scene.  Whenever the resolution
+// changes between effects, the chain steps back up to full
+// resolution and, if needed, down to the new one.
+// --------------------------------------------------------
+std::vector<PostPass> PostProcessChain::Plan() const
+{
+	std::vector<PostPass> passes;
+	unsigned int current = 1;
+	for (unsigned int i = 0; i < effects.size(); i++)
+	{
+		if (effects[i].Enabled && !effects[i].Enabled())
+			continue;
+
+		// Pixel effects are always at full resolution
+		unsigned int downscale = 1;
+		if (effects[i].Kind == POST_EFFECT_NEIGHBORHOOD && effects[i].Downscale)
+			downscale = std::clamp(effects[i].Downscale(), 1u, (unsigned int)MAX_POST_DOWNSCALE);
+
+		if (downscale != current)
+		{
+			if (current > 1)
+				passes.push_back({ POST_PASS_UPSAMPLE, -1, {}, current });
+			if (downscale > 1)
+				passes.push_back({ POST_PASS_DOWNSAMPLE, -1, {}, downscale });
+			current = downscale;
+		}
+
+		if (effects[i].Kind == POST_EFFECT_NEIGHBORHOOD)
+			passes.push_back({ POST_PASS_EFFECT, (int)i, {}, downscale });
+		else if (passes.empty())
+			passes.push_back({ POST_PASS_EFFECT, -1, { i }, 1 });
+		else
+			passes.back().Fused.push_back(i);
+	}
+
+	if (current > 1)
+		passes.push_back({ POST_PASS_UPSAMPLE, -1, {}, current });
+	return passes;
+}
+
+// --------------------------------------------------------
+// Every pass's result is its own graph texture, named after
+// the pass; the graph decides which of them share memory.
+// --------------------------------------------------------
+unsigned int PostProcessChain::AddToGraph(RenderGraph& graph, unsigned int output, unsigned int depth,
+	const RenderGraphTextureDesc& desc, unsigned int depthFormat, PostProcessBackend& backend) const
+{
+	std::vector<PostPass> passes = Plan();
+	if (passes.empty())
+		return output;
+
+	unsigned int scene = graph.CreateTexture("Scene", desc);
+	unsigned int input = scene;
+	unsigned int reducedDepth = 0;
+	for (size_t p = 0; p < passes.size(); p++)
+	{
+		PostPass& pass = passes[p];
+		std::string name =
+			pass.Type == POST_PASS_DOWNSAMPLE ? "Downsample" :
+			pass.Type == POST_PASS_UPSAMPLE ? "Upsample" :
+			pass.Effect >= 0 ? effects[pass.Effect].Name : "";
+		for (unsigned int fused : pass.Fused)
+			name += (name.empty() ? "" : " + ") + effects[fused].Name;
+
+		// Everything but an upsample draws at its own downscale
+		RenderGraphTextureDesc outputDesc = desc;
+		if (pass.Type != POST_PASS_UPSAMPLE)
+		{
+			outputDesc.Width = PostResample::GetReducedSize(desc.Width, pass.Downscale);
+			outputDesc.Height = PostResample::GetReducedSize(desc.Height, pass.Downscale);
+		}
+
+		if (pass.Type == POST_PASS_DOWNSAMPLE)
+		{
+			RenderGraphTextureDesc depthDesc = outputDesc;
+			depthDesc.Format = depthFormat;
+			reducedDepth = graph.CreateTexture(name + " depth", depthDesc);
+		}
+
+		pass.Input = input;
+		pass.Output = p + 1 == passes.size() ? output : graph.CreateTexture(name, outputDesc);
+		pass.ReducedDepth = reducedDepth;
+
+		unsigned int graphPass = graph.AddPass(name, [&backend, pass]() {
+			backend.DrawPostPass(pass);
+		});
+		graph.Read(graphPass, pass.Input);
+		graph.Write(graphPass, pass.Output);
+		if (pass.Type == POST_PASS_DOWNSAMPLE)
+		{
+			graph.Read(graphPass, depth);
+			graph.Write(graphPass, reducedDepth);
+		}
+		else if (pass.Type == POST_PASS_UPSAMPLE)
+		{
+			graph.Read(graphPass, reducedDepth);
+			graph.Read(graphPass, depth);
+		}
+		input = pass.Output;
+	}
+	return scene;
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+#include "RenderGraph.h"
+
+// --------------------------------------------------------
+// What a post effect reads
+//  - PIXEL: only its own pixel's color, so it can run at
+//    the end of whatever pass comes before it
+//  - NEIGHBORHOOD: other pixels (blurs, pixelation), so it
+//    needs its input in a texture, and a pass of its own
+// --------------------------------------------------------
+enum PostEffectKind
+{
+	POST_EFFECT_PIXEL,
+	POST_EFFECT_NEIGHBORHOOD
+};
+
+// --------------------------------------------------------
+// What a pass does
+//  - EFFECT: a neighbourhood effect and/or fused pixel effects
+//  - DOWNSAMPLE: scene color and depth to a reduced target,
+//    ahead of effects that run at that resolution
+//  - UPSAMPLE: back to full resolution, by depth
+// --------------------------------------------------------
+enum PostPassType
+{
+	POST_PASS_EFFECT,
+	POST_PASS_DOWNSAMPLE,
+	POST_PASS_UPSAMPLE
+};
+
+struct PostEffect
+{
+	std::string Name;
+	PostEffectKind Kind;
+	std::function<bool()> Enabled;			// False while it wouldn't change anything
+	std::function<unsigned int()> Downscale;	// Resolution divisor; always 1 if empty
+};
+
+// --------------------------------------------------------
+// One full-screen draw: a neighbourhood effect, if there is
+// one, then the pixel effects that follow it applied to its
+// result in the same shader.  Pixel effects always run at
+// full resolution, so after reduced passes they are fused
+// into the upsample.
+// --------------------------------------------------------
+struct PostPass
+{
+	PostPassType Type;
+	int Effect;							// Index of the neighbourhood effect, or -1
+	std::vector<unsigned int> Fused;	// Pixel effects, in chain order
+	unsigned int Downscale;				// Of the reduced side: drawn at, or upsampled from
+
+	// Graph textures, set by PostProcessChain::AddToGraph()
+	unsigned int Input = 0;
+	unsigned int Output = 0;
+	unsigned int ReducedDepth = 0;		// Written by a downsample, read by its upsample
+};
+
+// --------------------------------------------------------
+// Draws the passes a chain adds to a render graph
+// --------------------------------------------------------
+class PostProcessBackend
+{
+public:
+	virtual ~PostProcessBackend() {}
+
+	virtual void DrawPostPass(const PostPass& pass) = 0;
+};
+
+// --------------------------------------------------------
+// An ordered list of post effects, each with a predicate
+// that says whether it's on.  Each frame, the enabled ones
+// become as few full-screen passes as they can: each
+// neighbourhood effect starts a pass, and pixel effects
+// join the pass before them.  With nothing enabled there
+// are no passes and the scene draws straight to the output.
+//
+// Effects with a downscale run at that fraction of the
+// output's size, between a downsample and a bilateral
+// upsample (see PostResample.h) shared by neighbouring
+// effects at the same downscale.
+// --------------------------------------------------------
+class PostProcessChain
+{
+public:
+	// Returns the effect's index, which passes refer to it by
+	unsigned int Add(const std::string& name, PostEffectKind kind, std::function<bool()> enabled,
+		std::function<unsigned int()> downscale = nullptr);
+
+	const PostEffect& GetEffect(unsigned int index) const;
+	unsigned int GetEffectCount() const;
+
+	// Checks every predicate, so only valid for the current settings
+	std::vector<PostPass> Plan() const;
+
+	// Plans, then adds a graph pass per planned pass, each writing a
+	// new texture like desc (scaled down for reduced passes) and the
+	// last writing the output.  Reduced depth is a single channel
+	// depthFormat texture, made from the scene's depth.  Returns the
+	// texture the first pass reads, which the scene should be drawn
+	// into: the output itself with no passes.
+	unsigned int AddToGraph(RenderGraph& graph, unsigned int output, unsigned int depth,
+		const RenderGraphTextureDesc& desc, unsigned int depthFormat, PostProcessBackend& backend) const;
+
+private:
+	std::vector<PostEffect> effects;
+};
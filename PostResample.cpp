@@ -0,0 +1,132 @@
+#include "PostResample.h"
+#include <DirectXMath.h>
+#include <DirectXPackedVector.h>
+#include <algorithm>
+#include <cmath>
+
+using namespace DirectX;
+using namespace DirectX::PackedVector;
+
+namespace
+{
+	XMVECTOR LoadPixel(const BlockImage& image, unsigned int x, unsigned int y)
+	{
+		return XMLoadUByteN4((const XMUBYTEN4*)&image.Pixels[((size_t)y * image.Width + x) * 4]);
+	}
+
+	void StorePixel(BlockImage& image, unsigned int x, unsigned int y, FXMVECTOR color)
+	{
+		XMStoreUByteN4((XMUBYTEN4*)&image.Pixels[((size_t)y * image.Width + x) * 4], color);
+	}
+}
+
+unsigned int PostResample::GetReducedSize(unsigned int size, unsigned int downscale)
+{
+	return (size + downscale - 1) / downscale;
+}
+
+float PostResample::LinearizeDepth(float depth, float proj33, float proj43)
+{
+	return proj43 / (depth - proj33);
+}
+
+BlockImage PostResample::Downsample(const BlockImage& image, unsigned int downscale)
+{
+	BlockImage result = {};
+	result.Width = GetReducedSize(image.Width, downscale);
+	result.Height = GetReducedSize(image.Height, downscale);
+	result.Pixels.resize((size_t)result.Width * result.Height * 4);
+
+	for (unsigned int y = 0; y < result.Height; y++)
+	{
+		for (unsigned int x = 0; x < result.Width; x++)
+		{
+			XMVECTOR total = XMVectorZero();
+			unsigned int count = 0;
+			for (unsigned int by = y * downscale; by < std::min((y + 1) * downscale, image.Height); by++)
+			{
+				for (unsigned int bx = x * downscale; bx < std::min((x + 1) * downscale, image.Width); bx++)
+				{
+					total = XMVectorAdd(total, LoadPixel(image, bx, by));
+					count++;
+				}
+			}
+			StorePixel(result, x, y, XMVectorScale(total, 1.0f / count));
+		}
+	}
+	return result;
+}
+
+DepthImage PostResample::DownsampleDepth(const DepthImage& depth, unsigned int downscale)
+{
+	DepthImage result = {};
+	result.Width = GetReducedSize(depth.Width, downscale);
+	result.Height = GetReducedSize(depth.Height, downscale);
+	result.Depths.resize((size_t)result.Width * result.Height);
+
+	for (unsigned int y = 0; y < result.Height; y++)
+	{
+		for (unsigned int x = 0; x < result.Width; x++)
+		{
+			float total = 0;
+			unsigned int count = 0;
+			for (unsigned int by = y * downscale; by < std::min((y + 1) * downscale, depth.Height); by++)
+			{
+				for (unsigned int bx = x * downscale; bx < std::min((x + 1) * downscale, depth.Width); bx++)
+				{
+					total += depth.Depths[(size_t)by * depth.Width + bx];
+					count++;
+				}
+			}
+			result.Depths[(size_t)y * result.Width + x] = total / count;
+		}
+	}
+	return result;
+}
+
+// --------------------------------------------------------
+// The full resolution pixel's center, in reduced texels,
+// picks the 2 x 2 texels around it (clamped at the edges)
+// and their bilinear weights, as a linear sampler would.
+// --------------------------------------------------------
+BlockImage PostResample::BilateralUpsample(const BlockImage& low, const DepthImage& lowDepth,
+	const DepthImage& fullDepth, unsigned int downscale)
+{
+	BlockImage result = {};
+	result.Width = fullDepth.Width;
+	result.Height = fullDepth.Height;
+	result.Pixels.resize((size_t)result.Width * result.Height * 4);
+
+	for (unsigned int y = 0; y < result.Height; y++)
+	{
+		for (unsigned int x = 0; x < result.Width; x++)
+		{
+			float u = (x + 0.5f) / downscale - 0.5f;
+			float v = (y + 0.5f) / downscale - 0.5f;
+			float fu = u - std::floor(u);
+			float fv = v - std::floor(v);
+			int x0 = (int)std::floor(u);
+			int y0 = (int)std::floor(v);
+			float depth = fullDepth.Depths[(size_t)y * fullDepth.Width + x];
+
+			XMVECTOR total = XMVectorZero();
+			float totalWeight = 0;
+			for (int i = 0; i < 4; i++)
+			{
+				int dx = i & 1;
+				int dy = i >> 1;
+				unsigned int tx = (unsigned int)std::clamp(x0 + dx, 0, (int)low.Width - 1);
+				unsigned int ty = (unsigned int)std::clamp(y0 + dy, 0, (int)low.Height - 1);
+
+				float bilinear = (dx ? fu : 1 - fu) * (dy ? fv : 1 - fv);
+				float difference = std::abs(lowDepth.Depths[(size_t)ty * lowDepth.Width + tx] - depth) / depth;
+				float weight = bilinear / (BILATERAL_DEPTH_EPSILON + difference);
+
+				total = XMVectorMultiplyAdd(LoadPixel(low, tx, ty), XMVectorReplicate(weight), total);
+				totalWeight += weight;
+			}
+			StorePixel(result, x, y, XMVectorScale(total, 1.0f / totalWeight));
+		}
+	}
+	return result;
+}
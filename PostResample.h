@@ -0,0 +1,57 @@
+#pragma once
+
+#include <vector>
+#include "BlockCompression.h"
+
+// Largest downscale a reduced-resolution post pass can use
+#define MAX_POST_DOWNSCALE 4
+
+// Keeps bilateral weights finite where depths match exactly
+// (must match BilateralUpsample.hlsl)
+#define BILATERAL_DEPTH_EPSILON 0.01f
+
+// --------------------------------------------------------
+// One depth per pixel, linear (view space distance), rows
+// tightly packed
+// --------------------------------------------------------
+struct DepthImage
+{
+	unsigned int Width;
+	unsigned int Height;
+	std::vector<float> Depths;
+};
+
+// --------------------------------------------------------
+// The filters that move post processing to and from a
+// reduced resolution, on the CPU, matching the downsample
+// and upsample shaders for comparing GPU output against.
+//
+// Downsampling by n averages each n x n block (clipped at
+// the right and bottom edges) into one texel, for both color
+// and linear depth.  Upsampling blends the 2 x 2 nearest
+// reduced texels by their bilinear weights, each divided by
+// how far its depth is from the full resolution pixel's:
+//
+//   w = bilinear / (epsilon + |low depth - depth| / depth)
+//
+// so colors don't bleed across edges between near and far
+// surfaces.
+// --------------------------------------------------------
+namespace PostResample
+{
+	// Texels along one side of an image downscaled by n, rounded up
+	unsigned int GetReducedSize(unsigned int size, unsigned int downscale);
+
+	// Linear depth from a depth buffer value, given the projection
+	// matrix's _33 and _43 (row vector convention)
+	float LinearizeDepth(float depth, float proj33, float proj43);
+
+	// Results are rounded to 8 bits; the GPU's reduced targets keep
+	// half floats, so can differ by that rounding
+	BlockImage Downsample(const BlockImage& image, unsigned int downscale);
+	DepthImage DownsampleDepth(const DepthImage& depth, unsigned int downscale);
+
+	// Back to fullDepth's size
+	BlockImage BilateralUpsample(const BlockImage& low, const DepthImage& lowDepth,
+		const DepthImage& fullDepth, unsigned int downscale);
+}
@@ -0,0 +1,221 @@
+#include "RenderGraph.h"
+#include <algorithm>
+
+bool RenderGraphTextureDesc::operator==(const RenderGraphTextureDesc& other) const
+{
+	return Width == other.Width && Height == other.Height && Format == other.Format;
+}
+
+bool RenderGraphTextureDesc::operator!=(const RenderGraphTextureDesc& other) const
+{
+	return !(*this == other);
+}
+
+unsigned int RenderGraph::CreateTexture(const std::string& name, const RenderGraphTextureDesc& desc)
+{
+	textures.push_back({ name, desc, false });
+	return (unsigned int)textures.size() - 1;
+}
+
+unsigned int RenderGraph::ImportTexture(const std::string& name)
+{
+	textures.push_back({ name, {}, true });
+	return (unsigned int)textures.size() - 1;
+}
+
+unsigned int RenderGraph::AddPass(const std::string& name, std::function<void()> execute)
+{
+	passes.push_back({ name, {}, {}, execute });
+	return (unsigned int)passes.size() - 1;
+}
+
+void RenderGraph::Read(unsigned int pass, unsigned int texture)
+{
+	passes[pass].Reads.push_back(texture);
+}
+
+void RenderGraph::Write(unsigned int pass, unsigned int texture)
+{
+	passes[pass].Writes.push_back(texture);
+}
+
+void RenderGraph::Clear()
+{
+	textures.clear();
+	passes.clear();
+	order.clear();
+	slots.clear();
+	pool.clear();
+}
+
+bool RenderGraph::Compile()
+{
+	order.clear();
+	slots.assign(textures.size(), -1);
+	pool.clear();
+
+	// Who writes each texture, in the order they were added
+	std::vector<std::vector<unsigned int>> writers(textures.size());
+	for (unsigned int p = 0; p < passes.size(); p++)
+		for (unsigned int t : passes[p].Writes)
+			writers[t].push_back(p);
+
+	// Cull: start from the passes that write imported textures,
+	// then keep every writer of whatever a kept pass reads
+	std::vector<bool> alive(passes.size(), false);
+	std::vector<unsigned int> pending;
+	for (unsigned int t = 0; t < textures.size(); t++)
+		if (textures[t].Imported)
+			pending.insert(pending.end(), writers[t].begin(), writers[t].end());
+	while (!pending.empty())
+	{
+		unsigned int p = pending.back();
+		pending.pop_back();
+		if (alive[p])
+			continue;
+
+		alive[p] = true;
+		for (unsigned int t : passes[p].Reads)
+			pending.insert(pending.end(), writers[t].begin(), writers[t].end());
+	}
+
+	// Each texture's writers run in turn, then its readers
+	std::vector<std::vector<unsigned int>> after(passes.size());
+	std::vector<unsigned int> waitingOn(passes.size(), 0);
+	for (unsigned int p = 0; p < passes.size(); p++)
+	{
+		if (!alive[p])
+			continue;
+
+		for (unsigned int t : passes[p].Writes)
+		{
+			std::vector<unsigned int>& w = writers[t];
+			size_t next = std::find(w.begin(), w.end(), p) - w.begin() + 1;
+			if (next < w.size())
+			{
+				after[p].push_back(w[next]);
+				waitingOn[w[next]]++;
+			}
+		}
+
+		for (unsigned int t : passes[p].Reads)
+		{
+			for (unsigned int w : writers[t])
+			{
+				if (w == p)
+					continue;
+				after[w].push_back(p);
+				waitingOn[p]++;
+			}
+		}
+	}
+
+	// Of the passes that are ready, the earliest added goes first,
+	// so passes without dependencies keep the order they were added
+	std::vector<bool> placed(passes.size(), false);
+	unsigned int aliveCount = (unsigned int)std::count(alive.begin(), alive.end(), true);
+	while (order.size() < aliveCount)
+	{
+		unsigned int ready = 0;
+		while (ready < passes.size() && (!alive[ready] || placed[ready] || waitingOn[ready] > 0))
+			ready++;
+		if (ready == passes.size())
+		{
+			order.clear();
+			return false;
+		}
+
+		placed[ready] = true;
+		order.push_back(ready);
+		for (unsigned int p : after[ready])
+			waitingOn[p]--;
+	}
+
+	// Lifetime of each transient texture, as positions in the order
+	std::vector<int> firstUse(textures.size(), -1);
+	std::vector<int> lastUse(textures.size(), -1);
+	for (unsigned int i = 0; i < order.size(); i++)
+	{
+		const RenderGraphPass& pass = passes[order[i]];
+		for (const std::vector<unsigned int>* list : { &pass.Reads, &pass.Writes })
+		{
+			for (unsigned int t : *list)
+			{
+				if (firstUse[t] < 0)
+					firstUse[t] = i;
+				lastUse[t] = i;
+			}
+		}
+	}
+
+	// Alias: in order of first use, each texture takes the first
+	// matching slot that's free by then, or a new one
+	std::vector<unsigned int> byFirstUse;
+	for (unsigned int t = 0; t < textures.size(); t++)
+		if (!textures[t].Imported && firstUse[t] >= 0)
+			byFirstUse.push_back(t);
+	std::stable_sort(byFirstUse.begin(), byFirstUse.end(),
+		[&](unsigned int a, unsigned int b) { return firstUse[a] < firstUse[b]; });
+
+	std::vector<int> slotFreeAfter;
+	for (unsigned int t : byFirstUse)
+	{
+		int slot = -1;
+		for (unsigned int s = 0; s < pool.size() && slot < 0; s++)
+			if (pool[s] == textures[t].Desc && slotFreeAfter[s] < firstUse[t])
+				slot = s;
+
+		if (slot < 0)
+		{
+			slot = (int)pool.size();
+			pool.push_back(textures[t].Desc);
+			slotFreeAfter.push_back(0);
+		}
+
+		slots[t] = slot;
+		slotFreeAfter[slot] = lastUse[t];
+	}
+	return true;
+}
+
+void RenderGraph::Execute() const
+{
+	for (unsigned int p : order)
+		if (passes[p].Execute)
+			passes[p].Execute();
+}
+
+const RenderGraphTexture& RenderGraph::GetTexture(unsigned int texture) const
+{
+	return textures[texture];
+}
+
+const RenderGraphPass& RenderGraph::GetPass(unsigned int pass) const
+{
+	return passes[pass];
+}
+
+unsigned int RenderGraph::GetTextureCount() const
+{
+	return (unsigned int)textures.size();
+}
+
+unsigned int RenderGraph::GetPassCount() const
+{
+	return (unsigned int)passes.size();
+}
+
+const std::vector<unsigned int>& RenderGraph::GetOrder() const
+{
+	return order;
+}
+
+int RenderGraph::GetSlot(unsigned int texture) const
+{
+	return texture < slots.size() ? slots[texture] : -1;
+}
+
+const std::vector<RenderGraphTextureDesc>& RenderGraph::GetPool() const
+{
+	return pool;
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+// --------------------------------------------------------
+// What a transient texture needs to be.  Format holds a
+// DXGI_FORMAT, kept as a plain number so the graph has no
+// dependency on the graphics API.  Two textures can only
+// share memory when their descriptions match exactly.
+// --------------------------------------------------------
+struct RenderGraphTextureDesc
+{
+	unsigned int Width;
+	unsigned int Height;
+	unsigned int Format;
+
+	bool operator==(const RenderGraphTextureDesc& other) const;
+	bool operator!=(const RenderGraphTextureDesc& other) const;
+};
+
+struct RenderGraphTexture
+{
+	std::string Name;
+	RenderGraphTextureDesc Desc;
+	bool Imported;		// Owned outside the graph (the back buffer), never aliased
+};
+
+struct RenderGraphPass
+{
+	std::string Name;
+	std::vector<unsigned int> Reads;
+	std::vector<unsigned int> Writes;
+	std::function<void()> Execute;
+};
+
+// --------------------------------------------------------
+// A frame's passes and the textures they read and write,
+// declared in any order.  Compile() then:
+//  - culls passes whose writes never reach an imported
+//    texture, directly or through other passes
+//  - orders the rest so each texture's writers run (in the
+//    order they were added) before any of its readers
+//  - gives every transient texture a slot in a pool, where
+//    textures with matching descriptions whose lifetimes
+//    don't overlap share a slot
+//
+// The graph only hands out slot numbers; whoever executes
+// it keeps one real texture per slot (see GetPool()), and
+// recreates them when the pool changes, e.g. on resize.
+// --------------------------------------------------------
+class RenderGraph
+{
+public:
+	// Declaration; each returns the new texture's or pass's index
+	unsigned int CreateTexture(const std::string& name, const RenderGraphTextureDesc& desc);
+	unsigned int ImportTexture(const std::string& name);
+	unsigned int AddPass(const std::string& name, std::function<void()> execute);
+	void Read(unsigned int pass, unsigned int texture);
+	void Write(unsigned int pass, unsigned int texture);
+	void Clear();
+
+	// False if passes depend on each other in a cycle
+	bool Compile();
+
+	// Runs the compiled passes in order
+	void Execute() const;
+
+	const RenderGraphTexture& GetTexture(unsigned int texture) const;
+	const RenderGraphPass& GetPass(unsigned int pass) const;
+	unsigned int GetTextureCount() const;
+	unsigned int GetPassCount() const;
+
+	// Results of Compile()
+	const std::vector<unsigned int>& GetOrder() const;
+	int GetSlot(unsigned int texture) const;	// -1 if imported or unused
+	const std::vector<RenderGraphTextureDesc>& GetPool() const;
+
+private:
+	std::vector<RenderGraphTexture> textures;
+	std::vector<RenderGraphPass> passes;
+
+	std::vector<unsigned int> order;
+	std::vector<int> slots;
+	std::vector<RenderGraphTextureDesc> pool;
+};
@@ -0,0 +1,88 @@
+#include "RingAllocator.h"
+
+// --------------------------------------------------------
+// Capacity is trimmed to a whole number of aligned blocks, so
+// every offset handed out stays aligned even after wrapping.
+// Alignment must be a power of two.
+// --------------------------------------------------------
+RingAllocator::RingAllocator(unsigned int capacity, unsigned int alignment) :
+	capacity(capacity & ~(alignment - 1)),
+	alignment(alignment)
+{
+	Reset();
+}
+
+// --------------------------------------------------------
+// Carves size bytes (rounded up to the alignment) off the
+// head.  A range never straddles the end: if it doesn't fit
+// before the end, the rest is skipped as padding and the
+// range starts back at zero instead.
+// --------------------------------------------------------
+bool RingAllocator::Allocate(unsigned int size, unsigned int* offset)
+{
+	unsigned int aligned = (size + alignment - 1) & ~(alignment - 1);
+	if (aligned == 0 || aligned > capacity)
+		return false;
+
+	// Nothing in use or pending, so start from the beginning and avoid padding
+	if (used == 0 && frames.empty())
+	{
+		head = 0;
+		tail = 0;
+	}
+
+	unsigned int padding = 0;
+	if (used == 0 || head > tail)
+	{
+		// Free space is [head, capacity) followed by [0, tail)
+		if (capacity - head < aligned)
+		{
+			if (used > 0 && aligned > tail)
+				return false;
+			padding = capacity - head;
+		}
+	}
+	else
+	{
+		// Free space is [head, tail), or nothing at all when full
+		if (tail - head < aligned)
+			return false;
+	}
+
+	unsigned int start = (head + padding) % capacity;
+	*offset = start;
+	head = (start + aligned) % capacity;
+	used += padding + aligned;
+	frameBytes += padding + aligned;
+	return true;
+}
+
+void RingAllocator::EndFrame(unsigned long long fence)
+{
+	FrameMark mark = {};
+	mark.Fence = fence;
+	mark.End = head;
+	mark.Bytes = frameBytes;
+	frames.push_back(mark);
+
+	frameBytes = 0;
+}
+
+void RingAllocator::Retire(unsigned long long completedFence)
+{
+	while (!frames.empty() && frames.front().Fence <= completedFence)
+	{
+		tail = frames.front().End;
+		used -= frames.front().Bytes;
+		frames.pop_front();
+	}
+}
+
+void RingAllocator::Reset()
+{
+	head = 0;
+	tail = 0;
+	used = 0;
+	frameBytes = 0;
+	frames.clear();
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <deque>
+
+// --------------------------------------------------------
+// Hands out aligned byte ranges from a fixed-size region,
+// oldest first, like a queue.  Everything allocated between
+// two EndFrame() calls belongs to that frame and is freed
+// together once the frame's fence is known to be complete.
+//
+// Only offsets are managed here - the memory itself lives
+// elsewhere (a GPU buffer, or a plain array when testing).
+// --------------------------------------------------------
+class RingAllocator
+{
+public:
+	RingAllocator(unsigned int capacity, unsigned int alignment);
+
+	// Returns false if the range won't fit until older frames retire
+	bool Allocate(unsigned int size, unsigned int* offset);
+
+	// Closes the current frame, to be freed once fence completes
+	void EndFrame(unsigned long long fence);
+
+	// Frees every frame whose fence is at or below completedFence
+	void Retire(unsigned long long completedFence);
+
+	// Drops all allocations, including ones from unfinished frames
+	void Reset();
+
+	unsigned int GetCapacity() const { return capacity; }
+	unsigned int GetUsed() const { return used; }
+	unsigned int GetFramesInFlight() const { return (unsigned int)frames.size(); }
+
+private:
+	struct FrameMark
+	{
+		unsigned long long Fence;
+		unsigned int End;	// Head position when the frame closed
+		unsigned int Bytes;	// Consumed by the frame, including wrap padding
+	};
+
+	unsigned int capacity;
+	unsigned int alignment;
+	unsigned int head;	// Next free byte
+	unsigned int tail;	// Oldest byte still in use
+	unsigned int used;	// Bytes between tail and head, tells full from empty
+	unsigned int frameBytes;
+	std::deque<FrameMark> frames;
+};
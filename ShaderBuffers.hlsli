@@ -0,0 +1,49 @@
+#ifndef GGP_SHADER_BUFFERS
+#define GGP_SHADER_BUFFERS
+
+#include "ShaderStructs.hlsli"
+
+// Constant buffers are grouped by how often they change, and each
+// group always lives in the same register so it only has to be
+// uploaded and bound when its contents actually change.
+// Layouts must match the structs in BufferStructs.h
+
+// Written once per frame by the application
+cbuffer PerFrame : register(b0)
+{
+    matrix view;
+    matrix proj;
+    matrix lightView;
+    matrix lightProj;
+    float3 camPosition;
+    float time;
+    int lightCount;
+    float specularMipCount; // Roughness levels in SpecularMap
+    float2 perFramePadding;
+    float4 ambientSH[9];    // Sky irradiance, rgb, with the basis folded in
+    Light lights[MAX_LIGHTS];
+}
+
+// Written when a different material is prepared
+cbuffer PerMaterial : register(b1)
+{
+    float4 colorTint;
+    float2 textureScale;
+    float2 textureOffset;
+    float roughness;
+    uint albedoSlice;       // Slices into the material texture
+    uint normalSlice;       // arrays, only read by shaders built
+    uint surfaceSlice;      // with PERM_TEXTURE_ARRAYS
+}
+
+// Written for every draw.  The combined matrices are
+// built on the CPU once per object, not once per vertex.
+cbuffer PerObject : register(b2)
+{
+    matrix world;
+    matrix worldInvTrans;
+    matrix wvp;
+    matrix lightWVP;
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,173 @@
+#include "ShaderPermutationTable.h"
+#include <cctype>
+
+namespace
+{
+	bool HasAnyLights(const ShaderPermutationKey& key)
+	{
+		return key.DirLights == SHADER_ANY_LIGHTS &&
+			key.PointLights == SHADER_ANY_LIGHTS &&
+			key.SpotLights == SHADER_ANY_LIGHTS;
+	}
+
+	// Every feature and any lights, which is what PixelShader.hlsl
+	// builds without any switches set (apart from the texture layout)
+	bool HasEverything(const ShaderPermutationKey& key)
+	{
+		return (key.Features & SHADER_FEATURE_ALL) == SHADER_FEATURE_ALL && HasAnyLights(key);
+	}
+
+	// "a", "a and b" or "a, b and c"
+	std::string JoinList(const std::string* items, unsigned int count, const char* last)
+	{
+		std::string text;
+		for (unsigned int i = 0; i < count; i++)
+		{
+			if (i > 0)
+				text += i + 1 == count ? last : ", ";
+			text += items[i];
+		}
+		return text;
+	}
+
+	// One line on what the variant covers
+	std::string Describe(const ShaderPermutationKey& key)
+	{
+		const unsigned int bits[] = { SHADER_FEATURE_NORMAL_MAP, SHADER_FEATURE_PBR_MAPS, SHADER_FEATURE_SHADOWS };
+		const char* names[] = { "normal map", "PBR maps", "shadows" };
+		const char* missingNames[] = { "a normal map", "PBR maps", "shadows" };
+
+		std::string present[3], missing[3];
+		unsigned int presentCount = 0, missingCount = 0;
+		for (int i = 0; i < 3; i++)
+		{
+			if (key.Features & bits[i])
+				present[presentCount++] = names[i];
+			else
+				missing[missingCount++] = missingNames[i];
+		}
+
+		std::string text = presentCount ? JoinList(present, presentCount, " and ") : "Albedo only";
+		text[0] = (char)toupper(text[0]);
+		if (missingCount)
+			text += (presentCount ? " without " : ", without ") + JoinList(missing, missingCount, " or ");
+
+		if (HasAnyLights(key))
+		{
+			text += ", with any lights";
+		}
+		else
+		{
+			text += ", with " + std::to_string(key.DirLights) + " directional, ";
+			text += std::to_string(key.PointLights) + " point & ";
+			text += std::to_string(key.SpotLights) + (key.SpotLights == 1 ? " spot light" : " spot lights");
+		}
+
+		if (key.Features & SHADER_FEATURE_TEXTURE_ARRAYS)
+			text += ", and material textures in arrays";
+		return text;
+	}
+}
+
+unsigned int ShaderPermutationTable::FindEntry(const ShaderPermutationEntry* manifest, unsigned int manifestCount, const ShaderPermutationKey& key)
+{
+	unsigned int anyLights = FindGeneral(manifest, manifestCount, key.Features);
+	bool foundAnyLights = false;
+
+	for (unsigned int i = 0; i < manifestCount; i++)
+	{
+		const ShaderPermutationKey& k = manifest[i].Key;
+		if (k.Features != key.Features)
+			continue;
+
+		if (k.DirLights == key.DirLights &&
+			k.PointLights == key.PointLights &&
+			k.SpotLights == key.SpotLights)
+			return i;
+
+		if (!foundAnyLights && HasAnyLights(k))
+		{
+			anyLights = i;
+			foundAnyLights = true;
+		}
+	}
+
+	return anyLights;
+}
+
+unsigned int ShaderPermutationTable::FindGeneral(const ShaderPermutationEntry* manifest, unsigned int manifestCount, unsigned int features)
+{
+	if (!(features & SHADER_FEATURE_TEXTURE_ARRAYS))
+		return 0;
+
+	for (unsigned int i = 0; i < manifestCount; i++)
+	{
+		const ShaderPermutationKey& k = manifest[i].Key;
+		if (k.Features == (SHADER_FEATURE_ALL | SHADER_FEATURE_TEXTURE_ARRAYS) && HasAnyLights(k))
+			return i;
+	}
+
+	return 0;
+}
+
+bool ShaderPermutationTable::IsGeneral(const ShaderPermutationKey& key)
+{
+	return key.Features == SHADER_FEATURE_ALL && HasAnyLights(key);
+}
+
+std::string ShaderPermutationTable::GetName(const ShaderPermutationKey& key)
+{
+	std::string name = "PixelShader";
+	if (IsGeneral(key))
+		return name;
+
+	name += '_';
+	if (key.Features & SHADER_FEATURE_TEXTURE_ARRAYS)
+		name += 'A';
+	if (!HasEverything(key))
+	{
+		if (key.Features & SHADER_FEATURE_NORMAL_MAP) name += 'N';
+		if (key.Features & SHADER_FEATURE_PBR_MAPS) name += 'M';
+		if (key.Features & SHADER_FEATURE_SHADOWS) name += 'S';
+		if (name.back() == '_')
+			name += '0';
+	}
+
+	if (!HasAnyLights(key))
+	{
+		name += "_D" + std::to_string(key.DirLights);
+		name += 'P';
+		name += std::to_string(key.PointLights);
+		name += 'S';
+		name += std::to_string(key.SpotLights);
+	}
+	return name;
+}
+
+// --------------------------------------------------------
+// Only the switches that differ from PixelShader.hlsl's
+// defaults are set, in the order it declares them
+// --------------------------------------------------------
+std::string ShaderPermutationTable::GetWrapper(const ShaderPermutationKey& key)
+{
+	std::string text = "// " + Describe(key) + "\n";
+	text += "// Generated by Tools/GeneratePermutations.cpp, and listed in PixelShaderPermutations.inl\n";
+
+	if (key.Features & SHADER_FEATURE_TEXTURE_ARRAYS)
+		text += "#define PERM_TEXTURE_ARRAYS 1\n";
+	if (!HasEverything(key))
+	{
+		text += key.Features & SHADER_FEATURE_NORMAL_MAP ? "#define PERM_NORMAL_MAP 1\n" : "#define PERM_NORMAL_MAP 0\n";
+		text += key.Features & SHADER_FEATURE_PBR_MAPS ? "#define PERM_PBR_MAPS 1\n" : "#define PERM_PBR_MAPS 0\n";
+		text += key.Features & SHADER_FEATURE_SHADOWS ? "#define PERM_SHADOWS 1\n" : "#define PERM_SHADOWS 0\n";
+	}
+	if (!HasAnyLights(key))
+	{
+		text += "#define PERM_DIR_LIGHTS " + std::to_string(key.DirLights) + "\n";
+		text += "#define PERM_POINT_LIGHTS " + std::to_string(key.PointLights) + "\n";
+		text += "#define PERM_SPOT_LIGHTS " + std::to_string(key.SpotLights) + "\n";
+	}
+
+	text += "\n#include \"PixelShader.hlsl\"\n";
+	return text;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <string>
+
+// Feature bits, matching the PERM_* switches in PixelShader.hlsl
+#define SHADER_FEATURE_NORMAL_MAP	0x1
+#define SHADER_FEATURE_PBR_MAPS		0x2
+#define SHADER_FEATURE_SHADOWS		0x4
+#define SHADER_FEATURE_ALL			0x7
+
+// Not a feature but a texture layout (PERM_TEXTURE_ARRAYS), so a
+// variant with it can only stand in for keys that also have it
+#define SHADER_FEATURE_TEXTURE_ARRAYS	0x8
+
+// Light count for variants that handle any number of lights
+#define SHADER_ANY_LIGHTS			-1
+
+// --------------------------------------------------------
+// What a pixel shader variant was compiled for
+// --------------------------------------------------------
+struct ShaderPermutationKey
+{
+	unsigned int Features;
+	int DirLights;
+	int PointLights;
+	int SpotLights;
+};
+
+// --------------------------------------------------------
+// One compiled variant: its key and the .cso it lives in
+// --------------------------------------------------------
+struct ShaderPermutationEntry
+{
+	ShaderPermutationKey Key;
+	const wchar_t* File;
+};
+
+// --------------------------------------------------------
+// Matching keys to variants, and the names and wrappers of
+// variants, with no graphics API.  Tools/GeneratePermutations.cpp
+// uses these to write every PixelShader_*.hlsl wrapper and
+// the manifest (PixelShaderPermutations.inl) from its table
+// of feature bits, so they can't drift apart.
+// --------------------------------------------------------
+namespace ShaderPermutationTable
+{
+	// Manifest index for a key: an exact match, then a variant
+	// with the same features and any light counts, then the
+	// general variant for the key's texture layout
+	unsigned int FindEntry(const ShaderPermutationEntry* manifest, unsigned int manifestCount, const ShaderPermutationKey& key);
+
+	// The variant to fall back on for a set of features: the first
+	// entry, unless the features call for texture arrays
+	unsigned int FindGeneral(const ShaderPermutationEntry* manifest, unsigned int manifestCount, unsigned int features);
+
+	// The general variant is PixelShader.hlsl itself
+	bool IsGeneral(const ShaderPermutationKey& key);
+
+	// Shader name for a key, without extension: PixelShader, then
+	// A for arrays and N, M & S for each feature (left out when
+	// it has every feature and any lights), then the light counts
+	// as D#P#S#.  For example PixelShader_NM_D3P1S1.
+	std::string GetName(const ShaderPermutationKey& key);
+
+	// The .hlsl wrapper that sets the key's PERM_* switches and
+	// includes PixelShader.hlsl
+	std::string GetWrapper(const ShaderPermutationKey& key);
+}
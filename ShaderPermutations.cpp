@@ -0,0 +1,66 @@
+#include "ShaderPermutations.h"
+#include "PathHelpers.h"
+
+// --------------------------------------------------------
+// Every compiled variant of PixelShader.hlsl.  Regenerate
+// the list with Tools/GeneratePermutations.cpp rather than
+// editing it.
+// --------------------------------------------------------
+const ShaderPermutationEntry ShaderPermutations::LitManifest[] =
+{
+#include "PixelShaderPermutations.inl"
+};
+const unsigned int ShaderPermutations::LitManifestCount = sizeof(LitManifest) / sizeof(LitManifest[0]);
+
+ShaderPermutations::ShaderPermutations(
+	Microsoft::WRL::ComPtr<ID3D11Device> device,
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
+	const ShaderPermutationEntry* manifest,
+	unsigned int manifestCount) :
+	device(device),
+	context(context),
+	manifest(manifest),
+	manifestCount(manifestCount)
+{
+	shaders.resize(manifestCount);
+}
+
+std::shared_ptr<SimplePixelShader> ShaderPermutations::Find(const ShaderPermutationKey& key)
+{
+	return Load(ShaderPermutationTable::FindEntry(manifest, manifestCount, key));
+}
+
+std::shared_ptr<SimplePixelShader> ShaderPermutations::GetGeneral()
+{
+	return Load(0);
+}
+
+bool ShaderPermutations::Owns(const SimplePixelShader* shader)
+{
+	for (auto& s : shaders)
+		if (s && s.get() == shader)
+			return true;
+	return false;
+}
+
+// --------------------------------------------------------
+// Loads a variant on first use.  A variant that fails to
+// load falls back to the general one rather than leaving
+// a material with no shader.
+// --------------------------------------------------------
+std::shared_ptr<SimplePixelShader> ShaderPermutations::Load(unsigned int index)
+{
+	if (index >= manifestCount)
+		return 0;
+
+	if (!shaders[index])
+	{
+		shaders[index] = std::make_shared<SimplePixelShader>(
+			device, context, FixPath(manifest[index].File).c_str());
+		unsigned int general = ShaderPermutationTable::FindGeneral(manifest, manifestCount, manifest[index].Key.Features);
+		if (!shaders[index]->IsShaderValid() && index != general)
+			shaders[index] = Load(general);
+	}
+
+	return shaders[index];
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <d3d11.h>
+#include <wrl/client.h>
+#include <memory>
+#include <vector>
+#include "ShaderPermutationTable.h"
+#include "SimpleShader.h"
+
+// --------------------------------------------------------
+// The variants of one shader, compiled ahead of time (each
+// is a small .hlsl wrapper that sets the PERM_* defines,
+// generated along with the manifest that lists them by
+// Tools/GeneratePermutations.cpp).  Its first entry must be the
+// general variant, used when nothing more specific matches.
+// Keys with texture arrays instead fall back to the first
+// variant that has every feature, arrays and any lights.
+//
+// Variants are loaded the first time they're asked for.
+// --------------------------------------------------------
+class ShaderPermutations
+{
+public:
+	ShaderPermutations(
+		Microsoft::WRL::ComPtr<ID3D11Device> device,
+		Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
+		const ShaderPermutationEntry* manifest,
+		unsigned int manifestCount);
+
+	// Best variant for a key, see ShaderPermutationTable::FindEntry()
+	std::shared_ptr<SimplePixelShader> Find(const ShaderPermutationKey& key);
+	std::shared_ptr<SimplePixelShader> GetGeneral();
+
+	// Whether a shader is one of this set's variants
+	bool Owns(const SimplePixelShader* shader);
+
+	// Variants of PixelShader.hlsl, from PixelShaderPermutations.inl
+	static const ShaderPermutationEntry LitManifest[];
+	static const unsigned int LitManifestCount;
+
+private:
+	Microsoft::WRL::ComPtr<ID3D11Device> device;
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context;
+	const ShaderPermutationEntry* manifest;
+	unsigned int manifestCount;
+
+	// Indexed like the manifest, null until first use
+	std::vector<std::shared_ptr<SimplePixelShader>> shaders;
+
+	std::shared_ptr<SimplePixelShader> Load(unsigned int index);
+};
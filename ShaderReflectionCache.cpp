@@ -0,0 +1,347 @@
+#include "ShaderReflectionCache.h"
+#include <fstream>
+#include <string.h>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+ShaderReflectionData::ShaderReflectionData() :
+	builder(),
+	mapping(0),
+	view(0),
+	viewSize(0),
+	header(0),
+	buffers(0),
+	variables(0),
+	resources(0),
+	inputs(0),
+	outputs(0),
+	names(0)
+{
+}
+
+ShaderReflectionData::~ShaderReflectionData()
+{
+	Release();
+}
+
+// --------------------------------------------------------
+// 64-bit FNV-1a over the whole bytecode.  Only used to spot
+// a stale sidecar, so it doesn't need to be cryptographic.
+// --------------------------------------------------------
+uint64_t ShaderReflectionData::HashBytecode(const void* bytecode, size_t size)
+{
+	const unsigned char* bytes = (const unsigned char*)bytecode;
+	uint64_t hash = 14695981039346656037ull;
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+// --------------------------------------------------------
+// Starts building a new block, dropping any current data
+// --------------------------------------------------------
+void ShaderReflectionData::Begin(uint64_t bytecodeHash)
+{
+	Release();
+
+	builder = {};
+	builder.Header.Magic = SHADER_REFLECTION_MAGIC;
+	builder.Header.Version = SHADER_REFLECTION_VERSION;
+	builder.Header.BytecodeHash = bytecodeHash;
+}
+
+// --------------------------------------------------------
+// Appends a name (with its terminator) to the name block
+// --------------------------------------------------------
+uint32_t ShaderReflectionData::Builder::AddName(const char* name)
+{
+	uint32_t offset = (uint32_t)Names.size();
+	Names.append(name ? name : "");
+	Names.push_back('\0');
+	return offset;
+}
+
+void ShaderReflectionData::AddBuffer(const char* name, uint32_t type, uint32_t size, uint32_t bindIndex)
+{
+	ShaderReflectionBuffer buffer = {};
+	buffer.Name = builder.AddName(name);
+	buffer.Type = type;
+	buffer.Size = size;
+	buffer.BindIndex = bindIndex;
+	buffer.FirstVariable = (uint32_t)builder.Variables.size();
+	builder.Buffers.push_back(buffer);
+}
+
+void ShaderReflectionData::AddVariable(const char* name, uint32_t byteOffset, uint32_t size)
+{
+	// Variables always belong to the most recent buffer
+	if (builder.Buffers.empty())
+		return;
+
+	ShaderReflectionVariable variable = {};
+	variable.Name = builder.AddName(name);
+	variable.ByteOffset = byteOffset;
+	variable.Size = size;
+	builder.Variables.push_back(variable);
+	builder.Buffers.back().VariableCount++;
+}
+
+void ShaderReflectionData::AddResource(const char* name, ShaderReflectionResourceType type, uint32_t bindIndex)
+{
+	ShaderReflectionResource resource = {};
+	resource.Name = builder.AddName(name);
+	resource.Type = type;
+	resource.BindIndex = bindIndex;
+	builder.Resources.push_back(resource);
+}
+
+void ShaderReflectionData::AddInput(const char* semanticName, uint32_t semanticIndex, uint32_t mask, uint32_t componentType, uint32_t stream)
+{
+	ShaderReflectionSignature input = {};
+	input.SemanticName = builder.AddName(semanticName);
+	input.SemanticIndex = semanticIndex;
+	input.Mask = mask;
+	input.ComponentType = componentType;
+	input.Stream = stream;
+	builder.Inputs.push_back(input);
+}
+
+void ShaderReflectionData::AddOutput(const char* semanticName, uint32_t semanticIndex, uint32_t mask, uint32_t componentType, uint32_t stream)
+{
+	ShaderReflectionSignature output = {};
+	output.SemanticName = builder.AddName(semanticName);
+	output.SemanticIndex = semanticIndex;
+	output.Mask = mask;
+	output.ComponentType = componentType;
+	output.Stream = stream;
+	builder.Outputs.push_back(output);
+}
+
+void ShaderReflectionData::SetThreadGroupSize(uint32_t x, uint32_t y, uint32_t z)
+{
+	builder.Header.ThreadGroupSize[0] = x;
+	builder.Header.ThreadGroupSize[1] = y;
+	builder.Header.ThreadGroupSize[2] = z;
+}
+
+// --------------------------------------------------------
+// Lays the built tables out in their file order and parses
+// the result, so built and loaded data are read the same way
+// --------------------------------------------------------
+bool ShaderReflectionData::End()
+{
+	ShaderReflectionHeader h = builder.Header;
+	h.BufferCount = (uint32_t)builder.Buffers.size();
+	h.VariableCount = (uint32_t)builder.Variables.size();
+	h.ResourceCount = (uint32_t)builder.Resources.size();
+	h.InputCount = (uint32_t)builder.Inputs.size();
+	h.OutputCount = (uint32_t)builder.Outputs.size();
+	h.NameBytes = (uint32_t)builder.Names.size();
+
+	owned.clear();
+	auto append = [&](const void* data, size_t size)
+		{
+			size_t offset = owned.size();
+			owned.resize(offset + size);
+			if (size > 0)
+				memcpy(&owned[offset], data, size);
+		};
+	append(&h, sizeof(h));
+	append(builder.Buffers.data(), builder.Buffers.size() * sizeof(ShaderReflectionBuffer));
+	append(builder.Variables.data(), builder.Variables.size() * sizeof(ShaderReflectionVariable));
+	append(builder.Resources.data(), builder.Resources.size() * sizeof(ShaderReflectionResource));
+	append(builder.Inputs.data(), builder.Inputs.size() * sizeof(ShaderReflectionSignature));
+	append(builder.Outputs.data(), builder.Outputs.size() * sizeof(ShaderReflectionSignature));
+	append(builder.Names.data(), builder.Names.size());
+
+	builder = {};
+	return Parse(owned.data(), owned.size(), h.BytecodeHash);
+}
+
+// --------------------------------------------------------
+// Validates a block and points the tables into it.  Any
+// mismatch (wrong version, other bytecode, truncated file,
+// out of range names) rejects the whole block, and the
+// caller falls back to real reflection.
+// --------------------------------------------------------
+bool ShaderReflectionData::Parse(const void* data, size_t size, uint64_t bytecodeHash)
+{
+	header = 0;
+	if (data == 0 || size < sizeof(ShaderReflectionHeader))
+		return false;
+
+	const ShaderReflectionHeader* h = (const ShaderReflectionHeader*)data;
+	if (h->Magic != SHADER_REFLECTION_MAGIC ||
+		h->Version != SHADER_REFLECTION_VERSION ||
+		h->BytecodeHash != bytecodeHash)
+		return false;
+
+	// Sizes are summed in 64 bits so huge counts can't wrap around
+	uint64_t expected = sizeof(ShaderReflectionHeader);
+	expected += (uint64_t)h->BufferCount * sizeof(ShaderReflectionBuffer);
+	expected += (uint64_t)h->VariableCount * sizeof(ShaderReflectionVariable);
+	expected += (uint64_t)h->ResourceCount * sizeof(ShaderReflectionResource);
+	expected += (uint64_t)h->InputCount * sizeof(ShaderReflectionSignature);
+	expected += (uint64_t)h->OutputCount * sizeof(ShaderReflectionSignature);
+	expected += h->NameBytes;
+	if (expected != size)
+		return false;
+
+	const unsigned char* bytes = (const unsigned char*)data;
+	const unsigned char* next = bytes + sizeof(ShaderReflectionHeader);
+	const ShaderReflectionBuffer* b = (const ShaderReflectionBuffer*)next;
+	next += h->BufferCount * sizeof(ShaderReflectionBuffer);
+	const ShaderReflectionVariable* v = (const ShaderReflectionVariable*)next;
+	next += h->VariableCount * sizeof(ShaderReflectionVariable);
+	const ShaderReflectionResource* r = (const ShaderReflectionResource*)next;
+	next += h->ResourceCount * sizeof(ShaderReflectionResource);
+	const ShaderReflectionSignature* in = (const ShaderReflectionSignature*)next;
+	next += h->InputCount * sizeof(ShaderReflectionSignature);
+	const ShaderReflectionSignature* out = (const ShaderReflectionSignature*)next;
+	next += h->OutputCount * sizeof(ShaderReflectionSignature);
+	const char* n = (const char*)next;
+
+	// Names must all land inside a terminated name block
+	if (h->NameBytes > 0 && n[h->NameBytes - 1] != '\0')
+		return false;
+	auto validName = [&](uint32_t name) { return name < h->NameBytes; };
+
+	for (uint32_t i = 0; i < h->BufferCount; i++)
+	{
+		if (!validName(b[i].Name) ||
+			b[i].FirstVariable > h->VariableCount ||
+			b[i].VariableCount > h->VariableCount - b[i].FirstVariable)
+			return false;
+	}
+	for (uint32_t i = 0; i < h->VariableCount; i++)
+		if (!validName(v[i].Name)) return false;
+	for (uint32_t i = 0; i < h->ResourceCount; i++)
+		if (!validName(r[i].Name) || r[i].Type > SHADER_REFLECTION_UAV) return false;
+	for (uint32_t i = 0; i < h->InputCount; i++)
+		if (!validName(in[i].SemanticName)) return false;
+	for (uint32_t i = 0; i < h->OutputCount; i++)
+		if (!validName(out[i].SemanticName)) return false;
+
+	view = bytes;
+	viewSize = size;
+	buffers = b;
+	variables = v;
+	resources = r;
+	inputs = in;
+	outputs = out;
+	names = n;
+	header = h;
+	return true;
+}
+
+// --------------------------------------------------------
+// Maps a sidecar file read-only and parses it in place.
+// Returns false (leaving nothing loaded) if the file is
+// missing, unreadable or doesn't match the bytecode.
+// --------------------------------------------------------
+bool ShaderReflectionData::Load(const std::filesystem::path& path, uint64_t bytecodeHash)
+{
+	Release();
+
+	size_t size = 0;
+	void* data = 0;
+
+#ifdef _WIN32
+	HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER fileSize = {};
+	if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0)
+	{
+		// The view keeps the file mapped after both handles close
+		HANDLE fileMapping = CreateFileMappingW(file, 0, PAGE_READONLY, 0, 0, 0);
+		if (fileMapping)
+		{
+			data = MapViewOfFile(fileMapping, FILE_MAP_READ, 0, 0, 0);
+			size = (size_t)fileSize.QuadPart;
+			CloseHandle(fileMapping);
+		}
+	}
+	CloseHandle(file);
+#else
+	int file = open(path.c_str(), O_RDONLY);
+	if (file < 0)
+		return false;
+
+	struct stat fileStat = {};
+	if (fstat(file, &fileStat) == 0 && fileStat.st_size > 0)
+	{
+		data = mmap(0, (size_t)fileStat.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+		if (data == MAP_FAILED)
+			data = 0;
+		size = (size_t)fileStat.st_size;
+	}
+	close(file);
+#endif
+
+	if (data == 0)
+		return false;
+
+	mapping = data;
+	viewSize = size;
+	if (!Parse(data, size, bytecodeHash))
+	{
+		Release();
+		return false;
+	}
+	return true;
+}
+
+// --------------------------------------------------------
+// Writes the current block out as a sidecar
+// --------------------------------------------------------
+bool ShaderReflectionData::Save(const std::filesystem::path& path) const
+{
+	if (!IsValid())
+		return false;
+
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file)
+		return false;
+
+	file.write((const char*)view, (std::streamsize)viewSize);
+	return file.good();
+}
+
+// --------------------------------------------------------
+// Unmaps or frees the current block
+// --------------------------------------------------------
+void ShaderReflectionData::Release()
+{
+	if (mapping)
+	{
+#ifdef _WIN32
+		UnmapViewOfFile(mapping);
+#else
+		munmap(mapping, viewSize);
+#endif
+		mapping = 0;
+	}
+	owned.clear();
+
+	view = 0;
+	viewSize = 0;
+	header = 0;
+	buffers = 0;
+	variables = 0;
+	resources = 0;
+	inputs = 0;
+	outputs = 0;
+	names = 0;
+}
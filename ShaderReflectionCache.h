@@ -0,0 +1,164 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+// "SREF" and the layout version, bumped whenever a struct below changes
+#define SHADER_REFLECTION_MAGIC		0x46455253
+#define SHADER_REFLECTION_VERSION	1
+
+// --------------------------------------------------------
+// On-disk layout of a reflection sidecar, which is also
+// how it's read back: the file is mapped and these structs
+// are used in place.  The header is followed by the buffer,
+// variable, resource, input and output tables (in that
+// order, each tightly packed) and then the name block.
+//
+// Every name is an offset into the name block.
+// --------------------------------------------------------
+struct ShaderReflectionHeader
+{
+	uint32_t Magic;
+	uint32_t Version;
+	uint64_t BytecodeHash;	// Sidecar is ignored if the .cso changed
+	uint32_t BufferCount;
+	uint32_t VariableCount;
+	uint32_t ResourceCount;
+	uint32_t InputCount;
+	uint32_t OutputCount;
+	uint32_t NameBytes;
+	uint32_t ThreadGroupSize[3];	// Compute shaders only
+	uint32_t Padding;
+};
+
+struct ShaderReflectionBuffer
+{
+	uint32_t Name;
+	uint32_t Type;		// D3D_CBUFFER_TYPE
+	uint32_t Size;
+	uint32_t BindIndex;
+	uint32_t FirstVariable;
+	uint32_t VariableCount;
+};
+
+struct ShaderReflectionVariable
+{
+	uint32_t Name;
+	uint32_t ByteOffset;
+	uint32_t Size;
+};
+
+enum ShaderReflectionResourceType
+{
+	SHADER_REFLECTION_TEXTURE,
+	SHADER_REFLECTION_SAMPLER,
+	SHADER_REFLECTION_UAV
+};
+
+struct ShaderReflectionResource
+{
+	uint32_t Name;
+	uint32_t Type;		// ShaderReflectionResourceType
+	uint32_t BindIndex;
+};
+
+// One entry of the input or output signature
+struct ShaderReflectionSignature
+{
+	uint32_t SemanticName;
+	uint32_t SemanticIndex;
+	uint32_t Mask;
+	uint32_t ComponentType;	// D3D_REGISTER_COMPONENT_TYPE
+	uint32_t Stream;
+};
+
+// --------------------------------------------------------
+// Everything SimpleShader needs from shader reflection, in
+// one compact block that can be saved next to a .cso and
+// memory-mapped back on later runs.
+//
+// Either build it (Begin, Add..., End) from reflection, or
+// Load() it.  Both end up with the same read-only view, so
+// callers don't care where the data came from.
+//
+// Nothing here depends on Direct3D; the D3D enums are
+// stored as plain integers.
+// --------------------------------------------------------
+class ShaderReflectionData
+{
+public:
+	ShaderReflectionData();
+	~ShaderReflectionData();
+	ShaderReflectionData(const ShaderReflectionData&) = delete;
+	ShaderReflectionData& operator=(const ShaderReflectionData&) = delete;
+
+	// Identifies the bytecode a sidecar was made from
+	static uint64_t HashBytecode(const void* bytecode, size_t size);
+
+	// Building
+	void Begin(uint64_t bytecodeHash);
+	void AddBuffer(const char* name, uint32_t type, uint32_t size, uint32_t bindIndex); // Variables added next belong to it
+	void AddVariable(const char* name, uint32_t byteOffset, uint32_t size);
+	void AddResource(const char* name, ShaderReflectionResourceType type, uint32_t bindIndex);
+	void AddInput(const char* semanticName, uint32_t semanticIndex, uint32_t mask, uint32_t componentType, uint32_t stream);
+	void AddOutput(const char* semanticName, uint32_t semanticIndex, uint32_t mask, uint32_t componentType, uint32_t stream);
+	void SetThreadGroupSize(uint32_t x, uint32_t y, uint32_t z);
+	bool End();
+
+	// Reading and writing sidecars
+	bool Load(const std::filesystem::path& path, uint64_t bytecodeHash);
+	bool Parse(const void* data, size_t size, uint64_t bytecodeHash);
+	bool Save(const std::filesystem::path& path) const;
+	void Release();
+
+	// Access (only when valid)
+	bool IsValid() const { return header != 0; }
+	const void* GetData() const { return view; }
+	size_t GetDataSize() const { return viewSize; }
+
+	uint32_t GetBufferCount() const { return header->BufferCount; }
+	uint32_t GetVariableCount() const { return header->VariableCount; }
+	uint32_t GetResourceCount() const { return header->ResourceCount; }
+	uint32_t GetInputCount() const { return header->InputCount; }
+	uint32_t GetOutputCount() const { return header->OutputCount; }
+	const uint32_t* GetThreadGroupSize() const { return header->ThreadGroupSize; }
+
+	const ShaderReflectionBuffer& GetBuffer(uint32_t index) const { return buffers[index]; }
+	const ShaderReflectionVariable& GetVariable(uint32_t index) const { return variables[index]; }
+	const ShaderReflectionResource& GetResource(uint32_t index) const { return resources[index]; }
+	const ShaderReflectionSignature& GetInput(uint32_t index) const { return inputs[index]; }
+	const ShaderReflectionSignature& GetOutput(uint32_t index) const { return outputs[index]; }
+	const char* GetName(uint32_t name) const { return names + name; }
+
+private:
+	// Tables while building
+	struct Builder
+	{
+		ShaderReflectionHeader Header;
+		std::vector<ShaderReflectionBuffer> Buffers;
+		std::vector<ShaderReflectionVariable> Variables;
+		std::vector<ShaderReflectionResource> Resources;
+		std::vector<ShaderReflectionSignature> Inputs;
+		std::vector<ShaderReflectionSignature> Outputs;
+		std::string Names;
+		uint32_t AddName(const char* name);
+	} builder;
+
+	// Backing memory: either built in place or a mapped file
+	std::vector<unsigned char> owned;
+	void* mapping;
+
+	// The parsed view
+	const unsigned char* view;
+	size_t viewSize;
+	const ShaderReflectionHeader* header;
+	const ShaderReflectionBuffer* buffers;
+	const ShaderReflectionVariable* variables;
+	const ShaderReflectionResource* resources;
+	const ShaderReflectionSignature* inputs;
+	const ShaderReflectionSignature* outputs;
+	const char* names;
+};
@@ -1,17 +1,9 @@
-#include "ShaderStructs.hlsli"
+#include "ShaderBuffers.hlsli"
 
-// Constant Buffer for external (C++) data
-cbuffer externalData : register(b0)
-{
-    matrix world;
-    matrix view;
-    matrix projection;
-};
 // --------------------------------------------------------
 // A simplified vertex shader for rendering to a shadow map
 // --------------------------------------------------------
 float4 main(VertexShaderInput input) : SV_POSITION
 {
-    matrix wvp = mul(projection, mul(view, world));
-    return mul(wvp, float4(input.localPosition, 1.0f));
+    return mul(lightWVP, float4(input.localPosition, 1.0f));
 }
\ No newline at end of file
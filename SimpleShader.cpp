@@ -1,4 +1,5 @@
 #include "SimpleShader.h"
+#include <algorithm>
 
 // Default error reporting state
 bool ISimpleShader::ReportErrors = false;
@@ -11,6 +12,30 @@ bool ISimpleShader::ReportWarnings = false;
 // ISimpleShader::ReportErrors = true;
 // ISimpleShader::ReportWarnings = true;
 
+// No state cache by default, so binds go straight to the context
+std::shared_ptr<StateCache> ISimpleShader::SharedStateCache;
+
+// To skip redundant binds, hand the shaders a cache
+// that wraps the same context they were created with:
+//
+// ISimpleShader::SharedStateCache = myStateCache;
+
+// No external buffers by default, so every buffer is managed here
+std::vector<std::string> ISimpleShader::ExternalBuffers;
+
+// Buffers that several shaders share (per-frame data, etc.) can
+// be created and bound once by the application instead:
+//
+// ISimpleShader::ExternalBuffers = { "PerFrame" };
+
+SimpleShaderUploadStats ISimpleShader::UploadStats = {};
+
+// Default buffers by default, updated with UpdateSubresource()
+bool ISimpleShader::UseDynamicBuffers = false;
+
+// Reflection sidecars are used (and written) by default
+bool ISimpleShader::UseReflectionCache = true;
+
 
 ///////////////////////////////////////////////////////////////////////////////
 // ------ BASE SIMPLE SHADER --------------------------------------------------
@@ -29,6 +54,12 @@ ISimpleShader::ISimpleShader(Microsoft::WRL::ComPtr<ID3D11Device> device, Micros
 	this->constantBufferCount = 0;
 	this->constantBuffers = 0;
 	this->shaderValid = false;
+
+	// Partial constant buffer updates need 11.1 and driver support
+	D3D11_FEATURE_DATA_D3D11_OPTIONS options = {};
+	device->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS, &options, sizeof(options));
+	if (options.ConstantBufferPartialUpdate)
+		context.As(&deviceContext1);
 }
 
 // --------------------------------------------------------
@@ -57,17 +88,14 @@ void ISimpleShader::CleanUp()
 		constantBufferCount = 0;
 	}
 
-	for (unsigned int i = 0; i < shaderResourceViews.size(); i++)
-		delete shaderResourceViews[i];
-	
-	for (unsigned int i = 0; i < samplerStates.size(); i++)
-		delete samplerStates[i];
-
 	// Clean up tables
-	varTable.clear();
-	cbTable.clear();
-	samplerTable.clear();
-	textureTable.clear();
+	shaderResourceViews.clear();
+	samplerStates.clear();
+	variables.clear();
+	varTable.Clear();
+	cbTable.Clear();
+	samplerTable.Clear();
+	textureTable.Clear();
 }
 
 // --------------------------------------------------------
@@ -94,6 +122,35 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 		return false;
 	}
 
+	// Reflection data comes from the sidecar next to the .cso when it
+	// was made from this exact bytecode, otherwise from D3DReflect()
+	uint64_t bytecodeHash = ShaderReflectionData::HashBytecode(
+		shaderBlob->GetBufferPointer(),
+		shaderBlob->GetBufferSize());
+	std::wstring cacheFile = std::wstring(shaderFile) + L".refl";
+	if (!UseReflectionCache || !reflection.Load(cacheFile, bytecodeHash))
+	{
+		if (!ReflectShader(bytecodeHash))
+		{
+			if (ReportErrors)
+			{
+				LogError("SimpleShader::LoadShaderFile() - Error reflecting shader from file '");
+				LogW(shaderFile);
+				LogError("'.\n");
+			}
+
+			return false;
+		}
+
+		// Failing to save just means reflecting again next time
+		if (UseReflectionCache && !reflection.Save(cacheFile) && ReportWarnings)
+		{
+			LogWarning("SimpleShader::LoadShaderFile() - Unable to write reflection cache '");
+			LogW(cacheFile.c_str());
+			LogWarning("'.\n");
+		}
+	}
+
 	// Create the shader - Calls an overloaded version of this abstract
 	// method in the appropriate child class
 	shaderValid = CreateShader(shaderBlob);
@@ -106,26 +163,44 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 			LogError("'. Ensure the type of shader (vertex, pixel, etc.) matches the SimpleShader type (SimpleVertexShader, SimplePixelShader, etc.) you're using.\n");
 		}
 
+		reflection.Release();
 		return false;
 	}
 
+	// Tables are built from the reflection data, which isn't needed after
+	BuildTables();
+	reflection.Release();
+
+	// All set
+	return true;
+}
+
+// --------------------------------------------------------
+// Uses shader reflection to gather everything the tables
+// need into this shader's reflection data
+//
+// bytecodeHash - Hash of the loaded shader blob, stored so
+//                a saved sidecar can be checked later
+// --------------------------------------------------------
+bool ISimpleShader::ReflectShader(uint64_t bytecodeHash)
+{
 	// Set up shader reflection to get information about
 	// this shader and its variables,  buffers, etc.
 	Microsoft::WRL::ComPtr<ID3D11ShaderReflection> refl;
-	D3DReflect(
+	HRESULT hr = D3DReflect(
 		shaderBlob->GetBufferPointer(),
 		shaderBlob->GetBufferSize(),
 		IID_ID3D11ShaderReflection,
 		(void**)refl.GetAddressOf());
+	if (FAILED(hr))
+		return false;
 	
 	// Get the description of the shader
 	D3D11_SHADER_DESC shaderDesc;
 	refl->GetDesc(&shaderDesc);
 
-	// Create resource arrays
-	constantBufferCount = shaderDesc.ConstantBuffers;
-	constantBuffers = new SimpleConstantBuffer[constantBufferCount];
-	
+	reflection.Begin(bytecodeHash);
+
 	// Handle bound resources (like shaders and samplers)
 	unsigned int resourceCount = shaderDesc.BoundResources;
 	for (unsigned int r = 0; r < resourceCount; r++)
@@ -139,33 +214,26 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 		{
 		case D3D_SIT_STRUCTURED: // Treat structured buffers as texture resources
 		case D3D_SIT_TEXTURE: // A texture resource
-		{
-			// Create the SRV wrapper
-			SimpleSRV* srv = new SimpleSRV();
-			srv->BindIndex = resourceDesc.BindPoint;				// Shader bind point
-			srv->Index = (unsigned int)shaderResourceViews.size();	// Raw index
-
-			textureTable.insert(std::pair<std::string, SimpleSRV*>(resourceDesc.Name, srv));
-			shaderResourceViews.push_back(srv);
-		}
+			reflection.AddResource(resourceDesc.Name, SHADER_REFLECTION_TEXTURE, resourceDesc.BindPoint);
 			break;
 
 		case D3D_SIT_SAMPLER: // A sampler resource
-		{
-			// Create the sampler wrapper
-			SimpleSampler* samp = new SimpleSampler();
-			samp->BindIndex = resourceDesc.BindPoint;			// Shader bind point
-			samp->Index = (unsigned int)samplerStates.size();	// Raw index
+			reflection.AddResource(resourceDesc.Name, SHADER_REFLECTION_SAMPLER, resourceDesc.BindPoint);
+			break;
 
-			samplerTable.insert(std::pair<std::string, SimpleSampler*>(resourceDesc.Name, samp));
-			samplerStates.push_back(samp);
-		}
+		case D3D_SIT_UAV_APPEND_STRUCTURED: // Any kind of UAV (compute shaders)
+		case D3D_SIT_UAV_CONSUME_STRUCTURED:
+		case D3D_SIT_UAV_RWBYTEADDRESS:
+		case D3D_SIT_UAV_RWSTRUCTURED:
+		case D3D_SIT_UAV_RWSTRUCTURED_WITH_COUNTER:
+		case D3D_SIT_UAV_RWTYPED:
+			reflection.AddResource(resourceDesc.Name, SHADER_REFLECTION_UAV, resourceDesc.BindPoint);
 			break;
 		}
 	}
 
 	// Loop through all constant buffers
-	for (unsigned int b = 0; b < constantBufferCount; b++)
+	for (unsigned int b = 0; b < shaderDesc.ConstantBuffers; b++)
 	{
 		// Get this buffer
 		ID3D11ShaderReflectionConstantBuffer* cb =
@@ -175,62 +243,147 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 		D3D11_SHADER_BUFFER_DESC bufferDesc;
 		cb->GetDesc(&bufferDesc);
 
-		// Save the type, which we reference when setting these buffers
-		constantBuffers[b].Type = bufferDesc.Type;
-		
 		// Get the description of the resource binding, so
 		// we know exactly how it's bound in the shader
 		D3D11_SHADER_INPUT_BIND_DESC bindDesc;
 		refl->GetResourceBindingDescByName(bufferDesc.Name, &bindDesc);
+
+		reflection.AddBuffer(bufferDesc.Name, bufferDesc.Type, bufferDesc.Size, bindDesc.BindPoint);
+
+		// Loop through all variables in this buffer
+		for (unsigned int v = 0; v < bufferDesc.Variables; v++)
+		{
+			// Get the description of this variable
+			D3D11_SHADER_VARIABLE_DESC varDesc;
+			cb->GetVariableByIndex(v)->GetDesc(&varDesc);
+
+			reflection.AddVariable(varDesc.Name, varDesc.StartOffset, varDesc.Size);
+		}
+	}
+
+	// Signatures, for input layouts and stream output
+	for (unsigned int i = 0; i < shaderDesc.InputParameters; i++)
+	{
+		D3D11_SIGNATURE_PARAMETER_DESC paramDesc;
+		refl->GetInputParameterDesc(i, &paramDesc);
+		reflection.AddInput(paramDesc.SemanticName, paramDesc.SemanticIndex, paramDesc.Mask, paramDesc.ComponentType, paramDesc.Stream);
+	}
+	for (unsigned int i = 0; i < shaderDesc.OutputParameters; i++)
+	{
+		D3D11_SIGNATURE_PARAMETER_DESC paramDesc;
+		refl->GetOutputParameterDesc(i, &paramDesc);
+		reflection.AddOutput(paramDesc.SemanticName, paramDesc.SemanticIndex, paramDesc.Mask, paramDesc.ComponentType, paramDesc.Stream);
+	}
+
+	// Only meaningful for compute shaders (zeros otherwise)
+	unsigned int groupX = 0, groupY = 0, groupZ = 0;
+	refl->GetThreadGroupSize(&groupX, &groupY, &groupZ);
+	reflection.SetThreadGroupSize(groupX, groupY, groupZ);
+
+	return reflection.End();
+}
+
+// --------------------------------------------------------
+// Builds the resource arrays, constant buffers and lookup
+// tables from the reflection data
+// --------------------------------------------------------
+void ISimpleShader::BuildTables()
+{
+	// Textures and samplers, in the order they were reflected
+	for (unsigned int r = 0; r < reflection.GetResourceCount(); r++)
+	{
+		const ShaderReflectionResource& resource = reflection.GetResource(r);
+		if (resource.Type == SHADER_REFLECTION_TEXTURE)
+		{
+			SimpleSRV srv = {};
+			srv.BindIndex = resource.BindIndex;							// Shader bind point
+			srv.Index = (unsigned int)shaderResourceViews.size();		// Raw index
+
+			textureTable.Add(reflection.GetName(resource.Name), srv.Index);
+			shaderResourceViews.push_back(srv);
+		}
+		else if (resource.Type == SHADER_REFLECTION_SAMPLER)
+		{
+			SimpleSampler samp = {};
+			samp.BindIndex = resource.BindIndex;						// Shader bind point
+			samp.Index = (unsigned int)samplerStates.size();			// Raw index
+
+			samplerTable.Add(reflection.GetName(resource.Name), samp.Index);
+			samplerStates.push_back(samp);
+		}
+	}
+
+	// Create resource arrays
+	constantBufferCount = reflection.GetBufferCount();
+	constantBuffers = new SimpleConstantBuffer[constantBufferCount];
+	variables.reserve(reflection.GetVariableCount());
+
+	// Loop through all constant buffers
+	for (unsigned int b = 0; b < constantBufferCount; b++)
+	{
+		const ShaderReflectionBuffer& bufferDesc = reflection.GetBuffer(b);
+		const char* bufferName = reflection.GetName(bufferDesc.Name);
+
+		// Save the type, which we reference when setting these buffers
+		constantBuffers[b].Type = (D3D_CBUFFER_TYPE)bufferDesc.Type;
 		
 		// Set up the buffer and put its pointer in the table
-		constantBuffers[b].BindIndex = bindDesc.BindPoint;
-		constantBuffers[b].Name = bufferDesc.Name;
-		cbTable.insert(std::pair<std::string, SimpleConstantBuffer*>(bufferDesc.Name, &constantBuffers[b]));
+		constantBuffers[b].BindIndex = bufferDesc.BindIndex;
+		constantBuffers[b].Name = bufferName;
+		cbTable.Add(bufferName, b);
+
+		// The application owns external buffers, so there's nothing to create
+		constantBuffers[b].External =
+			std::find(ExternalBuffers.begin(), ExternalBuffers.end(), constantBuffers[b].Name) != ExternalBuffers.end();
 
 		// Create this constant buffer
-		D3D11_BUFFER_DESC newBuffDesc = {};
-		newBuffDesc.Usage = D3D11_USAGE_DEFAULT;
-		newBuffDesc.ByteWidth = ((bufferDesc.Size + 15) / 16) * 16; // Quick and dirty 16-byte alignment using integer division
-		newBuffDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-		newBuffDesc.CPUAccessFlags = 0;
-		newBuffDesc.MiscFlags = 0;
-		newBuffDesc.StructureByteStride = 0;
-		device->CreateBuffer(&newBuffDesc, 0, constantBuffers[b].ConstantBuffer.GetAddressOf());
+		if (!constantBuffers[b].External)
+		{
+			constantBuffers[b].Dynamic = UseDynamicBuffers;
+
+			D3D11_BUFFER_DESC newBuffDesc = {};
+			newBuffDesc.Usage = UseDynamicBuffers ? D3D11_USAGE_DYNAMIC : D3D11_USAGE_DEFAULT;
+			newBuffDesc.ByteWidth = ((bufferDesc.Size + 15) / 16) * 16; // Quick and dirty 16-byte alignment using integer division
+			newBuffDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+			newBuffDesc.CPUAccessFlags = UseDynamicBuffers ? D3D11_CPU_ACCESS_WRITE : 0;
+			newBuffDesc.MiscFlags = 0;
+			newBuffDesc.StructureByteStride = 0;
+			device->CreateBuffer(&newBuffDesc, 0, constantBuffers[b].ConstantBuffer.GetAddressOf());
+		}
 
 		// Set up the data buffer for this constant buffer
 		constantBuffers[b].Size = bufferDesc.Size;
 		constantBuffers[b].LocalDataBuffer = new unsigned char[bufferDesc.Size];
 		ZeroMemory(constantBuffers[b].LocalDataBuffer, bufferDesc.Size);
 
+		// The GPU copy starts out undefined, so the first upload sends everything
+		constantBuffers[b].Dirty = true;
+		constantBuffers[b].DirtyStart = 0;
+		constantBuffers[b].DirtyEnd = bufferDesc.Size;
+
 		// Loop through all variables in this buffer
-		for (unsigned int v = 0; v < bufferDesc.Variables; v++)
+		for (unsigned int v = 0; v < bufferDesc.VariableCount; v++)
 		{
-			// Get this variable
-			ID3D11ShaderReflectionVariable* var =
-				cb->GetVariableByIndex(v);
-			
-			// Get the description of the variable and its type
-			D3D11_SHADER_VARIABLE_DESC varDesc;
-			var->GetDesc(&varDesc);
+			const ShaderReflectionVariable& varDesc = reflection.GetVariable(bufferDesc.FirstVariable + v);
 
 			// Create the variable struct
 			SimpleShaderVariable varStruct = {};
 			varStruct.ConstantBufferIndex = b;
-			varStruct.ByteOffset = varDesc.StartOffset;
+			varStruct.ByteOffset = varDesc.ByteOffset;
 			varStruct.Size = varDesc.Size;
 			
-			// Get a string version
-			std::string varName(varDesc.Name);
-
 			// Add this variable to the table and the constant buffer
-			varTable.insert(std::pair<std::string, SimpleShaderVariable>(varName, varStruct));
+			varTable.Add(reflection.GetName(varDesc.Name), (unsigned int)variables.size());
+			variables.push_back(varStruct);
 			constantBuffers[b].Variables.push_back(varStruct);
 		}
 	}
 
-	// All set
-	return true;
+	// Lookups binary search, so the tables must be sorted
+	SortTable(cbTable);
+	SortTable(varTable);
+	SortTable(textureTable);
+	SortTable(samplerTable);
 }
 
 // --------------------------------------------------------
@@ -240,18 +393,17 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 // name - the name of the variable to look for
 // size - the size of the variable (for verification), or -1 to bypass
 // --------------------------------------------------------
-SimpleShaderVariable* ISimpleShader::FindVariable(std::string name, int size)
+SimpleShaderVariable* ISimpleShader::FindVariable(const std::string& name, int size)
 {
 	// Look for the key
-	std::unordered_map<std::string, SimpleShaderVariable>::iterator result =
-		varTable.find(name);
+	SimpleShaderParam param = GetVariableParam(name);
 
 	// Did we find the key?
-	if (result == varTable.end())
+	if (!param.IsValid())
 		return 0;
 
-	// Grab the result from the iterator
-	SimpleShaderVariable* var = &(result->second);
+	// Grab the result from the array
+	SimpleShaderVariable* var = &variables[param.Index];
 
 	// Is the data size correct ?
 	if (size > 0 && var->Size != size)
@@ -264,20 +416,43 @@ SimpleShaderVariable* ISimpleShader::FindVariable(std::string name, int size)
 // --------------------------------------------------------
 // Helper for looking up a constant buffer by name
 // --------------------------------------------------------
-SimpleConstantBuffer* ISimpleShader::FindConstantBuffer(std::string name)
+SimpleConstantBuffer* ISimpleShader::FindConstantBuffer(const std::string& name)
 {
 	// Look for the key
-	std::unordered_map<std::string, SimpleConstantBuffer*>::iterator result =
-		cbTable.find(name);
+	SimpleShaderParam param = GetBufferParam(name);
 
 	// Did we find the key?
-	if (result == cbTable.end())
+	if (!param.IsValid())
 		return 0;
 
 	// Success
-	return result->second;
+	return &constantBuffers[param.Index];
+}
+
+// --------------------------------------------------------
+// Sorts a table for lookups.  Two names with the same hash
+// are reported, as a pre-computed hash only finds the first.
+// --------------------------------------------------------
+void ISimpleShader::SortTable(SimpleShaderTable& table)
+{
+	if (!table.Sort() && ReportWarnings)
+		LogWarning("SimpleShader::LoadShaderFile() - Names with the same hash were found in this shader, so only the first can be looked up by hash.\n");
 }
 
+// --------------------------------------------------------
+// Resolve names (or pre-computed name hashes) to handles.
+// Resolve once, then set through the handle as often as
+// needed without any further lookups.
+// --------------------------------------------------------
+SimpleShaderParam ISimpleShader::GetVariableParam(const std::string& name) { return varTable.Find(name.c_str()); }
+SimpleShaderParam ISimpleShader::GetVariableParam(unsigned int nameHash) { return varTable.Find(nameHash); }
+SimpleShaderParam ISimpleShader::GetShaderResourceViewParam(const std::string& name) { return textureTable.Find(name.c_str()); }
+SimpleShaderParam ISimpleShader::GetShaderResourceViewParam(unsigned int nameHash) { return textureTable.Find(nameHash); }
+SimpleShaderParam ISimpleShader::GetSamplerParam(const std::string& name) { return samplerTable.Find(name.c_str()); }
+SimpleShaderParam ISimpleShader::GetSamplerParam(unsigned int nameHash) { return samplerTable.Find(nameHash); }
+SimpleShaderParam ISimpleShader::GetBufferParam(const std::string& name) { return cbTable.Find(name.c_str()); }
+SimpleShaderParam ISimpleShader::GetBufferParam(unsigned int nameHash) { return cbTable.Find(nameHash); }
+
 // --------------------------------------------------------
 // Prints the specified message to the console with the 
 // given color and Visual Studio's output window
@@ -347,12 +522,7 @@ void ISimpleShader::CopyAllBufferData()
 
 	// Loop through the constant buffers and copy all data
 	for (unsigned int i = 0; i < constantBufferCount; i++)
-	{
-		// Copy the entire local data buffer
-		deviceContext->UpdateSubresource(
-			constantBuffers[i].ConstantBuffer.Get(), 0, 0,
-			constantBuffers[i].LocalDataBuffer, 0, 0);
-	}
+		UploadBuffer(&constantBuffers[i]);
 }
 
 // --------------------------------------------------------
@@ -380,9 +550,7 @@ void ISimpleShader::CopyBufferData(unsigned int index)
 	if (!cb) return;
 
 	// Copy the data and get out
-	deviceContext->UpdateSubresource(
-		cb->ConstantBuffer.Get(), 0, 0, 
-		cb->LocalDataBuffer, 0, 0);
+	UploadBuffer(cb);
 }
 
 // --------------------------------------------------------
@@ -392,7 +560,7 @@ void ISimpleShader::CopyBufferData(unsigned int index)
 //              Useful for updating more frequently-changing
 //              variables without having to re-copy all buffers.
 // --------------------------------------------------------
-void ISimpleShader::CopyBufferData(std::string bufferName)
+void ISimpleShader::CopyBufferData(const std::string& bufferName)
 {
 	// Ensure the shader is valid
 	if (!shaderValid) return;
@@ -402,9 +570,69 @@ void ISimpleShader::CopyBufferData(std::string bufferName)
 	if (!cb) return;
 
 	// Copy the data and get out
-	deviceContext->UpdateSubresource(
-		cb->ConstantBuffer.Get(), 0, 0, 
-		cb->LocalDataBuffer, 0, 0);
+	UploadBuffer(cb);
+}
+
+// --------------------------------------------------------
+// Copies local data to the shader's specified constant buffer
+//
+// buffer - A handle from GetBufferParam()
+// --------------------------------------------------------
+void ISimpleShader::CopyBufferData(SimpleShaderParam buffer)
+{
+	CopyBufferData(buffer.Index);
+}
+
+// --------------------------------------------------------
+// Copies a buffer's entire local data buffer to the GPU
+// and counts the upload.  External buffers are skipped,
+// as the application uploads those itself.
+// --------------------------------------------------------
+void ISimpleShader::UploadBuffer(SimpleConstantBuffer* cb)
+{
+	if (cb->External)
+		return;
+
+	// Nothing set since the last upload
+	if (!cb->Dirty)
+	{
+		UploadStats.CleanSkips++;
+		return;
+	}
+
+	unsigned int bytes = cb->Size;
+	if (cb->Dynamic)
+	{
+		// Discard hands back fresh memory, so the whole buffer is written
+		D3D11_MAPPED_SUBRESOURCE mapped = {};
+		if (FAILED(deviceContext->Map(cb->ConstantBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped)))
+			return; // Stays dirty, so the next copy tries again
+		memcpy(mapped.pData, cb->LocalDataBuffer, cb->Size);
+		deviceContext->Unmap(cb->ConstantBuffer.Get(), 0);
+	}
+	else if (deviceContext1)
+	{
+		// Only send the changed range, widened to whole 16-byte constants
+		D3D11_BOX box = {};
+		box.left = (cb->DirtyStart / 16) * 16;
+		box.right = ((cb->DirtyEnd + 15) / 16) * 16;
+		box.bottom = 1;
+		box.back = 1;
+		deviceContext1->UpdateSubresource1(
+			cb->ConstantBuffer.Get(), 0, &box,
+			cb->LocalDataBuffer + box.left, 0, 0, 0);
+		bytes = box.right - box.left;
+	}
+	else
+	{
+		deviceContext->UpdateSubresource(
+			cb->ConstantBuffer.Get(), 0, 0,
+			cb->LocalDataBuffer, 0, 0);
+	}
+
+	cb->Dirty = false;
+	UploadStats.Uploads++;
+	UploadStats.Bytes += bytes;
 }
 
 
@@ -417,7 +645,7 @@ void ISimpleShader::CopyBufferData(std::string bufferName)
 //
 // Returns true if data is copied, false if variable doesn't exist
 // --------------------------------------------------------
-bool ISimpleShader::SetData(std::string name, const void* data, unsigned int size)
+bool ISimpleShader::SetData(const std::string& name, const void* data, unsigned int size)
 {
 	// Look for the variable and verify
 	SimpleShaderVariable* var = FindVariable(name, -1);
@@ -445,20 +673,16 @@ bool ISimpleShader::SetData(std::string name, const void* data, unsigned int siz
 		return false;
 	}
 
-	// Set the data in the local data buffer
-	memcpy(
-		constantBuffers[var->ConstantBufferIndex].LocalDataBuffer + var->ByteOffset,
-		data,
-		size);
-
-	// Success
-	return true;
+	// Set the data in the local data buffer, tracking what changed
+	SimpleShaderParam param;
+	param.Index = (unsigned int)(var - variables.data());
+	return SetData(param, data, size);
 }
 
 // --------------------------------------------------------
 // Sets INTEGER data
 // --------------------------------------------------------
-bool ISimpleShader::SetInt(std::string name, int data)
+bool ISimpleShader::SetInt(const std::string& name, int data)
 {
 	return this->SetData(name, (void*)(&data), sizeof(int));
 }
@@ -466,7 +690,7 @@ bool ISimpleShader::SetInt(std::string name, int data)
 // --------------------------------------------------------
 // Sets a FLOAT variable by name in the local data buffer
 // --------------------------------------------------------
-bool ISimpleShader::SetFloat(std::string name, float data)
+bool ISimpleShader::SetFloat(const std::string& name, float data)
 {
 	return this->SetData(name, (void*)(&data), sizeof(float));
 }
@@ -474,7 +698,7 @@ bool ISimpleShader::SetFloat(std::string name, float data)
 // --------------------------------------------------------
 // Sets a FLOAT2 variable by name in the local data buffer
 // --------------------------------------------------------
-bool ISimpleShader::SetFloat2(std::string name, const float data[2])
+bool ISimpleShader::SetFloat2(const std::string& name, const float data[2])
 {
 	return this->SetData(name, (void*)data, sizeof(float) * 2);
 }
@@ -482,7 +706,7 @@ bool ISimpleShader::SetFloat2(std::string name, const float data[2])
 // --------------------------------------------------------
 // Sets a FLOAT2 variable by name in the local data buffer
 // --------------------------------------------------------
-bool ISimpleShader::SetFloat2(std::string name, const DirectX::XMFLOAT2 data)
+bool ISimpleShader::SetFloat2(const std::string& name, const DirectX::XMFLOAT2 data)
 {
 	return this->SetData(name, &data, sizeof(float) * 2);
 }
@@ -490,7 +714,7 @@ bool ISimpleShader::SetFloat2(std::string name, const DirectX::XMFLOAT2 data)
 // --------------------------------------------------------
 // Sets a FLOAT3 variable by name in the local data buffer
 // --------------------------------------------------------
-bool ISimpleShader::SetFloat3(std::string name, const float data[3])
+bool ISimpleShader::SetFloat3(const std::string& name, const float data[3])
 {
 	return this->SetData(name, (void*)data, sizeof(float) * 3);
 }
@@ -498,7 +722,7 @@ bool ISimpleShader::SetFloat3(std::string name, const float data[3])
 // --------------------------------------------------------
 // Sets a FLOAT3 variable by name in the local data buffer
 // --------------------------------------------------------
-bool ISimpleShader::SetFloat3(std::string name, const DirectX::XMFLOAT3 data)
+bool ISimpleShader::SetFloat3(const std::string& name, const DirectX::XMFLOAT3 data)
 {
 	return this->SetData(name, &data, sizeof(float) * 3);
 }
@@ -506,7 +730,7 @@ bool ISimpleShader::SetFloat3(std::string name, const DirectX::XMFLOAT3 data)
 // --------------------------------------------------------
 // Sets a FLOAT4 variable by name in the local data buffer
 // --------------------------------------------------------
-bool ISimpleShader::SetFloat4(std::string name, const float data[4])
+bool ISimpleShader::SetFloat4(const std::string& name, const float data[4])
 {
 	return this->SetData(name, (void*)data, sizeof(float) * 4);
 }
@@ -514,7 +738,7 @@ bool ISimpleShader::SetFloat4(std::string name, const float data[4])
 // --------------------------------------------------------
 // Sets a FLOAT4 variable by name in the local data buffer
 // --------------------------------------------------------
-bool ISimpleShader::SetFloat4(std::string name, const DirectX::XMFLOAT4 data)
+bool ISimpleShader::SetFloat4(const std::string& name, const DirectX::XMFLOAT4 data)
 {
 	return this->SetData(name, &data, sizeof(float) * 4);
 }
@@ -522,7 +746,7 @@ bool ISimpleShader::SetFloat4(std::string name, const DirectX::XMFLOAT4 data)
 // --------------------------------------------------------
 // Sets a MATRIX (4x4) variable by name in the local data buffer
 // --------------------------------------------------------
-bool ISimpleShader::SetMatrix4x4(std::string name, const float data[16])
+bool ISimpleShader::SetMatrix4x4(const std::string& name, const float data[16])
 {
 	return this->SetData(name, (void*)data, sizeof(float) * 16);
 }
@@ -530,16 +754,66 @@ bool ISimpleShader::SetMatrix4x4(std::string name, const float data[16])
 // --------------------------------------------------------
 // Sets a MATRIX (4x4) variable by name in the local data buffer
 // --------------------------------------------------------
-bool ISimpleShader::SetMatrix4x4(std::string name, const DirectX::XMFLOAT4X4 data)
+bool ISimpleShader::SetMatrix4x4(const std::string& name, const DirectX::XMFLOAT4X4 data)
 {
 	return this->SetData(name, &data, sizeof(float) * 16);
 }
 
+// --------------------------------------------------------
+// Sets a variable through a handle from GetVariableParam()
+// with arbitrary data of the specified size.  No lookups
+// and no warnings: an invalid handle simply returns false.
+// --------------------------------------------------------
+bool ISimpleShader::SetData(SimpleShaderParam param, const void* data, unsigned int size)
+{
+	// Also rejects invalid handles
+	if (param.Index >= variables.size())
+		return false;
+
+	// Same size rule as setting by name
+	SimpleShaderVariable* var = &variables[param.Index];
+	if (size > var->Size)
+		return false;
+
+	// Identical data leaves the buffer clean
+	SimpleConstantBuffer* cb = &constantBuffers[var->ConstantBufferIndex];
+	unsigned char* dest = cb->LocalDataBuffer + var->ByteOffset;
+	if (memcmp(dest, data, size) == 0)
+	{
+		UploadStats.SameWrites++;
+		return true;
+	}
+	memcpy(dest, data, size);
+
+	// Grow the dirty range to cover this write
+	unsigned int start = var->ByteOffset;
+	unsigned int end = var->ByteOffset + size;
+	if (!cb->Dirty)
+	{
+		cb->Dirty = true;
+		cb->DirtyStart = start;
+		cb->DirtyEnd = end;
+	}
+	else
+	{
+		cb->DirtyStart = min(cb->DirtyStart, start);
+		cb->DirtyEnd = max(cb->DirtyEnd, end);
+	}
+	return true;
+}
+
+bool ISimpleShader::SetInt(SimpleShaderParam param, int data) { return SetData(param, &data, sizeof(int)); }
+bool ISimpleShader::SetFloat(SimpleShaderParam param, float data) { return SetData(param, &data, sizeof(float)); }
+bool ISimpleShader::SetFloat2(SimpleShaderParam param, const DirectX::XMFLOAT2& data) { return SetData(param, &data, sizeof(float) * 2); }
+bool ISimpleShader::SetFloat3(SimpleShaderParam param, const DirectX::XMFLOAT3& data) { return SetData(param, &data, sizeof(float) * 3); }
+bool ISimpleShader::SetFloat4(SimpleShaderParam param, const DirectX::XMFLOAT4& data) { return SetData(param, &data, sizeof(float) * 4); }
+bool ISimpleShader::SetMatrix4x4(SimpleShaderParam param, const DirectX::XMFLOAT4X4& data) { return SetData(param, &data, sizeof(float) * 16); }
+
 // --------------------------------------------------------
 // Determines if the shader contains the specified
 // variable within one of its constant buffers
 // --------------------------------------------------------
-bool ISimpleShader::HasVariable(std::string name)
+bool ISimpleShader::HasVariable(const std::string& name)
 {
 	return FindVariable(name, -1) != 0;
 }
@@ -547,7 +821,7 @@ bool ISimpleShader::HasVariable(std::string name)
 // --------------------------------------------------------
 // Determines if the shader contains the specified SRV
 // --------------------------------------------------------
-bool ISimpleShader::HasShaderResourceView(std::string name)
+bool ISimpleShader::HasShaderResourceView(const std::string& name)
 {
 	return GetShaderResourceViewInfo(name) != 0;
 }
@@ -555,7 +829,7 @@ bool ISimpleShader::HasShaderResourceView(std::string name)
 // --------------------------------------------------------
 // Determines if the shader contains the specified sampler
 // --------------------------------------------------------
-bool ISimpleShader::HasSamplerState(std::string name)
+bool ISimpleShader::HasSamplerState(const std::string& name)
 {
 	return GetSamplerInfo(name) != 0;
 }
@@ -563,7 +837,7 @@ bool ISimpleShader::HasSamplerState(std::string name)
 // --------------------------------------------------------
 // Gets info about a shader variable, if it exists
 // --------------------------------------------------------
-const SimpleShaderVariable* ISimpleShader::GetVariableInfo(std::string name)
+const SimpleShaderVariable* ISimpleShader::GetVariableInfo(const std::string& name)
 {
 	return FindVariable(name, -1);
 }
@@ -573,18 +847,17 @@ const SimpleShaderVariable* ISimpleShader::GetVariableInfo(std::string name)
 //
 // name - the name of the SRV
 // --------------------------------------------------------
-const SimpleSRV* ISimpleShader::GetShaderResourceViewInfo(std::string name)
+const SimpleSRV* ISimpleShader::GetShaderResourceViewInfo(const std::string& name)
 {
 	// Look for the key
-	std::unordered_map<std::string, SimpleSRV*>::iterator result =
-		textureTable.find(name);
+	SimpleShaderParam param = GetShaderResourceViewParam(name);
 
 	// Did we find the key?
-	if (result == textureTable.end())
+	if (!param.IsValid())
 		return 0;
 
 	// Success
-	return result->second;
+	return &shaderResourceViews[param.Index];
 }
 
 
@@ -599,7 +872,7 @@ const SimpleSRV* ISimpleShader::GetShaderResourceViewInfo(unsigned int index)
 	if (index >= shaderResourceViews.size()) return 0;
 
 	// Grab the bind index
-	return shaderResourceViews[index];
+	return &shaderResourceViews[index];
 }
 
 
@@ -608,18 +881,17 @@ const SimpleSRV* ISimpleShader::GetShaderResourceViewInfo(unsigned int index)
 // 
 // name - the name of the sampler
 // --------------------------------------------------------
-const SimpleSampler* ISimpleShader::GetSamplerInfo(std::string name)
+const SimpleSampler* ISimpleShader::GetSamplerInfo(const std::string& name)
 {
 	// Look for the key
-	std::unordered_map<std::string, SimpleSampler*>::iterator result =
-		samplerTable.find(name);
+	SimpleShaderParam param = GetSamplerParam(name);
 
 	// Did we find the key?
-	if (result == samplerTable.end())
+	if (!param.IsValid())
 		return 0;
 
 	// Success
-	return result->second;
+	return &samplerStates[param.Index];
 }
 
 // --------------------------------------------------------
@@ -633,7 +905,7 @@ const SimpleSampler* ISimpleShader::GetSamplerInfo(unsigned int index)
 	if (index >= samplerStates.size()) return 0;
 
 	// Grab the bind index
-	return samplerStates[index];
+	return &samplerStates[index];
 }
 
 
@@ -661,7 +933,7 @@ unsigned int ISimpleShader::GetBufferSize(unsigned int index)
 // Gets info about a particular constant buffer 
 // by name, if it exists
 // --------------------------------------------------------
-const SimpleConstantBuffer * ISimpleShader::GetBufferInfo(std::string name)
+const SimpleConstantBuffer * ISimpleShader::GetBufferInfo(const std::string& name)
 {
 	return FindConstantBuffer(name);
 }
@@ -771,28 +1043,16 @@ bool SimpleVertexShader::CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlo
 	// matches what the vertex shader expects.  Code adapted from:
 	// https://takinginitiative.wordpress.com/2011/12/11/directx-1011-basic-shader-reflection-automatic-input-layout-creation/
 
-	// Reflect shader info
-	Microsoft::WRL::ComPtr<ID3D11ShaderReflection> refl;
-	D3DReflect(
-		shaderBlob->GetBufferPointer(),
-		shaderBlob->GetBufferSize(),
-		IID_ID3D11ShaderReflection,
-		(void**)refl.GetAddressOf());
-	
-	// Get shader info
-	D3D11_SHADER_DESC shaderDesc;
-	refl->GetDesc(&shaderDesc);
-
-	// Read input layout description from shader info
+	// Read input layout description from the reflected input signature
 	std::vector<D3D11_INPUT_ELEMENT_DESC> inputLayoutDesc;
-	for (unsigned int i = 0; i< shaderDesc.InputParameters; i++)
+	for (unsigned int i = 0; i < reflection.GetInputCount(); i++)
 	{
-		D3D11_SIGNATURE_PARAMETER_DESC paramDesc;
-		refl->GetInputParameterDesc(i, &paramDesc);
+		const ShaderReflectionSignature& paramDesc = reflection.GetInput(i);
+		const char* semanticName = reflection.GetName(paramDesc.SemanticName);
 
 		// Check the semantic name for "_PER_INSTANCE"
 		std::string perInstanceStr = "_PER_INSTANCE";
-		std::string sem = paramDesc.SemanticName;
+		std::string sem = semanticName;
 		int lenDiff = (int)sem.size() - (int)perInstanceStr.size();
 		bool isPerInstance = 
 			lenDiff >= 0 &&
@@ -800,7 +1060,7 @@ bool SimpleVertexShader::CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlo
 
 		// Fill out input element desc
 		D3D11_INPUT_ELEMENT_DESC elementDesc = {};
-		elementDesc.SemanticName = paramDesc.SemanticName;
+		elementDesc.SemanticName = semanticName;
 		elementDesc.SemanticIndex = paramDesc.SemanticIndex;
 		elementDesc.InputSlot = 0;
 		elementDesc.AlignedByteOffset = D3D11_APPEND_ALIGNED_ELEMENT;
@@ -868,6 +1128,24 @@ void SimpleVertexShader::SetShaderAndCBs()
 	// Is shader valid?
 	if (!shaderValid) return;
 
+	// Let the cache filter out anything already bound
+	if (SharedStateCache)
+	{
+		SharedStateCache->SetInputLayout(inputLayout.Get());
+		SharedStateCache->SetVertexShader(shader.Get());
+
+		for (unsigned int i = 0; i < constantBufferCount; i++)
+		{
+			if (constantBuffers[i].Type != D3D11_CT_CBUFFER || constantBuffers[i].External)
+				continue;
+
+			SharedStateCache->SetVSConstantBuffer(
+				constantBuffers[i].BindIndex,
+				constantBuffers[i].ConstantBuffer.Get());
+		}
+		return;
+	}
+
 	// Set the shader and input layout
 	deviceContext->IASetInputLayout(inputLayout.Get());
 	deviceContext->VSSetShader(shader.Get(), 0, 0);
@@ -875,8 +1153,9 @@ void SimpleVertexShader::SetShaderAndCBs()
 	// Set the constant buffers
 	for (unsigned int i = 0; i < constantBufferCount; i++)
 	{
-		// Skip "buffers" that aren't true constant buffers
-		if (constantBuffers[i].Type != D3D11_CT_CBUFFER)
+		// Skip "buffers" that aren't true constant buffers,
+		// along with any the application binds itself
+		if (constantBuffers[i].Type != D3D11_CT_CBUFFER || constantBuffers[i].External)
 			continue;
 
 		// This is a real constant buffer, so set it
@@ -895,11 +1174,11 @@ void SimpleVertexShader::SetShaderAndCBs()
 //
 // Returns true if a texture of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleVertexShader::SetShaderResourceView(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
+bool SimpleVertexShader::SetShaderResourceView(const std::string& name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
 {
 	// Look for the variable and verify
-	const SimpleSRV* srvInfo = GetShaderResourceViewInfo(name);
-	if (srvInfo == 0)
+	SimpleShaderParam param = GetShaderResourceViewParam(name);
+	if (!param.IsValid())
 	{
 		if (ReportWarnings)
 		{
@@ -910,8 +1189,24 @@ bool SimpleVertexShader::SetShaderResourceView(std::string name, Microsoft::WRL:
 		return false;
 	}
 
+	return SetShaderResourceView(param, srv);
+}
+
+// --------------------------------------------------------
+// Sets a shader resource view in the vertex shader stage
+// using a handle from GetShaderResourceViewParam()
+// --------------------------------------------------------
+bool SimpleVertexShader::SetShaderResourceView(SimpleShaderParam param, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
+{
+	const SimpleSRV* srvInfo = GetShaderResourceViewInfo(param.Index);
+	if (srvInfo == 0)
+		return false;
+
 	// Set the shader resource view
-	deviceContext->VSSetShaderResources(srvInfo->BindIndex, 1, srv.GetAddressOf());
+	if (SharedStateCache)
+		SharedStateCache->SetVSShaderResource(srvInfo->BindIndex, srv.Get());
+	else
+		deviceContext->VSSetShaderResources(srvInfo->BindIndex, 1, srv.GetAddressOf());
 
 	// Success
 	return true;
@@ -925,11 +1220,11 @@ bool SimpleVertexShader::SetShaderResourceView(std::string name, Microsoft::WRL:
 //
 // Returns true if a sampler of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleVertexShader::SetSamplerState(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState)
+bool SimpleVertexShader::SetSamplerState(const std::string& name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState)
 {
 	// Look for the variable and verify
-	const SimpleSampler* sampInfo = GetSamplerInfo(name);
-	if (sampInfo == 0)
+	SimpleShaderParam param = GetSamplerParam(name);
+	if (!param.IsValid())
 	{
 		if (ReportWarnings)
 		{
@@ -940,8 +1235,24 @@ bool SimpleVertexShader::SetSamplerState(std::string name, Microsoft::WRL::ComPt
 		return false;
 	}
 
+	return SetSamplerState(param, samplerState);
+}
+
+// --------------------------------------------------------
+// Sets a sampler state in the vertex shader stage
+// using a handle from GetSamplerParam()
+// --------------------------------------------------------
+bool SimpleVertexShader::SetSamplerState(SimpleShaderParam param, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState)
+{
+	const SimpleSampler* sampInfo = GetSamplerInfo(param.Index);
+	if (sampInfo == 0)
+		return false;
+
 	// Set the shader resource view
-	deviceContext->VSSetSamplers(sampInfo->BindIndex, 1, samplerState.GetAddressOf());
+	if (SharedStateCache)
+		SharedStateCache->SetVSSampler(sampInfo->BindIndex, samplerState.Get());
+	else
+		deviceContext->VSSetSamplers(sampInfo->BindIndex, 1, samplerState.GetAddressOf());
 
 	// Success
 	return true;
@@ -1011,14 +1322,32 @@ void SimplePixelShader::SetShaderAndCBs()
 	// Is shader valid?
 	if (!shaderValid) return;
 	
+	// Let the cache filter out anything already bound
+	if (SharedStateCache)
+	{
+		SharedStateCache->SetPixelShader(shader.Get());
+
+		for (unsigned int i = 0; i < constantBufferCount; i++)
+		{
+			if (constantBuffers[i].Type != D3D11_CT_CBUFFER || constantBuffers[i].External)
+				continue;
+
+			SharedStateCache->SetPSConstantBuffer(
+				constantBuffers[i].BindIndex,
+				constantBuffers[i].ConstantBuffer.Get());
+		}
+		return;
+	}
+
 	// Set the shader
 	deviceContext->PSSetShader(shader.Get(), 0, 0);
 
 	// Set the constant buffers
 	for (unsigned int i = 0; i < constantBufferCount; i++)
 	{
-		// Skip "buffers" that aren't true constant buffers
-		if (constantBuffers[i].Type != D3D11_CT_CBUFFER)
+		// Skip "buffers" that aren't true constant buffers,
+		// along with any the application binds itself
+		if (constantBuffers[i].Type != D3D11_CT_CBUFFER || constantBuffers[i].External)
 			continue;
 
 		// This is a real constant buffer, so set it
@@ -1037,11 +1366,11 @@ void SimplePixelShader::SetShaderAndCBs()
 //
 // Returns true if a texture of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimplePixelShader::SetShaderResourceView(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
+bool SimplePixelShader::SetShaderResourceView(const std::string& name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
 {
 	// Look for the variable and verify
-	const SimpleSRV* srvInfo = GetShaderResourceViewInfo(name);
-	if (srvInfo == 0)
+	SimpleShaderParam param = GetShaderResourceViewParam(name);
+	if (!param.IsValid())
 	{
 		if (ReportWarnings)
 		{
@@ -1052,8 +1381,24 @@ bool SimplePixelShader::SetShaderResourceView(std::string name, Microsoft::WRL::
 		return false;
 	}
 
+	return SetShaderResourceView(param, srv);
+}
+
+// --------------------------------------------------------
+// Sets a shader resource view in the pixel shader stage
+// using a handle from GetShaderResourceViewParam()
+// --------------------------------------------------------
+bool SimplePixelShader::SetShaderResourceView(SimpleShaderParam param, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
+{
+	const SimpleSRV* srvInfo = GetShaderResourceViewInfo(param.Index);
+	if (srvInfo == 0)
+		return false;
+
 	// Set the shader resource view
-	deviceContext->PSSetShaderResources(srvInfo->BindIndex, 1, srv.GetAddressOf());
+	if (SharedStateCache)
+		SharedStateCache->SetPSShaderResource(srvInfo->BindIndex, srv.Get());
+	else
+		deviceContext->PSSetShaderResources(srvInfo->BindIndex, 1, srv.GetAddressOf());
 
 	// Success
 	return true;
@@ -1067,11 +1412,11 @@ bool SimplePixelShader::SetShaderResourceView(std::string name, Microsoft::WRL::
 //
 // Returns true if a sampler of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimplePixelShader::SetSamplerState(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState)
+bool SimplePixelShader::SetSamplerState(const std::string& name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState)
 {
 	// Look for the variable and verify
-	const SimpleSampler* sampInfo = GetSamplerInfo(name);
-	if (sampInfo == 0)
+	SimpleShaderParam param = GetSamplerParam(name);
+	if (!param.IsValid())
 	{
 		if (ReportWarnings)
 		{
@@ -1082,8 +1427,24 @@ bool SimplePixelShader::SetSamplerState(std::string name, Microsoft::WRL::ComPtr
 		return false;
 	}
 
+	return SetSamplerState(param, samplerState);
+}
+
+// --------------------------------------------------------
+// Sets a sampler state in the pixel shader stage
+// using a handle from GetSamplerParam()
+// --------------------------------------------------------
+bool SimplePixelShader::SetSamplerState(SimpleShaderParam param, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState)
+{
+	const SimpleSampler* sampInfo = GetSamplerInfo(param.Index);
+	if (sampInfo == 0)
+		return false;
+
 	// Set the shader resource view
-	deviceContext->PSSetSamplers(sampInfo->BindIndex, 1, samplerState.GetAddressOf());
+	if (SharedStateCache)
+		SharedStateCache->SetPSSampler(sampInfo->BindIndex, samplerState.Get());
+	else
+		deviceContext->PSSetSamplers(sampInfo->BindIndex, 1, samplerState.GetAddressOf());
 
 	// Success
 	return true;
@@ -1161,8 +1522,9 @@ void SimpleDomainShader::SetShaderAndCBs()
 	// Set the constant buffers
 	for (unsigned int i = 0; i < constantBufferCount; i++)
 	{
-		// Skip "buffers" that aren't true constant buffers
-		if (constantBuffers[i].Type != D3D11_CT_CBUFFER)
+		// Skip "buffers" that aren't true constant buffers,
+		// along with any the application binds itself
+		if (constantBuffers[i].Type != D3D11_CT_CBUFFER || constantBuffers[i].External)
 			continue;
 
 		// This is a real constant buffer, so set it
@@ -1181,11 +1543,11 @@ void SimpleDomainShader::SetShaderAndCBs()
 //
 // Returns true if a texture of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleDomainShader::SetShaderResourceView(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
+bool SimpleDomainShader::SetShaderResourceView(const std::string& name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
 {
 	// Look for the variable and verify
-	const SimpleSRV* srvInfo = GetShaderResourceViewInfo(name);
-	if (srvInfo == 0)
+	SimpleShaderParam param = GetShaderResourceViewParam(name);
+	if (!param.IsValid())
 	{
 		if (ReportWarnings)
 		{
@@ -1196,6 +1558,19 @@ bool SimpleDomainShader::SetShaderResourceView(std::string name, Microsoft::WRL:
 		return false;
 	}
 
+	return SetShaderResourceView(param, srv);
+}
+
+// --------------------------------------------------------
+// Sets a shader resource view in the domain shader stage
+// using a handle from GetShaderResourceViewParam()
+// --------------------------------------------------------
+bool SimpleDomainShader::SetShaderResourceView(SimpleShaderParam param, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
+{
+	const SimpleSRV* srvInfo = GetShaderResourceViewInfo(param.Index);
+	if (srvInfo == 0)
+		return false;
+
 	// Set the shader resource view
 	deviceContext->DSSetShaderResources(srvInfo->BindIndex, 1, srv.GetAddressOf());
 
@@ -1211,11 +1586,11 @@ bool SimpleDomainShader::SetShaderResourceView(std::string name, Microsoft::WRL:
 //
 // Returns true if a sampler of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleDomainShader::SetSamplerState(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState)
+bool SimpleDomainShader::SetSamplerState(const std::string& name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState)
 {
 	// Look for the variable and verify
-	const SimpleSampler* sampInfo = GetSamplerInfo(name);
-	if (sampInfo == 0)
+	SimpleShaderParam param = GetSamplerParam(name);
+	if (!param.IsValid())
 	{
 		if (ReportWarnings)
 		{
@@ -1226,6 +1601,19 @@ bool SimpleDomainShader::SetSamplerState(std::string name, Microsoft::WRL::ComPt
 		return false;
 	}
 
+	return SetSamplerState(param, samplerState);
+}
+
+// --------------------------------------------------------
+// Sets a sampler state in the domain shader stage
+// using a handle from GetSamplerParam()
+// --------------------------------------------------------
+bool SimpleDomainShader::SetSamplerState(SimpleShaderParam param, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState)
+{
+	const SimpleSampler* sampInfo = GetSamplerInfo(param.Index);
+	if (sampInfo == 0)
+		return false;
+
 	// Set the shader resource view
 	deviceContext->DSSetSamplers(sampInfo->BindIndex, 1, samplerState.GetAddressOf());
 
@@ -1304,8 +1692,9 @@ void SimpleHullShader::SetShaderAndCBs()
 	// Set the constant buffers?
 	for (unsigned int i = 0; i < constantBufferCount; i++)
 	{
-		// Skip "buffers" that aren't true constant buffers
-		if (constantBuffers[i].Type != D3D11_CT_CBUFFER)
+		// Skip "buffers" that aren't true constant buffers,
+		// along with any the application binds itself
+		if (constantBuffers[i].Type != D3D11_CT_CBUFFER || constantBuffers[i].External)
 			continue;
 
 		// This is a real constant buffer, so set it
@@ -1324,11 +1713,11 @@ void SimpleHullShader::SetShaderAndCBs()
 //
 // Returns true if a texture of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleHullShader::SetShaderResourceView(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
+bool SimpleHullShader::SetShaderResourceView(const std::string& name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
 {
 	// Look for the variable and verify
-	const SimpleSRV* srvInfo = GetShaderResourceViewInfo(name);
-	if (srvInfo == 0)
+	SimpleShaderParam param = GetShaderResourceViewParam(name);
+	if (!param.IsValid())
 	{
 		if (ReportWarnings)
 		{
@@ -1339,6 +1728,19 @@ bool SimpleHullShader::SetShaderResourceView(std::string name, Microsoft::WRL::C
 		return false;
 	}
 
+	return SetShaderResourceView(param, srv);
+}
+
+// --------------------------------------------------------
+// Sets a shader resource view in the hull shader stage
+// using a handle from GetShaderResourceViewParam()
+// --------------------------------------------------------
+bool SimpleHullShader::SetShaderResourceView(SimpleShaderParam param, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
+{
+	const SimpleSRV* srvInfo = GetShaderResourceViewInfo(param.Index);
+	if (srvInfo == 0)
+		return false;
+
 	// Set the shader resource view
 	deviceContext->HSSetShaderResources(srvInfo->BindIndex, 1, srv.GetAddressOf());
 
@@ -1354,11 +1756,11 @@ bool SimpleHullShader::SetShaderResourceView(std::string name, Microsoft::WRL::C
 //
 // Returns true if a sampler of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleHullShader::SetSamplerState(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState)
+bool SimpleHullShader::SetSamplerState(const std::string& name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState)
 {
 	// Look for the variable and verify
-	const SimpleSampler* sampInfo = GetSamplerInfo(name);
-	if (sampInfo == 0)
+	SimpleShaderParam param = GetSamplerParam(name);
+	if (!param.IsValid())
 	{
 		if (ReportWarnings)
 		{
@@ -1369,6 +1771,19 @@ bool SimpleHullShader::SetSamplerState(std::string name, Microsoft::WRL::ComPtr<
 		return false;
 	}
 
+	return SetSamplerState(param, samplerState);
+}
+
+// --------------------------------------------------------
+// Sets a sampler state in the hull shader stage
+// using a handle from GetSamplerParam()
+// --------------------------------------------------------
+bool SimpleHullShader::SetSamplerState(SimpleShaderParam param, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState)
+{
+	const SimpleSampler* sampInfo = GetSamplerInfo(param.Index);
+	if (sampInfo == 0)
+		return false;
+
 	// Set the shader resource view
 	deviceContext->HSSetSamplers(sampInfo->BindIndex, 1, samplerState.GetAddressOf());
 
@@ -1455,31 +1870,18 @@ bool SimpleGeometryShader::CreateShaderWithStreamOut(Microsoft::WRL::ComPtr<ID3D
 	// called more than once on the same object
 	this->CleanUp();
 
-	// Reflect shader info
-	Microsoft::WRL::ComPtr<ID3D11ShaderReflection> refl;
-	D3DReflect(
-		shaderBlob->GetBufferPointer(),
-		shaderBlob->GetBufferSize(),
-		IID_ID3D11ShaderReflection,
-		(void**)refl.GetAddressOf());
-
-	// Get shader info
-	D3D11_SHADER_DESC shaderDesc;
-	refl->GetDesc(&shaderDesc);
-
 	// Set up the output signature
 	streamOutVertexSize = 0;
 	std::vector<D3D11_SO_DECLARATION_ENTRY> soDecl;
-	for (unsigned int i = 0; i < shaderDesc.OutputParameters; i++)
+	for (unsigned int i = 0; i < reflection.GetOutputCount(); i++)
 	{
 		// Get the info about this entry
-		D3D11_SIGNATURE_PARAMETER_DESC paramDesc;
-		refl->GetOutputParameterDesc(i, &paramDesc);
+		const ShaderReflectionSignature& paramDesc = reflection.GetOutput(i);
 		
 		// Create the SO Declaration
 		D3D11_SO_DECLARATION_ENTRY entry = {};
 		entry.SemanticIndex  = paramDesc.SemanticIndex;
-		entry.SemanticName   = paramDesc.SemanticName;
+		entry.SemanticName   = reflection.GetName(paramDesc.SemanticName);
 		entry.Stream         = paramDesc.Stream;
 		entry.StartComponent = 0; // Assume starting at 0
 		entry.OutputSlot     = 0; // Assume the first output slot
@@ -1578,8 +1980,9 @@ void SimpleGeometryShader::SetShaderAndCBs()
 	// Set the constant buffers?
 	for (unsigned int i = 0; i < constantBufferCount; i++)
 	{
-		// Skip "buffers" that aren't true constant buffers
-		if (constantBuffers[i].Type != D3D11_CT_CBUFFER)
+		// Skip "buffers" that aren't true constant buffers,
+		// along with any the application binds itself
+		if (constantBuffers[i].Type != D3D11_CT_CBUFFER || constantBuffers[i].External)
 			continue;
 
 		// This is a real constant buffer, so set it
@@ -1598,11 +2001,11 @@ void SimpleGeometryShader::SetShaderAndCBs()
 //
 // Returns true if a texture of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleGeometryShader::SetShaderResourceView(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
+bool SimpleGeometryShader::SetShaderResourceView(const std::string& name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
 {
 	// Look for the variable and verify
-	const SimpleSRV* srvInfo = GetShaderResourceViewInfo(name);
-	if (srvInfo == 0)
+	SimpleShaderParam param = GetShaderResourceViewParam(name);
+	if (!param.IsValid())
 	{
 		if (ReportWarnings)
 		{
@@ -1613,6 +2016,19 @@ bool SimpleGeometryShader::SetShaderResourceView(std::string name, Microsoft::WR
 		return false;
 	}
 
+	return SetShaderResourceView(param, srv);
+}
+
+// --------------------------------------------------------
+// Sets a shader resource view in the Geometry shader stage
+// using a handle from GetShaderResourceViewParam()
+// --------------------------------------------------------
+bool SimpleGeometryShader::SetShaderResourceView(SimpleShaderParam param, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
+{
+	const SimpleSRV* srvInfo = GetShaderResourceViewInfo(param.Index);
+	if (srvInfo == 0)
+		return false;
+
 	// Set the shader resource view
 	deviceContext->GSSetShaderResources(srvInfo->BindIndex, 1, srv.GetAddressOf());
 
@@ -1628,11 +2044,11 @@ bool SimpleGeometryShader::SetShaderResourceView(std::string name, Microsoft::WR
 //
 // Returns true if a sampler of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleGeometryShader::SetSamplerState(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState)
+bool SimpleGeometryShader::SetSamplerState(const std::string& name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState)
 {
 	// Look for the variable and verify
-	const SimpleSampler* sampInfo = GetSamplerInfo(name);
-	if (sampInfo == 0)
+	SimpleShaderParam param = GetSamplerParam(name);
+	if (!param.IsValid())
 	{
 		if (ReportWarnings)
 		{
@@ -1643,6 +2059,19 @@ bool SimpleGeometryShader::SetSamplerState(std::string name, Microsoft::WRL::Com
 		return false;
 	}
 
+	return SetSamplerState(param, samplerState);
+}
+
+// --------------------------------------------------------
+// Sets a sampler state in the Geometry shader stage
+// using a handle from GetSamplerParam()
+// --------------------------------------------------------
+bool SimpleGeometryShader::SetSamplerState(SimpleShaderParam param, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState)
+{
+	const SimpleSampler* sampInfo = GetSamplerInfo(param.Index);
+	if (sampInfo == 0)
+		return false;
+
 	// Set the shader resource view
 	deviceContext->GSSetSamplers(sampInfo->BindIndex, 1, samplerState.GetAddressOf());
 
@@ -1703,7 +2132,7 @@ void SimpleComputeShader::CleanUp()
 {
 	ISimpleShader::CleanUp();
 
-	uavTable.clear();
+	uavTable.Clear();
 }
 
 // --------------------------------------------------------
@@ -1730,44 +2159,21 @@ bool SimpleComputeShader::CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBl
 	if (result != S_OK)
 		return false;
 
-	// Set up shader reflection to get information about UAV's
-	Microsoft::WRL::ComPtr<ID3D11ShaderReflection> refl;
-	D3DReflect(
-		shaderBlob->GetBufferPointer(),
-		shaderBlob->GetBufferSize(),
-		IID_ID3D11ShaderReflection,
-		(void**)refl.GetAddressOf());
-
-	// Get the description of the shader
-	D3D11_SHADER_DESC shaderDesc;
-	refl->GetDesc(&shaderDesc);
-	
 	// Grab the thread info
-	threadsTotal = refl->GetThreadGroupSize(
-		&threadsX,
-		&threadsY,
-		&threadsZ);
+	const uint32_t* groupSize = reflection.GetThreadGroupSize();
+	threadsX = groupSize[0];
+	threadsY = groupSize[1];
+	threadsZ = groupSize[2];
+	threadsTotal = threadsX * threadsY * threadsZ;
 
 	// Loop and get all UAV resources
-	unsigned int resourceCount = shaderDesc.BoundResources;
-	for (unsigned int r = 0; r < resourceCount; r++)
+	for (unsigned int r = 0; r < reflection.GetResourceCount(); r++)
 	{
-		// Get this resource's description
-		D3D11_SHADER_INPUT_BIND_DESC resourceDesc;
-		refl->GetResourceBindingDesc(r, &resourceDesc);
-
-		// Check the type, looking for any kind of UAV
-		switch (resourceDesc.Type)
-		{
-		case D3D_SIT_UAV_APPEND_STRUCTURED:
-		case D3D_SIT_UAV_CONSUME_STRUCTURED:
-		case D3D_SIT_UAV_RWBYTEADDRESS:
-		case D3D_SIT_UAV_RWSTRUCTURED:
-		case D3D_SIT_UAV_RWSTRUCTURED_WITH_COUNTER:
-		case D3D_SIT_UAV_RWTYPED:
-			uavTable.insert(std::pair<std::string, unsigned int>(resourceDesc.Name, resourceDesc.BindPoint));
-		}
+		const ShaderReflectionResource& resource = reflection.GetResource(r);
+		if (resource.Type == SHADER_REFLECTION_UAV)
+			uavTable.Add(reflection.GetName(resource.Name), resource.BindIndex);
 	}
+	SortTable(uavTable);
 
 	// All set
 	return true;
@@ -1788,8 +2194,9 @@ void SimpleComputeShader::SetShaderAndCBs()
 	// Set the constant buffers?
 	for (unsigned int i = 0; i < constantBufferCount; i++)
 	{
-		// Skip "buffers" that aren't true constant buffers
-		if (constantBuffers[i].Type != D3D11_CT_CBUFFER)
+		// Skip "buffers" that aren't true constant buffers,
+		// along with any the application binds itself
+		if (constantBuffers[i].Type != D3D11_CT_CBUFFER || constantBuffers[i].External)
 			continue;
 
 		// This is a real constant buffer, so set it
@@ -1856,7 +2263,7 @@ void SimpleComputeShader::DispatchByThreads(unsigned int threadsX, unsigned int
 // --------------------------------------------------------
 // Determines if this shader has the specified UAV
 // --------------------------------------------------------
-bool SimpleComputeShader::HasUnorderedAccessView(std::string name)
+bool SimpleComputeShader::HasUnorderedAccessView(const std::string& name)
 {
 	return GetUnorderedAccessViewIndex(name) != -1;
 }
@@ -1869,11 +2276,11 @@ bool SimpleComputeShader::HasUnorderedAccessView(std::string name)
 //
 // Returns true if a texture of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleComputeShader::SetShaderResourceView(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
+bool SimpleComputeShader::SetShaderResourceView(const std::string& name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
 {
 	// Look for the variable and verify
-	const SimpleSRV* srvInfo = GetShaderResourceViewInfo(name);
-	if (srvInfo == 0)
+	SimpleShaderParam param = GetShaderResourceViewParam(name);
+	if (!param.IsValid())
 	{
 		if (ReportWarnings)
 		{
@@ -1884,6 +2291,19 @@ bool SimpleComputeShader::SetShaderResourceView(std::string name, Microsoft::WRL
 		return false;
 	}
 
+	return SetShaderResourceView(param, srv);
+}
+
+// --------------------------------------------------------
+// Sets a shader resource view in the Compute shader stage
+// using a handle from GetShaderResourceViewParam()
+// --------------------------------------------------------
+bool SimpleComputeShader::SetShaderResourceView(SimpleShaderParam param, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
+{
+	const SimpleSRV* srvInfo = GetShaderResourceViewInfo(param.Index);
+	if (srvInfo == 0)
+		return false;
+
 	// Set the shader resource view
 	deviceContext->CSSetShaderResources(srvInfo->BindIndex, 1, srv.GetAddressOf());
 
@@ -1899,11 +2319,11 @@ bool SimpleComputeShader::SetShaderResourceView(std::string name, Microsoft::WRL
 //
 // Returns true if a sampler of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleComputeShader::SetSamplerState(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState)
+bool SimpleComputeShader::SetSamplerState(const std::string& name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState)
 {
 	// Look for the variable and verify
-	const SimpleSampler* sampInfo = GetSamplerInfo(name);
-	if (sampInfo == 0)
+	SimpleShaderParam param = GetSamplerParam(name);
+	if (!param.IsValid())
 	{
 		if (ReportWarnings)
 		{
@@ -1914,6 +2334,19 @@ bool SimpleComputeShader::SetSamplerState(std::string name, Microsoft::WRL::ComP
 		return false;
 	}
 
+	return SetSamplerState(param, samplerState);
+}
+
+// --------------------------------------------------------
+// Sets a sampler state in the Compute shader stage
+// using a handle from GetSamplerParam()
+// --------------------------------------------------------
+bool SimpleComputeShader::SetSamplerState(SimpleShaderParam param, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState)
+{
+	const SimpleSampler* sampInfo = GetSamplerInfo(param.Index);
+	if (sampInfo == 0)
+		return false;
+
 	// Set the shader resource view
 	deviceContext->CSSetSamplers(sampInfo->BindIndex, 1, samplerState.GetAddressOf());
 
@@ -1930,7 +2363,7 @@ bool SimpleComputeShader::SetSamplerState(std::string name, Microsoft::WRL::ComP
 //
 // Returns true if a UAV of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleComputeShader::SetUnorderedAccessView(std::string name, Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> uav, unsigned int appendConsumeOffset)
+bool SimpleComputeShader::SetUnorderedAccessView(const std::string& name, Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> uav, unsigned int appendConsumeOffset)
 {
 	// Look for the variable and verify
 	unsigned int bindIndex = GetUnorderedAccessViewIndex(name);
@@ -1955,16 +2388,15 @@ bool SimpleComputeShader::SetUnorderedAccessView(std::string name, Microsoft::WR
 // --------------------------------------------------------
 // Gets the index of the specified UAV (or -1)
 // --------------------------------------------------------
-int SimpleComputeShader::GetUnorderedAccessViewIndex(std::string name)
+int SimpleComputeShader::GetUnorderedAccessViewIndex(const std::string& name)
 {
 	// Look for the key
-	std::unordered_map<std::string, unsigned int>::iterator result =
-		uavTable.find(name);
+	SimpleShaderParam param = uavTable.Find(name.c_str());
 
 	// Did we find the key?
-	if (result == uavTable.end())
+	if (!param.IsValid())
 		return -1;
 
-	// Success
-	return result->second;
+	// Success (the table holds bind points rather than indices)
+	return param.Index;
 }
\ No newline at end of file
@@ -3,13 +3,18 @@
 #pragma comment(lib, "d3dcompiler.lib")
 
 #include <d3d11.h>
+#include <d3d11_1.h>
 #include <d3dcompiler.h>
 #include <DirectXMath.h>
 #include <wrl/client.h>
 
-#include <unordered_map>
 #include <vector>
 #include <string>
+#include <memory>
+
+#include "StateCache.h"
+#include "ShaderReflectionCache.h"
+#include "SimpleShaderTable.h"
 
 
 // --------------------------------------------------------
@@ -37,6 +42,13 @@ struct SimpleConstantBuffer
 	Microsoft::WRL::ComPtr<ID3D11Buffer> ConstantBuffer = 0;
 	unsigned char* LocalDataBuffer = 0;
 	std::vector<SimpleShaderVariable> Variables;
+	bool External = false; // Owned and bound by the application, see ExternalBuffers
+	bool Dynamic = false;  // Created with USAGE_DYNAMIC and uploaded with Map()
+
+	// Local data that hasn't reached the GPU yet, as a byte range
+	bool Dirty = true;
+	unsigned int DirtyStart = 0;
+	unsigned int DirtyEnd = 0;
 };
 
 // --------------------------------------------------------
@@ -57,6 +69,17 @@ struct SimpleSampler
 	unsigned int BindIndex; // The register of the Sampler
 };
 
+// --------------------------------------------------------
+// Running totals of constant buffer uploads, for profiling
+// --------------------------------------------------------
+struct SimpleShaderUploadStats
+{
+	unsigned int Uploads;
+	unsigned int Bytes;
+	unsigned int CleanSkips;	// Uploads skipped because nothing changed
+	unsigned int SameWrites;	// Sets skipped because the bytes were identical
+};
+
 // --------------------------------------------------------
 // Base abstract class for simplifying shader handling
 // --------------------------------------------------------
@@ -73,46 +96,70 @@ public:
 	void SetShader();
 	void CopyAllBufferData();
 	void CopyBufferData(unsigned int index);
-	void CopyBufferData(std::string bufferName);
+	void CopyBufferData(const std::string& bufferName);
+	void CopyBufferData(SimpleShaderParam buffer);
+
+	// Resolving names to handles, either at runtime or from a
+	// SimpleShaderHash() computed at compile time
+	SimpleShaderParam GetVariableParam(const std::string& name);
+	SimpleShaderParam GetVariableParam(unsigned int nameHash);
+	SimpleShaderParam GetShaderResourceViewParam(const std::string& name);
+	SimpleShaderParam GetShaderResourceViewParam(unsigned int nameHash);
+	SimpleShaderParam GetSamplerParam(const std::string& name);
+	SimpleShaderParam GetSamplerParam(unsigned int nameHash);
+	SimpleShaderParam GetBufferParam(const std::string& name);
+	SimpleShaderParam GetBufferParam(unsigned int nameHash);
 
 	// Sets arbitrary shader data
-	bool SetData(std::string name, const void* data, unsigned int size);
-
-	bool SetInt(std::string name, int data);
-	bool SetFloat(std::string name, float data);
-	bool SetFloat2(std::string name, const float data[2]);
-	bool SetFloat2(std::string name, const DirectX::XMFLOAT2 data);
-	bool SetFloat3(std::string name, const float data[3]);
-	bool SetFloat3(std::string name, const DirectX::XMFLOAT3 data);
-	bool SetFloat4(std::string name, const float data[4]);
-	bool SetFloat4(std::string name, const DirectX::XMFLOAT4 data);
-	bool SetMatrix4x4(std::string name, const float data[16]);
-	bool SetMatrix4x4(std::string name, const DirectX::XMFLOAT4X4 data);
+	bool SetData(const std::string& name, const void* data, unsigned int size);
+
+	bool SetInt(const std::string& name, int data);
+	bool SetFloat(const std::string& name, float data);
+	bool SetFloat2(const std::string& name, const float data[2]);
+	bool SetFloat2(const std::string& name, const DirectX::XMFLOAT2 data);
+	bool SetFloat3(const std::string& name, const float data[3]);
+	bool SetFloat3(const std::string& name, const DirectX::XMFLOAT3 data);
+	bool SetFloat4(const std::string& name, const float data[4]);
+	bool SetFloat4(const std::string& name, const DirectX::XMFLOAT4 data);
+	bool SetMatrix4x4(const std::string& name, const float data[16]);
+	bool SetMatrix4x4(const std::string& name, const DirectX::XMFLOAT4X4 data);
+
+	// Sets shader data through resolved handles
+	bool SetData(SimpleShaderParam param, const void* data, unsigned int size);
+
+	bool SetInt(SimpleShaderParam param, int data);
+	bool SetFloat(SimpleShaderParam param, float data);
+	bool SetFloat2(SimpleShaderParam param, const DirectX::XMFLOAT2& data);
+	bool SetFloat3(SimpleShaderParam param, const DirectX::XMFLOAT3& data);
+	bool SetFloat4(SimpleShaderParam param, const DirectX::XMFLOAT4& data);
+	bool SetMatrix4x4(SimpleShaderParam param, const DirectX::XMFLOAT4X4& data);
 
 	// Setting shader resources
-	virtual bool SetShaderResourceView(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv) = 0;
-	virtual bool SetSamplerState(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState) = 0;
+	virtual bool SetShaderResourceView(const std::string& name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv) = 0;
+	virtual bool SetShaderResourceView(SimpleShaderParam param, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv) = 0;
+	virtual bool SetSamplerState(const std::string& name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState) = 0;
+	virtual bool SetSamplerState(SimpleShaderParam param, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState) = 0;
 
 	// Simple resource checking
-	bool HasVariable(std::string name);
-	bool HasShaderResourceView(std::string name);
-	bool HasSamplerState(std::string name);
+	bool HasVariable(const std::string& name);
+	bool HasShaderResourceView(const std::string& name);
+	bool HasSamplerState(const std::string& name);
 
 	// Getting data about variables and resources
-	const SimpleShaderVariable* GetVariableInfo(std::string name);
+	const SimpleShaderVariable* GetVariableInfo(const std::string& name);
 	
-	const SimpleSRV* GetShaderResourceViewInfo(std::string name);
+	const SimpleSRV* GetShaderResourceViewInfo(const std::string& name);
 	const SimpleSRV* GetShaderResourceViewInfo(unsigned int index);
-	size_t GetShaderResourceViewCount() { return textureTable.size(); }
+	size_t GetShaderResourceViewCount() { return shaderResourceViews.size(); }
 	
-	const SimpleSampler* GetSamplerInfo(std::string name);
+	const SimpleSampler* GetSamplerInfo(const std::string& name);
 	const SimpleSampler* GetSamplerInfo(unsigned int index);
-	size_t GetSamplerCount() { return samplerTable.size(); }
+	size_t GetSamplerCount() { return samplerStates.size(); }
 
 	// Get data about constant buffers
 	unsigned int GetBufferCount();
 	unsigned int GetBufferSize(unsigned int index);
-	const SimpleConstantBuffer* GetBufferInfo(std::string name);
+	const SimpleConstantBuffer* GetBufferInfo(const std::string& name);
 	const SimpleConstantBuffer* GetBufferInfo(unsigned int index);
 	
 	// Misc getters
@@ -122,6 +169,27 @@ public:
 	static bool ReportErrors;
 	static bool ReportWarnings;
 
+	// Optional filter for redundant binds (vertex and pixel shaders only)
+	static std::shared_ptr<StateCache> SharedStateCache;
+
+	// Names of constant buffers the application manages itself.
+	// These are reflected as usual (so variable info is still
+	// available) but never created, bound or copied by a shader.
+	// Must be filled in before any shaders are loaded.
+	static std::vector<std::string> ExternalBuffers;
+
+	// Uploads made by all shaders since the last reset
+	static SimpleShaderUploadStats UploadStats;
+	static void ResetUploadStats() { UploadStats = {}; }
+
+	// Upload buffers with Map(WRITE_DISCARD) instead of UpdateSubresource(),
+	// applies to buffers created after it's set
+	static bool UseDynamicBuffers;
+
+	// Read reflection data from (and save it to) a ".refl" file
+	// next to each .cso, rather than reflecting on every load
+	static bool UseReflectionCache;
+
 protected:
 	
 	bool shaderValid;
@@ -129,20 +197,31 @@ protected:
 	Microsoft::WRL::ComPtr<ID3D11Device> device;
 	Microsoft::WRL::ComPtr<ID3D11DeviceContext> deviceContext;
 
+	// Set when the runtime can update part of a constant buffer
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext1> deviceContext1;
+
 	// Resource counts
 	unsigned int constantBufferCount;
 	
 	// Maps for variables and buffers
 	SimpleConstantBuffer*		constantBuffers; // For index-based lookup
-	std::vector<SimpleSRV*>		shaderResourceViews;
-	std::vector<SimpleSampler*>	samplerStates;
-	std::unordered_map<std::string, SimpleConstantBuffer*> cbTable;
-	std::unordered_map<std::string, SimpleShaderVariable> varTable;
-	std::unordered_map<std::string, SimpleSRV*> textureTable;
-	std::unordered_map<std::string, SimpleSampler*> samplerTable;
-
-	// Initialization method
+	std::vector<SimpleShaderVariable> variables;
+	std::vector<SimpleSRV>		shaderResourceViews;
+	std::vector<SimpleSampler>	samplerStates;
+
+	// Name hash -> index into the arrays above (these indices are the handles)
+	SimpleShaderTable cbTable;
+	SimpleShaderTable varTable;
+	SimpleShaderTable textureTable;
+	SimpleShaderTable samplerTable;
+
+	// Reflection results, only held while the shader is loading
+	ShaderReflectionData reflection;
+
+	// Initialization methods
 	bool LoadShaderFile(LPCWSTR shaderFile);
+	bool ReflectShader(uint64_t bytecodeHash);
+	void BuildTables();
 
 	// Pure virtual functions for dealing with shader types
 	virtual bool CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob) = 0;
@@ -150,9 +229,13 @@ protected:
 
 	virtual void CleanUp();
 
+	// Copies a buffer's local data to the GPU
+	void UploadBuffer(SimpleConstantBuffer* cb);
+
 	// Helpers for finding data by name
-	SimpleShaderVariable* FindVariable(std::string name, int size);
-	SimpleConstantBuffer* FindConstantBuffer(std::string name);
+	SimpleShaderVariable* FindVariable(const std::string& name, int size);
+	SimpleConstantBuffer* FindConstantBuffer(const std::string& name);
+	void SortTable(SimpleShaderTable& table);
 
 	// Error logging
 	void Log(std::string message, WORD color);
@@ -178,8 +261,10 @@ public:
 	Microsoft::WRL::ComPtr<ID3D11InputLayout> GetInputLayout() { return inputLayout; }
 	bool GetPerInstanceCompatible() { return perInstanceCompatible; }
 
-	bool SetShaderResourceView(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv);
-	bool SetSamplerState(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState);
+	bool SetShaderResourceView(const std::string& name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv);
+	bool SetShaderResourceView(SimpleShaderParam param, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv);
+	bool SetSamplerState(const std::string& name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState);
+	bool SetSamplerState(SimpleShaderParam param, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState);
 
 protected:
 	bool perInstanceCompatible;
@@ -201,8 +286,10 @@ public:
 	~SimplePixelShader();
 	Microsoft::WRL::ComPtr<ID3D11PixelShader> GetDirectXShader() { return shader; }
 
-	bool SetShaderResourceView(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv);
-	bool SetSamplerState(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState);
+	bool SetShaderResourceView(const std::string& name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv);
+	bool SetShaderResourceView(SimpleShaderParam param, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv);
+	bool SetSamplerState(const std::string& name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState);
+	bool SetSamplerState(SimpleShaderParam param, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState);
 
 protected:
 	Microsoft::WRL::ComPtr<ID3D11PixelShader> shader;
@@ -221,8 +308,10 @@ public:
 	~SimpleDomainShader();
 	Microsoft::WRL::ComPtr<ID3D11DomainShader> GetDirectXShader() { return shader; }
 
-	bool SetShaderResourceView(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv);
-	bool SetSamplerState(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState);
+	bool SetShaderResourceView(const std::string& name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv);
+	bool SetShaderResourceView(SimpleShaderParam param, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv);
+	bool SetSamplerState(const std::string& name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState);
+	bool SetSamplerState(SimpleShaderParam param, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState);
 
 protected:
 	Microsoft::WRL::ComPtr<ID3D11DomainShader> shader;
@@ -241,8 +330,10 @@ public:
 	~SimpleHullShader();
 	Microsoft::WRL::ComPtr<ID3D11HullShader> GetDirectXShader() { return shader; }
 
-	bool SetShaderResourceView(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv);
-	bool SetSamplerState(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState);
+	bool SetShaderResourceView(const std::string& name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv);
+	bool SetShaderResourceView(SimpleShaderParam param, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv);
+	bool SetSamplerState(const std::string& name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState);
+	bool SetSamplerState(SimpleShaderParam param, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState);
 
 protected:
 	Microsoft::WRL::ComPtr<ID3D11HullShader> shader;
@@ -261,8 +352,10 @@ public:
 	~SimpleGeometryShader();
 	Microsoft::WRL::ComPtr<ID3D11GeometryShader> GetDirectXShader() { return shader; }
 
-	bool SetShaderResourceView(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv);
-	bool SetSamplerState(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState);
+	bool SetShaderResourceView(const std::string& name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv);
+	bool SetShaderResourceView(SimpleShaderParam param, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv);
+	bool SetSamplerState(const std::string& name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState);
+	bool SetSamplerState(SimpleShaderParam param, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState);
 
 	bool CreateCompatibleStreamOutBuffer(Microsoft::WRL::ComPtr<ID3D11Buffer> buffer, int vertexCount);
 
@@ -300,17 +393,19 @@ public:
 	void DispatchByGroups(unsigned int groupsX, unsigned int groupsY, unsigned int groupsZ);
 	void DispatchByThreads(unsigned int threadsX, unsigned int threadsY, unsigned int threadsZ);
 
-	bool HasUnorderedAccessView(std::string name);
+	bool HasUnorderedAccessView(const std::string& name);
 
-	bool SetShaderResourceView(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv);
-	bool SetSamplerState(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState);
-	bool SetUnorderedAccessView(std::string name, Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> uav, unsigned int appendConsumeOffset = -1);
+	bool SetShaderResourceView(const std::string& name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv);
+	bool SetShaderResourceView(SimpleShaderParam param, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv);
+	bool SetSamplerState(const std::string& name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState);
+	bool SetSamplerState(SimpleShaderParam param, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState);
+	bool SetUnorderedAccessView(const std::string& name, Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> uav, unsigned int appendConsumeOffset = -1);
 
-	int GetUnorderedAccessViewIndex(std::string name);
+	int GetUnorderedAccessViewIndex(const std::string& name);
 
 protected:
 	Microsoft::WRL::ComPtr<ID3D11ComputeShader> shader;
-	std::unordered_map<std::string, unsigned int> uavTable;
+	SimpleShaderTable uavTable; // Name hash -> UAV bind point
 
 	unsigned int threadsX;
 	unsigned int threadsY;
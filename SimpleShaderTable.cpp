@@ -0,0 +1,66 @@
+#include "SimpleShaderTable.h"
+#include <algorithm>
+
+void SimpleShaderTable::Add(const char* name, unsigned int index)
+{
+	SimpleShaderTableEntry entry = {};
+	entry.Hash = SimpleShaderHash(name);
+	entry.Index = index;
+	entry.Name = name;
+	entries.push_back(entry);
+}
+
+// --------------------------------------------------------
+// Stable, so names with the same hash stay in the order
+// they were added
+// --------------------------------------------------------
+bool SimpleShaderTable::Sort()
+{
+	std::stable_sort(entries.begin(), entries.end(),
+		[](const SimpleShaderTableEntry& a, const SimpleShaderTableEntry& b) { return a.Hash < b.Hash; });
+
+	return std::adjacent_find(entries.begin(), entries.end(),
+		[](const SimpleShaderTableEntry& a, const SimpleShaderTableEntry& b) { return a.Hash == b.Hash; }) == entries.end();
+}
+
+void SimpleShaderTable::Clear()
+{
+	entries.clear();
+}
+
+// --------------------------------------------------------
+// Searches the run of entries with the name's hash (almost
+// always just one) for the name itself
+// --------------------------------------------------------
+SimpleShaderParam SimpleShaderTable::Find(const char* name) const
+{
+	SimpleShaderParam param;
+	unsigned int nameHash = SimpleShaderHash(name);
+
+	std::vector<SimpleShaderTableEntry>::const_iterator entry = std::lower_bound(
+		entries.begin(), entries.end(), nameHash,
+		[](const SimpleShaderTableEntry& entry, unsigned int hash) { return entry.Hash < hash; });
+	for (; entry != entries.end() && entry->Hash == nameHash; entry++)
+	{
+		if (entry->Name == name)
+		{
+			param.Index = entry->Index;
+			break;
+		}
+	}
+
+	return param;
+}
+
+SimpleShaderParam SimpleShaderTable::Find(unsigned int nameHash) const
+{
+	SimpleShaderParam param;
+
+	std::vector<SimpleShaderTableEntry>::const_iterator entry = std::lower_bound(
+		entries.begin(), entries.end(), nameHash,
+		[](const SimpleShaderTableEntry& entry, unsigned int hash) { return entry.Hash < hash; });
+	if (entry != entries.end() && entry->Hash == nameHash)
+		param.Index = entry->Index;
+
+	return param;
+}
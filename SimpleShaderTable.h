@@ -0,0 +1,73 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// --------------------------------------------------------
+// 32-bit FNV-1a hash of a variable or resource name.
+// Shaders look names up by this hash, so hot code can hash
+// its names once at compile time:
+//
+//   constexpr unsigned int WorldHash = SimpleShaderHash("world");
+// --------------------------------------------------------
+constexpr unsigned int SimpleShaderHash(const char* name)
+{
+	unsigned int hash = 2166136261u;
+	while (*name)
+	{
+		hash ^= (unsigned char)*name++;
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+// --------------------------------------------------------
+// A variable, resource or constant buffer resolved ahead of
+// time, so setting it is a plain array index.  Handles are
+// only meaningful for the shader that produced them; setting
+// an invalid handle does nothing and returns false.
+// --------------------------------------------------------
+struct SimpleShaderParam
+{
+	unsigned int Index = (unsigned int)-1;
+	bool IsValid() const { return Index != (unsigned int)-1; }
+};
+
+// --------------------------------------------------------
+// One name in a lookup table
+// --------------------------------------------------------
+struct SimpleShaderTableEntry
+{
+	unsigned int Hash;
+	unsigned int Index;
+	std::string Name;
+};
+
+// --------------------------------------------------------
+// Name -> index lookups for one kind of shader parameter:
+// a flat array sorted by hash and binary searched.
+//
+// A different name can have the same hash, so looking up a
+// name also compares it against the entry's, and fails
+// rather than returning some other parameter.  Looking up
+// a hash can't tell colliding names apart, and finds the
+// first added.
+// --------------------------------------------------------
+class SimpleShaderTable
+{
+public:
+	// Entries can't be looked up until the table is sorted
+	void Add(const char* name, unsigned int index);
+
+	// Returns false if two names share a hash
+	bool Sort();
+
+	void Clear();
+	unsigned int GetCount() const { return (unsigned int)entries.size(); }
+
+	SimpleShaderParam Find(const char* name) const;
+	SimpleShaderParam Find(unsigned int nameHash) const;
+
+private:
+	std::vector<SimpleShaderTableEntry> entries;
+};
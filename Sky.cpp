@@ -25,6 +25,23 @@ Sky::Sky(std::shared_ptr<Mesh> skyMesh, Microsoft::WRL::ComPtr<ID3D11SamplerStat
 		back.c_str()
 	);
 
+	CreateShadersAndStates(psPath, vsPath);
+}
+
+// --------------------------------------------------------
+// For a cube map that's already loaded (for instance, from
+// faces decoded alongside other textures)
+// --------------------------------------------------------
+Sky::Sky(std::shared_ptr<Mesh> skyMesh, Microsoft::WRL::ComPtr<ID3D11SamplerState> skySamplerState, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> cubeMap, wchar_t* psPath, wchar_t* vsPath) :
+	mesh(skyMesh),
+	samplerState(skySamplerState),
+	textureSRV(cubeMap)
+{
+	CreateShadersAndStates(psPath, vsPath);
+}
+
+void Sky::CreateShadersAndStates(wchar_t* psPath, wchar_t* vsPath)
+{
 	vs = std::make_shared<SimpleVertexShader>(Graphics::Device, Graphics::Context, vsPath);
 	ps = std::make_shared<SimplePixelShader>(Graphics::Device, Graphics::Context, psPath);
 
@@ -32,13 +49,13 @@ Sky::Sky(std::shared_ptr<Mesh> skyMesh, Microsoft::WRL::ComPtr<ID3D11SamplerStat
 	rasterDesc.FillMode = D3D11_FILL_SOLID;
 	rasterDesc.CullMode = D3D11_CULL_FRONT;
 
-	Graphics::Device->CreateRasterizerState(&rasterDesc, &rasterizerState);
+	rasterizerState = Graphics::Pipelines->GetRasterizerState(rasterDesc);
 
 	D3D11_DEPTH_STENCIL_DESC depthDesc = {};
 	depthDesc.DepthEnable = true;
 	depthDesc.DepthFunc = D3D11_COMPARISON_LESS_EQUAL;
 
-	Graphics::Device->CreateDepthStencilState(&depthDesc, &depthStencil);
+	depthStencil = Graphics::Pipelines->GetDepthStencilState(depthDesc);
 }
 
 // --------------------------------------------------------
@@ -143,30 +160,24 @@ Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> Sky::CreateCubemap(
 	return cubeSRV;
 }
 
-void Sky::Draw(std::shared_ptr<Camera> camera) {
+// Camera matrices come from the per-frame buffer, which must already be bound
+void Sky::Draw() {
 
 	// Set rasterizer and depth states
-	Graphics::Context->RSSetState(rasterizerState.Get());
-	Graphics::Context->OMSetDepthStencilState(depthStencil.Get(), 0);
+	Graphics::State->SetRasterizerState(rasterizerState.Get());
+	Graphics::State->SetDepthStencilState(depthStencil.Get(), 0);
 
 	// Set shaders
 	vs->SetShader();
 	ps->SetShader();
 
 	// Shader info
-	vs->SetMatrix4x4("view", camera->GetView());
-	vs->SetMatrix4x4("proj", camera->GetProjection());
-
-	vs->CopyAllBufferData();
-
 	ps->SetShaderResourceView("SkyTexture", textureSRV);
 	ps->SetSamplerState("SkySampler", samplerState);
 
-	ps->CopyAllBufferData();
-
 	mesh->Draw();
 
 	// Reset states
-	Graphics::Context->RSSetState(0);
-	Graphics::Context->OMSetDepthStencilState(0, 0);
+	Graphics::State->SetRasterizerState(0);
+	Graphics::State->SetDepthStencilState(0, 0);
 }
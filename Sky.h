@@ -18,8 +18,11 @@ private:
 	std::shared_ptr<SimplePixelShader> ps;
 	std::shared_ptr<SimpleVertexShader> vs;
 
+	void CreateShadersAndStates(wchar_t* psPath, wchar_t* vsPath);
+
 public:
 	Sky(std::shared_ptr<Mesh> skyMesh, Microsoft::WRL::ComPtr<ID3D11SamplerState> skySamplerState, wchar_t* texPath, wchar_t* psPath, wchar_t* vsPath);
+	Sky(std::shared_ptr<Mesh> skyMesh, Microsoft::WRL::ComPtr<ID3D11SamplerState> skySamplerState, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> cubeMap, wchar_t* psPath, wchar_t* vsPath);
 	// Helper for creating a cubemap from 6 individual textures
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> CreateCubemap(
 		const wchar_t* right,
@@ -28,5 +31,5 @@ public:
 		const wchar_t* down,
 		const wchar_t* front,
 		const wchar_t* back);
-	void Draw(std::shared_ptr<Camera> camera);
+	void Draw();
 };
\ No newline at end of file
@@ -5,5 +5,6 @@ SamplerState SkySampler : register(s0);
 
 float4 main(VertexToPixel_Sky input) : SV_TARGET
 {
-    return SkyTexture.Sample(SkySampler, input.sampleDir);
+    // The scene is linear, and the sky's images aren't
+    return pow(SkyTexture.Sample(SkySampler, input.sampleDir), 2.2f);
 }
\ No newline at end of file
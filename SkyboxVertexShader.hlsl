@@ -1,10 +1,4 @@
-#include "ShaderStructs.hlsli"
-
-cbuffer ExternalData : register(b0)
-{
-    matrix view;
-    matrix proj;
-}
+#include "ShaderBuffers.hlsli"
 
 VertexToPixel_Sky main(VertexShaderInput input)
 {
@@ -0,0 +1,216 @@
+#include "SphericalHarmonics.h"
+#include <algorithm>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	// Normalization constants of the real SH basis, per coefficient
+	const float basisScale[SH_COEFFICIENT_COUNT] =
+	{
+		0.282095f,							// 1 / (2 sqrt(pi))
+		0.488603f, 0.488603f, 0.488603f,	// sqrt(3 / (4 pi))
+		1.092548f, 1.092548f,				// sqrt(15 / (4 pi))
+		0.315392f,							// sqrt(5 / (16 pi))
+		1.092548f,
+		0.546274f							// sqrt(15 / (16 pi))
+	};
+
+	// Clamped cosine lobe, per band
+	const float cosineLobe[3] = { XM_PI, XM_2PI / 3.0f, XM_PIDIV4 };
+	const int bandOf[SH_COEFFICIENT_COUNT] = { 0, 1, 1, 1, 2, 2, 2, 2, 2 };
+
+	// The basis functions in a unit direction
+	void EvaluateBasis(float x, float y, float z, float basis[SH_COEFFICIENT_COUNT])
+	{
+		basis[0] = basisScale[0];
+		basis[1] = basisScale[1] * y;
+		basis[2] = basisScale[2] * z;
+		basis[3] = basisScale[3] * x;
+		basis[4] = basisScale[4] * x * y;
+		basis[5] = basisScale[5] * y * z;
+		basis[6] = basisScale[6] * (3 * z * z - 1);
+		basis[7] = basisScale[7] * x * z;
+		basis[8] = basisScale[8] * (x * x - y * y);
+	}
+
+	// Direction through (u, v), each -1 to 1 across the face
+	// (v downward), in the D3D cube map convention
+	XMVECTOR FaceDirection(int face, float u, float v)
+	{
+		switch (face)
+		{
+		case 0: return XMVectorSet(1, -v, -u, 0);
+		case 1: return XMVectorSet(-1, -v, u, 0);
+		case 2: return XMVectorSet(u, 1, v, 0);
+		case 3: return XMVectorSet(u, -1, -v, 0);
+		case 4: return XMVectorSet(u, -v, 1, 0);
+		default: return XMVectorSet(-u, -v, -1, 0);
+		}
+	}
+
+	// Solid angle of the part of a face between its center and
+	// (u, v), so a texel's is the difference at its four corners
+	float CornerArea(float u, float v)
+	{
+		return std::atan2(u * v, std::sqrt(u * u + v * v + 1));
+	}
+
+	float TexelSolidAngle(float u0, float v0, float u1, float v1)
+	{
+		return CornerArea(u1, v1) - CornerArea(u0, v1) - CornerArea(u1, v0) + CornerArea(u0, v0);
+	}
+
+	// Built on first use (thread safe, as a function-local static)
+	struct SRGBTable
+	{
+		float ToLinear[256];
+
+		SRGBTable()
+		{
+			for (int i = 0; i < 256; i++)
+			{
+				float c = i / 255.0f;
+				ToLinear[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+			}
+		}
+	};
+	const float* SRGBToLinearTable() { static const SRGBTable table; return table.ToLinear; }
+
+	// Sums one face's rows [first, end) into sums
+	void ProjectRows(const BlockImage& face, int faceIndex, unsigned int first, unsigned int end, XMVECTOR sums[SH_COEFFICIENT_COUNT])
+	{
+		const float* srgb = SRGBToLinearTable();
+		float texelSize = 2.0f / face.Width;
+		float texelHeight = 2.0f / face.Height;
+		float basis[SH_COEFFICIENT_COUNT];
+
+		for (unsigned int y = first; y < end; y++)
+		{
+			float v0 = y * texelHeight - 1;
+			float v1 = v0 + texelHeight;
+			const unsigned char* row = &face.Pixels[(size_t)y * face.Width * 4];
+
+			for (unsigned int x = 0; x < face.Width; x++)
+			{
+				float u0 = x * texelSize - 1;
+				float u1 = u0 + texelSize;
+
+				XMFLOAT3 dir;
+				XMStoreFloat3(&dir, XMVector3Normalize(FaceDirection(faceIndex, (u0 + u1) * 0.5f, (v0 + v1) * 0.5f)));
+				EvaluateBasis(dir.x, dir.y, dir.z, basis);
+
+				const unsigned char* texel = &row[x * 4];
+				XMVECTOR radiance = XMVectorScale(
+					XMVectorSet(srgb[texel[0]], srgb[texel[1]], srgb[texel[2]], 0),
+					TexelSolidAngle(u0, v0, u1, v1));
+
+				for (int i = 0; i < SH_COEFFICIENT_COUNT; i++)
+					sums[i] = XMVectorMultiplyAdd(radiance, XMVectorReplicate(basis[i]), sums[i]);
+			}
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Each thread sums its own share of the rows of all six
+// faces, and the partial sums are added at the end, so the
+// result doesn't depend on scheduling.  Every radiance is
+// weighted by the texel's exact solid angle, which over a
+// whole cube sums to 4 pi.
+// --------------------------------------------------------
+SHColor SphericalHarmonics::ProjectCubemap(const BlockImage* faces[6], unsigned int threadCount)
+{
+	// All the faces' rows, numbered one after another
+	unsigned int totalRows = 0;
+	for (int f = 0; f < 6; f++)
+		if (faces[f] && faces[f]->Width > 0)
+			totalRows += faces[f]->Height;
+
+	const unsigned int minRowsPerThread = 32;
+	threadCount = std::clamp(totalRows / minRowsPerThread, 1u, std::max(1u, threadCount));
+	unsigned int rowsPerThread = (totalRows + threadCount - 1) / threadCount;
+
+	std::vector<XMFLOAT4> partials((size_t)threadCount * SH_COEFFICIENT_COUNT);
+	auto project = [&](unsigned int t)
+	{
+		XMVECTOR sums[SH_COEFFICIENT_COUNT];
+		for (int i = 0; i < SH_COEFFICIENT_COUNT; i++)
+			sums[i] = XMVectorZero();
+
+		unsigned int first = t * rowsPerThread;
+		unsigned int end = std::min(first + rowsPerThread, totalRows);
+		unsigned int faceStart = 0;
+		for (int f = 0; f < 6; f++)
+		{
+			if (!faces[f] || faces[f]->Width == 0)
+				continue;
+			unsigned int faceEnd = faceStart + faces[f]->Height;
+			if (first < faceEnd && end > faceStart)
+				ProjectRows(*faces[f], f, std::max(first, faceStart) - faceStart, std::min(end, faceEnd) - faceStart, sums);
+			faceStart = faceEnd;
+		}
+
+		for (int i = 0; i < SH_COEFFICIENT_COUNT; i++)
+			XMStoreFloat4(&partials[(size_t)t * SH_COEFFICIENT_COUNT + i], sums[i]);
+	};
+
+	if (threadCount == 1)
+	{
+		project(0);
+	}
+	else
+	{
+		std::vector<std::thread> threads;
+		for (unsigned int t = 0; t < threadCount; t++)
+			threads.emplace_back(project, t);
+		for (std::thread& t : threads)
+			t.join();
+	}
+
+	SHColor result = {};
+	for (int i = 0; i < SH_COEFFICIENT_COUNT; i++)
+	{
+		XMVECTOR sum = XMVectorZero();
+		for (unsigned int t = 0; t < threadCount; t++)
+			sum = XMVectorAdd(sum, XMLoadFloat4(&partials[(size_t)t * SH_COEFFICIENT_COUNT + i]));
+		XMStoreFloat3(&result.Coefficients[i], sum);
+	}
+	return result;
+}
+
+SHColor SphericalHarmonics::ConvolveIrradiance(const SHColor& radiance)
+{
+	SHColor irradiance = {};
+	for (int i = 0; i < SH_COEFFICIENT_COUNT; i++)
+		XMStoreFloat3(&irradiance.Coefficients[i],
+			XMVectorScale(XMLoadFloat3(&radiance.Coefficients[i]), cosineLobe[bandOf[i]]));
+	return irradiance;
+}
+
+XMFLOAT3 SphericalHarmonics::Evaluate(const SHColor& sh, XMFLOAT3 direction)
+{
+	XMFLOAT3 dir;
+	XMStoreFloat3(&dir, XMVector3Normalize(XMLoadFloat3(&direction)));
+
+	float basis[SH_COEFFICIENT_COUNT];
+	EvaluateBasis(dir.x, dir.y, dir.z, basis);
+
+	XMVECTOR sum = XMVectorZero();
+	for (int i = 0; i < SH_COEFFICIENT_COUNT; i++)
+		sum = XMVectorMultiplyAdd(XMLoadFloat3(&sh.Coefficients[i]), XMVectorReplicate(basis[i]), sum);
+
+	XMFLOAT3 result;
+	XMStoreFloat3(&result, sum);
+	return result;
+}
+
+void SphericalHarmonics::PackForShader(const SHColor& irradiance, float scale, XMFLOAT4 packed[SH_COEFFICIENT_COUNT])
+{
+	for (int i = 0; i < SH_COEFFICIENT_COUNT; i++)
+		XMStoreFloat4(&packed[i],
+			XMVectorScale(XMLoadFloat3(&irradiance.Coefficients[i]), basisScale[i] * scale / XM_PI));
+}
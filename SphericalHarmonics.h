@@ -0,0 +1,50 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include "BlockCompression.h"
+
+// Coefficients in the first three bands (l = 0, 1, 2)
+#define SH_COEFFICIENT_COUNT 9
+
+// --------------------------------------------------------
+// An RGB function over the sphere as 9 spherical harmonics
+// coefficients, in the usual order:
+//   (0,0), (1,-1), (1,0), (1,1), (2,-2), (2,-1), (2,0), (2,1), (2,2)
+// --------------------------------------------------------
+struct SHColor
+{
+	DirectX::XMFLOAT3 Coefficients[SH_COEFFICIENT_COUNT];
+};
+
+// --------------------------------------------------------
+// Ambient diffuse light from a cube map.  The sky's faces
+// are projected onto the first 9 SH basis functions once,
+// on the CPU, and the lit shader then gets the irradiance
+// for any normal from a 9 term polynomial instead of
+// convolving or sampling the cube map.  Three bands keep
+// irradiance to within a few percent of the real thing,
+// since the cosine lobe it's convolved with is so smooth.
+//
+// No graphics API, like the rest of the texture pipeline.
+// --------------------------------------------------------
+namespace SphericalHarmonics
+{
+	// Projects the radiance of a cube map, faces in D3D order
+	// (+X, -X, +Y, -Y, +Z, -Z) as sRGB RGBA8, onto SH.  Each
+	// texel is weighted by the solid angle it covers, and the
+	// faces' rows are split across threads.  Missing faces
+	// (null) are black.  Faces needn't share a size.
+	SHColor ProjectCubemap(const BlockImage* faces[6], unsigned int threadCount);
+
+	// Radiance to irradiance: convolves with the clamped cosine
+	// lobe, which only scales each band (by pi, 2pi/3, pi/4)
+	SHColor ConvolveIrradiance(const SHColor& radiance);
+
+	// Reconstructs the function in a direction (need not be unit length)
+	DirectX::XMFLOAT3 Evaluate(const SHColor& sh, DirectX::XMFLOAT3 direction);
+
+	// Folds the basis constants and the Lambert 1/pi into the
+	// coefficients of irradiance, so the shader's ambient term
+	// (see AmbientSH() in PBRFuncs.hlsli) is only multiply-adds
+	void PackForShader(const SHColor& irradiance, float scale, DirectX::XMFLOAT4 packed[SH_COEFFICIENT_COUNT]);
+}
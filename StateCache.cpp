@@ -0,0 +1,265 @@
+#include "StateCache.h"
+
+// --------------------------------------------------------
+// Constructor - Starts with nothing known about the context
+// --------------------------------------------------------
+StateCache::StateCache(std::shared_ptr<StateCacheBackend> backend) :
+	backend(backend)
+{
+	constantBufferOffsets = backend->SupportsConstantBufferOffsets();
+	Invalidate();
+	ResetStats();
+}
+
+// --------------------------------------------------------
+// Clears all tracked state.  Use after any code that talks
+// to the context directly (third party renderers, etc.)
+// --------------------------------------------------------
+void StateCache::Invalidate()
+{
+	// Null is a legitimate binding, so "unknown" needs a value
+	// that can never match anything a caller passes in
+	vertexShader = Unknown<ID3D11VertexShader>();
+	pixelShader = Unknown<ID3D11PixelShader>();
+	inputLayout = Unknown<ID3D11InputLayout>();
+	topology = 0; // D3D11_PRIMITIVE_TOPOLOGY_UNDEFINED
+
+	for (unsigned int i = 0; i < STATE_CACHE_VB_SLOTS; i++)
+	{
+		vertexBuffers[i] = Unknown<ID3D11Buffer>();
+		vertexStrides[i] = 0;
+		vertexOffsets[i] = 0;
+	}
+	indexBuffer = Unknown<ID3D11Buffer>();
+	indexFormat = 0; // DXGI_FORMAT_UNKNOWN
+	indexOffset = 0;
+
+	for (unsigned int i = 0; i < STATE_CACHE_CB_SLOTS; i++)
+	{
+		vsConstantBuffers[i] = Unknown<ID3D11Buffer>();
+		psConstantBuffers[i] = Unknown<ID3D11Buffer>();
+		vsConstantRanges[i][0] = vsConstantRanges[i][1] = 0;
+		psConstantRanges[i][0] = psConstantRanges[i][1] = 0;
+	}
+	for (unsigned int i = 0; i < STATE_CACHE_SRV_SLOTS; i++)
+	{
+		vsResources[i] = Unknown<ID3D11ShaderResourceView>();
+		psResources[i] = Unknown<ID3D11ShaderResourceView>();
+	}
+	for (unsigned int i = 0; i < STATE_CACHE_SAMPLER_SLOTS; i++)
+	{
+		vsSamplers[i] = Unknown<ID3D11SamplerState>();
+		psSamplers[i] = Unknown<ID3D11SamplerState>();
+	}
+
+	rasterizerState = Unknown<ID3D11RasterizerState>();
+	depthStencilState = Unknown<ID3D11DepthStencilState>();
+	stencilRef = 0;
+
+	// Unknown contents means the next unbind has to cover everything
+	psResourceHighWater = STATE_CACHE_SRV_SLOTS;
+}
+
+void StateCache::ResetStats()
+{
+	stats = {};
+}
+
+// --------------------------------------------------------
+// Helper that counts a bind and decides if it goes through
+// --------------------------------------------------------
+bool StateCache::Track(bool redundant)
+{
+	if (redundant)
+	{
+		stats.Skipped++;
+		return false;
+	}
+
+	stats.Issued++;
+	return true;
+}
+
+void StateCache::SetVertexShader(ID3D11VertexShader* shader)
+{
+	if (!Track(shader == vertexShader)) return;
+	vertexShader = shader;
+	backend->VSSetShader(shader);
+}
+
+void StateCache::SetPixelShader(ID3D11PixelShader* shader)
+{
+	if (!Track(shader == pixelShader)) return;
+	pixelShader = shader;
+	backend->PSSetShader(shader);
+}
+
+void StateCache::SetInputLayout(ID3D11InputLayout* layout)
+{
+	if (!Track(layout == inputLayout)) return;
+	inputLayout = layout;
+	backend->IASetInputLayout(layout);
+}
+
+void StateCache::SetPrimitiveTopology(unsigned int newTopology)
+{
+	if (!Track(newTopology == topology)) return;
+	topology = newTopology;
+	backend->IASetPrimitiveTopology(newTopology);
+}
+
+void StateCache::SetVertexBuffer(unsigned int slot, ID3D11Buffer* buffer, unsigned int stride, unsigned int offset)
+{
+	if (slot >= STATE_CACHE_VB_SLOTS) return;
+	bool redundant =
+		vertexBuffers[slot] == buffer &&
+		vertexStrides[slot] == stride &&
+		vertexOffsets[slot] == offset;
+	if (!Track(redundant)) return;
+
+	vertexBuffers[slot] = buffer;
+	vertexStrides[slot] = stride;
+	vertexOffsets[slot] = offset;
+	backend->IASetVertexBuffer(slot, buffer, stride, offset);
+}
+
+void StateCache::SetIndexBuffer(ID3D11Buffer* buffer, unsigned int format, unsigned int offset)
+{
+	bool redundant =
+		indexBuffer == buffer &&
+		indexFormat == format &&
+		indexOffset == offset;
+	if (!Track(redundant)) return;
+
+	indexBuffer = buffer;
+	indexFormat = format;
+	indexOffset = offset;
+	backend->IASetIndexBuffer(buffer, format, offset);
+}
+
+void StateCache::SetVSConstantBuffer(unsigned int slot, ID3D11Buffer* buffer)
+{
+	if (slot >= STATE_CACHE_CB_SLOTS) return;
+	bool redundant =
+		vsConstantBuffers[slot] == buffer &&
+		vsConstantRanges[slot][0] == 0 &&
+		vsConstantRanges[slot][1] == 0;
+	if (!Track(redundant)) return;
+
+	vsConstantBuffers[slot] = buffer;
+	vsConstantRanges[slot][0] = vsConstantRanges[slot][1] = 0;
+	backend->VSSetConstantBuffer(slot, buffer);
+}
+
+void StateCache::SetPSConstantBuffer(unsigned int slot, ID3D11Buffer* buffer)
+{
+	if (slot >= STATE_CACHE_CB_SLOTS) return;
+	bool redundant =
+		psConstantBuffers[slot] == buffer &&
+		psConstantRanges[slot][0] == 0 &&
+		psConstantRanges[slot][1] == 0;
+	if (!Track(redundant)) return;
+
+	psConstantBuffers[slot] = buffer;
+	psConstantRanges[slot][0] = psConstantRanges[slot][1] = 0;
+	backend->PSSetConstantBuffer(slot, buffer);
+}
+
+// --------------------------------------------------------
+// Binds a window of a larger buffer, measured in 16-byte
+// constants (D3D 11.1).  Many objects can share one buffer
+// this way, so only the offsets change between draws.
+// --------------------------------------------------------
+void StateCache::SetVSConstantBuffer1(unsigned int slot, ID3D11Buffer* buffer, unsigned int firstConstant, unsigned int numConstants)
+{
+	if (slot >= STATE_CACHE_CB_SLOTS || !constantBufferOffsets) return;
+	bool redundant =
+		vsConstantBuffers[slot] == buffer &&
+		vsConstantRanges[slot][0] == firstConstant &&
+		vsConstantRanges[slot][1] == numConstants;
+	if (!Track(redundant)) return;
+
+	vsConstantBuffers[slot] = buffer;
+	vsConstantRanges[slot][0] = firstConstant;
+	vsConstantRanges[slot][1] = numConstants;
+	backend->VSSetConstantBuffer1(slot, buffer, firstConstant, numConstants);
+}
+
+void StateCache::SetPSConstantBuffer1(unsigned int slot, ID3D11Buffer* buffer, unsigned int firstConstant, unsigned int numConstants)
+{
+	if (slot >= STATE_CACHE_CB_SLOTS || !constantBufferOffsets) return;
+	bool redundant =
+		psConstantBuffers[slot] == buffer &&
+		psConstantRanges[slot][0] == firstConstant &&
+		psConstantRanges[slot][1] == numConstants;
+	if (!Track(redundant)) return;
+
+	psConstantBuffers[slot] = buffer;
+	psConstantRanges[slot][0] = firstConstant;
+	psConstantRanges[slot][1] = numConstants;
+	backend->PSSetConstantBuffer1(slot, buffer, firstConstant, numConstants);
+}
+
+void StateCache::SetVSShaderResource(unsigned int slot, ID3D11ShaderResourceView* srv)
+{
+	if (slot >= STATE_CACHE_SRV_SLOTS) return;
+	if (!Track(vsResources[slot] == srv)) return;
+	vsResources[slot] = srv;
+	backend->VSSetShaderResources(slot, 1, &srv);
+}
+
+void StateCache::SetPSShaderResource(unsigned int slot, ID3D11ShaderResourceView* srv)
+{
+	if (slot >= STATE_CACHE_SRV_SLOTS) return;
+	if (!Track(psResources[slot] == srv)) return;
+	psResources[slot] = srv;
+	backend->PSSetShaderResources(slot, 1, &srv);
+	if (slot >= psResourceHighWater) psResourceHighWater = slot + 1;
+}
+
+void StateCache::SetVSSampler(unsigned int slot, ID3D11SamplerState* sampler)
+{
+	if (slot >= STATE_CACHE_SAMPLER_SLOTS) return;
+	if (!Track(vsSamplers[slot] == sampler)) return;
+	vsSamplers[slot] = sampler;
+	backend->VSSetSampler(slot, sampler);
+}
+
+void StateCache::SetPSSampler(unsigned int slot, ID3D11SamplerState* sampler)
+{
+	if (slot >= STATE_CACHE_SAMPLER_SLOTS) return;
+	if (!Track(psSamplers[slot] == sampler)) return;
+	psSamplers[slot] = sampler;
+	backend->PSSetSampler(slot, sampler);
+}
+
+// --------------------------------------------------------
+// Unbinds every pixel shader resource, which is needed before
+// a texture that was being sampled becomes a render target.
+// Only the range that could actually hold something is cleared.
+// --------------------------------------------------------
+void StateCache::UnbindPSShaderResources()
+{
+	if (!Track(psResourceHighWater == 0)) return;
+
+	ID3D11ShaderResourceView* nullSRVs[STATE_CACHE_SRV_SLOTS] = {};
+	backend->PSSetShaderResources(0, psResourceHighWater, nullSRVs);
+	for (unsigned int i = 0; i < STATE_CACHE_SRV_SLOTS; i++)
+		psResources[i] = 0;
+	psResourceHighWater = 0;
+}
+
+void StateCache::SetRasterizerState(ID3D11RasterizerState* state)
+{
+	if (!Track(rasterizerState == state)) return;
+	rasterizerState = state;
+	backend->RSSetState(state);
+}
+
+void StateCache::SetDepthStencilState(ID3D11DepthStencilState* state, unsigned int newStencilRef)
+{
+	if (!Track(depthStencilState == state && stencilRef == newStencilRef)) return;
+	depthStencilState = state;
+	stencilRef = newStencilRef;
+	backend->OMSetDepthStencilState(state, newStencilRef);
+}
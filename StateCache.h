@@ -0,0 +1,154 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+
+// Only pointers to these are stored, so d3d11.h isn't needed
+// here, and the cache builds (and is tested) without it
+struct ID3D11VertexShader;
+struct ID3D11PixelShader;
+struct ID3D11InputLayout;
+struct ID3D11Buffer;
+struct ID3D11ShaderResourceView;
+struct ID3D11SamplerState;
+struct ID3D11RasterizerState;
+struct ID3D11DepthStencilState;
+
+// Number of slots tracked for each shader stage and the input
+// assembler (the D3D11_COMMONSHADER_*_COUNT and
+// D3D11_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT values)
+#define STATE_CACHE_CB_SLOTS		14
+#define STATE_CACHE_SRV_SLOTS		128
+#define STATE_CACHE_SAMPLER_SLOTS	16
+#define STATE_CACHE_VB_SLOTS		32
+
+// --------------------------------------------------------
+// Counts of API calls that were actually sent to the
+// context versus ones that were filtered out as redundant
+// --------------------------------------------------------
+struct StateCacheStats
+{
+	unsigned int Issued;
+	unsigned int Skipped;
+};
+
+// --------------------------------------------------------
+// Where the cache sends the binds it doesn't skip: the
+// device context when drawing (see D3D11StateCacheBackend),
+// or something that records them when testing.  Topologies
+// and formats are the D3D11 enum values.
+// --------------------------------------------------------
+class StateCacheBackend
+{
+public:
+	virtual ~StateCacheBackend() {}
+
+	// Whether the *SetConstantBuffers1() calls are available (D3D 11.1)
+	virtual bool SupportsConstantBufferOffsets() = 0;
+
+	virtual void VSSetShader(ID3D11VertexShader* shader) = 0;
+	virtual void PSSetShader(ID3D11PixelShader* shader) = 0;
+	virtual void IASetInputLayout(ID3D11InputLayout* layout) = 0;
+	virtual void IASetPrimitiveTopology(unsigned int topology) = 0;
+	virtual void IASetVertexBuffer(unsigned int slot, ID3D11Buffer* buffer, unsigned int stride, unsigned int offset) = 0;
+	virtual void IASetIndexBuffer(ID3D11Buffer* buffer, unsigned int format, unsigned int offset) = 0;
+
+	virtual void VSSetConstantBuffer(unsigned int slot, ID3D11Buffer* buffer) = 0;
+	virtual void PSSetConstantBuffer(unsigned int slot, ID3D11Buffer* buffer) = 0;
+	virtual void VSSetConstantBuffer1(unsigned int slot, ID3D11Buffer* buffer, unsigned int firstConstant, unsigned int numConstants) = 0;
+	virtual void PSSetConstantBuffer1(unsigned int slot, ID3D11Buffer* buffer, unsigned int firstConstant, unsigned int numConstants) = 0;
+	virtual void VSSetShaderResources(unsigned int startSlot, unsigned int count, ID3D11ShaderResourceView* const* srvs) = 0;
+	virtual void PSSetShaderResources(unsigned int startSlot, unsigned int count, ID3D11ShaderResourceView* const* srvs) = 0;
+	virtual void VSSetSampler(unsigned int slot, ID3D11SamplerState* sampler) = 0;
+	virtual void PSSetSampler(unsigned int slot, ID3D11SamplerState* sampler) = 0;
+
+	virtual void RSSetState(ID3D11RasterizerState* state) = 0;
+	virtual void OMSetDepthStencilState(ID3D11DepthStencilState* state, unsigned int stencilRef) = 0;
+};
+
+// --------------------------------------------------------
+// Sits between the engine and the device context and
+// remembers what is currently bound, so binding the same
+// object to the same slot twice costs no API call.
+//
+// Only raw pointers are stored: the context holds its own
+// reference to anything bound, so a tracked pointer can't
+// be freed (and its address reused) while it's still bound.
+//
+// Anything that changes state behind the cache's back
+// must call Invalidate() afterwards.
+// --------------------------------------------------------
+class StateCache
+{
+public:
+	StateCache(std::shared_ptr<StateCacheBackend> backend);
+
+	// Shaders and input assembler
+	void SetVertexShader(ID3D11VertexShader* shader);
+	void SetPixelShader(ID3D11PixelShader* shader);
+	void SetInputLayout(ID3D11InputLayout* layout);
+	void SetPrimitiveTopology(unsigned int topology);
+	void SetVertexBuffer(unsigned int slot, ID3D11Buffer* buffer, unsigned int stride, unsigned int offset);
+	void SetIndexBuffer(ID3D11Buffer* buffer, unsigned int format, unsigned int offset);
+
+	// Per-stage resources
+	void SetVSConstantBuffer(unsigned int slot, ID3D11Buffer* buffer);
+	void SetPSConstantBuffer(unsigned int slot, ID3D11Buffer* buffer);
+	void SetVSConstantBuffer1(unsigned int slot, ID3D11Buffer* buffer, unsigned int firstConstant, unsigned int numConstants);
+	void SetPSConstantBuffer1(unsigned int slot, ID3D11Buffer* buffer, unsigned int firstConstant, unsigned int numConstants);
+	void SetVSShaderResource(unsigned int slot, ID3D11ShaderResourceView* srv);
+	void SetPSShaderResource(unsigned int slot, ID3D11ShaderResourceView* srv);
+	void SetVSSampler(unsigned int slot, ID3D11SamplerState* sampler);
+	void SetPSSampler(unsigned int slot, ID3D11SamplerState* sampler);
+	void UnbindPSShaderResources();
+
+	// Fixed function states
+	void SetRasterizerState(ID3D11RasterizerState* state);
+	void SetDepthStencilState(ID3D11DepthStencilState* state, unsigned int stencilRef);
+
+	// Forget everything, forcing the next bind of each slot through
+	void Invalidate();
+
+	// Statistics
+	StateCacheStats GetStats() { return stats; }
+	void ResetStats();
+
+private:
+	std::shared_ptr<StateCacheBackend> backend;
+	bool constantBufferOffsets;
+	StateCacheStats stats;
+
+	ID3D11VertexShader* vertexShader;
+	ID3D11PixelShader* pixelShader;
+	ID3D11InputLayout* inputLayout;
+	unsigned int topology;
+
+	ID3D11Buffer* vertexBuffers[STATE_CACHE_VB_SLOTS];
+	unsigned int vertexStrides[STATE_CACHE_VB_SLOTS];
+	unsigned int vertexOffsets[STATE_CACHE_VB_SLOTS];
+	ID3D11Buffer* indexBuffer;
+	unsigned int indexFormat;
+	unsigned int indexOffset;
+
+	ID3D11Buffer* vsConstantBuffers[STATE_CACHE_CB_SLOTS];
+	ID3D11Buffer* psConstantBuffers[STATE_CACHE_CB_SLOTS];
+	unsigned int vsConstantRanges[STATE_CACHE_CB_SLOTS][2]; // First & count, zeros for the whole buffer
+	unsigned int psConstantRanges[STATE_CACHE_CB_SLOTS][2];
+	ID3D11ShaderResourceView* vsResources[STATE_CACHE_SRV_SLOTS];
+	ID3D11ShaderResourceView* psResources[STATE_CACHE_SRV_SLOTS];
+	ID3D11SamplerState* vsSamplers[STATE_CACHE_SAMPLER_SLOTS];
+	ID3D11SamplerState* psSamplers[STATE_CACHE_SAMPLER_SLOTS];
+
+	ID3D11RasterizerState* rasterizerState;
+	ID3D11DepthStencilState* depthStencilState;
+	unsigned int stencilRef;
+
+	// Highest PS resource slot bound since the last unbind, +1
+	unsigned int psResourceHighWater;
+
+	// Records the outcome of a bind and returns whether it must be issued
+	bool Track(bool redundant);
+
+	// Placeholder for "not known", which forces the next bind through
+	template<typename T> static T* Unknown() { return reinterpret_cast<T*>(~(uintptr_t)0); }
+};
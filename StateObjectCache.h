@@ -0,0 +1,184 @@
+#pragma once
+
+#include <cstring>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+// --------------------------------------------------------
+// Lookups that found an existing object versus ones that
+// had to create a new one
+// --------------------------------------------------------
+struct StateObjectCacheStats
+{
+	unsigned int Hits;
+	unsigned int Misses;
+};
+
+// --------------------------------------------------------
+// Hands out one shared object per unique description, so
+// asking twice for the same state returns the same object.
+//
+// Descriptions are compared byte for byte, so they must be
+// plain structs with any padding zeroed by the caller.
+// Objects are created through a callback, which keeps this
+// free of any graphics API (a stand-in works for testing).
+//
+// Objects are never evicted: the cache owns them until it
+// is destroyed or cleared.
+// --------------------------------------------------------
+template<typename Desc, typename Object>
+class StateObjectCache
+{
+public:
+	typedef std::function<Object(const Desc&)> CreateFunction;
+
+	StateObjectCache(CreateFunction create) : create(create), stats{} { }
+
+	// Returns the cached object for desc, creating it on the first request
+	Object Get(const Desc& desc)
+	{
+		unsigned long long hash = Hash(desc);
+
+		// Different descriptions may share a hash, so confirm the bytes
+		auto range = lookup.equal_range(hash);
+		for (auto it = range.first; it != range.second; it++)
+		{
+			const Entry& entry = entries[it->second];
+			if (memcmp(&entry.Description, &desc, sizeof(Desc)) == 0)
+			{
+				stats.Hits++;
+				return entry.Value;
+			}
+		}
+
+		// Don't remember failures, so a later request can try again
+		stats.Misses++;
+		Object object = create(desc);
+		if (!object)
+			return object;
+
+		lookup.emplace(hash, (unsigned int)entries.size());
+		entries.push_back({ desc, object });
+		return object;
+	}
+
+	// FNV-1a over the raw bytes of the description
+	static unsigned long long Hash(const Desc& desc)
+	{
+		const unsigned char* bytes = (const unsigned char*)&desc;
+		unsigned long long hash = 14695981039346656037ull;
+		for (size_t i = 0; i < sizeof(Desc); i++)
+		{
+			hash ^= bytes[i];
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+	void Clear()
+	{
+		entries.clear();
+		lookup.clear();
+		stats = {};
+	}
+
+	unsigned int GetCount() const { return (unsigned int)entries.size(); }
+	StateObjectCacheStats GetStats() const { return stats; }
+
+private:
+	struct Entry
+	{
+		Desc Description;
+		Object Value;
+	};
+
+	CreateFunction create;
+	std::vector<Entry> entries;
+	std::unordered_multimap<unsigned long long, unsigned int> lookup; // Hash to index in entries
+	StateObjectCacheStats stats;
+};
+
+// Width of each field in a pipeline key, highest bits first
+#define PIPELINE_KEY_VS_BITS		12
+#define PIPELINE_KEY_PS_BITS		12
+#define PIPELINE_KEY_LAYOUT_BITS	8
+#define PIPELINE_KEY_RASTER_BITS	8
+#define PIPELINE_KEY_DEPTH_BITS		8
+#define PIPELINE_KEY_USER_BITS		16
+
+// --------------------------------------------------------
+// Turns object pointers into small ids that fit a pipeline
+// key.  Ids start at 1, with 0 reserved for null.  Once a
+// field runs out of ids the last one is shared, which only
+// makes sorting less precise.
+// --------------------------------------------------------
+class PipelineIdTable
+{
+public:
+	PipelineIdTable(unsigned int bits) : maxId((1u << bits) - 1) { }
+
+	unsigned int GetId(const void* object)
+	{
+		if (!object)
+			return 0;
+
+		auto it = ids.find(object);
+		if (it != ids.end())
+			return it->second;
+
+		unsigned int id = (unsigned int)ids.size() + 1;
+		if (id > maxId) id = maxId;
+		ids.emplace(object, id);
+		return id;
+	}
+
+private:
+	unsigned int maxId;
+	std::unordered_map<const void*, unsigned int> ids;
+};
+
+// --------------------------------------------------------
+// Packs everything that makes up a pipeline into one number
+// so draws can be sorted to minimize state changes.  Shaders
+// occupy the highest bits since they're the costliest to
+// switch, and the low bits are left for the caller (usually
+// a material id) to break ties.
+// --------------------------------------------------------
+class PipelineKeyBuilder
+{
+public:
+	PipelineKeyBuilder() :
+		vsIds(PIPELINE_KEY_VS_BITS),
+		psIds(PIPELINE_KEY_PS_BITS),
+		layoutIds(PIPELINE_KEY_LAYOUT_BITS),
+		rasterIds(PIPELINE_KEY_RASTER_BITS),
+		depthIds(PIPELINE_KEY_DEPTH_BITS),
+		userIds(PIPELINE_KEY_USER_BITS)
+	{ }
+
+	unsigned long long MakeKey(
+		const void* vs,
+		const void* ps,
+		const void* layout,
+		const void* rasterizer,
+		const void* depthStencil,
+		const void* user = 0)
+	{
+		unsigned long long key = vsIds.GetId(vs);
+		key = (key << PIPELINE_KEY_PS_BITS) | psIds.GetId(ps);
+		key = (key << PIPELINE_KEY_LAYOUT_BITS) | layoutIds.GetId(layout);
+		key = (key << PIPELINE_KEY_RASTER_BITS) | rasterIds.GetId(rasterizer);
+		key = (key << PIPELINE_KEY_DEPTH_BITS) | depthIds.GetId(depthStencil);
+		key = (key << PIPELINE_KEY_USER_BITS) | userIds.GetId(user);
+		return key;
+	}
+
+private:
+	PipelineIdTable vsIds;
+	PipelineIdTable psIds;
+	PipelineIdTable layoutIds;
+	PipelineIdTable rasterIds;
+	PipelineIdTable depthIds;
+	PipelineIdTable userIds;
+};
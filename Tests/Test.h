@@ -0,0 +1,52 @@
+#pragma once
+
+// --------------------------------------------------------
+// Bare minimum for the checks in this folder: each test is
+// its own executable, counts failed CHECKs as it goes and
+// returns TestResult() from main(), which CTest reads as
+// pass (0) or fail.
+// --------------------------------------------------------
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+
+inline int& TestFailures()
+{
+	static int failures = 0;
+	return failures;
+}
+
+#define CHECK(condition) \
+	do { if (!(condition)) { std::printf("%s(%d): CHECK(%s) failed\n", __FILE__, __LINE__, #condition); TestFailures()++; } } while (0)
+
+#define CHECK_NEAR(a, b, tolerance) \
+	do { double checkA = (a), checkB = (b); if (!(std::fabs(checkA - checkB) <= (tolerance))) { \
+		std::printf("%s(%d): CHECK_NEAR(%s, %s) failed: %g vs %g\n", __FILE__, __LINE__, #a, #b, checkA, checkB); \
+		TestFailures()++; } } while (0)
+
+inline int TestResult()
+{
+	if (TestFailures())
+		std::printf("%d check(s) failed\n", TestFailures());
+	else
+		std::printf("All checks passed\n");
+	return TestFailures() ? 1 : 0;
+}
+
+// --------------------------------------------------------
+// Wall clock time for the benchmarks, which only report
+// their numbers; timings never fail a test
+// --------------------------------------------------------
+class TestTimer
+{
+public:
+	TestTimer() : start(std::chrono::steady_clock::now()) {}
+
+	double Seconds() const
+	{
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+
+private:
+	std::chrono::steady_clock::time_point start;
+};
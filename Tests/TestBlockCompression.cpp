@@ -0,0 +1,365 @@
+// --------------------------------------------------------
+// BlockCompression: decodes what the encoder wrote and
+// checks the error per format, checks the SIMD loops give
+// the same blocks as the plain ones, plus encode throughput
+// --------------------------------------------------------
+#include "BlockCompression.h"
+#include "Test.h"
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <vector>
+
+// The same encoder built with BLOCK_COMPRESSION_NO_SIMD, under
+// another name (see CMakeLists.txt)
+namespace BlockCompressionScalar
+{
+	std::vector<unsigned char> CompressImage(BlockCompressionFormat format, const BlockImage& image, unsigned int threadCount);
+}
+
+namespace
+{
+	// --------------------------------------------------------
+	// Reference decoders, straight from the format specs, for
+	// just the parts the encoder writes
+	// --------------------------------------------------------
+	unsigned int ReadBits(const unsigned char* block, unsigned int& pos, unsigned int count)
+	{
+		unsigned int value = 0;
+		for (unsigned int i = 0; i < count; i++, pos++)
+			value |= ((block[pos >> 3] >> (pos & 7)) & 1u) << i;
+		return value;
+	}
+
+	void Unpack565(unsigned int color, int rgb[3])
+	{
+		int r = (color >> 11) & 31, g = (color >> 5) & 63, b = color & 31;
+		rgb[0] = (r << 3) | (r >> 2);
+		rgb[1] = (g << 2) | (g >> 4);
+		rgb[2] = (b << 3) | (b >> 2);
+	}
+
+	void DecodeBC1(const unsigned char* block, unsigned char pixels[64])
+	{
+		unsigned int c0 = block[0] | block[1] << 8;
+		unsigned int c1 = block[2] | block[3] << 8;
+		int palette[4][3];
+		Unpack565(c0, palette[0]);
+		Unpack565(c1, palette[1]);
+		for (int c = 0; c < 3; c++)
+		{
+			if (c0 > c1)
+			{
+				palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+				palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+			}
+			else
+			{
+				palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+				palette[3][c] = 0;
+			}
+		}
+
+		unsigned int pos = 32;
+		for (int i = 0; i < 16; i++)
+		{
+			unsigned int index = ReadBits(block, pos, 2);
+			for (int c = 0; c < 3; c++)
+				pixels[i * 4 + c] = (unsigned char)palette[index][c];
+			pixels[i * 4 + 3] = 255;
+		}
+	}
+
+	void DecodeBC4(const unsigned char* block, unsigned char pixels[64], int channel)
+	{
+		int r0 = block[0], r1 = block[1];
+		int palette[8] = { r0, r1 };
+		if (r0 > r1)
+		{
+			for (int i = 2; i < 8; i++)
+				palette[i] = ((8 - i) * r0 + (i - 1) * r1) / 7;
+		}
+		else
+		{
+			for (int i = 2; i < 6; i++)
+				palette[i] = ((6 - i) * r0 + (i - 1) * r1) / 5;
+			palette[6] = 0;
+			palette[7] = 255;
+		}
+
+		unsigned int pos = 16;
+		for (int i = 0; i < 16; i++)
+			pixels[i * 4 + channel] = (unsigned char)palette[ReadBits(block, pos, 3)];
+	}
+
+	// Mode 6 only; any other mode fails the check
+	void DecodeBC7(const unsigned char* block, unsigned char pixels[64])
+	{
+		unsigned int pos = 0;
+		CHECK(ReadBits(block, pos, 7) == 64);
+
+		int endpoints[2][4];
+		for (int c = 0; c < 4; c++)
+		{
+			endpoints[0][c] = ReadBits(block, pos, 7);
+			endpoints[1][c] = ReadBits(block, pos, 7);
+		}
+		int p0 = ReadBits(block, pos, 1), p1 = ReadBits(block, pos, 1);
+		for (int c = 0; c < 4; c++)
+		{
+			endpoints[0][c] = endpoints[0][c] << 1 | p0;
+			endpoints[1][c] = endpoints[1][c] << 1 | p1;
+		}
+
+		static const int weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+		for (int i = 0; i < 16; i++)
+		{
+			unsigned int index = ReadBits(block, pos, i == 0 ? 3 : 4);
+			for (int c = 0; c < 4; c++)
+				pixels[i * 4 + c] = (unsigned char)(((64 - weights[index]) * endpoints[0][c] + weights[index] * endpoints[1][c] + 32) >> 6);
+		}
+		CHECK(pos == 128);
+	}
+
+	int ChannelCount(BlockCompressionFormat format)
+	{
+		switch (format)
+		{
+		case BLOCK_COMPRESSION_BC1: return 3;
+		case BLOCK_COMPRESSION_BC4: return 1;
+		case BLOCK_COMPRESSION_BC5: return 2;
+		default: return 4;
+		}
+	}
+
+	// --------------------------------------------------------
+	// Peak signal to noise ratio of the decoded image over the
+	// channels the format keeps, in dB
+	// --------------------------------------------------------
+	double PSNR(BlockCompressionFormat format, const BlockImage& image, const std::vector<unsigned char>& blocks)
+	{
+		unsigned int blocksWide = (image.Width + 3) / 4;
+		unsigned int blocksHigh = (image.Height + 3) / 4;
+		unsigned int blockBytes = BlockCompression::GetBlockBytes(format);
+		int channels = ChannelCount(format);
+
+		double squaredError = 0;
+		size_t samples = 0;
+		for (unsigned int by = 0; by < blocksHigh; by++)
+		{
+			for (unsigned int bx = 0; bx < blocksWide; bx++)
+			{
+				const unsigned char* block = &blocks[(by * blocksWide + bx) * blockBytes];
+				unsigned char decoded[64] = {};
+				switch (format)
+				{
+				case BLOCK_COMPRESSION_BC1: DecodeBC1(block, decoded); break;
+				case BLOCK_COMPRESSION_BC4: DecodeBC4(block, decoded, 0); break;
+				case BLOCK_COMPRESSION_BC5: DecodeBC4(block, decoded, 0); DecodeBC4(block + 8, decoded, 1); break;
+				case BLOCK_COMPRESSION_BC7: DecodeBC7(block, decoded); break;
+				}
+
+				// Pixels past the edges of the image don't count
+				for (unsigned int i = 0; i < 16; i++)
+				{
+					unsigned int x = bx * 4 + i % 4;
+					unsigned int y = by * 4 + i / 4;
+					if (x >= image.Width || y >= image.Height)
+						continue;
+
+					for (int c = 0; c < channels; c++)
+					{
+						double difference = (double)decoded[i * 4 + c] - image.Pixels[(y * image.Width + x) * 4 + c];
+						squaredError += difference * difference;
+						samples++;
+					}
+				}
+			}
+		}
+
+		if (squaredError == 0)
+			return 100.0;
+		return 10.0 * std::log10(255.0 * 255.0 * samples / squaredError);
+	}
+
+	// Smooth gradients in every channel, like most albedo & roughness maps
+	BlockImage MakeGradient(unsigned int width, unsigned int height)
+	{
+		BlockImage image = { width, height, std::vector<unsigned char>(width * height * 4) };
+		for (unsigned int y = 0; y < height; y++)
+		{
+			for (unsigned int x = 0; x < width; x++)
+			{
+				unsigned char* pixel = &image.Pixels[(y * width + x) * 4];
+				pixel[0] = (unsigned char)(x * 255 / (width - 1));
+				pixel[1] = (unsigned char)(y * 255 / (height - 1));
+				pixel[2] = (unsigned char)((x + y) * 255 / (width + height - 2));
+				pixel[3] = (unsigned char)(255 - x * 128 / width);
+			}
+		}
+		return image;
+	}
+
+	// Gradients with some per-pixel noise on top, closer to a photo
+	BlockImage MakeNoisy(unsigned int width, unsigned int height)
+	{
+		BlockImage image = MakeGradient(width, height);
+		std::srand(1234);
+		for (unsigned char& value : image.Pixels)
+			value = (unsigned char)std::min(255, std::max(0, value + std::rand() % 17 - 8));
+		return image;
+	}
+
+	void TestQuality()
+	{
+		// Lower bounds a little under what the encoder reaches now,
+		// so a regression in the fit shows up as a failure
+		struct Case { BlockCompressionFormat Format; const char* Name; double Gradient; double Noisy; };
+		const Case cases[] =
+		{
+			{ BLOCK_COMPRESSION_BC1, "BC1", 43.0, 34.0 },
+			{ BLOCK_COMPRESSION_BC4, "BC4", 60.0, 48.0 },
+			{ BLOCK_COMPRESSION_BC5, "BC5", 60.0, 48.0 },
+			{ BLOCK_COMPRESSION_BC7, "BC7", 48.0, 35.0 },
+		};
+
+		BlockImage gradient = MakeGradient(256, 256);
+		BlockImage noisy = MakeNoisy(256, 256);
+		for (const Case& c : cases)
+		{
+			std::vector<unsigned char> blocks = BlockCompression::CompressImage(c.Format, gradient, 4);
+			CHECK(blocks.size() == BlockCompression::GetCompressedSize(c.Format, 256, 256));
+			double gradientPSNR = PSNR(c.Format, gradient, blocks);
+
+			blocks = BlockCompression::CompressImage(c.Format, noisy, 4);
+			double noisyPSNR = PSNR(c.Format, noisy, blocks);
+
+			std::printf("%s: gradient %.2f dB, noisy %.2f dB\n", c.Name, gradientPSNR, noisyPSNR);
+			CHECK(gradientPSNR >= c.Gradient);
+			CHECK(noisyPSNR >= c.Noisy);
+		}
+
+		// A flat block comes back exactly
+		unsigned char flat[64];
+		for (int i = 0; i < 16; i++)
+		{
+			flat[i * 4 + 0] = 200;
+			flat[i * 4 + 1] = 100;
+			flat[i * 4 + 2] = 50;
+			flat[i * 4 + 3] = 255;
+		}
+		unsigned char block[16] = {};
+		unsigned char decoded[64] = {};
+		BlockCompression::CompressBlock(BLOCK_COMPRESSION_BC4, flat, block);
+		DecodeBC4(block, decoded, 0);
+		CHECK(decoded[0] == 200 && decoded[60] == 200);
+		BlockCompression::CompressBlock(BLOCK_COMPRESSION_BC7, flat, block);
+		DecodeBC7(block, decoded);
+		CHECK(decoded[4] == 200 && decoded[5] == 100 && decoded[6] == 50);
+		CHECK(decoded[7] >= 254); // The P bit is shared, so 255 can be off by one
+	}
+
+	void TestPartialBlocks()
+	{
+		// Sizes that aren't multiples of 4 round up to whole blocks
+		CHECK(BlockCompression::GetCompressedSize(BLOCK_COMPRESSION_BC1, 3, 5) == 8 * 2);
+		CHECK(BlockCompression::GetCompressedSize(BLOCK_COMPRESSION_BC7, 3, 5) == 16 * 2);
+		CHECK(BlockCompression::GetCompressedSize(BLOCK_COMPRESSION_BC5, 1, 1) == 16);
+
+		// ...and encode the same as the image with its edges repeated
+		BlockImage odd = MakeNoisy(13, 7);
+		BlockImage padded = { 16, 8, std::vector<unsigned char>(16 * 8 * 4) };
+		for (unsigned int y = 0; y < 8; y++)
+			for (unsigned int x = 0; x < 16; x++)
+				for (unsigned int c = 0; c < 4; c++)
+					padded.Pixels[(y * 16 + x) * 4 + c] = odd.Pixels[(std::min(y, 6u) * 13 + std::min(x, 12u)) * 4 + c];
+
+		std::vector<unsigned char> blocks = BlockCompression::CompressImage(BLOCK_COMPRESSION_BC7, odd, 3);
+		CHECK(blocks.size() == BlockCompression::GetCompressedSize(BLOCK_COMPRESSION_BC7, 13, 7));
+		CHECK(blocks == BlockCompression::CompressImage(BLOCK_COMPRESSION_BC7, padded, 1));
+
+		// More threads than rows of blocks
+		BlockImage tiny = MakeGradient(2, 2);
+		CHECK(BlockCompression::CompressImage(BLOCK_COMPRESSION_BC1, tiny, 8).size() == 8);
+	}
+
+	void TestDDS()
+	{
+		std::filesystem::path path = std::filesystem::temp_directory_path() / "TestBlockCompression.dds";
+
+		std::vector<std::vector<unsigned char>> mips;
+		mips.push_back(std::vector<unsigned char>(BlockCompression::GetCompressedSize(BLOCK_COMPRESSION_BC5, 64, 32), 1));
+		mips.push_back(std::vector<unsigned char>(BlockCompression::GetCompressedSize(BLOCK_COMPRESSION_BC5, 32, 16), 2));
+		mips.push_back(std::vector<unsigned char>(BlockCompression::GetCompressedSize(BLOCK_COMPRESSION_BC5, 16, 8), 3));
+		CHECK(BlockCompression::SaveDDS(path, BLOCK_COMPRESSION_BC5, 64, 32, mips));
+
+		BlockDDSLayout layout = {};
+		CHECK(BlockCompression::ReadDDSLayout(path, &layout));
+		CHECK(layout.Format == BLOCK_COMPRESSION_BC5);
+		CHECK(layout.Width == 64 && layout.Height == 32);
+		CHECK(layout.MipLevels == 3);
+		CHECK(layout.MipOffsets.size() == 3);
+		if (layout.MipOffsets.size() == 3)
+		{
+			CHECK(layout.MipOffsets[1] - layout.MipOffsets[0] == mips[0].size());
+			CHECK(layout.MipOffsets[2] - layout.MipOffsets[1] == mips[1].size());
+			CHECK(std::filesystem::file_size(path) == layout.MipOffsets[2] + mips[2].size());
+		}
+
+		std::filesystem::remove(path);
+		CHECK(!BlockCompression::ReadDDSLayout(path, &layout));
+	}
+
+	void TestSIMD()
+	{
+		// Same sums in the same order, so not a bit may differ
+		BlockImage gradient = MakeGradient(128, 64);
+		BlockImage noisy = MakeNoisy(128, 64);
+		BlockImage flat = { 8, 8, std::vector<unsigned char>(8 * 8 * 4, 77) };
+		for (BlockCompressionFormat format : { BLOCK_COMPRESSION_BC1, BLOCK_COMPRESSION_BC4, BLOCK_COMPRESSION_BC5, BLOCK_COMPRESSION_BC7 })
+		{
+			for (const BlockImage* image : { &gradient, &noisy, &flat })
+				CHECK(BlockCompression::CompressImage(format, *image, 2) == BlockCompressionScalar::CompressImage(format, *image, 2));
+		}
+	}
+
+	void BenchmarkEncode()
+	{
+		BlockImage image = MakeNoisy(1024, 1024);
+		const BlockCompressionFormat formats[] = { BLOCK_COMPRESSION_BC1, BLOCK_COMPRESSION_BC4, BLOCK_COMPRESSION_BC5, BLOCK_COMPRESSION_BC7 };
+		const char* names[] = { "BC1", "BC4", "BC5", "BC7" };
+		for (int i = 0; i < 4; i++)
+		{
+			TestTimer timer;
+			std::vector<unsigned char> blocks = BlockCompression::CompressImage(formats[i], image, 4);
+			double seconds = timer.Seconds();
+			CHECK(!blocks.empty());
+			std::printf("%s encode, 4 threads: %.1f ms for 1024x1024, %.1f M pixels/s\n",
+				names[i], seconds * 1000.0, image.Width * image.Height / seconds / 1e6);
+		}
+
+		// One thread each, so the SIMD speedup isn't lost in the
+		// threads' scheduling
+		for (int i = 0; i < 4; i++)
+		{
+			TestTimer scalarTimer;
+			std::vector<unsigned char> blocks = BlockCompressionScalar::CompressImage(formats[i], image, 1);
+			double scalarSeconds = scalarTimer.Seconds();
+			TestTimer timer;
+			CHECK(BlockCompression::CompressImage(formats[i], image, 1) == blocks);
+			double seconds = timer.Seconds();
+			std::printf("%s encode, 1 thread: %.1f ms plain, %.1f ms SIMD, %.2fx\n",
+				names[i], scalarSeconds * 1000.0, seconds * 1000.0, scalarSeconds / seconds);
+		}
+	}
+}
+
+int main()
+{
+	TestQuality();
+	TestPartialBlocks();
+	TestDDS();
+	TestSIMD();
+	BenchmarkEncode();
+	return TestResult();
+}
@@ -0,0 +1,201 @@
+// --------------------------------------------------------
+// ChannelPacker: which lane each source lands in, defaults
+// for missing maps, stretching small maps bilinearly (as
+// the scene's 128x128 metalness maps are) and reading the
+// manifest
+// --------------------------------------------------------
+#include "ChannelPacker.h"
+#include "PNGDecoder.h"
+#include "Test.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+
+namespace
+{
+	// Every pixel the same, with other values in the lanes that
+	// should be ignored
+	BlockImage MakeFlat(unsigned int width, unsigned int height, unsigned char red)
+	{
+		BlockImage image = { width, height, std::vector<unsigned char>((size_t)width * height * 4) };
+		for (size_t i = 0; i < image.Pixels.size(); i += 4)
+		{
+			image.Pixels[i + 0] = red;
+			image.Pixels[i + 1] = 17;
+			image.Pixels[i + 2] = 33;
+			image.Pixels[i + 3] = 49;
+		}
+		return image;
+	}
+
+	const unsigned char* Pixel(const BlockImage& image, unsigned int x, unsigned int y)
+	{
+		return &image.Pixels[((size_t)y * image.Width + x) * 4];
+	}
+
+	void TestLanes()
+	{
+		BlockImage roughness = MakeFlat(4, 2, 200);
+		BlockImage metalness = MakeFlat(4, 2, 30);
+		BlockImage occlusion = MakeFlat(4, 2, 90);
+		const unsigned char defaults[PACK_CHANNEL_COUNT] = { 255, 0, 255, 255 };
+
+		// Each source's red goes in its own lane
+		const BlockImage* all[PACK_CHANNEL_COUNT] = { &roughness, &metalness, &occlusion, nullptr };
+		BlockImage packed;
+		CHECK(ChannelPacker::Pack(all, defaults, &packed));
+		CHECK(packed.Width == 4 && packed.Height == 2);
+		bool lanes = true;
+		for (size_t i = 0; i < packed.Pixels.size(); i += 4)
+			lanes = lanes && packed.Pixels[i] == 200 && packed.Pixels[i + 1] == 30 && packed.Pixels[i + 2] == 90 && packed.Pixels[i + 3] == 255;
+		CHECK(lanes);
+
+		// Missing sources take their defaults
+		const BlockImage* some[PACK_CHANNEL_COUNT] = { nullptr, &metalness, nullptr, nullptr };
+		const unsigned char other[PACK_CHANNEL_COUNT] = { 128, 1, 64, 7 };
+		CHECK(ChannelPacker::Pack(some, other, &packed));
+		const unsigned char* p = Pixel(packed, 3, 1);
+		CHECK(p[0] == 128 && p[1] == 30 && p[2] == 64 && p[3] == 7);
+
+		// No sources at all is one pixel of the defaults
+		const BlockImage* none[PACK_CHANNEL_COUNT] = {};
+		CHECK(ChannelPacker::Pack(none, defaults, &packed));
+		CHECK(packed.Width == 1 && packed.Height == 1);
+		CHECK(packed.Pixels == std::vector<unsigned char>({ 255, 0, 255, 255 }));
+
+		// An empty source is an error
+		BlockImage empty = {};
+		const BlockImage* broken[PACK_CHANNEL_COUNT] = { &roughness, &empty, nullptr, nullptr };
+		CHECK(!ChannelPacker::Pack(broken, defaults, &packed));
+	}
+
+	// Bilinear sample, in doubles, of the red of image at the
+	// center of pixel (x, y) of a width x height image
+	double Reference(const BlockImage& image, unsigned int x, unsigned int y, unsigned int width, unsigned int height)
+	{
+		double u = std::clamp((x + 0.5) * image.Width / width - 0.5, 0.0, image.Width - 1.0);
+		double v = std::clamp((y + 0.5) * image.Height / height - 0.5, 0.0, image.Height - 1.0);
+		unsigned int x0 = (unsigned int)u, y0 = (unsigned int)v;
+		unsigned int x1 = std::min(x0 + 1, image.Width - 1), y1 = std::min(y0 + 1, image.Height - 1);
+		double fu = u - x0, fv = v - y0;
+		double top = Pixel(image, x0, y0)[0] * (1 - fu) + Pixel(image, x1, y0)[0] * fu;
+		double bottom = Pixel(image, x0, y1)[0] * (1 - fu) + Pixel(image, x1, y1)[0] * fu;
+		return top * (1 - fv) + bottom * fv;
+	}
+
+	void TestStretch()
+	{
+		// 2x2 up to 4x4: pixel centers a quarter texel in from the
+		// source's edges are clamped, the rest blend
+		BlockImage small = MakeFlat(2, 2, 0);
+		small.Pixels[4] = 200;		// (1, 0)
+		small.Pixels[12] = 100;		// (1, 1)
+		BlockImage large = MakeFlat(4, 4, 10);
+		const BlockImage* sources[PACK_CHANNEL_COUNT] = { &large, &small, nullptr, nullptr };
+		const unsigned char defaults[PACK_CHANNEL_COUNT] = { 255, 0, 255, 255 };
+		BlockImage packed;
+		CHECK(ChannelPacker::Pack(sources, defaults, &packed));
+		CHECK(packed.Width == 4 && packed.Height == 4);
+		CHECK(Pixel(packed, 0, 0)[1] == 0);
+		CHECK(Pixel(packed, 3, 0)[1] == 200);
+		CHECK(Pixel(packed, 3, 3)[1] == 100);
+		CHECK(std::abs(Pixel(packed, 1, 0)[1] - 50) <= 1);		// 200 * 1/4
+		CHECK(std::abs(Pixel(packed, 2, 2)[1] - 94) <= 1);		// 200 * 9/16 + 100 * 3/16
+		CHECK(Pixel(packed, 2, 2)[0] == 10);
+
+		// A 128x128 metalness map stretched to the scene's 1024x1024
+		// cobblestone roughness, as the scene's own (flat) metalness
+		// maps are.  Red varies quickly here so every blend shows.
+		BlockImage roughness;
+		CHECK(PNGDecoder::Load("Assets/Textures/PBR/cobblestone_roughness.png", &roughness));
+		if (roughness.Width != 1024 || roughness.Height != 1024)
+			return;
+		BlockImage metal = MakeFlat(128, 128, 0);
+		for (unsigned int y = 0; y < metal.Height; y++)
+			for (unsigned int x = 0; x < metal.Width; x++)
+				metal.Pixels[((size_t)y * metal.Width + x) * 4] = (unsigned char)((x * 37 + y * 91 + x * y) % 256);
+
+		const BlockImage* cobblestone[PACK_CHANNEL_COUNT] = { &roughness, &metal, nullptr, nullptr };
+		TestTimer timer;
+		CHECK(ChannelPacker::Pack(cobblestone, defaults, &packed));
+		double seconds = timer.Seconds();
+		CHECK(packed.Width == 1024 && packed.Height == 1024);
+
+		int worst = 0;
+		bool same = true;
+		for (unsigned int y = 0; y < packed.Height; y++)
+		{
+			for (unsigned int x = 0; x < packed.Width; x++)
+			{
+				const unsigned char* p = Pixel(packed, x, y);
+				same = same && p[0] == Pixel(roughness, x, y)[0] && p[2] == 255 && p[3] == 255;
+				worst = std::max(worst, (int)std::abs(p[1] - std::round(Reference(metal, x, y, 1024, 1024))));
+			}
+		}
+		CHECK(same);
+		CHECK(worst <= 1);
+		std::printf("Packing cobblestone at 1024x1024: %.1f ms\n", seconds * 1000.0);
+	}
+
+	void TestManifest()
+	{
+		std::filesystem::path folder = std::filesystem::temp_directory_path() / "TestChannelPacker";
+		std::filesystem::create_directories(folder);
+		std::filesystem::path path = folder / "packs.txt";
+		{
+			std::ofstream file(path);
+			file << "# packed   roughness   metalness   occlusion\n";
+			file << "\n";
+			file << "a.dds   a_rough.png   a_metal.png   a_ao.png\n";
+			file << "   b.dds   -   b_metal.png   # no roughness, and no occlusion column\n";
+			file << "c.dds#comment right after\n";
+			file << "   # indented comment\n";
+		}
+
+		std::vector<ChannelPack> packs = ChannelPacker::LoadManifest(path);
+		CHECK(packs.size() == 3);
+		if (packs.size() != 3)
+			return;
+
+		CHECK(packs[0].Output == (folder / "a.dds").wstring());
+		CHECK(packs[0].Sources[PACK_CHANNEL_ROUGHNESS] == (folder / "a_rough.png").wstring());
+		CHECK(packs[0].Sources[PACK_CHANNEL_METALNESS] == (folder / "a_metal.png").wstring());
+		CHECK(packs[0].Sources[PACK_CHANNEL_OCCLUSION] == (folder / "a_ao.png").wstring());
+
+		CHECK(packs[1].Output == (folder / "b.dds").wstring());
+		CHECK(packs[1].Sources[PACK_CHANNEL_ROUGHNESS].empty());
+		CHECK(packs[1].Sources[PACK_CHANNEL_METALNESS] == (folder / "b_metal.png").wstring());
+		CHECK(packs[1].Sources[PACK_CHANNEL_OCCLUSION].empty());
+
+		CHECK(packs[2].Output == (folder / "c.dds").wstring());
+		for (const ChannelPack& pack : packs)
+		{
+			CHECK(pack.Sources[PACK_CHANNEL_UNUSED].empty());
+			CHECK(pack.Defaults[PACK_CHANNEL_ROUGHNESS] == 255 && pack.Defaults[PACK_CHANNEL_METALNESS] == 0);
+			CHECK(pack.Defaults[PACK_CHANNEL_OCCLUSION] == 255 && pack.Defaults[PACK_CHANNEL_UNUSED] == 255);
+		}
+		std::filesystem::remove_all(folder);
+
+		// A missing manifest is no packs
+		CHECK(ChannelPacker::LoadManifest(folder / "packs.txt").empty());
+
+		// The scene's own manifest, loaded and packed
+		std::vector<ChannelPack> scene = ChannelPacker::LoadManifest("Assets/Textures/PBR/ChannelPacks.txt");
+		CHECK(scene.size() == 3);
+		if (scene.empty())
+			return;
+		CHECK(std::filesystem::path(scene[0].Output).filename() == "cobblestone_surface.dds");
+		CHECK(scene[0].Sources[PACK_CHANNEL_OCCLUSION].empty());
+		BlockImage packed;
+		CHECK(ChannelPacker::Load(scene[0], &packed));
+		CHECK(packed.Width == 1024 && packed.Height == 1024);
+	}
+}
+
+int main()
+{
+	TestLanes();
+	TestStretch();
+	TestManifest();
+	return TestResult();
+}
@@ -0,0 +1,186 @@
+// --------------------------------------------------------
+// ColorLUT: the shader's fetch (Lookup) against evaluating
+// the pipeline directly, for both trilinear and point
+// sampled LUTs, with exposure applied ahead of the LUT
+// --------------------------------------------------------
+#include "ColorLUT.h"
+#include "Test.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	// What Game::BakeColorLUT() uses, with and without dithering
+	std::vector<ColorStep> Graded()
+	{
+		return { { COLOR_STEP_SATURATION, 1.3f, {} }, { COLOR_STEP_GAMMA, 1.0f / 2.2f, {} } };
+	}
+
+	std::vector<ColorStep> Dithered()
+	{
+		std::vector<ColorStep> steps = Graded();
+		steps.push_back({ COLOR_STEP_PALETTE, 0, {
+			XMFLOAT3(0, 0, 0),
+			XMFLOAT3(0.25f, 0.25f, 0.25f),
+			XMFLOAT3(0.50f, 0.50f, 0.50f),
+			XMFLOAT3(0.75f, 0.75f, 0.75f),
+			XMFLOAT3(1, 1, 1) } });
+		return steps;
+	}
+
+	// Largest difference over rgb
+	float Difference(FXMVECTOR a, FXMVECTOR b)
+	{
+		XMFLOAT4 d;
+		XMStoreFloat4(&d, XMVectorAbs(XMVectorSubtract(a, b)));
+		return std::max({ d.x, d.y, d.z });
+	}
+
+	float Random(float range)
+	{
+		return range * std::rand() / RAND_MAX;
+	}
+
+	void TestEvaluate()
+	{
+		std::vector<ColorStep> steps = Graded();
+
+		// Grey stays grey, encoded by the gamma, and opaque
+		XMFLOAT4 grey;
+		XMStoreFloat4(&grey, ColorLUT::Evaluate(steps, XMVectorReplicate(0.25f)));
+		CHECK_NEAR(grey.x, std::pow(0.25, 1 / 2.2), 1e-5);
+		CHECK(grey.x == grey.y && grey.y == grey.z);
+		CHECK(grey.w == 1.0f);
+
+		// Input is clamped to the LUT's range
+		CHECK(Difference(ColorLUT::Evaluate(steps, XMVectorSet(3, 1, -1, 0)),
+			ColorLUT::Evaluate(steps, XMVectorSet(1, 1, 0, 0))) == 0);
+
+		CHECK(!ColorLUT::IsDiscrete(steps));
+		CHECK(ColorLUT::IsDiscrete(Dithered()));
+		CHECK(!ColorLUT::IsDiscrete({}));
+	}
+
+	void TestBake()
+	{
+		// Lattice points hold the pipeline at their linear color, to
+		// 8 bits, however many threads baked them
+		std::vector<ColorStep> steps = Graded();
+		ColorLUTImage lut = ColorLUT::Bake(steps, COLOR_LUT_SIZE, 1);
+		CHECK(lut.Size == COLOR_LUT_SIZE);
+		CHECK(lut.Pixels.size() == COLOR_LUT_SIZE * COLOR_LUT_SIZE * COLOR_LUT_SIZE * 4);
+		CHECK(ColorLUT::Bake(steps, COLOR_LUT_SIZE, 5).Pixels == lut.Pixels);
+
+		float worst = 0;
+		for (unsigned int i = 0; i < 200; i++)
+		{
+			unsigned int r = std::rand() % lut.Size, g = std::rand() % lut.Size, b = std::rand() % lut.Size;
+			XMVECTOR shaped = XMVectorScale(XMVectorSet((float)r, (float)g, (float)b, 0), 1.0f / (lut.Size - 1));
+			XMVECTOR linear = XMVectorMultiply(shaped, shaped);
+			for (bool nearest : { false, true })
+				worst = std::max(worst, Difference(ColorLUT::Lookup(lut, linear, 1, 0, nearest), ColorLUT::Evaluate(steps, linear)));
+		}
+		CHECK(worst <= 0.5f / 255 + 1e-5f);
+	}
+
+	// Largest and mean difference between a trilinear lookup and
+	// Evaluate(), over random colors
+	void CompareTrilinear(const std::vector<ColorStep>& steps, float& worst, double& mean)
+	{
+		ColorLUTImage lut = ColorLUT::Bake(steps, COLOR_LUT_SIZE, 4);
+		std::srand(11);
+		worst = 0;
+		mean = 0;
+		const int count = 20000;
+		for (int i = 0; i < count; i++)
+		{
+			XMVECTOR linear = XMVectorSet(Random(1), Random(1), Random(1), 1);
+			float difference = Difference(ColorLUT::Lookup(lut, linear, 1, 0, false), ColorLUT::Evaluate(steps, linear));
+			worst = std::max(worst, difference);
+			mean += difference / count;
+		}
+	}
+
+	void TestTrilinear()
+	{
+		// Where the pipeline is smooth, blending lattice points is
+		// within rounding of evaluating it
+		float worst;
+		double mean;
+		CompareTrilinear({ { COLOR_STEP_SATURATION, 0.8f, {} }, { COLOR_STEP_GAMMA, 1.0f / 2.2f, {} } }, worst, mean);
+		CHECK(worst < 1.0f / 255);
+
+		// Saturating past 1 clips colors leaving the gamut, and blends
+		// across the clip miss it, but only in a few cells
+		CompareTrilinear(Graded(), worst, mean);
+		std::printf("Trilinear LUT against Evaluate(): worst %.2f, mean %.2f (of 255)\n", worst * 255, mean * 255);
+		CHECK(mean < 1.0 / 255);
+	}
+
+	void TestPoint()
+	{
+		// Point sampled, the result is the palette color of the
+		// nearest lattice point: always a palette color, and the
+		// same as Evaluate() except close to where the choice flips
+		std::vector<ColorStep> steps = Dithered();
+		ColorLUTImage lut = ColorLUT::Bake(steps, COLOR_LUT_SIZE, 4);
+		std::srand(12);
+		int matches = 0, palette = 0;
+		const int count = 20000;
+		for (int i = 0; i < count; i++)
+		{
+			XMVECTOR linear = XMVectorSet(Random(1), Random(1), Random(1), 1);
+			XMFLOAT4 looked;
+			XMStoreFloat4(&looked, ColorLUT::Lookup(lut, linear, 1, 0, true));
+			matches += Difference(XMLoadFloat4(&looked), ColorLUT::Evaluate(steps, linear)) < 1.0f / 255;
+
+			// Greys in quarters, to 8 bits
+			float quarter = std::round(looked.x * 4) / 4;
+			palette += looked.x == looked.y && looked.y == looked.z && std::abs(looked.x - quarter) < 1.0f / 255;
+		}
+		CHECK(palette == count);
+		CHECK(matches > count * 9 / 10);
+		std::printf("Point LUT matches Evaluate() for %.1f%% of colors\n", 100.0 * matches / count);
+
+		// The dither's offset moves between palette colors
+		XMVECTOR middle = XMVectorReplicate(0.3f);
+		CHECK(Difference(ColorLUT::Lookup(lut, middle, 1, -1, true), XMVectorZero()) == 0);
+		CHECK(Difference(ColorLUT::Lookup(lut, middle, 1, 1, true), g_XMOne) == 0);
+	}
+
+	void TestExposure()
+	{
+		// Exposure scales HDR color before the LUT's clamp, so a
+		// highlight above 1 can be brought back down rather than
+		// clipping to white first
+		std::vector<ColorStep> steps = Graded();
+		ColorLUTImage lut = ColorLUT::Bake(steps, COLOR_LUT_SIZE, 4);
+		XMVECTOR highlight = XMVectorSet(3.2f, 2.0f, 1.2f, 1);
+		const float scale = std::exp2(-2.0f);
+		for (bool nearest : { false, true })
+		{
+			XMVECTOR looked = ColorLUT::Lookup(lut, highlight, scale, 0, nearest);
+			XMVECTOR expected = ColorLUT::Evaluate(steps, XMVectorScale(highlight, scale));
+			CHECK(Difference(looked, expected) < (nearest ? 0.05f : 3.0f / 255));
+			CHECK(Difference(looked, ColorLUT::Evaluate(steps, g_XMOne)) > 0.1f);
+		}
+
+		// Brighter exposure clips as before
+		XMVECTOR white = ColorLUT::Lookup(lut, XMVectorReplicate(0.6f), 4, 0, false);
+		CHECK(Difference(white, ColorLUT::Evaluate(steps, g_XMOne)) < 1e-5f);
+	}
+}
+
+int main()
+{
+	TestEvaluate();
+	TestBake();
+	TestTrilinear();
+	TestPoint();
+	TestExposure();
+	return TestResult();
+}
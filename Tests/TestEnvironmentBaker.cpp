@@ -0,0 +1,263 @@
+// --------------------------------------------------------
+// EnvironmentBaker: the prefiltered sky and the BRDF lookup
+// table against brute force integration of the GGX lobe,
+// a white sky staying white at every roughness, and the
+// mirror row of the table matching Schlick's Fresnel
+// --------------------------------------------------------
+#include "EnvironmentBaker.h"
+#include "Test.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace
+{
+	const double pi = 3.14159265358979323846;
+
+	struct Vector
+	{
+		double X, Y, Z;
+	};
+
+	double Dot(const Vector& a, const Vector& b)
+	{
+		return a.X * b.X + a.Y * b.Y + a.Z * b.Z;
+	}
+
+	Vector Normalize(const Vector& v)
+	{
+		double length = std::sqrt(Dot(v, v));
+		return { v.X / length, v.Y / length, v.Z / length };
+	}
+
+	double GGX(double NdotH, double alpha)
+	{
+		double a2 = alpha * alpha;
+		double denom = NdotH * NdotH * (a2 - 1) + 1;
+		return a2 / (pi * denom * denom);
+	}
+
+	double ToLinear(unsigned char srgb)
+	{
+		double c = srgb / 255.0;
+		return c <= 0.04045 ? c / 12.92 : std::pow((c + 0.055) / 1.055, 2.4);
+	}
+
+	unsigned char ToSRGB(double c)
+	{
+		c = std::clamp(c, 0.0, 1.0);
+		c = c <= 0.0031308 ? c * 12.92 : 1.055 * std::pow(c, 1 / 2.4) - 0.055;
+		return (unsigned char)(c * 255 + 0.5);
+	}
+
+	// Direction through texel (x, y) of a face, in the D3D cube
+	// map convention
+	Vector FaceDirection(int face, unsigned int x, unsigned int y, unsigned int size)
+	{
+		double u = (x + 0.5) * 2 / size - 1;
+		double v = (y + 0.5) * 2 / size - 1;
+		switch (face)
+		{
+		case 0: return Normalize({ 1, -v, -u });
+		case 1: return Normalize({ -1, -v, u });
+		case 2: return Normalize({ u, 1, v });
+		case 3: return Normalize({ u, -1, -v });
+		case 4: return Normalize({ u, -v, 1 });
+		default: return Normalize({ -u, -v, -1 });
+		}
+	}
+
+	// A sky that's smooth everywhere, brighter above, in linear light
+	double Sky(const Vector& direction)
+	{
+		return 0.45 + 0.3 * direction.Y + 0.15 * direction.X;
+	}
+
+	// Each face of the sky, as the sRGB images the baker takes
+	std::vector<BlockImage> MakeFaces(unsigned int size, double (*sky)(const Vector&))
+	{
+		std::vector<BlockImage> faces(6);
+		for (int f = 0; f < 6; f++)
+		{
+			faces[f] = { size, size, std::vector<unsigned char>((size_t)size * size * 4) };
+			for (unsigned int y = 0; y < size; y++)
+			{
+				for (unsigned int x = 0; x < size; x++)
+				{
+					unsigned char* texel = &faces[f].Pixels[((size_t)y * size + x) * 4];
+					texel[0] = texel[1] = texel[2] = ToSRGB(sky(FaceDirection(f, x, y, size)));
+					texel[3] = 255;
+				}
+			}
+		}
+		return faces;
+	}
+
+	// The prefilter's integral, with n = v = r, over the whole
+	// sphere: sky weighted by the GGX lobe's distribution of l
+	// (D / 4 when v = n) and n dot l
+	double BruteForcePrefilter(const Vector& N, double alpha)
+	{
+		const int steps = 600;
+		double sum = 0, weight = 0;
+		for (int i = 0; i < steps; i++)
+		{
+			double theta = (i + 0.5) * pi / steps;
+			for (int j = 0; j < steps * 2; j++)
+			{
+				double phi = (j + 0.5) * pi / steps;
+				Vector L = { std::sin(theta) * std::cos(phi), std::sin(theta) * std::sin(phi), std::cos(theta) };
+				double NdotL = Dot(N, L);
+				if (NdotL <= 0)
+					continue;
+				Vector H = Normalize({ N.X + L.X, N.Y + L.Y, N.Z + L.Z });
+				double w = GGX(Dot(N, H), alpha) / 4 * NdotL * std::sin(theta);
+				sum += Sky(L) * w;
+				weight += w;
+			}
+		}
+		return sum / weight;
+	}
+
+	// The table's scale and bias to F0, integrating the lobe over
+	// half vectors around n = +Z (dl = 4 v.h dh)
+	void BruteForceBRDF(double NdotV, double roughness, double& scale, double& bias)
+	{
+		double alpha = roughness * roughness;
+		double k = alpha / 2;
+		Vector V = { std::sqrt(1 - NdotV * NdotV), 0, NdotV };
+		const int steps = 1000;
+		scale = bias = 0;
+		for (int i = 0; i < steps; i++)
+		{
+			double theta = (i + 0.5) * (pi / 2) / steps;
+			for (int j = 0; j < steps; j++)
+			{
+				double phi = (j + 0.5) * 2 * pi / steps;
+				Vector H = { std::sin(theta) * std::cos(phi), std::sin(theta) * std::sin(phi), std::cos(theta) };
+				double VdotH = Dot(V, H);
+				double NdotL = 2 * VdotH * H.Z - NdotV;
+				if (VdotH <= 0 || NdotL <= 0)
+					continue;
+
+				double G = (NdotV / (NdotV * (1 - k) + k)) * (NdotL / (NdotL * (1 - k) + k));
+				double brdf = GGX(H.Z, alpha) * G / (4 * NdotV);
+				double fresnel = std::pow(1 - VdotH, 5);
+				double dl = 4 * VdotH * std::sin(theta) * ((pi / 2) / steps) * (2 * pi / steps);
+				scale += brdf * (1 - fresnel) * dl;
+				bias += brdf * fresnel * dl;
+			}
+		}
+	}
+
+	void TestPrefilter()
+	{
+		std::vector<BlockImage> faces = MakeFaces(64, Sky);
+		const BlockImage* pointers[6] = { &faces[0], &faces[1], &faces[2], &faces[3], &faces[4], &faces[5] };
+		EnvironmentSettings settings = { 16, 5, 512, 32 };
+		PrefilteredEnvironment environment = EnvironmentBaker::Prefilter(pointers, settings, 2);
+		CHECK(environment.Size == 16 && environment.MipLevels == 5);
+		CHECK(environment.Images.size() == 6 * 5);
+		if (environment.Images.size() != 6 * 5)
+			return;
+
+		// A few texels on each face of the rough mips, including by
+		// the faces' edges and corners
+		double worst = 0;
+		for (unsigned int mip = 1; mip < environment.MipLevels; mip++)
+		{
+			double roughness = (double)mip / (environment.MipLevels - 1);
+			unsigned int size = environment.Size >> mip;
+			for (int f = 0; f < 6; f++)
+			{
+				const BlockImage& image = environment.Images[f * environment.MipLevels + mip];
+				CHECK(image.Width == size && image.Height == size);
+				for (unsigned int y : { 0u, size / 2 })
+				{
+					for (unsigned int x : { 0u, size - 1 })
+					{
+						double baked = ToLinear(image.Pixels[((size_t)y * size + x) * 4]);
+						double expected = BruteForcePrefilter(FaceDirection(f, x, y, size), roughness * roughness);
+						worst = std::max(worst, std::abs(baked - expected));
+					}
+				}
+			}
+		}
+		std::printf("Prefiltered sky against brute force: worst %.4f\n", worst);
+		CHECK(worst < 0.01);
+	}
+
+	double White(const Vector&)
+	{
+		return 1;
+	}
+
+	void TestWhiteSky()
+	{
+		// However rough, a sky that's the same everywhere stays the same
+		std::vector<BlockImage> faces = MakeFaces(32, White);
+		const BlockImage* pointers[6] = { &faces[0], &faces[1], &faces[2], &faces[3], &faces[4], &faces[5] };
+		EnvironmentSettings settings = { 32, 6, 64, 32 };
+		PrefilteredEnvironment environment = EnvironmentBaker::Prefilter(pointers, settings, 2);
+		CHECK(environment.Images.size() == 6 * 6);
+		bool white = true;
+		for (const BlockImage& image : environment.Images)
+			for (unsigned char c : image.Pixels)
+				white = white && c == 255;
+		CHECK(white);
+
+		// Missing faces are black, which the roughest lobe around +Y
+		// picks up while its mirror doesn't
+		const BlockImage* some[6] = { &faces[0], nullptr, &faces[2], &faces[3], &faces[4], &faces[5] };
+		environment = EnvironmentBaker::Prefilter(some, settings, 2);
+		const BlockImage& mirror = environment.Images[1 * environment.MipLevels];
+		const BlockImage& up = environment.Images[2 * environment.MipLevels];
+		const BlockImage& rough = environment.Images[2 * environment.MipLevels + environment.MipLevels - 1];
+		CHECK(mirror.Pixels[0] == 0 && up.Pixels[0] == 255);
+		CHECK(rough.Pixels[0] < 255);
+	}
+
+	void TestBRDF()
+	{
+		EnvironmentSettings settings = { 16, 5, 1024, 32 };
+		std::vector<unsigned short> lut = EnvironmentBaker::BakeBRDF(settings, 2);
+		CHECK(lut.size() == 32 * 32 * 2);
+
+		// Texels at a spread of view angles and roughnesses
+		double worst = 0;
+		for (unsigned int y : { 8u, 16u, 24u, 31u })
+		{
+			for (unsigned int x : { 2u, 10u, 20u, 31u })
+			{
+				double scale, bias;
+				BruteForceBRDF((x + 0.5) / 32, (y + 0.5) / 32, scale, bias);
+				const unsigned short* texel = &lut[((size_t)y * 32 + x) * 2];
+				worst = std::max(worst, std::abs(texel[0] / 65535.0 - scale));
+				worst = std::max(worst, std::abs(texel[1] / 65535.0 - bias));
+			}
+		}
+		std::printf("BRDF table against brute force: worst %.4f\n", worst);
+		CHECK(worst < 0.01);
+
+		// The smoothest row is nearly a mirror, where the integral
+		// is Schlick's Fresnel alone: scale 1 - (1 - n.v)^5, bias
+		// (1 - n.v)^5.  Only the most grazing texel loses more than
+		// a percent to masking.
+		double mirrorWorst = 0;
+		for (unsigned int x = 1; x < 32; x++)
+		{
+			double fresnel = std::pow(1 - (x + 0.5) / 32, 5);
+			mirrorWorst = std::max(mirrorWorst, std::abs(lut[x * 2] / 65535.0 - (1 - fresnel)));
+			mirrorWorst = std::max(mirrorWorst, std::abs(lut[x * 2 + 1] / 65535.0 - fresnel));
+		}
+		CHECK(mirrorWorst < 0.01);
+	}
+}
+
+int main()
+{
+	TestPrefilter();
+	TestWhiteSky();
+	TestBRDF();
+	return TestResult();
+}
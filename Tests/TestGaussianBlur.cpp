@@ -0,0 +1,216 @@
+// --------------------------------------------------------
+// GaussianBlur: the kernel, the bilinear taps the shader
+// takes, and Blur() against known results and against a
+// simulation of the shader's two passes
+// --------------------------------------------------------
+#include "GaussianBlur.h"
+#include "Test.h"
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+namespace
+{
+	BlockImage MakeNoise(unsigned int width, unsigned int height)
+	{
+		BlockImage image = { width, height, std::vector<unsigned char>((size_t)width * height * 4) };
+		std::srand(3);
+		for (unsigned char& value : image.Pixels)
+			value = (unsigned char)(std::rand() & 255);
+		return image;
+	}
+
+	void TestWeights()
+	{
+		for (int radius = 0; radius <= MAX_BLUR_RADIUS; radius++)
+		{
+			std::vector<float> weights = GaussianBlur::GetWeights(radius);
+			CHECK((int)weights.size() == radius + 1);
+
+			// Normalized over both sides, and falling away from the center
+			double total = weights[0];
+			for (int i = 1; i <= radius; i++)
+			{
+				total += 2.0 * weights[i];
+				CHECK(weights[i] < weights[i - 1]);
+			}
+			CHECK_NEAR(total, 1, 1e-5);
+
+			// The last texel is 3 standard deviations out
+			if (radius > 0)
+				CHECK_NEAR(weights[radius] / weights[0], std::exp(-4.5), 1e-5);
+		}
+
+		// Out of range radii are clamped
+		CHECK(GaussianBlur::GetWeights(-4).size() == 1);
+		CHECK(GaussianBlur::GetWeights(MAX_BLUR_RADIUS + 10).size() == MAX_BLUR_RADIUS + 1);
+	}
+
+	void TestTaps()
+	{
+		// Radius 1 leaves texel 1 on its own; radius 2 pairs 1 & 2
+		std::vector<BlurTap> one = GaussianBlur::GetLinearTaps(1);
+		CHECK(one.size() == 2);
+		CHECK(one[1].Offset == 1.0f);
+		std::vector<BlurTap> two = GaussianBlur::GetLinearTaps(2);
+		CHECK(two.size() == 2);
+		CHECK(two[1].Offset > 1.0f && two[1].Offset < 1.5f);
+
+		for (int radius = 0; radius <= MAX_BLUR_RADIUS; radius++)
+		{
+			std::vector<float> weights = GaussianBlur::GetWeights(radius);
+			std::vector<BlurTap> taps = GaussianBlur::GetLinearTaps(radius);
+			CHECK((int)taps.size() == 1 + (radius + 1) / 2);
+			CHECK(taps.size() <= MAX_BLUR_TAPS);
+			CHECK(taps[0].Offset == 0 && taps[0].Weight == weights[0]);
+
+			// Each tap lands between its two texels, and hands each
+			// exactly its own weight
+			for (size_t t = 1; t < taps.size(); t++)
+			{
+				int first = (int)t * 2 - 1;
+				CHECK(taps[t].Offset >= first && taps[t].Offset <= first + 1);
+				float second = first + 1 <= radius ? weights[first + 1] : 0.0f;
+				float fraction = taps[t].Offset - first;
+				CHECK_NEAR(taps[t].Weight * (1 - fraction), weights[first], 1e-6);
+				CHECK_NEAR(taps[t].Weight * fraction, second, 1e-6);
+			}
+		}
+	}
+
+	void TestKnownImages()
+	{
+		// A flat image stays flat, edges included, at any radius
+		BlockImage flat = { 21, 13, std::vector<unsigned char>(21 * 13 * 4) };
+		for (size_t i = 0; i < flat.Pixels.size(); i++)
+			flat.Pixels[i] = (unsigned char)(40 + 50 * (i % 4));
+		for (int radius : { 1, 4, 17 })
+			CHECK(GaussianBlur::Blur(flat, radius).Pixels == flat.Pixels);
+
+		// Radius 0 changes nothing
+		BlockImage noise = MakeNoise(19, 11);
+		CHECK(GaussianBlur::Blur(noise, 0).Pixels == noise.Pixels);
+
+		// A single white texel spreads into the kernel times itself,
+		// rounded once per pass
+		const int radius = 5, size = 15, center = 7;
+		BlockImage dot = { size, size, std::vector<unsigned char>(size * size * 4, 0) };
+		for (int c = 0; c < 4; c++)
+			dot.Pixels[(center * size + center) * 4 + c] = 255;
+
+		std::vector<float> weights = GaussianBlur::GetWeights(radius);
+		BlockImage blurred = GaussianBlur::Blur(dot, radius);
+		int worst = 0;
+		for (int y = 0; y < size; y++)
+		{
+			for (int x = 0; x < size; x++)
+			{
+				int dx = std::abs(x - center), dy = std::abs(y - center);
+				float row = dx <= radius ? std::round(weights[dx] * 255) : 0;
+				float expected = dy <= radius ? std::round(row * weights[dy]) : 0;
+				worst = std::max(worst, std::abs(blurred.Pixels[(y * size + x) * 4 + 1] - (int)expected));
+			}
+		}
+		CHECK(worst <= 1);
+
+		// Blurring is symmetric, so a mirrored image blurs to the mirror
+		BlockImage mirrored = noise;
+		for (unsigned int y = 0; y < noise.Height; y++)
+			for (unsigned int x = 0; x < noise.Width; x++)
+				for (int c = 0; c < 4; c++)
+					mirrored.Pixels[(y * noise.Width + x) * 4 + c] = noise.Pixels[(y * noise.Width + (noise.Width - 1 - x)) * 4 + c];
+		BlockImage a = GaussianBlur::Blur(noise, 6), b = GaussianBlur::Blur(mirrored, 6);
+		bool same = true;
+		for (unsigned int y = 0; y < noise.Height; y++)
+			for (unsigned int x = 0; x < noise.Width; x++)
+				for (int c = 0; c < 4; c++)
+					same = same && a.Pixels[(y * noise.Width + x) * 4 + c] == b.Pixels[(y * noise.Width + (noise.Width - 1 - x)) * 4 + c];
+		CHECK(same);
+	}
+
+	// A clamped bilinear fetch from a row, pos in texels
+	float Fetch(const std::vector<float>& row, float pos)
+	{
+		int n = (int)row.size();
+		float base = std::floor(pos);
+		float t = pos - base;
+		int i0 = std::clamp((int)base, 0, n - 1), i1 = std::clamp((int)base + 1, 0, n - 1);
+		return row[i0] * (1 - t) + row[i1] * t;
+	}
+
+	std::vector<float> ShaderPass(const std::vector<float>& line, const std::vector<BlurTap>& taps)
+	{
+		std::vector<float> result(line.size());
+		for (size_t i = 0; i < line.size(); i++)
+		{
+			float total = Fetch(line, (float)i) * taps[0].Weight;
+			for (size_t t = 1; t < taps.size(); t++)
+				total += (Fetch(line, i + taps[t].Offset) + Fetch(line, i - taps[t].Offset)) * taps[t].Weight;
+			result[i] = total;
+		}
+		return result;
+	}
+
+	void TestAgainstShader()
+	{
+		// What BlurPostProcess.hlsl does with the taps, rows then
+		// columns, in float.  Blur() rounds between its passes, so
+		// the two may only differ by a step.
+		BlockImage image = MakeNoise(67, 41);
+		int worst = 0;
+		for (int radius = 1; radius <= MAX_BLUR_RADIUS; radius += 3)
+		{
+			std::vector<BlurTap> taps = GaussianBlur::GetLinearTaps(radius);
+			BlockImage blurred = GaussianBlur::Blur(image, radius);
+			for (int c = 0; c < 4; c++)
+			{
+				std::vector<float> horizontal(image.Pixels.size() / 4);
+				for (unsigned int y = 0; y < image.Height; y++)
+				{
+					std::vector<float> row(image.Width);
+					for (unsigned int x = 0; x < image.Width; x++)
+						row[x] = image.Pixels[(y * image.Width + x) * 4 + c] / 255.0f;
+					row = ShaderPass(row, taps);
+					std::copy(row.begin(), row.end(), horizontal.begin() + y * image.Width);
+				}
+
+				for (unsigned int x = 0; x < image.Width; x++)
+				{
+					std::vector<float> column(image.Height);
+					for (unsigned int y = 0; y < image.Height; y++)
+						column[y] = horizontal[y * image.Width + x];
+					column = ShaderPass(column, taps);
+					for (unsigned int y = 0; y < image.Height; y++)
+					{
+						int shader = (int)std::round(std::clamp(column[y], 0.0f, 1.0f) * 255);
+						worst = std::max(worst, std::abs(shader - blurred.Pixels[(y * image.Width + x) * 4 + c]));
+					}
+				}
+			}
+		}
+		CHECK(worst <= 1);
+	}
+
+	void BenchmarkBlur()
+	{
+		BlockImage image = MakeNoise(512, 512);
+		for (int radius : { 4, 16, 32 })
+		{
+			TestTimer timer;
+			BlockImage blurred = GaussianBlur::Blur(image, radius);
+			double seconds = timer.Seconds();
+			CHECK(blurred.Pixels.size() == image.Pixels.size());
+			std::printf("Blur() of 512x512, radius %d: %.1f ms\n", radius, seconds * 1000.0);
+		}
+	}
+}
+
+int main()
+{
+	TestWeights();
+	TestTaps();
+	TestKnownImages();
+	TestAgainstShader();
+	BenchmarkBlur();
+	return TestResult();
+}
@@ -0,0 +1,102 @@
+// --------------------------------------------------------
+// InstanceBatcher's grouping and packing: one group (so
+// one draw) per unique mesh & material pair, each group's
+// instances contiguous and in submission order
+// --------------------------------------------------------
+#include "InstanceBatcher.h"
+#include "Test.h"
+#include <set>
+#include <utility>
+
+namespace
+{
+	// Stand-ins for meshes and materials, only used as identities
+	int meshes[3];
+	int materials[2];
+
+	// Tags an instance so it can be found after packing
+	InstanceData MakeInstance(unsigned int id)
+	{
+		InstanceData data = {};
+		data.World._41 = (float)id;
+		return data;
+	}
+
+	void TestGrouping()
+	{
+		InstanceBatcher batcher;
+		std::set<std::pair<const void*, const void*>> pairs;
+
+		// Interleave every pair, as a draw order sorted by depth would
+		const unsigned int count = 60;
+		for (unsigned int i = 0; i < count; i++)
+		{
+			const void* mesh = &meshes[i % 3];
+			const void* material = &materials[(i / 3) % 2];
+			batcher.Add(mesh, material, MakeInstance(i));
+			pairs.insert({ mesh, material });
+		}
+		batcher.Build();
+
+		// N draws become one per pair
+		const std::vector<InstanceGroup>& groups = batcher.GetGroups();
+		CHECK(groups.size() == pairs.size());
+		CHECK(batcher.GetInstanceCount() == count);
+
+		unsigned int next = 0;
+		for (const InstanceGroup& group : groups)
+		{
+			// Groups tile the packed data with no gaps
+			CHECK(group.FirstInstance == next);
+			next += group.InstanceCount;
+
+			// Each instance belongs to its group's pair, in the order added
+			int last = -1;
+			for (unsigned int i = group.FirstInstance; i < group.FirstInstance + group.InstanceCount; i++)
+			{
+				unsigned int id = (unsigned int)batcher.GetInstanceData()[i].World._41;
+				CHECK(group.Mesh == &meshes[id % 3]);
+				CHECK(group.Material == &materials[(id / 3) % 2]);
+				CHECK((int)id > last);
+				last = (int)id;
+			}
+		}
+		CHECK(next == count);
+
+		// A material's groups are next to each other, so the material
+		// only changes once per material
+		unsigned int materialChanges = 0;
+		for (size_t g = 1; g < groups.size(); g++)
+			if (groups[g].Material != groups[g - 1].Material)
+				materialChanges++;
+		CHECK(materialChanges == 1);
+	}
+
+	void TestClear()
+	{
+		InstanceBatcher batcher;
+		batcher.Add(&meshes[0], &materials[0], MakeInstance(0));
+		batcher.Build();
+		CHECK(batcher.GetGroups().size() == 1);
+
+		// Nothing carries over to the next frame
+		batcher.Clear();
+		batcher.Build();
+		CHECK(batcher.GetGroups().empty());
+		CHECK(batcher.GetInstanceCount() == 0);
+
+		// One pair is one draw however many instances it has
+		for (unsigned int i = 0; i < 100; i++)
+			batcher.Add(&meshes[1], &materials[1], MakeInstance(i));
+		batcher.Build();
+		CHECK(batcher.GetGroups().size() == 1);
+		CHECK(batcher.GetGroups()[0].InstanceCount == 100);
+	}
+}
+
+int main()
+{
+	TestGrouping();
+	TestClear();
+	return TestResult();
+}
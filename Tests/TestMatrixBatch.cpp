@@ -0,0 +1,101 @@
+// --------------------------------------------------------
+// MatrixBatch against a plain scalar world * view * proj,
+// then a benchmark of the batched multiply
+// --------------------------------------------------------
+#include "MatrixBatch.h"
+#include "Test.h"
+#include <cstdlib>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	XMFLOAT4X4 RandomMatrix()
+	{
+		XMFLOAT4X4 m;
+		for (int r = 0; r < 4; r++)
+			for (int c = 0; c < 4; c++)
+				m.m[r][c] = (float)std::rand() / RAND_MAX * 2.0f - 1.0f;
+		return m;
+	}
+
+	XMFLOAT4X4 Multiply(const XMFLOAT4X4& a, const XMFLOAT4X4& b)
+	{
+		XMFLOAT4X4 result;
+		for (int r = 0; r < 4; r++)
+		{
+			for (int c = 0; c < 4; c++)
+			{
+				float sum = 0;
+				for (int k = 0; k < 4; k++)
+					sum += a.m[r][k] * b.m[k][c];
+				result.m[r][c] = sum;
+			}
+		}
+		return result;
+	}
+
+	void TestAgainstReference()
+	{
+		std::srand(29);
+		XMFLOAT4X4 view = RandomMatrix();
+		XMFLOAT4X4 proj = RandomMatrix();
+		XMFLOAT4X4 lightView = RandomMatrix();
+		XMFLOAT4X4 lightProj = RandomMatrix();
+
+		MatrixBatch batch;
+		std::vector<XMFLOAT4X4> worlds;
+		for (unsigned int i = 0; i < 100; i++)
+		{
+			worlds.push_back(RandomMatrix());
+			CHECK(batch.Add(worlds.back()) == i);
+		}
+		batch.Compute(view, proj, lightView, lightProj);
+		CHECK(batch.GetCount() == 100);
+
+		// Same products as the shaders used to form per vertex
+		for (unsigned int i = 0; i < worlds.size(); i++)
+		{
+			XMFLOAT4X4 wvp = Multiply(Multiply(worlds[i], view), proj);
+			XMFLOAT4X4 lightWVP = Multiply(Multiply(worlds[i], lightView), lightProj);
+			for (int r = 0; r < 4; r++)
+			{
+				for (int c = 0; c < 4; c++)
+				{
+					CHECK_NEAR(batch.Get(i).WVP.m[r][c], wvp.m[r][c], 1e-4);
+					CHECK_NEAR(batch.Get(i).LightWVP.m[r][c], lightWVP.m[r][c], 1e-4);
+				}
+			}
+		}
+
+		batch.Clear();
+		CHECK(batch.GetCount() == 0);
+	}
+
+	void BenchmarkCompute()
+	{
+		const unsigned int objects = 10000;
+		const unsigned int frames = 100;
+		XMFLOAT4X4 camera = RandomMatrix();
+
+		MatrixBatch batch;
+		for (unsigned int i = 0; i < objects; i++)
+			batch.Add(RandomMatrix());
+
+		TestTimer timer;
+		for (unsigned int f = 0; f < frames; f++)
+			batch.Compute(camera, camera, camera, camera);
+		double seconds = timer.Seconds();
+
+		std::printf("MatrixBatch::Compute: %u objects in %.3f ms, %.1f M objects/s\n",
+			objects, seconds * 1000.0 / frames, objects * (double)frames / seconds / 1e6);
+	}
+}
+
+int main()
+{
+	TestAgainstReference();
+	BenchmarkCompute();
+	return TestResult();
+}
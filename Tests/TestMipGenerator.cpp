@@ -0,0 +1,247 @@
+// --------------------------------------------------------
+// MipGenerator: chain sizes, known results for patterns
+// that have them, a scalar reference for the box filter,
+// and how long a full chain takes
+// --------------------------------------------------------
+#include "MipGenerator.h"
+#include "Test.h"
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+namespace
+{
+	BlockImage MakeImage(unsigned int width, unsigned int height)
+	{
+		return { width, height, std::vector<unsigned char>((size_t)width * height * 4, 255) };
+	}
+
+	unsigned char* Pixel(BlockImage& image, unsigned int x, unsigned int y)
+	{
+		return &image.Pixels[((size_t)y * image.Width + x) * 4];
+	}
+
+	// Black and white single pixel checkerboard, opaque
+	BlockImage MakeCheckerboard(unsigned int size)
+	{
+		BlockImage image = MakeImage(size, size);
+		for (unsigned int y = 0; y < size; y++)
+			for (unsigned int x = 0; x < size; x++)
+				std::fill(Pixel(image, x, y), Pixel(image, x, y) + 3, (unsigned char)((x + y) & 1 ? 255 : 0));
+		return image;
+	}
+
+	BlockImage MakeNoise(unsigned int width, unsigned int height)
+	{
+		BlockImage image = MakeImage(width, height);
+		std::srand(99);
+		for (unsigned char& value : image.Pixels)
+			value = (unsigned char)(std::rand() & 255);
+		return image;
+	}
+
+	void TestSizes()
+	{
+		CHECK(MipGenerator::GetMipCount(1, 1) == 1);
+		CHECK(MipGenerator::GetMipCount(2, 2) == 2);
+		CHECK(MipGenerator::GetMipCount(1024, 1024) == 11);
+		CHECK(MipGenerator::GetMipCount(1024, 1) == 11);
+		CHECK(MipGenerator::GetMipCount(37, 5) == 6);
+
+		// Odd sizes round down, and one side stops at 1 before the other
+		BlockImage odd = MakeImage(37, 5);
+		MipSettings settings = { MIP_FILTER_KAISER, MIP_CONTENT_SRGB, nullptr };
+		std::vector<BlockImage> levels = MipGenerator::Generate(odd, settings, 3);
+		const unsigned int widths[] = { 37, 18, 9, 4, 2, 1 };
+		const unsigned int heights[] = { 5, 2, 1, 1, 1, 1 };
+		CHECK(levels.size() == 6);
+		for (size_t i = 0; i < levels.size() && i < 6; i++)
+		{
+			CHECK(levels[i].Width == widths[i] && levels[i].Height == heights[i]);
+			CHECK(levels[i].Pixels.size() == (size_t)widths[i] * heights[i] * 4);
+		}
+
+		// Nothing to do for an empty image
+		BlockImage empty = {};
+		CHECK(MipGenerator::Generate(empty, settings, 1).empty());
+	}
+
+	void TestKnownValues()
+	{
+		// A flat color stays exactly the same all the way down,
+		// edges included, since the weights of each filter sum to 1
+		BlockImage flat = MakeImage(37, 5);
+		for (unsigned int i = 0; i < 37 * 5; i++)
+		{
+			flat.Pixels[i * 4 + 0] = 10;
+			flat.Pixels[i * 4 + 1] = 100;
+			flat.Pixels[i * 4 + 2] = 200;
+			flat.Pixels[i * 4 + 3] = 50;
+		}
+		for (MipFilter filter : { MIP_FILTER_BOX, MIP_FILTER_KAISER })
+		{
+			for (MipContent content : { MIP_CONTENT_LINEAR, MIP_CONTENT_SRGB })
+			{
+				MipSettings settings = { filter, content, nullptr };
+				for (BlockImage& level : MipGenerator::Generate(flat, settings, 2))
+				{
+					for (size_t i = 0; i < level.Pixels.size(); i += 4)
+						CHECK(level.Pixels[i] == 10 && level.Pixels[i + 1] == 100 && level.Pixels[i + 2] == 200 && level.Pixels[i + 3] == 50);
+				}
+			}
+		}
+
+		// A checkerboard averages to half intensity.  As linear data
+		// that's 128; as sRGB it's half the light, which is 188 and
+		// not the 128 a naive average of the bytes gives.  The Kaiser
+		// taps are symmetric, so away from the clamped edges it lands
+		// on the same value.
+		BlockImage checker = MakeCheckerboard(64);
+		for (MipFilter filter : { MIP_FILTER_BOX, MIP_FILTER_KAISER })
+		{
+			MipSettings linear = { filter, MIP_CONTENT_LINEAR, nullptr };
+			MipSettings srgb = { filter, MIP_CONTENT_SRGB, nullptr };
+			std::vector<BlockImage> linearLevels = MipGenerator::Generate(checker, linear, 1);
+			std::vector<BlockImage> srgbLevels = MipGenerator::Generate(checker, srgb, 1);
+			for (unsigned int level = 1; level < 4; level++)
+			{
+				unsigned int center = linearLevels[level].Width / 2;
+				CHECK(Pixel(linearLevels[level], center, center)[0] == 128);
+				CHECK(Pixel(srgbLevels[level], center, center)[1] == 188);
+				CHECK(Pixel(srgbLevels[level], center, center)[3] == 255);
+			}
+		}
+	}
+
+	void TestBoxReference()
+	{
+		// Straightforward double precision box chain, always from
+		// the unrounded level above, as Generate() promises
+		BlockImage image = MakeNoise(40, 24);
+		std::vector<double> current(image.Pixels.begin(), image.Pixels.end());
+		unsigned int width = image.Width, height = image.Height;
+
+		MipSettings settings = { MIP_FILTER_BOX, MIP_CONTENT_LINEAR, nullptr };
+		std::vector<BlockImage> levels = MipGenerator::Generate(image, settings, 1);
+		int worst = 0;
+		for (size_t level = 1; level < levels.size(); level++)
+		{
+			unsigned int w = std::max(1u, width / 2), h = std::max(1u, height / 2);
+			std::vector<double> next((size_t)w * h * 4);
+			for (unsigned int y = 0; y < h; y++)
+			{
+				for (unsigned int x = 0; x < w; x++)
+				{
+					for (unsigned int c = 0; c < 4; c++)
+					{
+						double sum = 0;
+						for (unsigned int s = 0; s < 4; s++)
+						{
+							unsigned int sx = std::min(x * 2 + s % 2, width - 1);
+							unsigned int sy = std::min(y * 2 + s / 2, height - 1);
+							sum += current[((size_t)sy * width + sx) * 4 + c];
+						}
+						next[((size_t)y * w + x) * 4 + c] = sum / 4;
+					}
+				}
+			}
+			current.swap(next);
+			width = w;
+			height = h;
+
+			CHECK(levels[level].Width == width && levels[level].Height == height);
+			for (size_t i = 0; i < current.size() && i < levels[level].Pixels.size(); i++)
+				worst = std::max(worst, std::abs((int)levels[level].Pixels[i] - (int)(current[i] + 0.5)));
+		}
+		CHECK(worst <= 1);
+	}
+
+	void TestNormals()
+	{
+		// Normals tilted alternately left and right: the average points
+		// straight up, and is stored at unit length again
+		BlockImage normals = MakeImage(64, 64);
+		BlockImage roughness = MakeImage(64, 64);
+		BlockImage flatNormals = MakeImage(64, 64);
+		for (unsigned int y = 0; y < 64; y++)
+		{
+			for (unsigned int x = 0; x < 64; x++)
+			{
+				unsigned char* n = Pixel(normals, x, y);
+				n[0] = (x + y) & 1 ? 204 : 51; // x = +-0.6
+				n[1] = 128;
+				n[2] = 230;						// z = 0.8
+
+				unsigned char* f = Pixel(flatNormals, x, y);
+				f[0] = 128;
+				f[1] = 128;
+				f[2] = 255;
+
+				Pixel(roughness, x, y)[0] = 77;	// 0.3
+			}
+		}
+
+		MipSettings normalSettings = { MIP_FILTER_BOX, MIP_CONTENT_NORMAL, nullptr };
+		std::vector<BlockImage> levels = MipGenerator::Generate(normals, normalSettings, 1);
+		const unsigned char* up = Pixel(levels[1], 5, 5);
+		CHECK(std::abs(up[0] - 128) <= 1 && std::abs(up[1] - 128) <= 1 && up[2] == 255);
+
+		// The shortened average raises roughness (Toksvig), but only
+		// below the top level, and only where the normals diverge
+		MipSettings toksvig = { MIP_FILTER_BOX, MIP_CONTENT_LINEAR, &normals };
+		std::vector<BlockImage> raised = MipGenerator::Generate(roughness, toksvig, 1);
+		CHECK(Pixel(raised[0], 5, 5)[0] == 77);
+		CHECK(Pixel(raised[1], 5, 5)[0] > 77 + 20);
+		CHECK(Pixel(raised[3], 2, 2)[0] >= Pixel(raised[1], 5, 5)[0]);
+
+		MipSettings flat = { MIP_FILTER_BOX, MIP_CONTENT_LINEAR, &flatNormals };
+		std::vector<BlockImage> unchanged = MipGenerator::Generate(roughness, flat, 1);
+		CHECK(Pixel(unchanged[1], 5, 5)[0] == 77);
+
+		// A normal map of another size is ignored
+		BlockImage small = MakeImage(32, 32);
+		MipSettings mismatched = { MIP_FILTER_BOX, MIP_CONTENT_LINEAR, &small };
+		CHECK(Pixel(MipGenerator::Generate(roughness, mismatched, 1)[1], 5, 5)[0] == 77);
+	}
+
+	void TestThreads()
+	{
+		// Splitting rows across threads changes nothing
+		BlockImage image = MakeNoise(256, 200);
+		MipSettings settings = { MIP_FILTER_KAISER, MIP_CONTENT_SRGB, nullptr };
+		std::vector<BlockImage> single = MipGenerator::Generate(image, settings, 1);
+		std::vector<BlockImage> several = MipGenerator::Generate(image, settings, 8);
+		CHECK(single.size() == several.size());
+		for (size_t i = 0; i < single.size() && i < several.size(); i++)
+			CHECK(single[i].Pixels == several[i].Pixels);
+	}
+
+	void BenchmarkGenerate()
+	{
+		BlockImage image = MakeNoise(2048, 2048);
+		for (MipFilter filter : { MIP_FILTER_BOX, MIP_FILTER_KAISER })
+		{
+			for (unsigned int threads : { 1u, 4u })
+			{
+				MipSettings settings = { filter, MIP_CONTENT_SRGB, nullptr };
+				TestTimer timer;
+				std::vector<BlockImage> levels = MipGenerator::Generate(image, settings, threads);
+				double seconds = timer.Seconds();
+				CHECK(levels.size() == 12);
+				std::printf("%s sRGB chain for 2048x2048, %u thread(s): %.1f ms\n",
+					filter == MIP_FILTER_BOX ? "Box" : "Kaiser", threads, seconds * 1000.0);
+			}
+		}
+	}
+}
+
+int main()
+{
+	TestSizes();
+	TestKnownValues();
+	TestBoxReference();
+	TestNormals();
+	TestThreads();
+	BenchmarkGenerate();
+	return TestResult();
+}
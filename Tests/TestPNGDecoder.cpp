@@ -0,0 +1,463 @@
+// --------------------------------------------------------
+// PNGDecoder: images written here in every color type, bit
+// depth, filter and interlacing must come back exactly,
+// the asset PNGs must match hashes of a reference decode,
+// and damaged files must fail rather than crash
+// --------------------------------------------------------
+#include "PNGDecoder.h"
+#include "Test.h"
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+namespace
+{
+	// --------------------------------------------------------
+	// Just enough of a PNG encoder to cover the decoder.  The
+	// deflate stream is either stored blocks or one fixed
+	// Huffman block with literals and distance 1 runs; the
+	// dynamic Huffman blocks real encoders write are covered
+	// by the asset PNGs instead.
+	// --------------------------------------------------------
+	struct BitWriter
+	{
+		std::vector<unsigned char> Bytes;
+		unsigned int Used = 8;
+
+		void Write(unsigned int value, unsigned int count)
+		{
+			for (unsigned int i = 0; i < count; i++)
+			{
+				if (Used == 8)
+				{
+					Bytes.push_back(0);
+					Used = 0;
+				}
+				Bytes.back() |= ((value >> i) & 1) << Used++;
+			}
+		}
+
+		// Huffman codes go most significant bit first
+		void WriteCode(unsigned int code, unsigned int length)
+		{
+			for (unsigned int i = length; i-- > 0;)
+				Write((code >> i) & 1, 1);
+		}
+	};
+
+	void WriteFixedLiteral(BitWriter& bits, unsigned int symbol)
+	{
+		if (symbol < 144) bits.WriteCode(0x30 + symbol, 8);
+		else if (symbol < 256) bits.WriteCode(0x190 + symbol - 144, 9);
+		else if (symbol < 280) bits.WriteCode(symbol - 256, 7);
+		else bits.WriteCode(0xC0 + symbol - 280, 8);
+	}
+
+	std::vector<unsigned char> Deflate(const std::vector<unsigned char>& data, bool stored)
+	{
+		BitWriter bits;
+		bits.Bytes = { 0x78, 0x01 };
+
+		if (stored)
+		{
+			// Small blocks, so a long image spans several
+			const size_t blockSize = 1000;
+			size_t pos = 0;
+			do
+			{
+				size_t length = std::min(blockSize, data.size() - pos);
+				bits.Bytes.push_back(pos + length == data.size() ? 1 : 0);
+				bits.Bytes.push_back((unsigned char)length);
+				bits.Bytes.push_back((unsigned char)(length >> 8));
+				bits.Bytes.push_back((unsigned char)~length);
+				bits.Bytes.push_back((unsigned char)(~length >> 8));
+				bits.Bytes.insert(bits.Bytes.end(), data.begin() + pos, data.begin() + pos + length);
+				pos += length;
+			} while (pos < data.size());
+		}
+		else
+		{
+			bits.Used = 8;
+			bits.Write(1, 1);	// Final block
+			bits.Write(1, 2);	// Fixed Huffman
+			for (size_t i = 0; i < data.size();)
+			{
+				// Repeats of the previous byte as length 3-10 matches
+				size_t run = 0;
+				while (i > 0 && run < 10 && i + run < data.size() && data[i + run] == data[i - 1])
+					run++;
+
+				if (run >= 3)
+				{
+					WriteFixedLiteral(bits, 257 + (unsigned int)run - 3);
+					bits.WriteCode(0, 5);	// Distance 1
+					i += run;
+				}
+				else
+				{
+					WriteFixedLiteral(bits, data[i++]);
+				}
+			}
+			WriteFixedLiteral(bits, 256);
+		}
+
+		unsigned int a = 1, b = 0;
+		for (unsigned char c : data)
+		{
+			a = (a + c) % 65521;
+			b = (b + a) % 65521;
+		}
+		unsigned int adler = b << 16 | a;
+		for (int shift = 24; shift >= 0; shift -= 8)
+			bits.Bytes.push_back((unsigned char)(adler >> shift));
+		return bits.Bytes;
+	}
+
+	void PutU32(std::vector<unsigned char>& out, uint32_t value)
+	{
+		for (int shift = 24; shift >= 0; shift -= 8)
+			out.push_back((unsigned char)(value >> shift));
+	}
+
+	void AddChunk(std::vector<unsigned char>& png, const char* type, const std::vector<unsigned char>& data)
+	{
+		PutU32(png, (uint32_t)data.size());
+		size_t start = png.size();
+		png.insert(png.end(), type, type + 4);
+		png.insert(png.end(), data.begin(), data.end());
+
+		uint32_t crc = 0xFFFFFFFF;
+		for (size_t i = start; i < png.size(); i++)
+		{
+			crc ^= png[i];
+			for (int k = 0; k < 8; k++)
+				crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+		}
+		PutU32(png, ~crc);
+	}
+
+	unsigned char Paeth(int a, int b, int c)
+	{
+		int p = a + b - c;
+		int pa = std::abs(p - a), pb = std::abs(p - b), pc = std::abs(p - c);
+		return (unsigned char)(pa <= pb && pa <= pc ? a : pb <= pc ? b : c);
+	}
+
+	// --------------------------------------------------------
+	// One test image: random samples for the color type and
+	// depth, plus what the decoder should turn them into
+	// --------------------------------------------------------
+	struct TestImage
+	{
+		unsigned int Width;
+		unsigned int Height;
+		unsigned int ColorType;
+		unsigned int Depth;
+		bool Interlaced;
+		bool Transparency;
+
+		std::vector<unsigned int> Samples;		// Channels per pixel, in rows
+		std::vector<unsigned char> Palette;		// RGB
+		std::vector<unsigned char> PaletteAlpha;
+		unsigned int Key[3];					// tRNS color for gray & RGB
+
+		unsigned int Channels() const
+		{
+			switch (ColorType)
+			{
+			case 2: return 3;
+			case 4: return 2;
+			case 6: return 4;
+			default: return 1;
+			}
+		}
+	};
+
+	TestImage MakeTestImage(unsigned int width, unsigned int height, unsigned int colorType, unsigned int depth, bool interlaced, bool transparency)
+	{
+		TestImage image = { width, height, colorType, depth, interlaced, transparency, {}, {}, {}, {} };
+		unsigned int max = (1u << depth) - 1;
+		image.Samples.resize((size_t)width * height * image.Channels());
+		for (unsigned int& sample : image.Samples)
+			sample = (unsigned int)std::rand() & max;
+
+		if (colorType == 3)
+		{
+			for (unsigned int i = 0; i <= max; i++)
+				for (int c = 0; c < 3; c++)
+					image.Palette.push_back((unsigned char)std::rand());
+
+			// Alpha for only some of the entries; the rest are opaque
+			for (unsigned int i = 0; i < (max + 2) / 2; i++)
+				image.PaletteAlpha.push_back((unsigned char)std::rand());
+		}
+
+		// The first pixel's color is the transparent one, so it's used
+		for (unsigned int c = 0; c < 3; c++)
+			image.Key[c] = image.Samples[colorType == 2 ? c : 0];
+		return image;
+	}
+
+	std::vector<unsigned char> Expected(const TestImage& image)
+	{
+		std::vector<unsigned char> pixels((size_t)image.Width * image.Height * 4);
+		unsigned int max = (1u << image.Depth) - 1;
+		auto scale = [&](unsigned int v) { return (unsigned char)(image.Depth == 16 ? v >> 8 : v * 255 / max); };
+
+		for (size_t i = 0; i < (size_t)image.Width * image.Height; i++)
+		{
+			const unsigned int* s = &image.Samples[i * image.Channels()];
+			unsigned char* out = &pixels[i * 4];
+			switch (image.ColorType)
+			{
+			case 0:
+				out[0] = out[1] = out[2] = scale(s[0]);
+				out[3] = image.Transparency && s[0] == image.Key[0] ? 0 : 255;
+				break;
+			case 2:
+				for (int c = 0; c < 3; c++)
+					out[c] = scale(s[c]);
+				out[3] = image.Transparency && s[0] == image.Key[0] && s[1] == image.Key[1] && s[2] == image.Key[2] ? 0 : 255;
+				break;
+			case 3:
+				for (int c = 0; c < 3; c++)
+					out[c] = image.Palette[s[0] * 3 + c];
+				out[3] = image.Transparency && s[0] < image.PaletteAlpha.size() ? image.PaletteAlpha[s[0]] : 255;
+				break;
+			case 4:
+				out[0] = out[1] = out[2] = scale(s[0]);
+				out[3] = scale(s[1]);
+				break;
+			case 6:
+				for (int c = 0; c < 4; c++)
+					out[c] = scale(s[c]);
+				break;
+			}
+		}
+		return pixels;
+	}
+
+	std::vector<unsigned char> Encode(const TestImage& image, bool stored)
+	{
+		// Adam7 passes as start & step in x and y; one pass otherwise
+		const unsigned int adam7[7][4] = { { 0, 0, 8, 8 }, { 4, 0, 8, 8 }, { 0, 4, 4, 8 }, { 2, 0, 4, 4 }, { 0, 2, 2, 4 }, { 1, 0, 2, 2 }, { 0, 1, 1, 2 } };
+		const unsigned int whole[1][4] = { { 0, 0, 1, 1 } };
+		const unsigned int (*passes)[4] = image.Interlaced ? adam7 : whole;
+		unsigned int passCount = image.Interlaced ? 7 : 1;
+
+		unsigned int channels = image.Channels();
+		unsigned int bpp = std::max(1u, channels * image.Depth / 8);
+		std::vector<unsigned char> filtered;
+		unsigned int filter = 0;
+		for (unsigned int p = 0; p < passCount; p++)
+		{
+			std::vector<unsigned char> previous;
+			for (unsigned int y = passes[p][1]; y < image.Height; y += passes[p][3])
+			{
+				// Pack the row's samples, most significant bits first
+				std::vector<unsigned char> row;
+				unsigned int accumulated = 0, bits = 0;
+				for (unsigned int x = passes[p][0]; x < image.Width; x += passes[p][2])
+				{
+					for (unsigned int c = 0; c < channels; c++)
+					{
+						unsigned int sample = image.Samples[((size_t)y * image.Width + x) * channels + c];
+						if (image.Depth == 16)
+						{
+							row.push_back((unsigned char)(sample >> 8));
+							row.push_back((unsigned char)sample);
+							continue;
+						}
+
+						accumulated = accumulated << image.Depth | sample;
+						bits += image.Depth;
+						if (bits == 8)
+						{
+							row.push_back((unsigned char)accumulated);
+							accumulated = bits = 0;
+						}
+					}
+				}
+				if (bits)
+					row.push_back((unsigned char)(accumulated << (8 - bits)));
+				if (row.empty())
+					break;
+				if (previous.empty())
+					previous.assign(row.size(), 0);
+
+				// Every filter type in turn
+				filter = (filter + 1) % 5;
+				filtered.push_back((unsigned char)filter);
+				for (size_t i = 0; i < row.size(); i++)
+				{
+					int a = i >= bpp ? row[i - bpp] : 0;
+					int b = previous[i];
+					int c = i >= bpp ? previous[i - bpp] : 0;
+					int predicted = filter == 1 ? a : filter == 2 ? b : filter == 3 ? (a + b) / 2 : filter == 4 ? Paeth(a, b, c) : 0;
+					filtered.push_back((unsigned char)(row[i] - predicted));
+				}
+				previous = row;
+			}
+		}
+
+		std::vector<unsigned char> png = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+		std::vector<unsigned char> header;
+		PutU32(header, image.Width);
+		PutU32(header, image.Height);
+		header.insert(header.end(), { (unsigned char)image.Depth, (unsigned char)image.ColorType, 0, 0, (unsigned char)image.Interlaced });
+		AddChunk(png, "IHDR", header);
+		AddChunk(png, "gAMA", { 0, 0, 0xB1, 0x8F });	// Ignored
+
+		if (image.ColorType == 3)
+		{
+			AddChunk(png, "PLTE", image.Palette);
+			if (image.Transparency)
+				AddChunk(png, "tRNS", image.PaletteAlpha);
+		}
+		else if (image.Transparency)
+		{
+			std::vector<unsigned char> key;
+			for (unsigned int c = 0; c < (image.ColorType == 2 ? 3u : 1u); c++)
+			{
+				key.push_back((unsigned char)(image.Key[c] >> 8));
+				key.push_back((unsigned char)image.Key[c]);
+			}
+			AddChunk(png, "tRNS", key);
+		}
+
+		// Split across several IDAT chunks
+		std::vector<unsigned char> compressed = Deflate(filtered, stored);
+		for (size_t pos = 0; pos < compressed.size(); pos += 100)
+			AddChunk(png, "IDAT", std::vector<unsigned char>(compressed.begin() + pos, compressed.begin() + std::min(pos + 100, compressed.size())));
+		AddChunk(png, "IEND", {});
+		return png;
+	}
+
+	void TestFormats()
+	{
+		struct Format { unsigned int ColorType; unsigned int Depth; };
+		const Format formats[] =
+		{
+			{ 0, 1 }, { 0, 2 }, { 0, 4 }, { 0, 8 }, { 0, 16 },
+			{ 2, 8 }, { 2, 16 },
+			{ 3, 1 }, { 3, 2 }, { 3, 4 }, { 3, 8 },
+			{ 4, 8 }, { 4, 16 },
+			{ 6, 8 }, { 6, 16 },
+		};
+		const unsigned int sizes[][2] = { { 1, 1 }, { 13, 7 }, { 33, 17 }, { 3, 40 } };
+
+		std::srand(7);
+		int cases = 0;
+		for (const Format& format : formats)
+		{
+			for (const auto& size : sizes)
+			{
+				for (int variant = 0; variant < 8; variant++)
+				{
+					bool interlaced = variant & 1;
+					bool stored = (variant & 2) != 0;
+					bool transparency = (variant & 4) && format.ColorType != 4 && format.ColorType != 6;
+					TestImage image = MakeTestImage(size[0], size[1], format.ColorType, format.Depth, interlaced, transparency);
+					std::vector<unsigned char> png = Encode(image, stored);
+
+					BlockImage decoded = {};
+					bool ok = PNGDecoder::Decode(png.data(), png.size(), &decoded);
+					bool match = ok && decoded.Width == image.Width && decoded.Height == image.Height && decoded.Pixels == Expected(image);
+					if (!match)
+					{
+						std::printf("Color type %u, depth %u, %ux%u, interlaced %d, stored %d, tRNS %d\n",
+							format.ColorType, format.Depth, size[0], size[1], interlaced, stored, transparency);
+					}
+					CHECK(match);
+					cases++;
+				}
+			}
+		}
+		std::printf("%d generated PNGs decoded\n", cases);
+	}
+
+	void TestDamaged()
+	{
+		std::srand(11);
+		TestImage image = MakeTestImage(64, 33, 2, 8, false, false);
+		std::vector<unsigned char> png = Encode(image, false);
+		BlockImage decoded = {};
+
+		// Not a PNG at all, and cut short in various places
+		CHECK(!PNGDecoder::Decode(png.data() + 1, png.size() - 1, &decoded));
+		CHECK(!PNGDecoder::Decode(png.data(), 0, &decoded));
+		for (size_t size : { (size_t)8, (size_t)20, (size_t)40, png.size() / 2, png.size() - 20 })
+			CHECK(!PNGDecoder::Decode(png.data(), size, &decoded));
+
+		// Flipped bits anywhere past the signature must not crash;
+		// most also fail to decode, as the data stops inflating
+		int rejected = 0;
+		for (int i = 0; i < 2000; i++)
+		{
+			std::vector<unsigned char> damaged = png;
+			for (int k = 0; k < 3; k++)
+				damaged[8 + std::rand() % (damaged.size() - 8)] ^= (unsigned char)(1 << (std::rand() % 8));
+			if (!PNGDecoder::Decode(damaged.data(), damaged.size(), &decoded))
+				rejected++;
+		}
+		std::printf("%d of 2000 damaged PNGs rejected\n", rejected);
+
+		CHECK(!PNGDecoder::Load("Assets/Textures/PBR/missing.png", &decoded));
+	}
+
+	// --------------------------------------------------------
+	// FNV-1a over the RGBA8 a reference decoder (zlib plus the
+	// PNG filters) produced for some of the asset PNGs, which
+	// real encoders wrote with dynamic Huffman blocks
+	// --------------------------------------------------------
+	uint64_t Hash(const std::vector<unsigned char>& bytes)
+	{
+		uint64_t hash = 0xcbf29ce484222325ull;
+		for (unsigned char b : bytes)
+			hash = (hash ^ b) * 0x100000001b3ull;
+		return hash;
+	}
+
+	void TestAssets()
+	{
+		struct Asset { const char* Path; unsigned int Width; unsigned int Height; uint64_t Hash; };
+		const Asset assets[] =
+		{
+			{ "Assets/Textures/PBR/cobblestone_metal.png", 128, 128, 0x60e1021eed6c2325ull },
+			{ "Assets/Textures/PBR/floor_metal.png", 1024, 1024, 0x8edc16c0e55ae311ull },
+			{ "Assets/Textures/PBR/floor_roughness.png", 1024, 1024, 0xfc2c5823b2827cb6ull },
+			{ "Assets/Textures/PBR/wood_albedo.png", 1024, 1024, 0xf3a830b32c810b4aull },
+		};
+
+		for (const Asset& asset : assets)
+		{
+			BlockImage image = {};
+			TestTimer timer;
+			bool ok = PNGDecoder::Load(asset.Path, &image);
+			double seconds = timer.Seconds();
+
+			CHECK(ok);
+			CHECK(image.Width == asset.Width && image.Height == asset.Height);
+			CHECK(Hash(image.Pixels) == asset.Hash);
+			std::printf("%s: %.1f ms\n", asset.Path, seconds * 1000.0);
+		}
+
+		// Load() and Decode() of the same bytes agree
+		std::ifstream file("Assets/Textures/PBR/wood_metal.png", std::ios::binary);
+		std::vector<unsigned char> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		BlockImage fromMemory = {}, fromFile = {};
+		CHECK(PNGDecoder::Decode(bytes.data(), bytes.size(), &fromMemory));
+		CHECK(PNGDecoder::Load("Assets/Textures/PBR/wood_metal.png", &fromFile));
+		CHECK(fromMemory.Pixels == fromFile.Pixels);
+	}
+}
+
+int main()
+{
+	TestFormats();
+	TestDamaged();
+	TestAssets();
+	return TestResult();
+}
@@ -0,0 +1,227 @@
+// --------------------------------------------------------
+// PostProcessChain: which passes each combination of
+// enabled effects plans, and what a backend is asked to
+// draw once they're added to a render graph
+// --------------------------------------------------------
+#include "PostProcessChain.h"
+#include "PostResample.h"
+#include "Test.h"
+#include <string>
+#include <vector>
+
+namespace
+{
+	// --------------------------------------------------------
+	// Stand-in for Game: keeps every pass it's asked to draw
+	// --------------------------------------------------------
+	class RecordingBackend : public PostProcessBackend
+	{
+	public:
+		std::vector<PostPass> Draws;
+
+		void DrawPostPass(const PostPass& pass) { Draws.push_back(pass); }
+	};
+
+	// The effects Game sets up, with switches for the tests
+	struct Settings
+	{
+		bool Blur = false;
+		unsigned int BlurDownscale = 1;
+		bool Pixelate = false;
+		unsigned int PixelateDownscale = 1;
+		bool Color = false;
+		bool Vignette = false;
+	};
+
+	// Indices of the effects MakeChain() adds
+	enum { BLUR_ACROSS, BLUR_DOWN, PIXELATE, COLOR, VIGNETTE };
+
+	PostProcessChain MakeChain(const Settings& s)
+	{
+		PostProcessChain chain;
+		chain.Add("Blur across", POST_EFFECT_NEIGHBORHOOD, [&s]() { return s.Blur; }, [&s]() { return s.BlurDownscale; });
+		chain.Add("Blur down", POST_EFFECT_NEIGHBORHOOD, [&s]() { return s.Blur; }, [&s]() { return s.BlurDownscale; });
+		chain.Add("Pixelate", POST_EFFECT_NEIGHBORHOOD, [&s]() { return s.Pixelate; }, [&s]() { return s.PixelateDownscale; });
+		chain.Add("Color", POST_EFFECT_PIXEL, [&s]() { return s.Color; });
+		chain.Add("Vignette", POST_EFFECT_PIXEL, [&s]() { return s.Vignette; });
+		return chain;
+	}
+
+	// Passes as "type:effect+fused/downscale", to compare in one go
+	std::string Describe(const std::vector<PostPass>& passes)
+	{
+		std::string text;
+		for (const PostPass& pass : passes)
+		{
+			if (!text.empty())
+				text += " ";
+			text += pass.Type == POST_PASS_DOWNSAMPLE ? "down" : pass.Type == POST_PASS_UPSAMPLE ? "up" : "fx";
+			text += ':';
+			text += std::to_string(pass.Effect);
+			for (unsigned int fused : pass.Fused)
+			{
+				text += '+';
+				text += std::to_string(fused);
+			}
+			text += '/';
+			text += std::to_string(pass.Downscale);
+		}
+		return text;
+	}
+
+	void TestPlan()
+	{
+		Settings s;
+		PostProcessChain chain = MakeChain(s);
+		CHECK(chain.GetEffectCount() == 5);
+		CHECK(chain.GetEffect(PIXELATE).Name == "Pixelate");
+
+		// Everything off: no passes at all
+		CHECK(chain.Plan().empty());
+
+		// A pixel effect on its own gets a pass that reads the scene,
+		// and the next one joins it
+		s.Color = true;
+		CHECK(Describe(chain.Plan()) == "fx:-1+3/1");
+		s.Vignette = true;
+		CHECK(Describe(chain.Plan()) == "fx:-1+3+4/1");
+
+		// After a neighbourhood effect, pixel effects fuse into its pass
+		s.Pixelate = true;
+		CHECK(Describe(chain.Plan()) == "fx:2+3+4/1");
+		s.Blur = true;
+		CHECK(Describe(chain.Plan()) == "fx:0/1 fx:1/1 fx:2+3+4/1");
+		s.Color = s.Vignette = false;
+		CHECK(Describe(chain.Plan()) == "fx:0/1 fx:1/1 fx:2/1");
+
+		// The chain follows the predicates each time it plans
+		s.Blur = s.Pixelate = false;
+		CHECK(chain.Plan().empty());
+	}
+
+	void TestPlanDownscale()
+	{
+		Settings s;
+		PostProcessChain chain = MakeChain(s);
+
+		// Blur at half resolution, between a downsample and an upsample
+		// that the pixel effects then fuse into
+		s.Blur = true;
+		s.BlurDownscale = 2;
+		s.Color = true;
+		CHECK(Describe(chain.Plan()) == "down:-1/2 fx:0/2 fx:1/2 up:-1+3/2");
+
+		// Effects at different downscales go back up in between, and
+		// pixel effects after a reduced one fuse into its upsample,
+		// as they run at full resolution
+		s.Pixelate = true;
+		s.PixelateDownscale = 4;
+		CHECK(Describe(chain.Plan()) == "down:-1/2 fx:0/2 fx:1/2 up:-1/2 down:-1/4 fx:2/4 up:-1+3/4");
+		s.Color = false;
+		CHECK(Describe(chain.Plan()) == "down:-1/2 fx:0/2 fx:1/2 up:-1/2 down:-1/4 fx:2/4 up:-1/4");
+
+		// Out of range downscales are clamped
+		s.Pixelate = false;
+		s.BlurDownscale = 0;
+		CHECK(Describe(chain.Plan()) == "fx:0/1 fx:1/1");
+		s.BlurDownscale = 9;
+		std::string max = std::to_string(MAX_POST_DOWNSCALE);
+		CHECK(Describe(chain.Plan()) == "down:-1/" + max + " fx:0/" + max + " fx:1/" + max + " up:-1/" + max);
+
+		// Pixel effects don't take a downscale
+		PostProcessChain pixelOnly;
+		pixelOnly.Add("Color", POST_EFFECT_PIXEL, nullptr, []() { return 2u; });
+		CHECK(Describe(pixelOnly.Plan()) == "fx:-1+0/1");
+	}
+
+	void TestGraph()
+	{
+		const RenderGraphTextureDesc desc = { 801, 600, 28 };
+		const unsigned int depthFormat = 41;
+
+		Settings s;
+		PostProcessChain chain = MakeChain(s);
+		RecordingBackend backend;
+
+		// With nothing enabled the scene is drawn into the output
+		RenderGraph graph;
+		unsigned int backBuffer = graph.ImportTexture("Back buffer");
+		unsigned int depth = graph.ImportTexture("Depth");
+		CHECK(chain.AddToGraph(graph, backBuffer, depth, desc, depthFormat, backend) == backBuffer);
+		CHECK(graph.GetPassCount() == 0 && graph.GetTextureCount() == 2);
+
+		// Blurred at half size, pixelated and colored at full size
+		s.Blur = true;
+		s.BlurDownscale = 2;
+		s.Pixelate = true;
+		s.Color = true;
+		graph.Clear();
+		backBuffer = graph.ImportTexture("Back buffer");
+		depth = graph.ImportTexture("Depth");
+		unsigned int scene = chain.AddToGraph(graph, backBuffer, depth, desc, depthFormat, backend);
+		CHECK(scene != backBuffer);
+		CHECK(graph.GetTexture(scene).Desc == desc);
+
+		unsigned int scenePass = graph.AddPass("Scene", nullptr);
+		graph.Write(scenePass, scene);
+		graph.Write(scenePass, depth);
+		CHECK(graph.Compile());
+		graph.Execute();
+
+		std::vector<PostPass> planned = chain.Plan();
+		CHECK(Describe(planned) == "down:-1/2 fx:0/2 fx:1/2 up:-1/2 fx:2+3/1");
+		CHECK(Describe(backend.Draws) == Describe(planned));
+		if (backend.Draws.size() != 5)
+			return;
+
+		// Each pass reads the one before, starting from the scene
+		// and ending in the output
+		CHECK(backend.Draws[0].Input == scene);
+		for (size_t i = 1; i < backend.Draws.size(); i++)
+			CHECK(backend.Draws[i].Input == backend.Draws[i - 1].Output);
+		CHECK(backend.Draws.back().Output == backBuffer);
+
+		// Reduced passes draw at the reduced size, rounded up
+		RenderGraphTextureDesc half = graph.GetTexture(backend.Draws[1].Output).Desc;
+		CHECK(half.Width == 401 && half.Height == 300 && half.Format == desc.Format);
+		CHECK(graph.GetTexture(backend.Draws[0].Output).Desc == half);
+		CHECK(graph.GetTexture(backend.Draws[3].Output).Desc == desc);
+
+		// The downsample makes reduced depth for the upsample
+		unsigned int reducedDepth = backend.Draws[0].ReducedDepth;
+		CHECK(graph.GetTexture(reducedDepth).Desc.Format == depthFormat);
+		CHECK(graph.GetTexture(reducedDepth).Desc.Width == 401);
+		CHECK(backend.Draws[3].ReducedDepth == reducedDepth);
+
+		// Graph passes read and write what the chain's passes say
+		const RenderGraphPass& downsample = graph.GetPass(graph.GetOrder()[1]);
+		CHECK(downsample.Name == "Downsample");
+		CHECK(downsample.Reads == std::vector<unsigned int>({ scene, depth }));
+		CHECK(downsample.Writes == std::vector<unsigned int>({ backend.Draws[0].Output, reducedDepth }));
+		const RenderGraphPass& upsample = graph.GetPass(graph.GetOrder()[4]);
+		CHECK(upsample.Name == "Upsample");
+		CHECK(upsample.Reads == std::vector<unsigned int>({ backend.Draws[2].Output, reducedDepth, depth }));
+		CHECK(graph.GetPass(graph.GetOrder()[5]).Name == "Pixelate + Color");
+		CHECK(graph.GetOrder()[0] == scenePass);
+
+		// Half size color is needed three times over but only ever two
+		// at once, and the scene is done with before the upsample
+		// writes full size color again, so they share
+		unsigned int halfSlots = 0, fullSlots = 0;
+		for (const RenderGraphTextureDesc& slot : graph.GetPool())
+		{
+			halfSlots += slot == half;
+			fullSlots += slot == desc;
+		}
+		CHECK(halfSlots == 2);
+		CHECK(fullSlots == 1);
+	}
+}
+
+int main()
+{
+	TestPlan();
+	TestPlanDownscale();
+	TestGraph();
+	return TestResult();
+}
@@ -0,0 +1,154 @@
+// --------------------------------------------------------
+// PostResample: reduced sizes, depth linearization, and the
+// downsample and bilateral upsample against values worked
+// out by hand
+// --------------------------------------------------------
+#include "PostResample.h"
+#include "Test.h"
+#include <cstdlib>
+#include <vector>
+
+namespace
+{
+	// Red varies per pixel, the rest stays fixed
+	BlockImage MakeImage(unsigned int width, unsigned int height, const std::vector<unsigned char>& red)
+	{
+		BlockImage image = { width, height, std::vector<unsigned char>((size_t)width * height * 4) };
+		for (size_t i = 0; i < red.size(); i++)
+		{
+			image.Pixels[i * 4 + 0] = red[i];
+			image.Pixels[i * 4 + 1] = 64;
+			image.Pixels[i * 4 + 2] = 128;
+			image.Pixels[i * 4 + 3] = 255;
+		}
+		return image;
+	}
+
+	std::vector<int> Red(const BlockImage& image)
+	{
+		std::vector<int> red;
+		for (size_t i = 0; i < image.Pixels.size(); i += 4)
+			red.push_back(image.Pixels[i]);
+		return red;
+	}
+
+	// Results are rounded to 8 bits, which may go either way
+	// for exact halves
+	bool Near(const std::vector<int>& a, const std::vector<int>& b)
+	{
+		if (a.size() != b.size())
+			return false;
+		for (size_t i = 0; i < a.size(); i++)
+			if (std::abs(a[i] - b[i]) > 1)
+				return false;
+		return true;
+	}
+
+	void TestSizes()
+	{
+		CHECK(PostResample::GetReducedSize(801, 2) == 401);
+		CHECK(PostResample::GetReducedSize(600, 4) == 150);
+		CHECK(PostResample::GetReducedSize(601, 4) == 151);
+		CHECK(PostResample::GetReducedSize(1, 4) == 1);
+		CHECK(PostResample::GetReducedSize(8, 1) == 8);
+	}
+
+	void TestLinearizeDepth()
+	{
+		// A perspective projection from 0.1 to 100 maps depth 0 to
+		// the near plane and 1 to the far plane
+		const float nearZ = 0.1f, farZ = 100.0f;
+		float proj33 = farZ / (farZ - nearZ);
+		float proj43 = -nearZ * farZ / (farZ - nearZ);
+		CHECK_NEAR(PostResample::LinearizeDepth(0, proj33, proj43), nearZ, 1e-6);
+		CHECK_NEAR(PostResample::LinearizeDepth(1, proj33, proj43), farZ, 1e-3);
+
+		// And back from a point at distance 10
+		float depth = (10 * proj33 + proj43) / 10;
+		CHECK_NEAR(PostResample::LinearizeDepth(depth, proj33, proj43), 10, 1e-3);
+	}
+
+	void TestDownsample()
+	{
+		// 5x3 by 2: blocks on the right and bottom are clipped, so
+		// average fewer pixels
+		BlockImage image = MakeImage(5, 3, {
+			  0,  10,  20,  30,  40,
+			100, 110, 120, 130, 140,
+			200, 210, 220, 230, 240 });
+		BlockImage half = PostResample::Downsample(image, 2);
+		CHECK(half.Width == 3 && half.Height == 2);
+		CHECK(Near(Red(half), { 55, 75, 90, 205, 225, 240 }));
+		CHECK(half.Pixels[1] == 64 && half.Pixels[2] == 128 && half.Pixels[3] == 255);
+
+		// Downscale 1 changes nothing
+		CHECK(PostResample::Downsample(image, 1).Pixels == image.Pixels);
+
+		DepthImage depth = { 3, 3, {
+			1, 2, 3,
+			4, 5, 6,
+			7, 8, 9 } };
+		DepthImage halfDepth = PostResample::DownsampleDepth(depth, 2);
+		CHECK(halfDepth.Width == 2 && halfDepth.Height == 2);
+		CHECK(halfDepth.Depths == std::vector<float>({ 3.0f, 4.5f, 7.5f, 9.0f }));
+	}
+
+	void TestBilateralUpsample()
+	{
+		// 2x2 reduced texels back up to 4x4.  Pixel (1, 1) sits a
+		// quarter texel from texel (0, 0) each way, so its bilinear
+		// weights are 9/16, 3/16, 3/16 and 1/16.
+		BlockImage low = MakeImage(2, 2, { 0, 200, 40, 100 });
+		DepthImage lowDepth = { 2, 2, { 10, 10, 10, 10 } };
+		DepthImage fullDepth = { 4, 4, std::vector<float>(16, 10.0f) };
+
+		// With depths all equal it's a plain bilinear upsample,
+		// clamped at the edges
+		BlockImage flat = PostResample::BilateralUpsample(low, lowDepth, fullDepth, 2);
+		CHECK(flat.Width == 4 && flat.Height == 4);
+		std::vector<int> red = Red(flat);
+		CHECK(red[0] == 0 && red[3] == 200 && red[12] == 40 && red[15] == 100);
+		CHECK(std::abs(red[1 * 4 + 1] - 51) <= 1);		// 0 * 9/16 + 200 * 3/16 + 40 * 3/16 + 100 * 1/16 = 51.25
+		CHECK(std::abs(red[1 * 4 + 2] - 134) <= 1);		// 0 * 3/16 + 200 * 9/16 + 40 * 1/16 + 100 * 3/16 = 133.75
+
+		// Texel (1, 0) twice as far as the pixel: its depth differs by
+		// a whole pixel depth, so its weight is 3/16 / 1.01 while the
+		// others' are divided by the 0.01 epsilon alone
+		lowDepth.Depths[1] = 20;
+		BlockImage edge = PostResample::BilateralUpsample(low, lowDepth, fullDepth, 2);
+		double far = 3.0 / 16 / (BILATERAL_DEPTH_EPSILON + 1);
+		double near = 1.0 / BILATERAL_DEPTH_EPSILON;
+		double expected = (200 * far + (40 * 3.0 / 16 + 100 * 1.0 / 16) * near) /
+			(far + (9.0 / 16 + 3.0 / 16 + 1.0 / 16) * near);
+		CHECK_NEAR(expected, 17.34, 0.01);
+		CHECK(std::abs(Red(edge)[1 * 4 + 1] - 17) <= 1);
+
+		// A pixel on the far surface between texels (0, 0) and (1, 0)
+		// takes almost all of (1, 0), where bilinear alone gives 150:
+		// 200 * 75 / (0.25 / 0.51 + 0.75 / 0.01) = 198.7
+		fullDepth.Depths[0 * 4 + 2] = 20;
+		edge = PostResample::BilateralUpsample(low, lowDepth, fullDepth, 2);
+		CHECK(std::abs(Red(edge)[2] - 199) <= 1);
+
+		// A flat image survives the round trip whatever the depths
+		BlockImage image = MakeImage(7, 5, std::vector<unsigned char>(35, 90));
+		DepthImage depth = { 7, 5, std::vector<float>(35) };
+		for (size_t i = 0; i < depth.Depths.size(); i++)
+			depth.Depths[i] = 1.0f + (float)(i * 7 % 11);
+		for (unsigned int downscale = 1; downscale <= MAX_POST_DOWNSCALE; downscale++)
+		{
+			BlockImage result = PostResample::BilateralUpsample(PostResample::Downsample(image, downscale),
+				PostResample::DownsampleDepth(depth, downscale), depth, downscale);
+			CHECK(result.Pixels == image.Pixels);
+		}
+	}
+}
+
+int main()
+{
+	TestSizes();
+	TestLinearizeDepth();
+	TestDownsample();
+	TestBilateralUpsample();
+	return TestResult();
+}
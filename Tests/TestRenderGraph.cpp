@@ -0,0 +1,219 @@
+// --------------------------------------------------------
+// RenderGraph: culling, ordering, cycles and aliasing of
+// transient textures, and executing a compiled graph over
+// and over as Game does between rebuilds
+// --------------------------------------------------------
+#include "RenderGraph.h"
+#include "Test.h"
+#include <string>
+#include <vector>
+
+namespace
+{
+	const RenderGraphTextureDesc full = { 800, 600, 10 };
+	const RenderGraphTextureDesc half = { 400, 300, 10 };
+
+	// Names of the compiled passes, in order
+	std::string Describe(const RenderGraph& graph)
+	{
+		std::string text;
+		for (unsigned int pass : graph.GetOrder())
+			text += (text.empty() ? "" : " ") + graph.GetPass(pass).Name;
+		return text;
+	}
+
+	void TestCulling()
+	{
+		// A pass whose output nothing reads is dropped, along with
+		// whatever only it needed
+		RenderGraph graph;
+		unsigned int output = graph.ImportTexture("Output");
+		unsigned int scene = graph.CreateTexture("Scene", full);
+		unsigned int debug = graph.CreateTexture("Debug", full);
+		unsigned int debugInput = graph.CreateTexture("Debug input", full);
+
+		unsigned int debugPrep = graph.AddPass("Debug prep", nullptr);
+		graph.Write(debugPrep, debugInput);
+		unsigned int debugPass = graph.AddPass("Debug", nullptr);
+		graph.Read(debugPass, debugInput);
+		graph.Read(debugPass, scene);
+		graph.Write(debugPass, debug);
+		unsigned int present = graph.AddPass("Present", nullptr);
+		graph.Read(present, scene);
+		graph.Write(present, output);
+		unsigned int scenePass = graph.AddPass("Scene", nullptr);
+		graph.Write(scenePass, scene);
+
+		CHECK(graph.Compile());
+		CHECK(Describe(graph) == "Scene Present");
+		CHECK(graph.GetSlot(debug) == -1 && graph.GetSlot(debugInput) == -1);
+		CHECK(graph.GetSlot(output) == -1);
+		CHECK(graph.GetSlot(scene) == 0);
+		CHECK(graph.GetPool() == std::vector<RenderGraphTextureDesc>({ full }));
+
+		// Nothing reaching an imported texture means nothing runs
+		RenderGraph empty;
+		unsigned int unused = empty.AddPass("Unused", nullptr);
+		empty.Write(unused, empty.CreateTexture("Unused", full));
+		CHECK(empty.Compile());
+		CHECK(empty.GetOrder().empty() && empty.GetPool().empty());
+	}
+
+	void TestOrder()
+	{
+		// Added backwards, run forwards
+		RenderGraph graph;
+		unsigned int output = graph.ImportTexture("Output");
+		unsigned int a = graph.CreateTexture("A", full);
+		unsigned int b = graph.CreateTexture("B", full);
+
+		unsigned int third = graph.AddPass("Third", nullptr);
+		graph.Read(third, b);
+		graph.Write(third, output);
+		unsigned int second = graph.AddPass("Second", nullptr);
+		graph.Read(second, a);
+		graph.Write(second, b);
+		unsigned int first = graph.AddPass("First", nullptr);
+		graph.Write(first, a);
+		CHECK(graph.Compile());
+		CHECK(Describe(graph) == "First Second Third");
+
+		// Several writers of one texture keep the order they were
+		// added, and all run before its readers
+		RenderGraph layered;
+		output = layered.ImportTexture("Output");
+		unsigned int color = layered.CreateTexture("Color", full);
+		unsigned int resolve = layered.AddPass("Resolve", nullptr);
+		layered.Read(resolve, color);
+		layered.Write(resolve, output);
+		unsigned int opaque = layered.AddPass("Opaque", nullptr);
+		layered.Write(opaque, color);
+		unsigned int sky = layered.AddPass("Sky", nullptr);
+		layered.Write(sky, color);
+		unsigned int overlay = layered.AddPass("Overlay", nullptr);
+		layered.Write(overlay, color);
+		CHECK(layered.Compile());
+		CHECK(Describe(layered) == "Opaque Sky Overlay Resolve");
+
+		// Independent passes keep the order they were added
+		RenderGraph side;
+		output = side.ImportTexture("Output");
+		unsigned int x = side.AddPass("X", nullptr);
+		side.Write(x, output);
+		unsigned int y = side.AddPass("Y", nullptr);
+		side.Write(y, side.ImportTexture("Other output"));
+		CHECK(side.Compile());
+		CHECK(Describe(side) == "X Y");
+	}
+
+	void TestCycle()
+	{
+		RenderGraph graph;
+		unsigned int a = graph.CreateTexture("A", full);
+		unsigned int b = graph.CreateTexture("B", full);
+		unsigned int output = graph.ImportTexture("Output");
+
+		unsigned int p1 = graph.AddPass("P1", nullptr);
+		graph.Read(p1, b);
+		graph.Write(p1, a);
+		unsigned int p2 = graph.AddPass("P2", nullptr);
+		graph.Read(p2, a);
+		graph.Write(p2, b);
+		unsigned int p3 = graph.AddPass("P3", nullptr);
+		graph.Read(p3, a);
+		graph.Write(p3, output);
+
+		CHECK(!graph.Compile());
+		CHECK(graph.GetOrder().empty());
+
+		// A pass may read and write the same texture without that
+		// being a cycle
+		RenderGraph self;
+		output = self.ImportTexture("Output");
+		unsigned int inPlace = self.AddPass("In place", nullptr);
+		self.Read(inPlace, output);
+		self.Write(inPlace, output);
+		CHECK(self.Compile());
+		CHECK(Describe(self) == "In place");
+	}
+
+	void TestAliasing()
+	{
+		// A chain of full, half, full, half, full: each texture is
+		// done with once the next pass has read it
+		RenderGraph graph;
+		unsigned int output = graph.ImportTexture("Output");
+		std::vector<unsigned int> textures;
+		for (const char* name : { "A", "B", "C", "D", "E" })
+			textures.push_back(graph.CreateTexture(name, textures.size() % 2 ? half : full));
+
+		// Each pass is named after what it writes
+		unsigned int first = graph.AddPass("A", nullptr);
+		graph.Write(first, textures[0]);
+		for (size_t i = 1; i < textures.size(); i++)
+		{
+			unsigned int pass = graph.AddPass(graph.GetTexture(textures[i]).Name, nullptr);
+			graph.Read(pass, textures[i - 1]);
+			graph.Write(pass, textures[i]);
+		}
+		unsigned int present = graph.AddPass("Present", nullptr);
+		graph.Read(present, textures.back());
+		graph.Write(present, output);
+		CHECK(graph.Compile());
+
+		// Matching descriptions share once their lifetimes allow it,
+		// different ones never do
+		CHECK(graph.GetPool() == std::vector<RenderGraphTextureDesc>({ full, half }));
+		for (size_t i = 0; i < textures.size(); i++)
+			CHECK(graph.GetSlot(textures[i]) == (int)(i % 2));
+		for (unsigned int t : textures)
+			CHECK(graph.GetPool()[graph.GetSlot(t)] == graph.GetTexture(t).Desc);
+
+		// The same format at another size is a different texture
+		RenderGraphTextureDesc wide = full;
+		wide.Width++;
+		CHECK(wide != full && !(wide == full));
+	}
+
+	void TestExecute()
+	{
+		// A compiled graph runs its passes in order each time it's
+		// executed, with nothing to redo in between
+		std::string ran;
+		RenderGraph graph;
+		unsigned int output = graph.ImportTexture("Output");
+		unsigned int scene = graph.CreateTexture("Scene", full);
+		unsigned int post = graph.AddPass("Post", [&ran]() { ran += "post "; });
+		graph.Read(post, scene);
+		graph.Write(post, output);
+		unsigned int scenePass = graph.AddPass("Scene", [&ran]() { ran += "scene "; });
+		graph.Write(scenePass, scene);
+		unsigned int culled = graph.AddPass("Culled", [&ran]() { ran += "culled "; });
+		graph.Write(culled, graph.CreateTexture("Unused", full));
+		graph.AddPass("No work", nullptr);
+
+		CHECK(graph.Compile());
+		graph.Execute();
+		graph.Execute();
+		CHECK(ran == "scene post scene post ");
+
+		// Clear() leaves nothing behind for the next build
+		graph.Clear();
+		CHECK(graph.GetPassCount() == 0 && graph.GetTextureCount() == 0);
+		CHECK(graph.GetOrder().empty() && graph.GetPool().empty());
+		CHECK(graph.GetSlot(scene) == -1);
+		ran.clear();
+		graph.Execute();
+		CHECK(ran.empty());
+	}
+}
+
+int main()
+{
+	TestCulling();
+	TestOrder();
+	TestCycle();
+	TestAliasing();
+	TestExecute();
+	return TestResult();
+}
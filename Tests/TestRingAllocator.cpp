@@ -0,0 +1,138 @@
+// --------------------------------------------------------
+// RingAllocator's wrap and fence handling, step by step,
+// then at random against a byte array standing in for the
+// GPU buffer, checking no two live ranges ever overlap
+// --------------------------------------------------------
+#include "RingAllocator.h"
+#include "Test.h"
+#include <cstdlib>
+#include <deque>
+#include <vector>
+
+namespace
+{
+	void TestWrapAndFences()
+	{
+		RingAllocator ring(1024, 256);
+		unsigned int offset = 0;
+
+		// Sizes round up to the alignment
+		CHECK(ring.Allocate(10, &offset) && offset == 0);
+		CHECK(ring.Allocate(256, &offset) && offset == 256);
+		ring.EndFrame(1);
+		CHECK(ring.Allocate(300, &offset) && offset == 512);
+		CHECK(ring.GetUsed() == 1024);
+
+		// Full until the GPU finishes a frame
+		CHECK(!ring.Allocate(1, &offset));
+		ring.EndFrame(2);
+		CHECK(ring.GetFramesInFlight() == 2);
+		ring.Retire(0);
+		CHECK(!ring.Allocate(1, &offset));
+		ring.Retire(1);
+		CHECK(ring.GetUsed() == 512);
+		CHECK(ring.GetFramesInFlight() == 1);
+
+		// Wraps to the start, up to the oldest frame still in use
+		CHECK(ring.Allocate(256, &offset) && offset == 0);
+		CHECK(ring.Allocate(256, &offset) && offset == 256);
+		CHECK(!ring.Allocate(1, &offset));
+		ring.EndFrame(3);
+		ring.Retire(3);
+		CHECK(ring.GetUsed() == 0);
+		CHECK(ring.GetFramesInFlight() == 0);
+
+		// Too big, or empty, never fits
+		CHECK(!ring.Allocate(2048, &offset));
+		CHECK(!ring.Allocate(0, &offset));
+	}
+
+	void TestPadding()
+	{
+		// A range that doesn't fit before the end starts back at zero,
+		// and the skipped bytes belong to its frame
+		RingAllocator ring(1024, 256);
+		unsigned int offset = 0;
+		CHECK(ring.Allocate(768, &offset) && offset == 0);
+		ring.EndFrame(1);
+		CHECK(ring.Allocate(256, &offset) && offset == 768);
+		ring.EndFrame(2);
+		ring.Retire(1);
+
+		CHECK(ring.Allocate(512, &offset) && offset == 0);
+		CHECK(ring.GetUsed() == 256 + 512);
+		ring.EndFrame(3);
+		ring.Retire(2);
+		CHECK(ring.GetUsed() == 512);
+
+		// Capacity is trimmed to whole aligned blocks
+		RingAllocator odd(1000, 256);
+		CHECK(odd.GetCapacity() == 768);
+		CHECK(odd.Allocate(768, &offset) && offset == 0);
+
+		// Reset drops even frames that haven't finished
+		ring.Reset();
+		CHECK(ring.GetUsed() == 0);
+		CHECK(ring.Allocate(1024, &offset) && offset == 0);
+	}
+
+	void TestRandomAgainstBackingStore()
+	{
+		const unsigned int capacity = 4096;
+		const unsigned int alignment = 256;
+		RingAllocator ring(capacity, alignment);
+
+		// Which frame owns each byte, -1 when free
+		std::vector<long long> owner(capacity, -1);
+		struct Live { unsigned long long Frame; unsigned int Offset; unsigned int Size; };
+		std::deque<Live> live;
+		unsigned long long frame = 0;
+
+		std::srand(32);
+		for (unsigned int step = 0; step < 100000; step++)
+		{
+			int action = std::rand() % 5;
+			if (action < 3)
+			{
+				unsigned int size = std::rand() % 900 + 1;
+				unsigned int offset = 0;
+				if (!ring.Allocate(size, &offset))
+					continue;
+
+				unsigned int aligned = (size + alignment - 1) & ~(alignment - 1);
+				CHECK(offset % alignment == 0);
+				CHECK(offset + aligned <= capacity);
+				for (unsigned int b = offset; b < offset + aligned && b < capacity; b++)
+				{
+					CHECK(owner[b] < 0);
+					owner[b] = (long long)frame;
+				}
+				live.push_back({ frame, offset, aligned });
+			}
+			else if (action == 3)
+			{
+				ring.EndFrame(frame++);
+			}
+			else
+			{
+				// The GPU is two frames behind
+				unsigned long long completed = frame > 2 ? frame - 2 : 0;
+				ring.Retire(completed);
+				while (!live.empty() && live.front().Frame <= completed && live.front().Frame < frame)
+				{
+					for (unsigned int b = live.front().Offset; b < live.front().Offset + live.front().Size; b++)
+						owner[b] = -1;
+					live.pop_front();
+				}
+			}
+		}
+	}
+}
+
+int main()
+{
+	TestWrapAndFences();
+	TestPadding();
+	TestRandomAgainstBackingStore();
+	return TestResult();
+}
@@ -0,0 +1,137 @@
+// --------------------------------------------------------
+// ShaderPermutationTable: picking a variant for a key,
+// variant names and wrappers, and that the generated
+// wrappers and manifest in the repo agree with them
+// --------------------------------------------------------
+#include "ShaderPermutationTable.h"
+#include "Test.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+	const int any = SHADER_ANY_LIGHTS;
+	const unsigned int arrays = SHADER_FEATURE_TEXTURE_ARRAYS;
+	const unsigned int normalAndMaps = SHADER_FEATURE_NORMAL_MAP | SHADER_FEATURE_PBR_MAPS;
+
+	// The manifest ShaderPermutations.cpp compiles in
+	const ShaderPermutationEntry litManifest[] =
+	{
+#include "PixelShaderPermutations.inl"
+	};
+	const unsigned int litManifestCount = sizeof(litManifest) / sizeof(litManifest[0]);
+
+	bool Same(const ShaderPermutationKey& a, const ShaderPermutationKey& b)
+	{
+		return a.Features == b.Features && a.DirLights == b.DirLights && a.PointLights == b.PointLights && a.SpotLights == b.SpotLights;
+	}
+
+	void TestFindEntry()
+	{
+		const ShaderPermutationEntry manifest[] =
+		{
+			{ { SHADER_FEATURE_ALL, any, any, any }, L"general" },
+			{ { normalAndMaps, 3, 1, 1 }, L"fixed" },
+			{ { normalAndMaps, any, any, any }, L"any lights" },
+			{ { normalAndMaps, any, any, any }, L"any lights again" },
+			{ { SHADER_FEATURE_ALL | arrays, 3, 1, 1 }, L"arrays fixed" },
+			{ { SHADER_FEATURE_ALL | arrays, any, any, any }, L"arrays general" },
+		};
+		const unsigned int count = sizeof(manifest) / sizeof(manifest[0]);
+
+		// Exact match, whatever else is listed first
+		CHECK(ShaderPermutationTable::FindEntry(manifest, count, { normalAndMaps, 3, 1, 1 }) == 1);
+
+		// Other light counts take the first variant with the same
+		// features and any lights
+		CHECK(ShaderPermutationTable::FindEntry(manifest, count, { normalAndMaps, 2, 0, 0 }) == 2);
+
+		// Features nothing was built for take the general variant
+		CHECK(ShaderPermutationTable::FindEntry(manifest, count, { SHADER_FEATURE_SHADOWS, 3, 1, 1 }) == 0);
+		CHECK(ShaderPermutationTable::FindEntry(manifest, count, { 0, any, any, any }) == 0);
+
+		// Texture arrays only ever fall back to a variant with arrays
+		CHECK(ShaderPermutationTable::FindEntry(manifest, count, { SHADER_FEATURE_ALL | arrays, 3, 1, 1 }) == 4);
+		CHECK(ShaderPermutationTable::FindEntry(manifest, count, { SHADER_FEATURE_ALL | arrays, 1, 1, 1 }) == 5);
+		CHECK(ShaderPermutationTable::FindEntry(manifest, count, { SHADER_FEATURE_SHADOWS | arrays, 3, 1, 1 }) == 5);
+		CHECK(ShaderPermutationTable::FindGeneral(manifest, count, normalAndMaps) == 0);
+		CHECK(ShaderPermutationTable::FindGeneral(manifest, count, SHADER_FEATURE_SHADOWS | arrays) == 5);
+
+		// Without an arrays variant, the general one is all there is
+		CHECK(ShaderPermutationTable::FindGeneral(manifest, 4, SHADER_FEATURE_ALL | arrays) == 0);
+	}
+
+	void TestNames()
+	{
+		CHECK(ShaderPermutationTable::IsGeneral({ SHADER_FEATURE_ALL, any, any, any }));
+		CHECK(!ShaderPermutationTable::IsGeneral({ SHADER_FEATURE_ALL | arrays, any, any, any }));
+		CHECK(!ShaderPermutationTable::IsGeneral({ SHADER_FEATURE_ALL, 3, 1, 1 }));
+
+		CHECK(ShaderPermutationTable::GetName({ SHADER_FEATURE_ALL, any, any, any }) == "PixelShader");
+		CHECK(ShaderPermutationTable::GetName({ SHADER_FEATURE_ALL | arrays, any, any, any }) == "PixelShader_A");
+		CHECK(ShaderPermutationTable::GetName({ SHADER_FEATURE_ALL, 3, 1, 1 }) == "PixelShader_NMS_D3P1S1");
+		CHECK(ShaderPermutationTable::GetName({ normalAndMaps | arrays, 2, 0, 12 }) == "PixelShader_ANM_D2P0S12");
+		CHECK(ShaderPermutationTable::GetName({ SHADER_FEATURE_SHADOWS, any, any, any }) == "PixelShader_S");
+		CHECK(ShaderPermutationTable::GetName({ 0, any, any, any }) == "PixelShader_0");
+
+		// Only what differs from PixelShader.hlsl's defaults is set
+		std::string wrapper = ShaderPermutationTable::GetWrapper({ normalAndMaps, 2, 0, 1 });
+		CHECK(wrapper.find("#define PERM_NORMAL_MAP 1\n") != std::string::npos);
+		CHECK(wrapper.find("#define PERM_SHADOWS 0\n") != std::string::npos);
+		CHECK(wrapper.find("#define PERM_DIR_LIGHTS 2\n#define PERM_POINT_LIGHTS 0\n#define PERM_SPOT_LIGHTS 1\n") != std::string::npos);
+		CHECK(wrapper.find("PERM_TEXTURE_ARRAYS") == std::string::npos);
+		std::string include = "\n#include \"PixelShader.hlsl\"\n";
+		CHECK(wrapper.size() > include.size() && wrapper.substr(wrapper.size() - include.size()) == include);
+
+		wrapper = ShaderPermutationTable::GetWrapper({ SHADER_FEATURE_ALL | arrays, any, any, any });
+		CHECK(wrapper.find("#define PERM_TEXTURE_ARRAYS 1\n") != std::string::npos);
+		CHECK(wrapper.find("PERM_NORMAL_MAP") == std::string::npos);
+		CHECK(wrapper.find("PERM_DIR_LIGHTS") == std::string::npos);
+	}
+
+	void TestGenerated()
+	{
+		// General first, and each entry once, under its own name
+		CHECK(litManifestCount > 1);
+		CHECK(ShaderPermutationTable::IsGeneral(litManifest[0].Key));
+		std::vector<std::string> listed;
+		for (unsigned int i = 0; i < litManifestCount; i++)
+		{
+			const ShaderPermutationKey& key = litManifest[i].Key;
+			std::string name = ShaderPermutationTable::GetName(key);
+			CHECK(std::filesystem::path(litManifest[i].File) == std::filesystem::path(name + ".cso"));
+			CHECK(ShaderPermutationTable::FindEntry(litManifest, litManifestCount, key) == i);
+			for (unsigned int j = 0; j < i; j++)
+				CHECK(!Same(litManifest[j].Key, key));
+			if (ShaderPermutationTable::IsGeneral(key))
+				continue;
+
+			// The wrapper in the repo is what the generator writes now
+			std::ifstream file(name + ".hlsl", std::ios::binary);
+			std::stringstream text;
+			text << file.rdbuf();
+			CHECK(file && text.str() == ShaderPermutationTable::GetWrapper(key));
+			listed.push_back(name + ".hlsl");
+		}
+
+		// And no wrapper is left over from an older table
+		for (const auto& entry : std::filesystem::directory_iterator("."))
+		{
+			std::string file = entry.path().filename().string();
+			if (file.rfind("PixelShader_", 0) == 0 && entry.path().extension() == ".hlsl")
+				CHECK(std::find(listed.begin(), listed.end(), file) != listed.end());
+		}
+	}
+}
+
+int main()
+{
+	TestFindEntry();
+	TestNames();
+	TestGenerated();
+	return TestResult();
+}
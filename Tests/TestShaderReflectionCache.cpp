@@ -0,0 +1,126 @@
+// --------------------------------------------------------
+// Reflection sidecars: built, saved, mapped back and read
+// the same, and rejected when stale, cut short or damaged
+// --------------------------------------------------------
+#include "ShaderReflectionCache.h"
+#include "Test.h"
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+namespace
+{
+	const char bytecode[] = "stand-in for a compiled shader";
+
+	void Build(ShaderReflectionData& data, uint64_t hash)
+	{
+		data.Begin(hash);
+		data.AddBuffer("PerObject", 0, 256, 2);
+		data.AddVariable("world", 0, 64);
+		data.AddVariable("worldInvTrans", 64, 64);
+		data.AddBuffer("PerFrame", 0, 80, 0);
+		data.AddVariable("view", 0, 64);
+		data.AddResource("Albedo", SHADER_REFLECTION_TEXTURE, 0);
+		data.AddResource("BasicSampler", SHADER_REFLECTION_SAMPLER, 1);
+		data.AddInput("POSITION", 0, 7, 3, 0);
+		data.AddInput("WORLD_PER_INSTANCE", 2, 15, 3, 0);
+		data.AddOutput("SV_TARGET", 0, 15, 3, 0);
+		data.SetThreadGroupSize(8, 4, 1);
+	}
+
+	// Everything Build() added, through the read-only view
+	void CheckContents(const ShaderReflectionData& data)
+	{
+		CHECK(data.IsValid());
+		if (!data.IsValid())
+			return;
+
+		CHECK(data.GetBufferCount() == 2);
+		CHECK(data.GetVariableCount() == 3);
+		CHECK(data.GetResourceCount() == 2);
+		CHECK(data.GetInputCount() == 2);
+		CHECK(data.GetOutputCount() == 1);
+
+		CHECK(std::strcmp(data.GetName(data.GetBuffer(0).Name), "PerObject") == 0);
+		CHECK(data.GetBuffer(0).Size == 256 && data.GetBuffer(0).BindIndex == 2);
+		CHECK(data.GetBuffer(0).FirstVariable == 0 && data.GetBuffer(0).VariableCount == 2);
+		CHECK(data.GetBuffer(1).FirstVariable == 2 && data.GetBuffer(1).VariableCount == 1);
+		CHECK(std::strcmp(data.GetName(data.GetVariable(1).Name), "worldInvTrans") == 0);
+		CHECK(data.GetVariable(1).ByteOffset == 64);
+		CHECK(std::strcmp(data.GetName(data.GetVariable(2).Name), "view") == 0);
+
+		CHECK(data.GetResource(1).Type == SHADER_REFLECTION_SAMPLER);
+		CHECK(std::strcmp(data.GetName(data.GetResource(1).Name), "BasicSampler") == 0);
+		CHECK(std::strcmp(data.GetName(data.GetInput(1).SemanticName), "WORLD_PER_INSTANCE") == 0);
+		CHECK(data.GetInput(1).SemanticIndex == 2 && data.GetInput(1).Mask == 15);
+		CHECK(std::strcmp(data.GetName(data.GetOutput(0).SemanticName), "SV_TARGET") == 0);
+
+		CHECK(data.GetThreadGroupSize()[0] == 8);
+		CHECK(data.GetThreadGroupSize()[1] == 4);
+		CHECK(data.GetThreadGroupSize()[2] == 1);
+	}
+
+	void TestRoundTrip(const std::filesystem::path& path)
+	{
+		uint64_t hash = ShaderReflectionData::HashBytecode(bytecode, sizeof(bytecode));
+		CHECK(hash != ShaderReflectionData::HashBytecode(bytecode, sizeof(bytecode) - 1));
+
+		ShaderReflectionData built;
+		Build(built, hash);
+		CHECK(built.End());
+		CheckContents(built);
+		CHECK(built.Save(path));
+
+		// Mapped from the file, the tables read exactly the same
+		ShaderReflectionData loaded;
+		CHECK(loaded.Load(path, hash));
+		CheckContents(loaded);
+		CHECK(loaded.GetDataSize() == built.GetDataSize());
+		CHECK(std::memcmp(loaded.GetData(), built.GetData(), built.GetDataSize()) == 0);
+
+		// A rebuilt .cso makes the sidecar stale
+		CHECK(!loaded.Load(path, hash + 1));
+		CHECK(!loaded.IsValid());
+		CHECK(!loaded.Load(path.string() + ".missing", hash));
+	}
+
+	void TestDamagedData(const std::filesystem::path& path)
+	{
+		uint64_t hash = ShaderReflectionData::HashBytecode(bytecode, sizeof(bytecode));
+		std::ifstream file(path, std::ios::binary);
+		std::vector<char> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		CHECK(!bytes.empty());
+
+		// Any truncation is caught by the size check
+		ShaderReflectionData data;
+		for (size_t size = 0; size < bytes.size(); size++)
+			CHECK(!data.Parse(bytes.data(), size, hash));
+
+		// Flipped bits either fail to parse, or leave names that
+		// still point inside the (terminated) name block
+		for (size_t i = 0; i < bytes.size(); i++)
+		{
+			std::vector<char> damaged = bytes;
+			damaged[i] ^= 0x80;
+			if (!data.Parse(damaged.data(), damaged.size(), hash))
+				continue;
+
+			const char* end = (const char*)data.GetData() + data.GetDataSize();
+			for (uint32_t v = 0; v < data.GetVariableCount(); v++)
+				CHECK(data.GetName(data.GetVariable(v).Name) < end);
+			for (uint32_t b = 0; b < data.GetBufferCount(); b++)
+				CHECK(data.GetBuffer(b).FirstVariable + data.GetBuffer(b).VariableCount <= data.GetVariableCount());
+		}
+	}
+}
+
+int main()
+{
+	std::filesystem::path path = std::filesystem::temp_directory_path() / "TestShaderReflectionCache.refl";
+	TestRoundTrip(path);
+	TestDamagedData(path);
+	std::filesystem::remove(path);
+	return TestResult();
+}
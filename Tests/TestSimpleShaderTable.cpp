@@ -0,0 +1,120 @@
+// --------------------------------------------------------
+// SimpleShaderTable lookups, including names whose hashes
+// collide, then a benchmark of resolving a parameter by
+// name, by pre-computed hash and through a handle
+// --------------------------------------------------------
+#include "SimpleShaderTable.h"
+#include "Test.h"
+#include <string>
+#include <vector>
+
+namespace
+{
+	// Known FNV-1a 32-bit collisions
+	static_assert(SimpleShaderHash("costarring") == SimpleShaderHash("liquid"));
+	static_assert(SimpleShaderHash("declinate") == SimpleShaderHash("macallums"));
+
+	// Hashes are usable at compile time
+	constexpr unsigned int WorldHash = SimpleShaderHash("world");
+	static_assert(SimpleShaderHash("") == 2166136261u);
+
+	void TestLookups()
+	{
+		SimpleShaderTable table;
+		table.Add("world", 0);
+		table.Add("view", 1);
+		table.Add("projection", 2);
+		CHECK(table.Sort());
+		CHECK(table.GetCount() == 3);
+
+		CHECK(table.Find("view").Index == 1);
+		CHECK(table.Find(SimpleShaderHash("projection")).Index == 2);
+		CHECK(table.Find(WorldHash).Index == 0);
+		CHECK(!table.Find("colorTint").IsValid());
+		CHECK(!table.Find(SimpleShaderHash("colorTint")).IsValid());
+
+		table.Clear();
+		CHECK(!table.Find("view").IsValid());
+	}
+
+	void TestCollisions()
+	{
+		// A name the shader doesn't have, with the hash of one it
+		// does, must not resolve to that one
+		SimpleShaderTable table;
+		table.Add("liquid", 7);
+		CHECK(table.Sort());
+		CHECK(table.Find("liquid").Index == 7);
+		CHECK(!table.Find("costarring").IsValid());
+
+		// Both names of a collision are found by name, and the hash
+		// finds the first added; the collision is reported
+		SimpleShaderTable both;
+		both.Add("macallums", 3);
+		both.Add("ambient", 4);
+		both.Add("declinate", 5);
+		CHECK(!both.Sort());
+		CHECK(both.Find("macallums").Index == 3);
+		CHECK(both.Find("declinate").Index == 5);
+		CHECK(both.Find("ambient").Index == 4);
+		CHECK(both.Find(SimpleShaderHash("declinate")).Index == 3);
+	}
+
+	// --------------------------------------------------------
+	// What each setter costs before it writes its bytes: the
+	// string API builds a string and searches by name, hashes
+	// skip the string, and handles skip the search
+	// --------------------------------------------------------
+	void BenchmarkLookups()
+	{
+		// About as many variables as the lit shaders have
+		SimpleShaderTable table;
+		std::vector<std::string> names;
+		for (unsigned int i = 0; i < 32; i++)
+		{
+			names.push_back("shaderVariableNumber" + std::to_string(i));
+			table.Add(names.back().c_str(), i);
+		}
+		table.Sort();
+
+		const unsigned int sets = 1000000;
+		std::vector<float> variables(names.size());
+		std::vector<unsigned int> hashes;
+		std::vector<SimpleShaderParam> handles;
+		for (const std::string& name : names)
+		{
+			hashes.push_back(SimpleShaderHash(name.c_str()));
+			handles.push_back(table.Find(name.c_str()));
+		}
+
+		TestTimer byName;
+		for (unsigned int i = 0; i < sets; i++)
+		{
+			std::string name = names[i % names.size()]; // As the old by-value std::string parameter
+			variables[table.Find(name.c_str()).Index] = (float)i;
+		}
+		double nameSeconds = byName.Seconds();
+
+		TestTimer byHash;
+		for (unsigned int i = 0; i < sets; i++)
+			variables[table.Find(hashes[i % hashes.size()]).Index] = (float)i;
+		double hashSeconds = byHash.Seconds();
+
+		TestTimer byHandle;
+		for (unsigned int i = 0; i < sets; i++)
+			variables[handles[i % handles.size()].Index] = (float)i;
+		double handleSeconds = byHandle.Seconds();
+
+		CHECK(variables[0] > 0);
+		std::printf("Sets per second: by name %.1f M, by hash %.1f M, by handle %.1f M\n",
+			sets / nameSeconds / 1e6, sets / hashSeconds / 1e6, sets / handleSeconds / 1e6);
+	}
+}
+
+int main()
+{
+	TestLookups();
+	TestCollisions();
+	BenchmarkLookups();
+	return TestResult();
+}
@@ -0,0 +1,316 @@
+// --------------------------------------------------------
+// SphericalHarmonics: irradiance from the 9 coefficients
+// against integrating the cube map texel by texel, for
+// environments with known answers, a sky with a sun and
+// the real sky, plus the shader's packed polynomial
+// --------------------------------------------------------
+#include "SphericalHarmonics.h"
+#include "PNGDecoder.h"
+#include "Test.h"
+#include <algorithm>
+#include <functional>
+#include <string>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	typedef std::function<XMFLOAT3(float x, float y, float z)> Radiance;
+
+	double ToLinear(unsigned char c)
+	{
+		double f = c / 255.0;
+		return f <= 0.04045 ? f / 12.92 : std::pow((f + 0.055) / 1.055, 2.4);
+	}
+
+	unsigned char ToSRGB(float c)
+	{
+		c = std::clamp(c, 0.0f, 1.0f);
+		float s = c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1 / 2.4f) - 0.055f;
+		return (unsigned char)(s * 255.0f + 0.5f);
+	}
+
+	// Unnormalized direction through (u, v) of a face, in the
+	// D3D convention: +X, -X, +Y, -Y, +Z, -Z, with v downward
+	void FaceDirection(int face, double u, double v, double d[3])
+	{
+		const double directions[6][3] =
+		{
+			{ 1, -v, -u }, { -1, -v, u }, { u, 1, v }, { u, -1, -v }, { u, -v, 1 }, { -u, -v, -1 }
+		};
+		for (int i = 0; i < 3; i++)
+			d[i] = directions[face][i];
+	}
+
+	struct Cubemap
+	{
+		BlockImage Images[6];
+		const BlockImage* Faces[6];
+	};
+
+	void MakeCubemap(Cubemap& cube, unsigned int size, Radiance radiance)
+	{
+		for (int face = 0; face < 6; face++)
+		{
+			BlockImage& image = cube.Images[face];
+			image = { size, size, std::vector<unsigned char>((size_t)size * size * 4, 255) };
+			for (unsigned int y = 0; y < size; y++)
+			{
+				for (unsigned int x = 0; x < size; x++)
+				{
+					double d[3];
+					FaceDirection(face, (x + 0.5) * 2 / size - 1, (y + 0.5) * 2 / size - 1, d);
+					double length = std::sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+					XMFLOAT3 color = radiance((float)(d[0] / length), (float)(d[1] / length), (float)(d[2] / length));
+					unsigned char* pixel = &image.Pixels[((size_t)y * size + x) * 4];
+					pixel[0] = ToSRGB(color.x);
+					pixel[1] = ToSRGB(color.y);
+					pixel[2] = ToSRGB(color.z);
+				}
+			}
+			cube.Faces[face] = &image;
+		}
+	}
+
+	// --------------------------------------------------------
+	// Irradiance by brute force: every texel's radiance times
+	// the cosine to the normal and the texel's solid angle
+	// (its area over the cube of the distance to it)
+	// --------------------------------------------------------
+	XMFLOAT3 IntegrateIrradiance(const BlockImage* const faces[6], XMFLOAT3 normal)
+	{
+		double n[3] = { normal.x, normal.y, normal.z };
+		double nLength = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+		double sum[3] = {};
+		for (int face = 0; face < 6; face++)
+		{
+			if (!faces[face])
+				continue;
+
+			const BlockImage& image = *faces[face];
+			for (unsigned int y = 0; y < image.Height; y++)
+			{
+				for (unsigned int x = 0; x < image.Width; x++)
+				{
+					double u = (x + 0.5) * 2 / image.Width - 1;
+					double v = (y + 0.5) * 2 / image.Height - 1;
+					double d[3];
+					FaceDirection(face, u, v, d);
+
+					double length = std::sqrt(1 + u * u + v * v);
+					double cosine = (d[0] * n[0] + d[1] * n[1] + d[2] * n[2]) / (length * nLength);
+					if (cosine <= 0)
+						continue;
+
+					double solidAngle = (2.0 / image.Width) * (2.0 / image.Height) / (length * length * length);
+					const unsigned char* pixel = &image.Pixels[((size_t)y * image.Width + x) * 4];
+					for (int c = 0; c < 3; c++)
+						sum[c] += ToLinear(pixel[c]) * cosine * solidAngle;
+				}
+			}
+		}
+		return XMFLOAT3((float)sum[0], (float)sum[1], (float)sum[2]);
+	}
+
+	// Normals along the axes, between them, and some in between
+	std::vector<XMFLOAT3> TestNormals()
+	{
+		std::vector<XMFLOAT3> normals =
+		{
+			{ 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 },
+			{ 1, 1, 1 }, { -1, 1, -1 }, { 1, -1, 1 }, { -1, -1, -1 },
+		};
+		for (int i = 0; i < 40; i++)
+		{
+			float theta = i * 2.39996f;	// Golden angle spiral
+			float y = 1 - (i + 0.5f) / 20.0f;
+			float r = std::sqrt(std::max(0.0f, 1 - y * y));
+			normals.push_back(XMFLOAT3(r * std::cos(theta), y, r * std::sin(theta)));
+		}
+		return normals;
+	}
+
+	// Largest error relative to the brightest irradiance seen, so
+	// directions facing away from all the light don't dominate
+	double CompareToIntegral(const BlockImage* const faces[6], const SHColor& irradiance, double* meanError)
+	{
+		std::vector<XMFLOAT3> normals = TestNormals();
+		std::vector<XMFLOAT3> expected, actual;
+		double brightest = 0;
+		for (const XMFLOAT3& n : normals)
+		{
+			expected.push_back(IntegrateIrradiance(faces, n));
+			actual.push_back(SphericalHarmonics::Evaluate(irradiance, n));
+			brightest = std::max(brightest, (double)std::max({ expected.back().x, expected.back().y, expected.back().z }));
+		}
+
+		double worst = 0, total = 0;
+		for (size_t i = 0; i < normals.size(); i++)
+		{
+			double error = std::max({
+				std::fabs(actual[i].x - expected[i].x),
+				std::fabs(actual[i].y - expected[i].y),
+				std::fabs(actual[i].z - expected[i].z) }) / brightest;
+			worst = std::max(worst, error);
+			total += error;
+		}
+		*meanError = total / normals.size();
+		return worst;
+	}
+
+	void TestConstant()
+	{
+		// Uniform white light gives pi in every direction, and
+		// nothing past the first band
+		Cubemap cube;
+		MakeCubemap(cube, 16, [](float, float, float) { return XMFLOAT3(1, 1, 1); });
+		SHColor radiance = SphericalHarmonics::ProjectCubemap(cube.Faces, 2);
+		SHColor irradiance = SphericalHarmonics::ConvolveIrradiance(radiance);
+
+		CHECK_NEAR(SphericalHarmonics::Evaluate(radiance, XMFLOAT3(0.2f, 0.9f, -0.3f)).x, 1, 0.002);
+		CHECK_NEAR(SphericalHarmonics::Evaluate(irradiance, XMFLOAT3(0, 0, 5)).y, XM_PI, 0.005);
+		CHECK_NEAR(SphericalHarmonics::Evaluate(irradiance, XMFLOAT3(-1, -1, 0)).z, XM_PI, 0.005);
+		for (int i = 1; i < SH_COEFFICIENT_COUNT; i++)
+			CHECK_NEAR(radiance.Coefficients[i].x, 0, 0.001);
+	}
+
+	void TestLinear()
+	{
+		// Radiance 0.5 + 0.5y lies entirely in bands 0 and 1, so its
+		// irradiance is exactly pi/2 + (pi/3)y: 2pi/3 scales band 1
+		Cubemap cube;
+		MakeCubemap(cube, 32, [](float, float y, float) { return XMFLOAT3(0.5f + 0.5f * y, 0.5f, 0); });
+		SHColor irradiance = SphericalHarmonics::ConvolveIrradiance(SphericalHarmonics::ProjectCubemap(cube.Faces, 1));
+
+		for (const XMFLOAT3& n : TestNormals())
+		{
+			float y = n.y / std::sqrt(n.x * n.x + n.y * n.y + n.z * n.z);
+			XMFLOAT3 e = SphericalHarmonics::Evaluate(irradiance, n);
+			CHECK_NEAR(e.x, XM_PIDIV2 + XM_PI / 3 * y, 0.02);
+			CHECK_NEAR(e.y, XM_PIDIV2, 0.01);
+			CHECK_NEAR(e.z, 0, 0.001);
+		}
+	}
+
+	void TestSky()
+	{
+		// A blue gradient sky, a dark ground and a small bright sun:
+		// the worst case for three bands, as the sun is anything but
+		// smooth.  The cosine lobe still blurs it enough.
+		Cubemap cube;
+		MakeCubemap(cube, 48, [](float x, float y, float z)
+		{
+			float sun = x * 0.5f + y * 0.7f + z * 0.5f > 0.97f ? 1.0f : 0.0f;
+			if (y < 0)
+				return XMFLOAT3(0.05f + sun, 0.04f + sun, 0.03f + sun);
+			return XMFLOAT3(0.2f + 0.1f * y + sun, 0.3f + 0.2f * y + sun, 0.5f + 0.4f * y + sun);
+		});
+		SHColor irradiance = SphericalHarmonics::ConvolveIrradiance(SphericalHarmonics::ProjectCubemap(cube.Faces, 4));
+
+		double mean = 0;
+		double worst = CompareToIntegral(cube.Faces, irradiance, &mean);
+		std::printf("Sky with sun: error %.2f%% mean, %.2f%% worst, of the brightest irradiance\n", mean * 100, worst * 100);
+		CHECK(mean < 0.01);
+		CHECK(worst < 0.02);
+
+		// Threads only change the order of the sums
+		SHColor single = SphericalHarmonics::ProjectCubemap(cube.Faces, 1);
+		SHColor several = SphericalHarmonics::ProjectCubemap(cube.Faces, 7);
+		for (int i = 0; i < SH_COEFFICIENT_COUNT; i++)
+			CHECK_NEAR(single.Coefficients[i].z, several.Coefficients[i].z, 1e-4);
+
+		// Missing faces are black, and sizes can differ
+		Cubemap lit;
+		MakeCubemap(lit, 24, [](float, float, float) { return XMFLOAT3(1, 0.5f, 0.25f); });
+		BlockImage smaller = { 8, 8, std::vector<unsigned char>(8 * 8 * 4, 255) };
+		const BlockImage* partial[6] = { 0, 0, lit.Faces[2], 0, &smaller, 0 };
+		irradiance = SphericalHarmonics::ConvolveIrradiance(SphericalHarmonics::ProjectCubemap(partial, 2));
+		worst = CompareToIntegral(partial, irradiance, &mean);
+		std::printf("Two faces lit: error %.2f%% mean, %.2f%% worst\n", mean * 100, worst * 100);
+		CHECK(worst < 0.03);
+	}
+
+	void TestPacking()
+	{
+		// The shader's polynomial (AmbientSH() in PBRFuncs.hlsli) is
+		// irradiance over pi, times the scale
+		Cubemap cube;
+		MakeCubemap(cube, 16, [](float x, float y, float z) { return XMFLOAT3(0.5f + 0.4f * x * y, 0.3f + 0.3f * z, 0.2f + 0.2f * x * x); });
+		SHColor irradiance = SphericalHarmonics::ConvolveIrradiance(SphericalHarmonics::ProjectCubemap(cube.Faces, 1));
+
+		XMFLOAT4 sh[SH_COEFFICIENT_COUNT];
+		const float scale = 2.5f;
+		SphericalHarmonics::PackForShader(irradiance, scale, sh);
+		for (const XMFLOAT3& normal : TestNormals())
+		{
+			float length = std::sqrt(normal.x * normal.x + normal.y * normal.y + normal.z * normal.z);
+			float x = normal.x / length, y = normal.y / length, z = normal.z / length;
+			float ambient[3];
+			for (int c = 0; c < 3; c++)
+			{
+				auto k = [&](int i) { return (&sh[i].x)[c]; };
+				ambient[c] = k(0) + k(1) * y + k(2) * z + k(3) * x + k(4) * (x * y) + k(5) * (y * z) +
+					k(6) * (3 * z * z - 1) + k(7) * (x * z) + k(8) * (x * x - y * y);
+			}
+			XMFLOAT3 e = SphericalHarmonics::Evaluate(irradiance, normal);
+			CHECK_NEAR(ambient[0], e.x * scale / XM_PI, 1e-4);
+			CHECK_NEAR(ambient[1], e.y * scale / XM_PI, 1e-4);
+			CHECK_NEAR(ambient[2], e.z * scale / XM_PI, 1e-4);
+		}
+	}
+
+	void TestRealSky()
+	{
+		// The sky the demo uses, faces in D3D order (it has no "up")
+		const char* names[6] = { "right", "left", "up", "down", "front", "back" };
+		BlockImage images[6];
+		const BlockImage* faces[6] = {};
+		for (int i = 0; i < 6; i++)
+			if (PNGDecoder::Load(std::string("Assets/Textures/Skies/Clouds Pink/") + names[i] + ".png", &images[i]))
+				faces[i] = &images[i];
+		CHECK(faces[0] && faces[1] && faces[4]);
+
+		TestTimer timer;
+		SHColor full = SphericalHarmonics::ProjectCubemap(faces, 4);
+		double seconds = timer.Seconds();
+		std::printf("Projecting the sky (%ux%u faces), 4 threads: %.1f ms\n", images[0].Width, images[0].Height, seconds * 1000.0);
+
+		// Brute force on every texel would be slow, so compare on every
+		// 16th; the projection of the smaller faces must agree too
+		BlockImage small[6];
+		const BlockImage* smallFaces[6] = {};
+		for (int i = 0; i < 6; i++)
+		{
+			if (!faces[i])
+				continue;
+			small[i] = { images[i].Width / 16, images[i].Height / 16, {} };
+			small[i].Pixels.resize((size_t)small[i].Width * small[i].Height * 4);
+			for (unsigned int y = 0; y < small[i].Height; y++)
+				for (unsigned int x = 0; x < small[i].Width; x++)
+					for (int c = 0; c < 4; c++)
+						small[i].Pixels[((size_t)y * small[i].Width + x) * 4 + c] = images[i].Pixels[((size_t)y * 16 * images[i].Width + x * 16) * 4 + c];
+			smallFaces[i] = &small[i];
+		}
+
+		SHColor irradiance = SphericalHarmonics::ConvolveIrradiance(SphericalHarmonics::ProjectCubemap(smallFaces, 4));
+		double mean = 0;
+		double worst = CompareToIntegral(smallFaces, irradiance, &mean);
+		std::printf("Clouds Pink: error %.2f%% mean, %.2f%% worst\n", mean * 100, worst * 100);
+		CHECK(worst < 0.03);
+
+		XMFLOAT3 up = SphericalHarmonics::Evaluate(SphericalHarmonics::ConvolveIrradiance(full), XMFLOAT3(0, 1, 0));
+		XMFLOAT3 upSmall = SphericalHarmonics::Evaluate(irradiance, XMFLOAT3(0, 1, 0));
+		CHECK_NEAR(up.x, upSmall.x, 0.05 * up.x);
+	}
+}
+
+int main()
+{
+	TestConstant();
+	TestLinear();
+	TestSky();
+	TestPacking();
+	TestRealSky();
+	return TestResult();
+}
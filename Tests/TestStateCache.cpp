@@ -0,0 +1,222 @@
+// --------------------------------------------------------
+// StateCache against a backend that records what reaches
+// it, checking which binds are issued and which skipped
+// --------------------------------------------------------
+#include "StateCache.h"
+#include "Test.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace
+{
+	// --------------------------------------------------------
+	// Stand-in for the device context: keeps the name of each
+	// call, and the range of the last PSSetShaderResources()
+	// --------------------------------------------------------
+	class RecordingBackend : public StateCacheBackend
+	{
+	public:
+		std::vector<std::string> Calls;
+		bool Offsets = true;
+		unsigned int LastPSResourceStart = 0;
+		unsigned int LastPSResourceCount = 0;
+
+		bool SupportsConstantBufferOffsets() { return Offsets; }
+
+		void VSSetShader(ID3D11VertexShader*) { Calls.push_back("VSSetShader"); }
+		void PSSetShader(ID3D11PixelShader*) { Calls.push_back("PSSetShader"); }
+		void IASetInputLayout(ID3D11InputLayout*) { Calls.push_back("IASetInputLayout"); }
+		void IASetPrimitiveTopology(unsigned int) { Calls.push_back("IASetPrimitiveTopology"); }
+		void IASetVertexBuffer(unsigned int, ID3D11Buffer*, unsigned int, unsigned int) { Calls.push_back("IASetVertexBuffer"); }
+		void IASetIndexBuffer(ID3D11Buffer*, unsigned int, unsigned int) { Calls.push_back("IASetIndexBuffer"); }
+
+		void VSSetConstantBuffer(unsigned int, ID3D11Buffer*) { Calls.push_back("VSSetConstantBuffer"); }
+		void PSSetConstantBuffer(unsigned int, ID3D11Buffer*) { Calls.push_back("PSSetConstantBuffer"); }
+		void VSSetConstantBuffer1(unsigned int, ID3D11Buffer*, unsigned int, unsigned int) { Calls.push_back("VSSetConstantBuffer1"); }
+		void PSSetConstantBuffer1(unsigned int, ID3D11Buffer*, unsigned int, unsigned int) { Calls.push_back("PSSetConstantBuffer1"); }
+		void VSSetShaderResources(unsigned int, unsigned int, ID3D11ShaderResourceView* const*) { Calls.push_back("VSSetShaderResources"); }
+		void PSSetShaderResources(unsigned int startSlot, unsigned int count, ID3D11ShaderResourceView* const*)
+		{
+			Calls.push_back("PSSetShaderResources");
+			LastPSResourceStart = startSlot;
+			LastPSResourceCount = count;
+		}
+		void VSSetSampler(unsigned int, ID3D11SamplerState*) { Calls.push_back("VSSetSampler"); }
+		void PSSetSampler(unsigned int, ID3D11SamplerState*) { Calls.push_back("PSSetSampler"); }
+
+		void RSSetState(ID3D11RasterizerState*) { Calls.push_back("RSSetState"); }
+		void OMSetDepthStencilState(ID3D11DepthStencilState*, unsigned int) { Calls.push_back("OMSetDepthStencilState"); }
+	};
+
+	// Distinct addresses to stand in for API objects, which
+	// the cache only ever compares
+	char objects[16];
+	template<typename T> T* Fake(int i) { return reinterpret_cast<T*>(&objects[i]); }
+
+	void TestRedundantBinds()
+	{
+		std::shared_ptr<RecordingBackend> backend = std::make_shared<RecordingBackend>();
+		StateCache cache(backend);
+
+		// Nothing is known at first, so even null goes through
+		cache.SetVertexShader(0);
+		cache.SetVertexShader(0);
+		cache.SetVertexShader(Fake<ID3D11VertexShader>(0));
+		cache.SetVertexShader(Fake<ID3D11VertexShader>(0));
+		cache.SetPixelShader(Fake<ID3D11PixelShader>(1));
+		cache.SetPixelShader(Fake<ID3D11PixelShader>(1));
+		CHECK(backend->Calls.size() == 3);
+		CHECK(cache.GetStats().Issued == 3);
+		CHECK(cache.GetStats().Skipped == 3);
+
+		// Every argument of a bind counts towards matching
+		ID3D11Buffer* vb = Fake<ID3D11Buffer>(2);
+		cache.SetVertexBuffer(0, vb, 32, 0);
+		cache.SetVertexBuffer(0, vb, 32, 0);
+		cache.SetVertexBuffer(0, vb, 64, 0);
+		cache.SetVertexBuffer(0, vb, 64, 16);
+		cache.SetVertexBuffer(1, vb, 64, 16);
+		cache.SetIndexBuffer(vb, 42, 0);
+		cache.SetIndexBuffer(vb, 42, 0);
+		cache.SetIndexBuffer(vb, 57, 0);
+		cache.SetPrimitiveTopology(4);
+		cache.SetPrimitiveTopology(4);
+		cache.SetDepthStencilState(0, 0);
+		cache.SetDepthStencilState(0, 0);
+		cache.SetDepthStencilState(0, 1);
+		CHECK(cache.GetStats().Issued == 3 + 4 + 2 + 1 + 2);
+		CHECK(cache.GetStats().Skipped == 3 + 1 + 1 + 1 + 1);
+
+		// Slots are tracked separately, per stage
+		cache.ResetStats();
+		ID3D11ShaderResourceView* srv = Fake<ID3D11ShaderResourceView>(3);
+		cache.SetPSShaderResource(0, srv);
+		cache.SetPSShaderResource(1, srv);
+		cache.SetVSShaderResource(0, srv);
+		cache.SetPSShaderResource(0, srv);
+		cache.SetVSShaderResource(0, srv);
+		ID3D11SamplerState* sampler = Fake<ID3D11SamplerState>(4);
+		cache.SetPSSampler(0, sampler);
+		cache.SetVSSampler(0, sampler);
+		cache.SetPSSampler(0, sampler);
+		CHECK(cache.GetStats().Issued == 5);
+		CHECK(cache.GetStats().Skipped == 3);
+
+		// Slots past the end are ignored altogether
+		cache.ResetStats();
+		cache.SetPSShaderResource(STATE_CACHE_SRV_SLOTS, srv);
+		cache.SetVertexBuffer(STATE_CACHE_VB_SLOTS, vb, 0, 0);
+		cache.SetPSConstantBuffer(STATE_CACHE_CB_SLOTS, vb);
+		CHECK(cache.GetStats().Issued == 0);
+		CHECK(cache.GetStats().Skipped == 0);
+	}
+
+	void TestConstantBufferRanges()
+	{
+		std::shared_ptr<RecordingBackend> backend = std::make_shared<RecordingBackend>();
+		StateCache cache(backend);
+		ID3D11Buffer* ring = Fake<ID3D11Buffer>(5);
+
+		// The same buffer at another offset is a different binding
+		cache.SetVSConstantBuffer1(2, ring, 0, 16);
+		cache.SetVSConstantBuffer1(2, ring, 0, 16);
+		cache.SetVSConstantBuffer1(2, ring, 16, 16);
+		CHECK(cache.GetStats().Issued == 2);
+		CHECK(cache.GetStats().Skipped == 1);
+
+		// ...and so is the whole buffer
+		cache.SetVSConstantBuffer(2, ring);
+		cache.SetVSConstantBuffer(2, ring);
+		cache.SetVSConstantBuffer1(2, ring, 16, 16);
+		CHECK(cache.GetStats().Issued == 4);
+		CHECK(cache.GetStats().Skipped == 2);
+		CHECK(backend->Calls.back() == "VSSetConstantBuffer1");
+
+		// Without 11.1 the offset binds are dropped, not counted
+		std::shared_ptr<RecordingBackend> old = std::make_shared<RecordingBackend>();
+		old->Offsets = false;
+		StateCache oldCache(old);
+		oldCache.SetPSConstantBuffer1(0, ring, 0, 16);
+		CHECK(old->Calls.empty());
+		CHECK(oldCache.GetStats().Issued == 0);
+		CHECK(oldCache.GetStats().Skipped == 0);
+	}
+
+	void TestInvalidate()
+	{
+		std::shared_ptr<RecordingBackend> backend = std::make_shared<RecordingBackend>();
+		StateCache cache(backend);
+		ID3D11RasterizerState* raster = Fake<ID3D11RasterizerState>(6);
+
+		cache.SetRasterizerState(raster);
+		cache.SetRasterizerState(raster);
+		cache.SetRasterizerState(0);
+		cache.SetRasterizerState(0);
+		CHECK(cache.GetStats().Issued == 2);
+
+		// After something else used the context, the same binds go
+		// through again, including null ones
+		cache.Invalidate();
+		cache.SetRasterizerState(0);
+		cache.SetInputLayout(0);
+		cache.SetPSSampler(3, 0);
+		cache.SetRasterizerState(0);
+		cache.SetInputLayout(0);
+		cache.SetPSSampler(3, 0);
+		CHECK(cache.GetStats().Issued == 5);
+		CHECK(cache.GetStats().Skipped == 5);
+	}
+
+	void TestUnbindHighWater()
+	{
+		std::shared_ptr<RecordingBackend> backend = std::make_shared<RecordingBackend>();
+		StateCache cache(backend);
+		ID3D11ShaderResourceView* srv = Fake<ID3D11ShaderResourceView>(7);
+
+		// Nothing is known, so the first unbind clears every slot
+		cache.UnbindPSShaderResources();
+		CHECK(backend->LastPSResourceStart == 0);
+		CHECK(backend->LastPSResourceCount == STATE_CACHE_SRV_SLOTS);
+
+		// With nothing bound since, unbinding again is redundant
+		cache.ResetStats();
+		cache.UnbindPSShaderResources();
+		CHECK(cache.GetStats().Issued == 0);
+		CHECK(cache.GetStats().Skipped == 1);
+
+		// Only up to the highest slot bound is cleared
+		cache.SetPSShaderResource(1, srv);
+		cache.SetPSShaderResource(5, srv);
+		cache.SetPSShaderResource(2, srv);
+		cache.UnbindPSShaderResources();
+		CHECK(backend->LastPSResourceCount == 6);
+
+		// Unbinding forgets the slots, so binding them again goes through
+		cache.ResetStats();
+		cache.SetPSShaderResource(5, srv);
+		CHECK(cache.GetStats().Issued == 1);
+
+		// Null into a slot known to be empty is skipped, so it
+		// doesn't make the next unbind necessary
+		cache.UnbindPSShaderResources();
+		cache.SetPSShaderResource(9, 0);
+		cache.ResetStats();
+		cache.UnbindPSShaderResources();
+		CHECK(cache.GetStats().Skipped == 1);
+
+		// Invalidating forgets the high water mark too
+		cache.Invalidate();
+		cache.UnbindPSShaderResources();
+		CHECK(backend->LastPSResourceCount == STATE_CACHE_SRV_SLOTS);
+	}
+}
+
+int main()
+{
+	TestRedundantBinds();
+	TestConstantBufferRanges();
+	TestInvalidate();
+	TestUnbindHighWater();
+	return TestResult();
+}
@@ -0,0 +1,136 @@
+// --------------------------------------------------------
+// StateObjectCache deduplication against a stand-in device,
+// and the ordering of pipeline keys
+// --------------------------------------------------------
+#include "StateObjectCache.h"
+#include "Test.h"
+#include <memory>
+#include <vector>
+
+namespace
+{
+	// Laid out like D3D11_RASTERIZER_DESC: plain fields, no padding
+	struct RasterDesc
+	{
+		int FillMode;
+		int CullMode;
+		int FrontCounterClockwise;
+		int DepthBias;
+		float DepthBiasClamp;
+		float SlopeScaledDepthBias;
+		int DepthClipEnable;
+	};
+
+	// --------------------------------------------------------
+	// Stand-in for the device: each call makes a new object
+	// and is counted, and it can be made to fail
+	// --------------------------------------------------------
+	struct StandInDevice
+	{
+		unsigned int Created = 0;
+		bool Fail = false;
+
+		std::shared_ptr<RasterDesc> Create(const RasterDesc& desc)
+		{
+			if (Fail)
+				return nullptr;
+			Created++;
+			return std::make_shared<RasterDesc>(desc);
+		}
+	};
+
+	void TestDeduplication()
+	{
+		StandInDevice device;
+		StateObjectCache<RasterDesc, std::shared_ptr<RasterDesc>> cache(
+			[&](const RasterDesc& desc) { return device.Create(desc); });
+
+		RasterDesc solid = { 3, 3, 0, 0, 0, 0, 1 };
+		RasterDesc shadow = { 3, 3, 0, 1000, 0, 1.0f, 1 };
+		RasterDesc solidAgain = solid;
+
+		std::shared_ptr<RasterDesc> a = cache.Get(solid);
+		std::shared_ptr<RasterDesc> b = cache.Get(shadow);
+		std::shared_ptr<RasterDesc> c = cache.Get(solidAgain);
+		CHECK(a && b && c);
+		CHECK(a == c);
+		CHECK(a != b);
+		CHECK(device.Created == 2);
+		CHECK(cache.GetCount() == 2);
+		CHECK(cache.GetStats().Hits == 1);
+		CHECK(cache.GetStats().Misses == 2);
+
+		// One differing field is a different state
+		RasterDesc culled = solid;
+		culled.CullMode = 1;
+		CHECK(cache.Get(culled) != a);
+		CHECK(cache.Hash(culled) != cache.Hash(solid));
+
+		// Failures aren't remembered, so the next request tries again
+		RasterDesc wireframe = { 2, 1, 0, 0, 0, 0, 1 };
+		device.Fail = true;
+		CHECK(!cache.Get(wireframe));
+		device.Fail = false;
+		CHECK(cache.Get(wireframe));
+		CHECK(cache.GetCount() == 4);
+
+		cache.Clear();
+		CHECK(cache.GetCount() == 0);
+		CHECK(cache.Get(solid) != a);
+	}
+
+	// Many lookups of a few states, as a frame of draws would make
+	void TestManyLookups()
+	{
+		StandInDevice device;
+		StateObjectCache<RasterDesc, std::shared_ptr<RasterDesc>> cache(
+			[&](const RasterDesc& desc) { return device.Create(desc); });
+
+		for (unsigned int i = 0; i < 1000; i++)
+		{
+			RasterDesc desc = { 3, (int)(i % 3) + 1, 0, (int)(i % 4), 0, 0, 1 };
+			cache.Get(desc);
+		}
+		CHECK(device.Created == 12);
+		CHECK(cache.GetStats().Hits == 1000 - 12);
+	}
+
+	void TestPipelineKeys()
+	{
+		PipelineKeyBuilder keys;
+		int vs[2] = {}, ps[2] = {}, layout = {}, raster = {}, material[2] = {};
+
+		// Shaders sort first, then states, then the caller's bits
+		unsigned long long first = keys.MakeKey(&vs[0], &ps[0], &layout, &raster, 0, &material[0]);
+		unsigned long long otherMaterial = keys.MakeKey(&vs[0], &ps[0], &layout, &raster, 0, &material[1]);
+		unsigned long long otherPS = keys.MakeKey(&vs[0], &ps[1], &layout, &raster, 0, &material[0]);
+		unsigned long long otherVS = keys.MakeKey(&vs[1], &ps[0], &layout, &raster, 0, &material[0]);
+		CHECK(first < otherMaterial);
+		CHECK(otherMaterial < otherPS);
+		CHECK(otherPS < otherVS);
+		CHECK(keys.MakeKey(&vs[0], &ps[0], &layout, &raster, 0, &material[0]) == first);
+
+		// Each field is in its own bits; null is id 0
+		CHECK((first >> 52) == 1);
+		CHECK((first & 0xFFFF) == 1);
+		CHECK(((first >> PIPELINE_KEY_USER_BITS) & 0xFF) == 0);
+
+		// A field that runs out of ids shares its last one
+		PipelineIdTable ids(2);
+		int objects[5];
+		CHECK(ids.GetId(0) == 0);
+		CHECK(ids.GetId(&objects[0]) == 1);
+		CHECK(ids.GetId(&objects[1]) == 2);
+		CHECK(ids.GetId(&objects[2]) == 3);
+		CHECK(ids.GetId(&objects[3]) == 3);
+		CHECK(ids.GetId(&objects[0]) == 1);
+	}
+}
+
+int main()
+{
+	TestDeduplication();
+	TestManyLookups();
+	TestPipelineKeys();
+	return TestResult();
+}
@@ -0,0 +1,123 @@
+// --------------------------------------------------------
+// TextureArrayPacker: which textures share arrays, and a
+// randomized check that every placement is valid
+// --------------------------------------------------------
+#include "TextureArrayPacker.h"
+#include "Test.h"
+#include <cstdlib>
+#include <set>
+#include <utility>
+#include <vector>
+
+namespace
+{
+	// DXGI_FORMAT values
+	const unsigned int RGBA8 = 28;
+	const unsigned int RGBA8_SRGB = 29;
+	const unsigned int BC7 = 98;
+
+	bool SameFormat(const TextureArrayFormat& a, const TextureArrayFormat& b)
+	{
+		return a.Width == b.Width && a.Height == b.Height && a.MipLevels == b.MipLevels && a.Format == b.Format;
+	}
+
+	void TestMaterials()
+	{
+		// Three materials of four maps each: albedo in sRGB, the rest
+		// linear, and one material's maps at a different size
+		TextureArrayPacker packer(16);
+		TextureArrayFormat albedo = { 1024, 1024, 11, RGBA8_SRGB };
+		TextureArrayFormat data = { 1024, 1024, 11, RGBA8 };
+		TextureArrayFormat smallAlbedo = { 512, 512, 10, RGBA8_SRGB };
+		TextureArrayFormat smallData = { 512, 512, 10, RGBA8 };
+
+		TextureArraySlot slot = {};
+		for (unsigned int material = 0; material < 2; material++)
+		{
+			CHECK(packer.Add(albedo, &slot));
+			CHECK(slot.Array == 0 && slot.Slice == material);
+			for (unsigned int map = 0; map < 3; map++)
+			{
+				CHECK(packer.Add(data, &slot));
+				CHECK(slot.Array == 1 && slot.Slice == material * 3 + map);
+			}
+		}
+		CHECK(packer.Add(smallAlbedo, &slot) && slot.Array == 2);
+		CHECK(packer.Add(smallData, &slot) && slot.Array == 3);
+
+		CHECK(packer.GetArrayCount() == 4);
+		CHECK(packer.GetSliceCount(0) == 2);
+		CHECK(packer.GetSliceCount(1) == 6);
+		CHECK(SameFormat(packer.GetFormat(2), smallAlbedo));
+	}
+
+	void TestLimits()
+	{
+		// A full array starts another of the same format
+		TextureArrayPacker packer(2);
+		TextureArrayFormat format = { 256, 256, 9, BC7 };
+		TextureArraySlot slot = {};
+		CHECK(packer.Add(format, &slot) && slot.Array == 0 && slot.Slice == 0);
+		CHECK(packer.Add(format, &slot) && slot.Array == 0 && slot.Slice == 1);
+		CHECK(packer.Add(format, &slot) && slot.Array == 1 && slot.Slice == 0);
+
+		// Mip count alone is enough to keep textures apart
+		TextureArrayFormat fewerMips = { 256, 256, 1, BC7 };
+		CHECK(packer.Add(fewerMips, &slot) && slot.Array == 2);
+
+		// Empty textures, or no room at all, can't be packed
+		TextureArrayFormat empty = { 0, 256, 1, BC7 };
+		CHECK(!packer.Add(empty, &slot));
+		TextureArrayFormat noMips = { 256, 256, 0, BC7 };
+		CHECK(!packer.Add(noMips, &slot));
+		TextureArrayPacker none(0);
+		CHECK(!none.Add(format, &slot));
+	}
+
+	void TestRandomValidation()
+	{
+		const unsigned int maxSlices = 5;
+		TextureArrayPacker packer(maxSlices);
+		std::vector<std::pair<TextureArrayFormat, TextureArraySlot>> placed;
+
+		std::srand(37);
+		for (unsigned int i = 0; i < 500; i++)
+		{
+			unsigned int size = 64u << (std::rand() % 3);
+			TextureArrayFormat format = { size, size, (unsigned int)(std::rand() % 2) + 1, std::rand() % 2 ? RGBA8 : BC7 };
+			TextureArraySlot slot = {};
+			CHECK(packer.Add(format, &slot));
+			placed.push_back({ format, slot });
+		}
+
+		// Every slice is used once, by a texture of the array's format
+		std::set<std::pair<unsigned int, unsigned int>> used;
+		for (const auto& p : placed)
+		{
+			CHECK(p.second.Array < packer.GetArrayCount());
+			CHECK(p.second.Slice < packer.GetSliceCount(p.second.Array));
+			CHECK(SameFormat(p.first, packer.GetFormat(p.second.Array)));
+			CHECK(used.insert({ p.second.Array, p.second.Slice }).second);
+		}
+
+		// No more arrays than needed: only the last of each format is partly full
+		unsigned int slices = 0;
+		for (unsigned int a = 0; a < packer.GetArrayCount(); a++)
+		{
+			slices += packer.GetSliceCount(a);
+			CHECK(packer.GetSliceCount(a) <= maxSlices);
+			for (unsigned int later = a + 1; later < packer.GetArrayCount(); later++)
+				if (SameFormat(packer.GetFormat(a), packer.GetFormat(later)))
+					CHECK(packer.GetSliceCount(a) == maxSlices);
+		}
+		CHECK(slices == placed.size());
+	}
+}
+
+int main()
+{
+	TestMaterials();
+	TestLimits();
+	TestRandomValidation();
+	return TestResult();
+}
@@ -0,0 +1,268 @@
+// --------------------------------------------------------
+// TextureAtlas: slots on the block grid at every clean mip,
+// gutters filled by clamping or wrapping, no bleeding
+// between slots down the mip chain, the shrunken last page
+// and the efficiency stats
+// --------------------------------------------------------
+#include "TextureAtlas.h"
+#include "MipGenerator.h"
+#include "Test.h"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+	// Every pixel the same color
+	BlockImage MakeFlat(unsigned int width, unsigned int height, unsigned char r, unsigned char g, unsigned char b)
+	{
+		BlockImage image = { width, height, std::vector<unsigned char>((size_t)width * height * 4) };
+		for (size_t i = 0; i < image.Pixels.size(); i += 4)
+		{
+			image.Pixels[i + 0] = r;
+			image.Pixels[i + 1] = g;
+			image.Pixels[i + 2] = b;
+			image.Pixels[i + 3] = 255;
+		}
+		return image;
+	}
+
+	// Each pixel holds its own coordinates
+	BlockImage MakeCoordinates(unsigned int width, unsigned int height)
+	{
+		BlockImage image = MakeFlat(width, height, 0, 0, 0);
+		for (unsigned int y = 0; y < height; y++)
+		{
+			for (unsigned int x = 0; x < width; x++)
+			{
+				image.Pixels[((size_t)y * width + x) * 4 + 0] = (unsigned char)x;
+				image.Pixels[((size_t)y * width + x) * 4 + 1] = (unsigned char)y;
+			}
+		}
+		return image;
+	}
+
+	const unsigned char* Pixel(const BlockImage& image, unsigned int x, unsigned int y)
+	{
+		return &image.Pixels[((size_t)y * image.Width + x) * 4];
+	}
+
+	// Textures of awkward sizes, each its own color
+	std::vector<BlockImage> MakeAssorted()
+	{
+		const unsigned int sizes[][2] = { { 37, 21 }, { 100, 60 }, { 13, 13 }, { 64, 64 }, { 5, 90 }, { 120, 7 }, { 33, 33 }, { 1, 1 } };
+		std::vector<BlockImage> images;
+		for (const auto& size : sizes)
+		{
+			unsigned char i = (unsigned char)images.size();
+			images.push_back(MakeFlat(size[0], size[1], (unsigned char)(30 + i * 25), (unsigned char)(250 - i * 30), (unsigned char)(i * 11)));
+		}
+		return images;
+	}
+
+	// The slot (texture plus gutter, rounded out to whole cells) an
+	// entry was given, in mip 0 pixels
+	struct Slot
+	{
+		unsigned int Left, Top, Right, Bottom;
+	};
+
+	Slot GetSlot(const AtlasEntry& entry, unsigned int cell, unsigned int gutter)
+	{
+		unsigned int left = entry.X - gutter;
+		unsigned int top = entry.Y - gutter;
+		unsigned int width = (entry.Width + gutter * 2 + cell - 1) / cell * cell;
+		unsigned int height = (entry.Height + gutter * 2 + cell - 1) / cell * cell;
+		return { left, top, left + width, top + height };
+	}
+
+	void TestAlignment()
+	{
+		// 3 clean mips: cells of 16 pixels, gutters of 4 at mip 0
+		AtlasSettings settings = { 256, 3, 1, ATLAS_GUTTER_CLAMP };
+		const unsigned int cell = 16, gutter = 4;
+		std::vector<BlockImage> images = MakeAssorted();
+		Atlas atlas = TextureAtlas::Build(images, {}, settings);
+		CHECK(atlas.Entries.size() == images.size());
+		CHECK(atlas.Stats.Unplaced == 0);
+
+		std::vector<Slot> slots;
+		for (const AtlasEntry& entry : atlas.Entries)
+		{
+			CHECK(entry.Placed && entry.Page < atlas.Pages.size());
+			const BlockImage& page = atlas.Pages[entry.Page];
+			Slot slot = GetSlot(entry, cell, gutter);
+			slots.push_back(slot);
+			CHECK(slot.Right <= page.Width && slot.Bottom <= page.Height);
+
+			// Each slot's edges land on a block boundary at every
+			// clean mip
+			bool aligned = true;
+			for (unsigned int mip = 0; mip < settings.MipLevels; mip++)
+			{
+				aligned = aligned && (slot.Left >> mip) % 4 == 0 && (slot.Top >> mip) % 4 == 0;
+				aligned = aligned && (slot.Right >> mip) % 4 == 0 && (slot.Bottom >> mip) % 4 == 0;
+			}
+			CHECK(aligned);
+
+			// And there's at least Padding texels of gutter around the
+			// texture at each of them, for bilinear filtering
+			bool padded = true;
+			for (unsigned int mip = 0; mip < settings.MipLevels; mip++)
+			{
+				padded = padded && (entry.X >> mip) - (slot.Left >> mip) >= settings.Padding;
+				padded = padded && (entry.Y >> mip) - (slot.Top >> mip) >= settings.Padding;
+				padded = padded && (slot.Right >> mip) - ((entry.X + entry.Width + (1u << mip) - 1) >> mip) >= settings.Padding;
+				padded = padded && (slot.Bottom >> mip) - ((entry.Y + entry.Height + (1u << mip) - 1) >> mip) >= settings.Padding;
+			}
+			CHECK(padded);
+
+			// Scale and offset pick out just the texture
+			CHECK_NEAR(entry.Offset.x * page.Width, entry.X, 1e-3);
+			CHECK_NEAR(entry.Offset.y * page.Height, entry.Y, 1e-3);
+			CHECK_NEAR(entry.Scale.x * page.Width, entry.Width, 1e-3);
+			CHECK_NEAR(entry.Scale.y * page.Height, entry.Height, 1e-3);
+		}
+
+		// Slots on the same page never overlap
+		bool apart = true;
+		for (size_t a = 0; a < slots.size(); a++)
+		{
+			for (size_t b = a + 1; b < slots.size(); b++)
+			{
+				if (atlas.Entries[a].Page != atlas.Entries[b].Page)
+					continue;
+				apart = apart && (slots[a].Right <= slots[b].Left || slots[b].Right <= slots[a].Left ||
+					slots[a].Bottom <= slots[b].Top || slots[b].Bottom <= slots[a].Top);
+			}
+		}
+		CHECK(apart);
+	}
+
+	void TestGutter()
+	{
+		// One mip and 2 texels of padding: a 2 texel gutter, in cells
+		// of 4, so a 5x3 texture has a 12x8 slot
+		BlockImage image = MakeCoordinates(5, 3);
+		for (AtlasGutter mode : { ATLAS_GUTTER_CLAMP, ATLAS_GUTTER_WRAP })
+		{
+			AtlasSettings settings = { 64, 1, 2, mode };
+			Atlas atlas = TextureAtlas::Build({ image }, { L"texture" }, settings);
+			CHECK(atlas.Pages.size() == 1);
+			if (atlas.Pages.size() != 1)
+				continue;
+			const AtlasEntry& entry = atlas.Entries[0];
+			const BlockImage& page = atlas.Pages[0];
+			CHECK(entry.Name == L"texture");
+			CHECK(entry.X % 4 == 2 && entry.Y % 4 == 2);
+
+			// The texture itself, unchanged
+			bool copied = true;
+			for (unsigned int y = 0; y < image.Height; y++)
+				for (unsigned int x = 0; x < image.Width; x++)
+					copied = copied && !memcmp(Pixel(page, entry.X + x, entry.Y + y), Pixel(image, x, y), 4);
+			CHECK(copied);
+
+			// Every gutter texel is the one clamping or wrapping picks
+			bool filled = true;
+			for (int y = -2; y < 8 - 2; y++)
+			{
+				for (int x = -2; x < 12 - 2; x++)
+				{
+					int sx = mode == ATLAS_GUTTER_WRAP ? (x + 5) % 5 : std::clamp(x, 0, 4);
+					int sy = mode == ATLAS_GUTTER_WRAP ? (y + 3) % 3 : std::clamp(y, 0, 2);
+					const unsigned char* p = Pixel(page, entry.X + x, entry.Y + y);
+					filled = filled && p[0] == sx && p[1] == sy;
+				}
+			}
+			CHECK(filled);
+
+			// Up and left of the texture's corner
+			const unsigned char* corner = Pixel(page, entry.X - 2, entry.Y - 1);
+			if (mode == ATLAS_GUTTER_CLAMP)
+				CHECK(corner[0] == 0 && corner[1] == 0);
+			else
+				CHECK(corner[0] == 3 && corner[1] == 2);
+		}
+	}
+
+	void TestNoBleeding()
+	{
+		// Box filtered mips of the pages, as Tools/BakeAtlas.cpp makes
+		// them.  At each clean mip a slot, gutter and all, holds only
+		// its own texture's color.
+		AtlasSettings settings = { 256, 3, 1, ATLAS_GUTTER_CLAMP };
+		const unsigned int cell = 16, gutter = 4;
+		std::vector<BlockImage> images = MakeAssorted();
+		Atlas atlas = TextureAtlas::Build(images, {}, settings);
+		MipSettings mipSettings = { MIP_FILTER_BOX, MIP_CONTENT_LINEAR, 0 };
+
+		for (unsigned int p = 0; p < atlas.Pages.size(); p++)
+		{
+			std::vector<BlockImage> levels = MipGenerator::Generate(atlas.Pages[p], mipSettings, 2);
+			CHECK(levels.size() >= settings.MipLevels);
+			if (levels.size() < settings.MipLevels)
+				continue;
+
+			for (unsigned int mip = 0; mip < settings.MipLevels; mip++)
+			{
+				bool clean = true;
+				for (size_t i = 0; i < atlas.Entries.size(); i++)
+				{
+					if (atlas.Entries[i].Page != p)
+						continue;
+					Slot slot = GetSlot(atlas.Entries[i], cell, gutter);
+					for (unsigned int y = slot.Top >> mip; y < slot.Bottom >> mip; y++)
+						for (unsigned int x = slot.Left >> mip; x < slot.Right >> mip; x++)
+							clean = clean && !memcmp(Pixel(levels[mip], x, y), images[i].Pixels.data(), 4);
+				}
+				CHECK(clean);
+			}
+		}
+	}
+
+	void TestPagesAndStats()
+	{
+		// 60x60 textures in 64x64 slots: 16 fill a 256x256 page, and
+		// the 2 left over need only 128x64
+		AtlasSettings settings = { 256, 1, 2, ATLAS_GUTTER_CLAMP };
+		std::vector<BlockImage> images(18, MakeFlat(60, 60, 200, 100, 50));
+
+		// Too wide for any page once its gutter is added
+		images.push_back(MakeFlat(254, 8, 1, 2, 3));
+
+		Atlas atlas = TextureAtlas::Build(images, {}, settings);
+		CHECK(atlas.Pages.size() == 2);
+		if (atlas.Pages.size() != 2)
+			return;
+		CHECK(atlas.Pages[0].Width == 256 && atlas.Pages[0].Height == 256);
+		CHECK(atlas.Pages[1].Width * atlas.Pages[1].Height == 128 * 64);
+		CHECK(std::max(atlas.Pages[1].Width, atlas.Pages[1].Height) == 128);
+		CHECK(!atlas.Entries.back().Placed);
+
+		unsigned int onFirst = 0;
+		for (size_t i = 0; i < 18; i++)
+			onFirst += atlas.Entries[i].Placed && atlas.Entries[i].Page == 0;
+		CHECK(onFirst == 16);
+
+		const AtlasStats& stats = atlas.Stats;
+		CHECK(stats.Pages == 2 && stats.Unplaced == 1);
+		CHECK(stats.PageTexels == 256 * 256 + 128 * 64);
+		CHECK(stats.TextureTexels == 18 * 60 * 60);
+		CHECK(stats.GutterTexels == 18 * (64 * 64 - 60 * 60));
+		CHECK_NEAR(stats.Efficiency, 18.0 * 60 * 60 / (256 * 256 + 128 * 64), 1e-6);
+
+		// Nothing to place is no pages at all
+		Atlas empty = TextureAtlas::Build({}, {}, settings);
+		CHECK(empty.Pages.empty() && empty.Stats.PageTexels == 0 && empty.Stats.Efficiency == 0);
+	}
+}
+
+int main()
+{
+	TestAlignment();
+	TestGutter();
+	TestNoBleeding();
+	TestPagesAndStats();
+	return TestResult();
+}
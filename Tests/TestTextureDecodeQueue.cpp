@@ -0,0 +1,111 @@
+// --------------------------------------------------------
+// TextureDecodeQueue: the startup images decoded across
+// threads must match decoding them one by one, and the
+// .dds cache must be written once and then reused
+// --------------------------------------------------------
+#include "TextureDecodeQueue.h"
+#include "Test.h"
+#include <algorithm>
+#include <filesystem>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	// What Game::LoadAssets() and Sky load at startup
+	std::vector<std::wstring> StartupImages()
+	{
+		std::vector<std::wstring> paths;
+		for (const char* folder : { "Assets/Textures/PBR", "Assets/Textures/Skies/Clouds Pink" })
+			for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(folder))
+				if (entry.path().extension() == ".png")
+					paths.push_back(entry.path().wstring());
+		return paths;
+	}
+
+	void TestImages()
+	{
+		std::vector<std::wstring> paths = StartupImages();
+		CHECK(paths.size() >= 16);
+
+		unsigned int threads = std::max(2u, std::thread::hardware_concurrency());
+		TextureDecodeQueue serial, parallel;
+		for (const std::wstring& path : paths)
+		{
+			serial.AddImage(path);
+			parallel.AddImage(path);
+		}
+		unsigned int missing = parallel.AddImage(L"Assets/Textures/PBR/missing.png");
+		serial.Decode(1);
+		parallel.Decode(threads);
+
+		CHECK(parallel.GetCount() == paths.size() + 1);
+		for (unsigned int i = 0; i < paths.size(); i++)
+		{
+			const DecodedTexture& a = serial.Get(i);
+			const DecodedTexture& b = parallel.Get(i);
+			CHECK(a.Decoded && b.Decoded);
+			CHECK(!b.Compressed);
+			CHECK(b.Path == paths[i]);
+			CHECK(b.Image.Width > 0 && b.Image.Width == a.Image.Width && b.Image.Height == a.Image.Height);
+			CHECK(b.Image.Pixels == a.Image.Pixels);
+		}
+
+		// A file that can't be decoded is left for WIC, not fatal
+		CHECK(!parallel.Get(missing).Decoded);
+
+		std::printf("%zu images: %.1f ms on 1 thread, %.1f ms on %u threads\n",
+			paths.size(), serial.GetDecodeTime(), parallel.GetDecodeTime(), threads);
+	}
+
+	void TestCompressedCache()
+	{
+		// Works on a copy, so no .dds lands among the assets
+		std::filesystem::path folder = std::filesystem::temp_directory_path() / "TestTextureDecodeQueue";
+		std::filesystem::create_directories(folder);
+		std::filesystem::path png = folder / "wood_metal.png";
+		std::filesystem::path dds = folder / "wood_metal.dds";
+		std::filesystem::copy_file("Assets/Textures/PBR/wood_metal.png", png, std::filesystem::copy_options::overwrite_existing);
+		std::filesystem::remove(dds);
+
+		TextureImportSettings settings = { BLOCK_COMPRESSION_BC7, MIP_FILTER_KAISER, MIP_CONTENT_SRGB, L"", false };
+
+		// First time it's encoded, and the result saved
+		TextureDecodeQueue first;
+		first.AddCompressed(png.wstring(), settings);
+		first.Decode(4);
+		const DecodedTexture& encoded = first.Get(0);
+		CHECK(encoded.Decoded && encoded.Compressed);
+		CHECK(encoded.CachePath == dds.wstring());
+		CHECK(encoded.Width == 128 && encoded.Height == 128);
+		CHECK(encoded.Mips.size() == 8);
+		CHECK(encoded.DDSFile.empty());
+		CHECK(std::filesystem::exists(dds));
+
+		// After that the .dds is read as is
+		TextureDecodeQueue second;
+		second.AddCompressed(png.wstring(), settings);
+		second.Decode(4);
+		const DecodedTexture& cached = second.Get(0);
+		CHECK(cached.Decoded);
+		CHECK(cached.Mips.empty());
+		CHECK(cached.DDSFile.size() == std::filesystem::file_size(dds));
+
+		// ...unless only the cache was wanted, which reads nothing
+		settings.CacheOnly = true;
+		TextureDecodeQueue cacheOnly;
+		cacheOnly.AddCompressed(png.wstring(), settings);
+		cacheOnly.Decode(1);
+		CHECK(cacheOnly.Get(0).Decoded);
+		CHECK(cacheOnly.Get(0).DDSFile.empty() && cacheOnly.Get(0).Mips.empty());
+
+		std::filesystem::remove_all(folder);
+	}
+}
+
+int main()
+{
+	TestImages();
+	TestCompressedCache();
+	return TestResult();
+}
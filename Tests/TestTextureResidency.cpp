@@ -0,0 +1,261 @@
+// --------------------------------------------------------
+// TextureResidency: budget accounting, LRU eviction and
+// fairness in small hand-worked cases, then invariants and
+// repeatability over a long randomized run
+// --------------------------------------------------------
+#include "TextureResidency.h"
+#include "Test.h"
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+namespace
+{
+	// Four levels of 64, 16, 4 and 1 bytes; from mip 2 on, 5 bytes
+	// are always resident
+	const std::vector<unsigned long long> levels = { 64, 16, 4, 1 };
+
+	typedef std::vector<unsigned int> Changed;
+
+	unsigned long long ResidentBytes(const TextureResidency& residency, const std::vector<std::vector<unsigned long long>>& textureLevels)
+	{
+		unsigned long long total = 0;
+		for (unsigned int i = 0; i < residency.GetCount(); i++)
+			for (unsigned int mip = residency.GetTarget(i); mip < textureLevels[i].size(); mip++)
+				total += textureLevels[i][mip];
+		return total;
+	}
+
+	void TestAdd()
+	{
+		TextureResidency residency(1000);
+		unsigned int a = residency.Add(levels, 2);
+		unsigned int b = residency.Add({ 64, 16 }, 5);	// Tail past the end
+		CHECK(a == 0 && b == 1);
+		CHECK(residency.GetTail(a) == 2 && residency.GetTarget(a) == 2);
+		CHECK(residency.GetTail(b) == 1 && residency.GetTarget(b) == 1);
+		CHECK(residency.GetStats().Committed == 5 + 16);
+
+		// No requests, nothing to do
+		CHECK(residency.Update().empty());
+		CHECK(residency.GetStats().Upgrades == 0);
+	}
+
+	void TestRequests()
+	{
+		TextureResidency residency(1000);
+		unsigned int a = residency.Add(levels, 2);
+		unsigned int b = residency.Add(levels, 2);
+
+		// The finest of several requests wins, and requests coarser
+		// than the tail are already met
+		residency.Request(a, 1);
+		residency.Request(a, 0);
+		residency.Request(a, 1);
+		residency.Request(b, 3);
+		CHECK(residency.Update() == Changed({ a }));
+		CHECK(residency.GetTarget(a) == 0 && residency.GetTarget(b) == 2);
+		CHECK(residency.GetStats().Upgrades == 2);
+		CHECK(residency.GetStats().Committed == 85 + 5);
+
+		// Levels stay while nothing needs the space...
+		CHECK(residency.Update().empty());
+		CHECK(residency.GetTarget(a) == 0);
+
+		// ...so coming back into view costs nothing
+		residency.Request(a, 0);
+		CHECK(residency.Update().empty());
+
+		// Asking for less doesn't evict anything by itself
+		residency.Request(a, 2);
+		residency.Update();
+		CHECK(residency.GetTarget(a) == 0);
+	}
+
+	void TestEviction()
+	{
+		TextureResidency residency(100);
+		unsigned int a = residency.Add(levels, 2);
+		unsigned int b = residency.Add(levels, 2);
+		unsigned int c = residency.Add(levels, 2);
+
+		// 15 bytes of tails, plus 80 for a
+		residency.Request(a, 0);
+		residency.Update();
+		CHECK(residency.GetStats().Committed == 95);
+
+		// b's mip 1 doesn't fit, so a (the only one with levels to
+		// spare) gives up its mip 0
+		residency.Request(b, 1);
+		CHECK(residency.Update() == Changed({ a, b }));
+		CHECK(residency.GetTarget(a) == 1 && residency.GetTarget(b) == 1);
+		CHECK(residency.GetStats().Evictions == 1 && residency.GetStats().Upgrades == 1);
+		CHECK(residency.GetStats().Committed == 47);
+
+		// c takes mip 1 from the free space, then mip 0 needs both
+		// a's and b's extra levels: a's go first, as it was used less
+		// recently
+		residency.Request(c, 0);
+		CHECK(residency.Update() == Changed({ a, b, c }));
+		CHECK(residency.GetTarget(a) == 2 && residency.GetTarget(b) == 2 && residency.GetTarget(c) == 0);
+		CHECK(residency.GetStats().Evictions == 2 && residency.GetStats().Upgrades == 2);
+		CHECK(residency.GetStats().Committed == 95);
+
+		// A smaller budget evicts only as much as it must, and
+		// never below the tails
+		residency.SetBudget(40);
+		CHECK(residency.Update() == Changed({ c }));
+		CHECK(residency.GetTarget(c) == 1);
+		CHECK(residency.GetStats().Committed == 31);
+
+		residency.SetBudget(1);
+		residency.Update();
+		CHECK(residency.GetTarget(c) == 2);
+		CHECK(residency.GetStats().Committed == 15);
+		CHECK(residency.GetStats().Budget == 1);
+	}
+
+	void TestTies()
+	{
+		// Used in the same frame, the lower index is evicted first
+		TextureResidency residency(1000);
+		unsigned int a = residency.Add(levels, 2);
+		unsigned int b = residency.Add(levels, 2);
+		residency.Request(a, 0);
+		residency.Request(b, 0);
+		residency.Update();
+
+		residency.SetBudget(160);
+		CHECK(residency.Update() == Changed({ a }));
+		CHECK(residency.GetTarget(a) == 1 && residency.GetTarget(b) == 0);
+	}
+
+	void TestFairness()
+	{
+		// Two textures both need mip 0 and only one could have it.
+		// Going a level at a time, each gets mip 1, and neither can
+		// take what the other needs this frame.
+		TextureResidency residency(100);
+		unsigned int a = residency.Add(levels, 2);
+		unsigned int b = residency.Add(levels, 2);
+		residency.Request(a, 0);
+		residency.Request(b, 0);
+		CHECK(residency.Update() == Changed({ a, b }));
+		CHECK(residency.GetTarget(a) == 1 && residency.GetTarget(b) == 1);
+		CHECK(residency.GetStats().Upgrades == 2);
+		CHECK(residency.GetStats().Evictions == 0);
+		CHECK(residency.GetStats().Starved == 2);
+
+		// Once b is out of view, a can take its space
+		residency.Request(a, 0);
+		CHECK(residency.Update() == Changed({ a, b }));
+		CHECK(residency.GetTarget(a) == 0 && residency.GetTarget(b) == 2);
+		CHECK(residency.GetStats().Starved == 0);
+	}
+
+	// --------------------------------------------------------
+	// Textures of assorted sizes, with random requests each
+	// frame; returns every frame's targets
+	// --------------------------------------------------------
+	std::vector<unsigned int> Simulate(unsigned int textureCount, unsigned int frames, unsigned long long budget, bool checks)
+	{
+		std::srand(5);
+		std::vector<std::vector<unsigned long long>> textureLevels;
+		TextureResidency residency(budget);
+		for (unsigned int i = 0; i < textureCount; i++)
+		{
+			// Square BC7 textures of 256 to 2048 texels
+			std::vector<unsigned long long> bytes;
+			for (unsigned int size = 256u << (std::rand() % 4); size >= 1; size /= 2)
+				bytes.push_back((unsigned long long)std::max(1u, size / 4) * std::max(1u, size / 4) * 16);
+			textureLevels.push_back(bytes);
+			residency.Add(bytes, (unsigned int)bytes.size() - 7);
+		}
+
+		std::vector<unsigned int> history;
+		for (unsigned int frame = 0; frame < frames; frame++)
+		{
+			// A third of the textures are seen each frame
+			std::vector<unsigned int> need(textureCount, ~0u);
+			for (unsigned int i = 0; i < textureCount; i++)
+			{
+				if (std::rand() % 3)
+					continue;
+				need[i] = std::rand() % (residency.GetTail(i) + 1);
+				residency.Request(i, need[i]);
+			}
+
+			std::vector<unsigned int> changed = residency.Update();
+			for (unsigned int i = 0; i < textureCount; i++)
+				history.push_back(residency.GetTarget(i));
+
+			if (!checks)
+				continue;
+
+			TextureResidencyStats stats = residency.GetStats();
+			CHECK(stats.Committed == ResidentBytes(residency, textureLevels));
+			CHECK(stats.Committed <= budget);
+			for (unsigned int i = 0; i < textureCount; i++)
+			{
+				CHECK(residency.GetTarget(i) <= residency.GetTail(i));
+
+				// Only starved textures may be short of what they asked for
+				if (need[i] != ~0u && residency.GetTarget(i) > need[i])
+					CHECK(stats.Starved > 0);
+			}
+			for (size_t i = 1; i < changed.size(); i++)
+				CHECK(changed[i - 1] < changed[i]);
+		}
+		return history;
+	}
+
+	void TestRandomized()
+	{
+		// Same requests, same decisions
+		std::vector<unsigned int> first = Simulate(60, 300, 24ull << 20, true);
+		std::vector<unsigned int> second = Simulate(60, 300, 24ull << 20, false);
+		CHECK(first == second);
+	}
+
+	void TestEstimateMip()
+	{
+		const float fov = 1.0471975f;	// 60 degrees
+		const float height = 720;
+
+		// A unit at distance 1 spans 720 / (2 * tan(30)) = 623.5 pixels
+		CHECK_NEAR(TextureResidency::EstimateMip(623.5f, 1, fov, height), 0, 0.001);
+		CHECK_NEAR(TextureResidency::EstimateMip(1247.0f, 1, fov, height), 1, 0.001);
+
+		// Each doubling of distance is one more mip
+		float near = TextureResidency::EstimateMip(1024, 4, fov, height);
+		float far = TextureResidency::EstimateMip(1024, 16, fov, height);
+		CHECK_NEAR(far - near, 2, 0.001);
+
+		// Closer than texels match pixels, and degenerate input
+		CHECK(TextureResidency::EstimateMip(64, 0.1f, fov, height) == 0);
+		CHECK(TextureResidency::EstimateMip(1024, 0, fov, height) == 0);
+		CHECK(TextureResidency::EstimateMip(0, 10, fov, height) == 0);
+	}
+
+	void BenchmarkUpdate()
+	{
+		const unsigned int textures = 2000, frames = 200;
+		TestTimer timer;
+		Simulate(textures, frames, 256ull << 20, false);
+		double seconds = timer.Seconds();
+		std::printf("%u textures: %.3f ms per frame of requests & Update()\n", textures, seconds * 1000.0 / frames);
+	}
+}
+
+int main()
+{
+	TestAdd();
+	TestRequests();
+	TestEviction();
+	TestTies();
+	TestFairness();
+	TestRandomized();
+	TestEstimateMip();
+	BenchmarkUpdate();
+	return TestResult();
+}
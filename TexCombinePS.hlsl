@@ -1,11 +1,4 @@
-#include "ShaderStructs.hlsli"
-
-cbuffer ExternalData : register(b0)
-{
-    float4 colorTint;
-    float2 textureScale;
-    float2 textureOffset;
-}
+#include "ShaderBuffers.hlsli"
 
 Texture2D SurfaceTexture : register(t0);
 Texture2D OverlayTexture : register(t1);
@@ -0,0 +1,128 @@
+#include "TextureArrayImporter.h"
+
+using namespace Microsoft::WRL;
+
+TextureArrayImporter::TextureArrayImporter(ComPtr<ID3D11Device> device, ComPtr<ID3D11DeviceContext> context) :
+	device(device),
+	context(context)
+{
+}
+
+unsigned int TextureArrayImporter::Add(ComPtr<ID3D11ShaderResourceView> srv)
+{
+	Source source = {};
+	source.SRV = srv;
+	sources.push_back(source);
+	return (unsigned int)sources.size() - 1;
+}
+
+// --------------------------------------------------------
+// Groups the queued textures by size, mip count & format,
+// then creates one array per group and copies every mip of
+// every texture into its slice on the GPU
+// --------------------------------------------------------
+void TextureArrayImporter::Build()
+{
+	TextureArrayPacker packer(D3D11_REQ_TEXTURE2D_ARRAY_AXIS_DIMENSION);
+	std::vector<ComPtr<ID3D11Texture2D>> textures(sources.size());
+
+	// Decide where everything goes
+	for (unsigned int i = 0; i < sources.size(); i++)
+	{
+		Source& s = sources[i];
+		if (!s.SRV)
+			continue;
+
+		ComPtr<ID3D11Resource> resource;
+		s.SRV->GetResource(resource.GetAddressOf());
+		if (FAILED(resource.As(&textures[i])))
+			continue;
+
+		D3D11_TEXTURE2D_DESC desc = {};
+		textures[i]->GetDesc(&desc);
+		if (desc.ArraySize != 1 || desc.SampleDesc.Count != 1)
+			continue;
+
+		TextureArrayFormat format = {};
+		format.Width = desc.Width;
+		format.Height = desc.Height;
+		format.MipLevels = desc.MipLevels;
+		format.Format = desc.Format;
+		s.Packed = packer.Add(format, &s.Slot);
+	}
+
+	// Create the arrays
+	std::vector<ComPtr<ID3D11Texture2D>> arrayTextures(packer.GetArrayCount());
+	arrays.resize(packer.GetArrayCount());
+	for (unsigned int a = 0; a < packer.GetArrayCount(); a++)
+	{
+		const TextureArrayFormat& format = packer.GetFormat(a);
+
+		D3D11_TEXTURE2D_DESC desc = {};
+		desc.Width = format.Width;
+		desc.Height = format.Height;
+		desc.MipLevels = format.MipLevels;
+		desc.ArraySize = packer.GetSliceCount(a);
+		desc.Format = (DXGI_FORMAT)format.Format;
+		desc.SampleDesc.Count = 1;
+		desc.Usage = D3D11_USAGE_DEFAULT;
+		desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+		device->CreateTexture2D(&desc, 0, arrayTextures[a].GetAddressOf());
+
+		// Always an array view, even with a single slice, to match the shader
+		D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+		srvDesc.Format = desc.Format;
+		srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2DARRAY;
+		srvDesc.Texture2DArray.MostDetailedMip = 0;
+		srvDesc.Texture2DArray.MipLevels = (UINT)-1;
+		srvDesc.Texture2DArray.FirstArraySlice = 0;
+		srvDesc.Texture2DArray.ArraySize = desc.ArraySize;
+		device->CreateShaderResourceView(arrayTextures[a].Get(), &srvDesc, arrays[a].GetAddressOf());
+	}
+
+	// Copy each texture into its slice, one mip at a time
+	for (unsigned int i = 0; i < sources.size(); i++)
+	{
+		Source& s = sources[i];
+		if (!s.Packed || !arrayTextures[s.Slot.Array])
+		{
+			s.Packed = false;
+			continue;
+		}
+
+		unsigned int mips = packer.GetFormat(s.Slot.Array).MipLevels;
+		for (unsigned int mip = 0; mip < mips; mip++)
+		{
+			context->CopySubresourceRegion(
+				arrayTextures[s.Slot.Array].Get(),
+				D3D11CalcSubresource(mip, s.Slot.Slice, mips),
+				0, 0, 0,
+				textures[i].Get(),
+				D3D11CalcSubresource(mip, 0, mips),
+				0);
+		}
+	}
+
+	// The arrays hold everything now, so the originals can go
+	for (Source& s : sources)
+		s.SRV.Reset();
+}
+
+bool TextureArrayImporter::IsPacked(unsigned int handle)
+{
+	return handle < sources.size() && sources[handle].Packed;
+}
+
+ComPtr<ID3D11ShaderResourceView> TextureArrayImporter::GetArray(unsigned int handle)
+{
+	if (!IsPacked(handle))
+		return 0;
+	return arrays[sources[handle].Slot.Array];
+}
+
+unsigned int TextureArrayImporter::GetSlice(unsigned int handle)
+{
+	if (!IsPacked(handle))
+		return 0;
+	return sources[handle].Slot.Slice;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <d3d11.h>
+#include <wrl/client.h>
+#include <vector>
+#include "TextureArrayPacker.h"
+
+// --------------------------------------------------------
+// Copies loaded textures into shared Texture2DArrays, so
+// materials whose textures match in size and format bind
+// the very same resources and differ only in slice.
+//
+// Add() every texture first, then Build() once.  After that
+// each handle maps to an array and a slice, unless the
+// texture couldn't be packed (no texture, an array already,
+// multisampled), in which case the original should be used.
+// The importer lets go of the originals when it's built.
+// --------------------------------------------------------
+class TextureArrayImporter
+{
+public:
+	TextureArrayImporter(
+		Microsoft::WRL::ComPtr<ID3D11Device> device,
+		Microsoft::WRL::ComPtr<ID3D11DeviceContext> context);
+
+	// Queues a texture and returns its handle
+	unsigned int Add(Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv);
+
+	// Creates the arrays and copies every packable texture in
+	void Build();
+
+	bool IsPacked(unsigned int handle);
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> GetArray(unsigned int handle);
+	unsigned int GetSlice(unsigned int handle);
+	unsigned int GetArrayCount() { return (unsigned int)arrays.size(); }
+
+private:
+	Microsoft::WRL::ComPtr<ID3D11Device> device;
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context;
+
+	struct Source
+	{
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> SRV;
+		bool Packed;
+		TextureArraySlot Slot;
+	};
+
+	std::vector<Source> sources;
+	std::vector<Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>> arrays;
+};
@@ -0,0 +1,36 @@
+#include "TextureArrayPacker.h"
+
+TextureArrayPacker::TextureArrayPacker(unsigned int maxSlices) :
+	maxSlices(maxSlices)
+{
+}
+
+bool TextureArrayPacker::Add(const TextureArrayFormat& format, TextureArraySlot* slot)
+{
+	if (format.Width == 0 || format.Height == 0 || format.MipLevels == 0 || maxSlices == 0)
+		return false;
+
+	for (unsigned int i = 0; i < arrays.size(); i++)
+	{
+		PackedArray& a = arrays[i];
+		if (a.Slices < maxSlices &&
+			a.Format.Width == format.Width &&
+			a.Format.Height == format.Height &&
+			a.Format.MipLevels == format.MipLevels &&
+			a.Format.Format == format.Format)
+		{
+			slot->Array = i;
+			slot->Slice = a.Slices++;
+			return true;
+		}
+	}
+
+	PackedArray a = {};
+	a.Format = format;
+	a.Slices = 1;
+	arrays.push_back(a);
+
+	slot->Array = (unsigned int)arrays.size() - 1;
+	slot->Slice = 0;
+	return true;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <vector>
+
+// --------------------------------------------------------
+// What a texture must match to share an array with others.
+// Format holds a DXGI_FORMAT, kept as a plain number so the
+// packer has no dependency on the graphics API.
+// --------------------------------------------------------
+struct TextureArrayFormat
+{
+	unsigned int Width;
+	unsigned int Height;
+	unsigned int MipLevels;
+	unsigned int Format;
+};
+
+// --------------------------------------------------------
+// Where a packed texture ended up
+// --------------------------------------------------------
+struct TextureArraySlot
+{
+	unsigned int Array;
+	unsigned int Slice;
+};
+
+// --------------------------------------------------------
+// Decides which textures can go into the same array.  Each
+// texture is placed in the first array with an identical
+// size, mip count and format, and a new array is started
+// when none match or the matching one is full.
+// --------------------------------------------------------
+class TextureArrayPacker
+{
+public:
+	TextureArrayPacker(unsigned int maxSlices);
+
+	// Returns false for textures that can't go in an array at all
+	bool Add(const TextureArrayFormat& format, TextureArraySlot* slot);
+
+	unsigned int GetArrayCount() const { return (unsigned int)arrays.size(); }
+	const TextureArrayFormat& GetFormat(unsigned int array) const { return arrays[array].Format; }
+	unsigned int GetSliceCount(unsigned int array) const { return arrays[array].Slices; }
+
+private:
+	struct PackedArray
+	{
+		TextureArrayFormat Format;
+		unsigned int Slices;
+	};
+
+	unsigned int maxSlices;
+	std::vector<PackedArray> arrays;
+};
@@ -0,0 +1,233 @@
+#include "TextureAtlas.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+// The ImGui copy of stb_rect_pack, implemented privately here
+// (imgui_draw.cpp keeps its own static copy)
+#define STBRP_STATIC
+#define STB_RECT_PACK_IMPLEMENTATION
+#include "ImGui/imstb_rectpack.h"
+
+using namespace DirectX;
+
+namespace
+{
+	// A BC block at the last clean mip, in mip 0 pixels
+	unsigned int GetCellSize(const AtlasSettings& settings)
+	{
+		return 4u << (std::max(settings.MipLevels, 1u) - 1);
+	}
+
+	// Padding scaled up to mip 0.  Blocks can mix a texture with
+	// its own gutter, so this needn't be a whole number of cells.
+	unsigned int GetGutter(const AtlasSettings& settings)
+	{
+		return settings.Padding << (std::max(settings.MipLevels, 1u) - 1);
+	}
+
+	bool PackRects(std::vector<stbrp_rect>& rects, unsigned int width, unsigned int height)
+	{
+		stbrp_context context = {};
+		std::vector<stbrp_node> nodes(width);
+		stbrp_init_target(&context, (int)width, (int)height, nodes.data(), (int)nodes.size());
+		stbrp_setup_heuristic(&context, STBRP_HEURISTIC_Skyline_BF_sortHeight);
+		return stbrp_pack_rects(&context, rects.data(), (int)rects.size()) != 0;
+	}
+
+	// --------------------------------------------------------
+	// Copies an image into its slot on the page, filling the
+	// rest of the slot (the gutter) from the image's edges
+	// --------------------------------------------------------
+	void CopyToSlot(const BlockImage& image, BlockImage& page, unsigned int slotX, unsigned int slotY, unsigned int slotWidth, unsigned int slotHeight, unsigned int gutter, AtlasGutter mode)
+	{
+		int width = (int)image.Width;
+		int height = (int)image.Height;
+		for (unsigned int y = 0; y < slotHeight; y++)
+		{
+			int sy = (int)y - (int)gutter;
+			sy = mode == ATLAS_GUTTER_WRAP ? ((sy % height) + height) % height : std::clamp(sy, 0, height - 1);
+
+			unsigned char* row = &page.Pixels[((size_t)(slotY + y) * page.Width + slotX) * 4];
+			for (unsigned int x = 0; x < slotWidth; x++)
+			{
+				int sx = (int)x - (int)gutter;
+				sx = mode == ATLAS_GUTTER_WRAP ? ((sx % width) + width) % width : std::clamp(sx, 0, width - 1);
+				memcpy(&row[x * 4], &image.Pixels[((size_t)sy * width + sx) * 4], 4);
+			}
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Packing happens in cells, so every slot is block aligned
+// at each clean mip.  Each page first takes as many of the
+// remaining textures as fit at full size, then shrinks as
+// far as those still fit.
+// --------------------------------------------------------
+Atlas TextureAtlas::Build(const std::vector<BlockImage>& images, const std::vector<std::wstring>& names, const AtlasSettings& settings)
+{
+	Atlas atlas = {};
+	unsigned int cell = GetCellSize(settings);
+	unsigned int gutter = GetGutter(settings);
+	unsigned int maxCells = settings.MaxSize / cell;
+
+	std::vector<unsigned int> waiting;
+	atlas.Entries.resize(images.size());
+	for (unsigned int i = 0; i < images.size(); i++)
+	{
+		AtlasEntry& entry = atlas.Entries[i];
+		entry.Name = i < names.size() ? names[i] : L"";
+		entry.Width = images[i].Width;
+		entry.Height = images[i].Height;
+
+		unsigned int slotWidth = (entry.Width + gutter * 2 + cell - 1) / cell;
+		unsigned int slotHeight = (entry.Height + gutter * 2 + cell - 1) / cell;
+		if (entry.Width > 0 && entry.Height > 0 && slotWidth <= maxCells && slotHeight <= maxCells)
+			waiting.push_back(i);
+		else
+			atlas.Stats.Unplaced++;
+	}
+
+	while (!waiting.empty())
+	{
+		std::vector<stbrp_rect> rects(waiting.size());
+		for (size_t r = 0; r < waiting.size(); r++)
+		{
+			rects[r].id = (int)waiting[r];
+			rects[r].w = (int)((atlas.Entries[waiting[r]].Width + gutter * 2 + cell - 1) / cell);
+			rects[r].h = (int)((atlas.Entries[waiting[r]].Height + gutter * 2 + cell - 1) / cell);
+		}
+		PackRects(rects, maxCells, maxCells);
+
+		std::vector<stbrp_rect> pageRects;
+		std::vector<unsigned int> leftOver;
+		unsigned long long cellArea = 0;
+		for (const stbrp_rect& r : rects)
+		{
+			if (r.was_packed)
+			{
+				pageRects.push_back(r);
+				cellArea += (unsigned long long)r.w * r.h;
+			}
+			else
+			{
+				leftOver.push_back((unsigned int)r.id);
+			}
+		}
+
+		// Every texture fits an empty page on its own, so this only
+		// guards against the packer misbehaving
+		if (pageRects.empty())
+		{
+			atlas.Stats.Unplaced += (unsigned int)leftOver.size();
+			break;
+		}
+
+		// Smallest page (then the squarest) that still holds them all.
+		// The full size page is always among them, and known to work.
+		std::vector<std::pair<unsigned int, unsigned int>> sizes;
+		for (unsigned int w = maxCells; w > 0; w /= 2)
+			for (unsigned int h = maxCells; h > 0; h /= 2)
+				if ((unsigned long long)w * h >= cellArea)
+					sizes.push_back({ w, h });
+		std::sort(sizes.begin(), sizes.end(), [](const auto& a, const auto& b)
+		{
+			unsigned long long areaA = (unsigned long long)a.first * a.second;
+			unsigned long long areaB = (unsigned long long)b.first * b.second;
+			if (areaA != areaB)
+				return areaA < areaB;
+			return std::max(a.first, a.second) < std::max(b.first, b.second);
+		});
+
+		unsigned int pageCellsX = maxCells;
+		unsigned int pageCellsY = maxCells;
+		for (const auto& size : sizes)
+		{
+			std::vector<stbrp_rect> attempt = pageRects;
+			if (PackRects(attempt, size.first, size.second))
+			{
+				pageRects = attempt;
+				pageCellsX = size.first;
+				pageCellsY = size.second;
+				break;
+			}
+		}
+
+		BlockImage page = {};
+		page.Width = pageCellsX * cell;
+		page.Height = pageCellsY * cell;
+		page.Pixels.resize((size_t)page.Width * page.Height * 4);
+
+		unsigned int pageIndex = (unsigned int)atlas.Pages.size();
+		for (const stbrp_rect& r : pageRects)
+		{
+			AtlasEntry& entry = atlas.Entries[r.id];
+			entry.Placed = true;
+			entry.Page = pageIndex;
+			entry.X = r.x * cell + gutter;
+			entry.Y = r.y * cell + gutter;
+			entry.Scale = XMFLOAT2((float)entry.Width / page.Width, (float)entry.Height / page.Height);
+			entry.Offset = XMFLOAT2((float)entry.X / page.Width, (float)entry.Y / page.Height);
+
+			CopyToSlot(images[r.id], page, r.x * cell, r.y * cell, r.w * cell, r.h * cell, gutter, settings.Gutter);
+
+			atlas.Stats.TextureTexels += (unsigned long long)entry.Width * entry.Height;
+			atlas.Stats.GutterTexels += (unsigned long long)r.w * r.h * cell * cell - (unsigned long long)entry.Width * entry.Height;
+		}
+
+		atlas.Stats.PageTexels += (unsigned long long)page.Width * page.Height;
+		atlas.Pages.push_back(std::move(page));
+		waiting.swap(leftOver);
+	}
+
+	atlas.Stats.Pages = (unsigned int)atlas.Pages.size();
+	atlas.Stats.Efficiency = atlas.Stats.PageTexels ? (float)((double)atlas.Stats.TextureTexels / atlas.Stats.PageTexels) : 0;
+	return atlas;
+}
+
+bool TextureAtlas::SaveLayout(const std::filesystem::path& path, const Atlas& atlas)
+{
+	std::ofstream file(path);
+	if (!file)
+		return false;
+
+	file.precision(9);
+	file << "# name page x y width height scaleU scaleV offsetU offsetV\n";
+	for (const AtlasEntry& e : atlas.Entries)
+	{
+		if (!e.Placed)
+			continue;
+		file << std::filesystem::path(e.Name).string() << ' ' << e.Page << ' '
+			<< e.X << ' ' << e.Y << ' ' << e.Width << ' ' << e.Height << ' '
+			<< e.Scale.x << ' ' << e.Scale.y << ' ' << e.Offset.x << ' ' << e.Offset.y << '\n';
+	}
+	return (bool)file;
+}
+
+bool TextureAtlas::LoadLayout(const std::filesystem::path& path, std::vector<AtlasEntry>* entries)
+{
+	std::ifstream file(path);
+	if (!file)
+		return false;
+
+	std::string line;
+	while (std::getline(file, line))
+	{
+		line = line.substr(0, line.find('#'));
+
+		std::istringstream columns(line);
+		std::string name;
+		AtlasEntry e = {};
+		if (!(columns >> name))
+			continue;
+		if (!(columns >> e.Page >> e.X >> e.Y >> e.Width >> e.Height >> e.Scale.x >> e.Scale.y >> e.Offset.x >> e.Offset.y))
+			return false;
+
+		e.Name = std::filesystem::path(name).wstring();
+		e.Placed = true;
+		entries->push_back(e);
+	}
+	return true;
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include "BlockCompression.h"
+
+// --------------------------------------------------------
+// What fills the gutter around each texture
+//  - CLAMP: its edge texels, stretched outward
+//  - WRAP: texels from the opposite edge, so filtering at
+//    the border of a tiling texture matches WRAP sampling
+// --------------------------------------------------------
+enum AtlasGutter
+{
+	ATLAS_GUTTER_CLAMP,
+	ATLAS_GUTTER_WRAP
+};
+
+struct AtlasSettings
+{
+	unsigned int MaxSize;		// Largest page, in pixels (a power of two)
+	unsigned int MipLevels;		// Mips that must stay free of bleeding
+	unsigned int Padding;		// Gutter texels at the smallest of those mips
+	AtlasGutter Gutter;
+};
+
+// --------------------------------------------------------
+// Where one texture ended up.  Scale and Offset go straight
+// into a Material's SetScale() and SetOffset(), turning the
+// mesh's 0-1 UVs into the texture's part of the page.
+// --------------------------------------------------------
+struct AtlasEntry
+{
+	std::wstring Name;
+	bool Placed;				// False if it's too large for a page
+	unsigned int Page;
+	unsigned int X;				// Top left of the texture itself,
+	unsigned int Y;				// inside its gutter
+	unsigned int Width;
+	unsigned int Height;
+	DirectX::XMFLOAT2 Scale;
+	DirectX::XMFLOAT2 Offset;
+};
+
+// --------------------------------------------------------
+// How well the textures filled their pages
+// --------------------------------------------------------
+struct AtlasStats
+{
+	unsigned int Pages;
+	unsigned int Unplaced;
+	unsigned long long PageTexels;		// Every page's full area
+	unsigned long long TextureTexels;	// Just the textures themselves
+	unsigned long long GutterTexels;	// Padding and alignment around them
+	float Efficiency;					// TextureTexels / PageTexels
+};
+
+struct Atlas
+{
+	std::vector<BlockImage> Pages;
+	std::vector<AtlasEntry> Entries;	// In the order the images were given
+	AtlasStats Stats;
+};
+
+// --------------------------------------------------------
+// Bakes many small textures into a few large pages, so
+// materials using them can share one texture and differ
+// only in their UV scale & offset.  Tiling (UVs outside
+// 0-1) doesn't work for atlased textures.
+//
+// Rectangles are packed with stb_rect_pack (the copy that
+// ships with ImGui), on a grid of BC blocks as large as the
+// last clean mip needs.  Each texture's slot (the texture
+// plus its gutter) then starts and ends on a block boundary
+// at every one of those mips, so no block, and no 2x2 box
+// filtered mip texel, mixes neighbours.  The gutter keeps
+// bilinear filtering at each of those mips in the slot.
+// Pages are filled up to MaxSize, and the last one is shrunk
+// to the smallest power of two that holds what's left.
+// Build only MipLevels mips for the pages, with the box
+// filter (wider filters reach into neighbouring slots).
+//
+// No graphics API, so atlases can be baked headless (see
+// Tools/BakeAtlas.cpp).
+// --------------------------------------------------------
+namespace TextureAtlas
+{
+	// Names are only carried through to the entries
+	Atlas Build(const std::vector<BlockImage>& images, const std::vector<std::wstring>& names, const AtlasSettings& settings);
+
+	// Plain text, one entry per line: name page x y width height,
+	// then the scale & offset (names can't hold spaces)
+	bool SaveLayout(const std::filesystem::path& path, const Atlas& atlas);
+	bool LoadLayout(const std::filesystem::path& path, std::vector<AtlasEntry>* entries);
+}
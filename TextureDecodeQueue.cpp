@@ -0,0 +1,168 @@
+#include "TextureDecodeQueue.h"
+#include "PNGDecoder.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
+namespace
+{
+	// Whether the file at path was written after time (missing files never were)
+	bool IsNewer(const std::wstring& path, std::filesystem::file_time_type time)
+	{
+		std::error_code error;
+		auto pathTime = std::filesystem::last_write_time(path, error);
+		return !error && pathTime > time;
+	}
+
+	bool ReadFile(const std::filesystem::path& path, std::vector<unsigned char>* data)
+	{
+		std::ifstream file(path, std::ios::binary | std::ios::ate);
+		if (!file)
+			return false;
+
+		std::streamoff size = file.tellg();
+		if (size <= 0)
+			return false;
+
+		data->resize((size_t)size);
+		file.seekg(0);
+		return (bool)file.read((char*)data->data(), size);
+	}
+
+	// --------------------------------------------------------
+	// Fills in a compressed texture: the cached .dds if it's
+	// current, otherwise the image (or pack, if there is one)
+	// encoded from scratch
+	// --------------------------------------------------------
+	void DecodeCompressed(const TextureImportSettings& settings, const ChannelPack* pack, DecodedTexture* texture, unsigned int threadCount)
+	{
+		std::filesystem::path ddsPath = std::filesystem::path(texture->Path).replace_extension(L".dds");
+		texture->CachePath = ddsPath.wstring();
+
+		std::vector<std::wstring> sources = { settings.NormalMapPath };
+		if (pack)
+			sources.insert(sources.end(), pack->Sources, pack->Sources + PACK_CHANNEL_COUNT);
+		else
+			sources.push_back(texture->Path);
+
+		std::error_code ddsError;
+		auto ddsTime = std::filesystem::last_write_time(ddsPath, ddsError);
+		bool current = !ddsError;
+		for (const std::wstring& source : sources)
+			if (!source.empty() && IsNewer(source, ddsTime))
+				current = false;
+
+		if (current && (settings.CacheOnly || ReadFile(ddsPath, &texture->DDSFile)))
+		{
+			texture->Decoded = true;
+			return;
+		}
+
+		// Blocks need sizes that are multiples of 4
+		BlockImage image = {};
+		bool loaded = pack ? ChannelPacker::Load(*pack, &image) : PNGDecoder::Load(texture->Path, &image);
+		if (!loaded || image.Width % 4 != 0 || image.Height % 4 != 0)
+			return;
+
+		// A normal map that fails to load just means no Toksvig
+		BlockImage normalMap = {};
+		MipSettings mipSettings = {};
+		mipSettings.Filter = settings.Filter;
+		mipSettings.Content = settings.Content;
+		if (!settings.NormalMapPath.empty() && PNGDecoder::Load(settings.NormalMapPath, &normalMap))
+			mipSettings.NormalMap = &normalMap;
+
+		std::vector<BlockImage> levels = MipGenerator::Generate(image, mipSettings, threadCount);
+		texture->Mips.resize(levels.size());
+		for (size_t i = 0; i < levels.size(); i++)
+			texture->Mips[i] = BlockCompression::CompressImage(settings.Format, levels[i], threadCount);
+
+		texture->Format = settings.Format;
+		texture->Width = image.Width;
+		texture->Height = image.Height;
+		texture->Decoded = true;
+
+		// Failing to save only means encoding again next time,
+		// unless the .dds was all that was wanted
+		bool saved = BlockCompression::SaveDDS(ddsPath, settings.Format, image.Width, image.Height, texture->Mips);
+		if (settings.CacheOnly)
+		{
+			texture->Decoded = saved;
+			texture->Mips.clear();
+		}
+	}
+}
+
+TextureDecodeQueue::TextureDecodeQueue() :
+	decodeTime(0)
+{
+}
+
+unsigned int TextureDecodeQueue::AddImage(const std::wstring& path)
+{
+	Job job = {};
+	job.Result.Path = path;
+	jobs.push_back(job);
+	return (unsigned int)jobs.size() - 1;
+}
+
+unsigned int TextureDecodeQueue::AddCompressed(const std::wstring& path, const TextureImportSettings& settings)
+{
+	Job job = {};
+	job.Settings = settings;
+	job.Result.Path = path;
+	job.Result.Compressed = true;
+	jobs.push_back(job);
+	return (unsigned int)jobs.size() - 1;
+}
+
+unsigned int TextureDecodeQueue::AddPacked(const ChannelPack& pack, const TextureImportSettings& settings)
+{
+	Job job = {};
+	job.Settings = settings;
+	job.Packed = true;
+	job.Pack = pack;
+	job.Result.Path = pack.Output;
+	job.Result.Compressed = true;
+	jobs.push_back(job);
+	return (unsigned int)jobs.size() - 1;
+}
+
+// --------------------------------------------------------
+// Each worker takes the next unstarted job until none are
+// left, so slow images (large, or needing encoding) don't
+// hold up the rest.  Threads left over once every job has
+// a worker are shared out to the mip and block encoders.
+// --------------------------------------------------------
+void TextureDecodeQueue::Decode(unsigned int threadCount)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+
+	unsigned int workerCount = std::clamp((unsigned int)jobs.size(), 1u, std::max(1u, threadCount));
+	unsigned int innerThreads = std::max(1u, threadCount / workerCount);
+	std::atomic<unsigned int> next(0);
+
+	auto work = [&]()
+	{
+		for (unsigned int i = next++; i < jobs.size(); i = next++)
+		{
+			DecodedTexture& texture = jobs[i].Result;
+			if (texture.Compressed)
+				DecodeCompressed(jobs[i].Settings, jobs[i].Packed ? &jobs[i].Pack : 0, &texture, innerThreads);
+			else
+				texture.Decoded = PNGDecoder::Load(texture.Path, &texture.Image);
+		}
+	};
+
+	std::vector<std::thread> workers;
+	for (unsigned int i = 1; i < workerCount; i++)
+		workers.emplace_back(work);
+	work();
+	for (std::thread& t : workers)
+		t.join();
+
+	decodeTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
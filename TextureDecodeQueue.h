@@ -0,0 +1,107 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "BlockCompression.h"
+#include "ChannelPacker.h"
+#include "MipGenerator.h"
+
+// --------------------------------------------------------
+// How an image is turned into a compressed texture
+// --------------------------------------------------------
+struct TextureImportSettings
+{
+	BlockCompressionFormat Format;
+	MipFilter Filter;
+	MipContent Content;
+
+	// Optional, for roughness maps: the matching normal map,
+	// for Toksvig adjustment (see MipSettings::NormalMap)
+	std::wstring NormalMapPath;
+
+	// Only makes sure the .dds is up to date, leaving the data
+	// on disk for whoever streams it (see TextureStreamer)
+	bool CacheOnly;
+};
+
+// --------------------------------------------------------
+// One texture's data, decoded and ready to be uploaded.
+// Which members are filled depends on how it was queued
+// and whether there was an up to date .dds for it.
+// --------------------------------------------------------
+struct DecodedTexture
+{
+	std::wstring Path;
+	bool Compressed;
+
+	// Compressed textures: the .dds the encoded data is cached in
+	std::wstring CachePath;
+
+	// False if the file couldn't be decoded here, in which
+	// case uploading falls back to loading it through WIC
+	bool Decoded;
+
+	// Plain images: the pixels, as RGBA8
+	BlockImage Image;
+
+	// Compressed textures: a cached .dds file, read as is...
+	std::vector<unsigned char> DDSFile;
+
+	// ...or freshly encoded mips, largest first
+	BlockCompressionFormat Format;
+	unsigned int Width;
+	unsigned int Height;
+	std::vector<std::vector<unsigned char>> Mips;
+};
+
+// --------------------------------------------------------
+// The first half of loading textures: everything that can
+// happen without the graphics API (reading files, decoding
+// PNGs, building mips, block compressing) done for many
+// images at once across worker threads.  Uploading the
+// results is left to the render thread (see
+// TextureImporter.h).
+//
+// Add() every image first, then Decode() once and Get()
+// each result by its handle.
+// --------------------------------------------------------
+class TextureDecodeQueue
+{
+public:
+	TextureDecodeQueue();
+
+	// Queues an image to be decoded as is, and returns its handle
+	unsigned int AddImage(const std::wstring& path);
+
+	// Queues an image to be block compressed with a full mip chain,
+	// or read from a .dds beside it (same name) that's at least as
+	// new as the image (and the normal map, if there is one).  Fresh
+	// encodes are saved as that .dds, so the cost is only paid once.
+	unsigned int AddCompressed(const std::wstring& path, const TextureImportSettings& settings);
+
+	// Like AddCompressed(), for the image a ChannelPack builds, cached
+	// at the pack's output path.  The cache is checked against every
+	// source map.
+	unsigned int AddPacked(const ChannelPack& pack, const TextureImportSettings& settings);
+
+	// Decodes every queued image, returning once they're all done
+	void Decode(unsigned int threadCount);
+
+	const DecodedTexture& Get(unsigned int handle) const { return jobs[handle].Result; }
+	unsigned int GetCount() const { return (unsigned int)jobs.size(); }
+
+	// Wall clock time the last Decode() took, in milliseconds
+	double GetDecodeTime() const { return decodeTime; }
+
+private:
+	struct Job
+	{
+		TextureImportSettings Settings;
+		bool Packed;
+		ChannelPack Pack;
+		DecodedTexture Result;
+	};
+
+	std::vector<Job> jobs;
+	double decodeTime;
+};
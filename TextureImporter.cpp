@@ -0,0 +1,135 @@
+#include "TextureImporter.h"
+#include "WICTextureLoader.h"
+#include "DDSTextureLoader.h"
+#include <thread>
+
+using namespace Microsoft::WRL;
+
+ComPtr<ID3D11ShaderResourceView> CreateDecodedTexture(
+	ComPtr<ID3D11Device> device,
+	ComPtr<ID3D11DeviceContext> context,
+	const DecodedTexture& texture)
+{
+	ComPtr<ID3D11ShaderResourceView> srv;
+	if (!texture.Decoded)
+	{
+		DirectX::CreateWICTextureFromFile(device.Get(), context.Get(), texture.Path.c_str(), 0, srv.GetAddressOf());
+		return srv;
+	}
+
+	if (!texture.DDSFile.empty())
+	{
+		DirectX::CreateDDSTextureFromMemory(device.Get(), texture.DDSFile.data(), texture.DDSFile.size(), 0, srv.GetAddressOf());
+		return srv;
+	}
+
+	// Queued with CacheOnly, so the data is still on disk
+	if (texture.Compressed && texture.Mips.empty())
+	{
+		DirectX::CreateDDSTextureFromFile(device.Get(), texture.CachePath.c_str(), 0, srv.GetAddressOf());
+		return srv;
+	}
+
+	// Plain images get just the one level
+	D3D11_TEXTURE2D_DESC desc = {};
+	std::vector<D3D11_SUBRESOURCE_DATA> initialData;
+	if (texture.Compressed)
+	{
+		desc.Width = texture.Width;
+		desc.Height = texture.Height;
+		desc.MipLevels = (unsigned int)texture.Mips.size();
+		desc.Format = (DXGI_FORMAT)BlockCompression::GetDXGIFormat(texture.Format);
+
+		unsigned int width = texture.Width;
+		for (const std::vector<unsigned char>& mip : texture.Mips)
+		{
+			D3D11_SUBRESOURCE_DATA data = {};
+			data.pSysMem = mip.data();
+			data.SysMemPitch = max(1u, (width + 3) / 4) * BlockCompression::GetBlockBytes(texture.Format);
+			initialData.push_back(data);
+			width = max(1u, width / 2);
+		}
+	}
+	else
+	{
+		desc.Width = texture.Image.Width;
+		desc.Height = texture.Image.Height;
+		desc.MipLevels = 1;
+		desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+
+		D3D11_SUBRESOURCE_DATA data = {};
+		data.pSysMem = texture.Image.Pixels.data();
+		data.SysMemPitch = texture.Image.Width * 4;
+		initialData.push_back(data);
+	}
+	desc.ArraySize = 1;
+	desc.SampleDesc.Count = 1;
+	desc.Usage = D3D11_USAGE_IMMUTABLE;
+	desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+	ComPtr<ID3D11Texture2D> resource;
+	if (SUCCEEDED(device->CreateTexture2D(&desc, initialData.data(), resource.GetAddressOf())))
+		device->CreateShaderResourceView(resource.Get(), 0, srv.GetAddressOf());
+	return srv;
+}
+
+ComPtr<ID3D11ShaderResourceView> CreateDecodedCubemap(
+	ComPtr<ID3D11Device> device,
+	const DecodedTexture* faces[6])
+{
+	ComPtr<ID3D11ShaderResourceView> srv;
+
+	// Every face takes its size from the first one that loaded
+	const BlockImage* first = 0;
+	for (int i = 0; i < 6 && !first; i++)
+		if (faces[i]->Decoded && !faces[i]->Compressed)
+			first = &faces[i]->Image;
+	if (!first)
+		return srv;
+
+	std::vector<unsigned char> black((size_t)first->Width * first->Height * 4, 0);
+	D3D11_SUBRESOURCE_DATA initialData[6] = {};
+	for (int i = 0; i < 6; i++)
+	{
+		const BlockImage& image = faces[i]->Image;
+		bool usable = faces[i]->Decoded && !faces[i]->Compressed &&
+			image.Width == first->Width && image.Height == first->Height;
+		initialData[i].pSysMem = usable ? image.Pixels.data() : black.data();
+		initialData[i].SysMemPitch = first->Width * 4;
+	}
+
+	D3D11_TEXTURE2D_DESC cubeDesc = {};
+	cubeDesc.Width = first->Width;
+	cubeDesc.Height = first->Height;
+	cubeDesc.MipLevels = 1;
+	cubeDesc.ArraySize = 6;
+	cubeDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+	cubeDesc.SampleDesc.Count = 1;
+	cubeDesc.Usage = D3D11_USAGE_IMMUTABLE;
+	cubeDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+	cubeDesc.MiscFlags = D3D11_RESOURCE_MISC_TEXTURECUBE;
+
+	ComPtr<ID3D11Texture2D> cubeMapTexture;
+	if (FAILED(device->CreateTexture2D(&cubeDesc, initialData, cubeMapTexture.GetAddressOf())))
+		return srv;
+
+	D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+	srvDesc.Format = cubeDesc.Format;
+	srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURECUBE;
+	srvDesc.TextureCube.MipLevels = 1;
+	srvDesc.TextureCube.MostDetailedMip = 0;
+	device->CreateShaderResourceView(cubeMapTexture.Get(), &srvDesc, srv.GetAddressOf());
+	return srv;
+}
+
+ComPtr<ID3D11ShaderResourceView> LoadCompressedTexture(
+	ComPtr<ID3D11Device> device,
+	ComPtr<ID3D11DeviceContext> context,
+	const std::wstring& path,
+	const TextureImportSettings& settings)
+{
+	TextureDecodeQueue queue;
+	unsigned int handle = queue.AddCompressed(path, settings);
+	queue.Decode(max(1u, std::thread::hardware_concurrency()));
+	return CreateDecodedTexture(device, context, queue.Get(handle));
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <d3d11.h>
+#include <wrl/client.h>
+#include <string>
+#include "TextureDecodeQueue.h"
+
+// --------------------------------------------------------
+// The second half of loading textures: turning what a
+// TextureDecodeQueue produced into resources.  These need
+// the immediate context, so they run on the render thread.
+//
+// Images that couldn't be decoded fall back to loading
+// uncompressed through WIC.
+// --------------------------------------------------------
+Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> CreateDecodedTexture(
+	Microsoft::WRL::ComPtr<ID3D11Device> device,
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
+	const DecodedTexture& texture);
+
+// --------------------------------------------------------
+// Creates a cube map from six decoded faces, in the order
+// +X, -X, +Y, -Y, +Z, -Z.  Faces that are missing or don't
+// match the first good face's size are left black.
+// --------------------------------------------------------
+Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> CreateDecodedCubemap(
+	Microsoft::WRL::ComPtr<ID3D11Device> device,
+	const DecodedTexture* faces[6]);
+
+// --------------------------------------------------------
+// Decodes and uploads a single compressed texture, for
+// when there's nothing to load alongside it
+// --------------------------------------------------------
+Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> LoadCompressedTexture(
+	Microsoft::WRL::ComPtr<ID3D11Device> device,
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
+	const std::wstring& path,
+	const TextureImportSettings& settings);
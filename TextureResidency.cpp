@@ -0,0 +1,147 @@
+#include "TextureResidency.h"
+#include <algorithm>
+#include <cmath>
+
+// Nothing has been requested before the first frame
+TextureResidency::TextureResidency(unsigned long long budget) :
+	budget(budget),
+	committed(0),
+	frame(1),
+	upgrades(0),
+	evictions(0),
+	starved(0)
+{
+}
+
+unsigned int TextureResidency::Add(const std::vector<unsigned long long>& levelBytes, unsigned int tailMip)
+{
+	Texture texture = {};
+	texture.LevelBytes = levelBytes;
+	texture.Tail = std::min(tailMip, (unsigned int)levelBytes.size() - 1);
+	texture.Target = texture.Tail;
+	texture.Need = texture.Tail;
+
+	for (unsigned int mip = texture.Tail; mip < levelBytes.size(); mip++)
+		committed += levelBytes[mip];
+
+	textures.push_back(texture);
+	changed.push_back(false);
+	return (unsigned int)textures.size() - 1;
+}
+
+void TextureResidency::Request(unsigned int texture, unsigned int mip)
+{
+	Texture& t = textures[texture];
+	mip = std::min(mip, t.Tail);
+
+	// Several users in one frame: the finest of their requests
+	if (t.LastUsed != frame)
+		t.Need = mip;
+	else
+		t.Need = std::min(t.Need, mip);
+	t.LastUsed = frame;
+}
+
+// --------------------------------------------------------
+// Drops the most detailed level of the least recently used
+// texture that can spare one, other than keep.  Textures
+// used this frame can only spare levels they didn't need.
+// --------------------------------------------------------
+bool TextureResidency::EvictOne(unsigned int keep)
+{
+	unsigned int victim = (unsigned int)textures.size();
+	for (unsigned int i = 0; i < textures.size(); i++)
+	{
+		const Texture& t = textures[i];
+		unsigned int floor = t.LastUsed == frame ? t.Need : t.Tail;
+		if (i == keep || t.Target >= floor)
+			continue;
+		if (victim == textures.size() || t.LastUsed < textures[victim].LastUsed)
+			victim = i;
+	}
+	if (victim == textures.size())
+		return false;
+
+	Texture& t = textures[victim];
+	committed -= t.LevelBytes[t.Target];
+	t.Target++;
+	evictions++;
+	changed[victim] = true;
+	return true;
+}
+
+std::vector<unsigned int> TextureResidency::Update()
+{
+	upgrades = 0;
+	evictions = 0;
+	starved = 0;
+	std::fill(changed.begin(), changed.end(), false);
+
+	// Fit a budget that shrank
+	while (committed > budget && EvictOne((unsigned int)textures.size())) {}
+
+	// Textures short of what they need this frame
+	std::vector<unsigned int> waiting;
+	for (unsigned int i = 0; i < textures.size(); i++)
+		if (textures[i].LastUsed == frame && textures[i].Need < textures[i].Target)
+			waiting.push_back(i);
+
+	// One level per texture per round, so a single large texture
+	// can't take the whole budget while others get nothing
+	while (!waiting.empty())
+	{
+		std::vector<unsigned int> stillWaiting;
+		for (unsigned int i : waiting)
+		{
+			Texture& t = textures[i];
+			unsigned long long cost = t.LevelBytes[t.Target - 1];
+			while (committed + cost > budget && EvictOne(i)) {}
+			if (committed + cost > budget)
+			{
+				starved++;
+				continue;
+			}
+
+			committed += cost;
+			t.Target--;
+			upgrades++;
+			changed[i] = true;
+			if (t.Need < t.Target)
+				stillWaiting.push_back(i);
+		}
+		waiting.swap(stillWaiting);
+	}
+
+	std::vector<unsigned int> result;
+	for (unsigned int i = 0; i < textures.size(); i++)
+		if (changed[i])
+			result.push_back(i);
+
+	frame++;
+	return result;
+}
+
+TextureResidencyStats TextureResidency::GetStats() const
+{
+	TextureResidencyStats stats = {};
+	stats.Budget = budget;
+	stats.Committed = committed;
+	stats.Upgrades = upgrades;
+	stats.Evictions = evictions;
+	stats.Starved = starved;
+	return stats;
+}
+
+// --------------------------------------------------------
+// A world unit at this distance spans screenHeight /
+// (2 * distance * tan(fov / 2)) pixels.  Each mip halves
+// the texels, so the mip where texels match pixels is the
+// log2 of their ratio.
+// --------------------------------------------------------
+float TextureResidency::EstimateMip(float texelsPerUnit, float distance, float fieldOfView, float screenHeight)
+{
+	float pixelsPerUnit = screenHeight / (2 * std::max(distance, 0.0001f) * std::tan(fieldOfView / 2));
+	if (texelsPerUnit <= 0 || pixelsPerUnit <= 0)
+		return 0;
+	return std::max(0.0f, std::log2(texelsPerUnit / pixelsPerUnit));
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <vector>
+
+// --------------------------------------------------------
+// Where the budget went in the last Update()
+// --------------------------------------------------------
+struct TextureResidencyStats
+{
+	unsigned long long Budget;
+	unsigned long long Committed;	// Bytes of every texture's target mips
+	unsigned int Upgrades;			// Mip levels granted
+	unsigned int Evictions;			// Mip levels taken away
+	unsigned int Starved;			// Textures left short of what they asked for
+};
+
+// --------------------------------------------------------
+// Decides how many mips of each streamed texture should be
+// in memory, keeping the total within a fixed budget.
+//
+// Every texture has a tail of small mips that's always
+// resident.  Each frame, users Request() the finest mip
+// they'll sample, then Update() grants the missing levels
+// one at a time, in turn across textures, coarsest first.
+// When the budget runs out, levels are evicted from the
+// least recently requested textures (ties go to the lower
+// index), never taking levels a texture needs this frame.
+// Extra levels are kept until the space is wanted, so a
+// texture that comes back into view finds them waiting.
+//
+// Mip 0 is the most detailed.  A texture's "target" is its
+// most detailed mip that should be resident; whoever does
+// the loading follows the targets.
+//
+// No clocks, threads or graphics API: the same requests
+// always give the same decisions.
+// --------------------------------------------------------
+class TextureResidency
+{
+public:
+	TextureResidency(unsigned long long budget);
+
+	// levelBytes holds each mip's size, most detailed first.  Mips
+	// from tailMip on are always resident, and counted as such.
+	unsigned int Add(const std::vector<unsigned long long>& levelBytes, unsigned int tailMip);
+
+	// The texture will be sampled down to this mip this frame
+	void Request(unsigned int texture, unsigned int mip);
+
+	// Ends the frame's requests and moves targets to match,
+	// returning the textures whose targets changed
+	std::vector<unsigned int> Update();
+
+	unsigned int GetTarget(unsigned int texture) const { return textures[texture].Target; }
+	unsigned int GetTail(unsigned int texture) const { return textures[texture].Tail; }
+	unsigned int GetCount() const { return (unsigned int)textures.size(); }
+
+	// A smaller budget evicts on the next Update()
+	void SetBudget(unsigned long long newBudget) { budget = newBudget; }
+	TextureResidencyStats GetStats() const;
+
+	// ----------------------------------------------------
+	// The finest mip worth having for a surface at distance
+	// (in world units), seen face on through a perspective
+	// camera, given how many texels of mip 0 cover one world
+	// unit.  Past that mip, texels are smaller than pixels.
+	// ----------------------------------------------------
+	static float EstimateMip(float texelsPerUnit, float distance, float fieldOfView, float screenHeight);
+
+private:
+	struct Texture
+	{
+		std::vector<unsigned long long> LevelBytes;
+		unsigned int Tail;
+		unsigned int Target;
+		unsigned int Need;			// Finest requested mip, this frame
+		unsigned long long LastUsed;	// Frame of the last request
+	};
+
+	bool EvictOne(unsigned int keep);
+
+	std::vector<Texture> textures;
+	unsigned long long budget;
+	unsigned long long committed;
+	unsigned long long frame;
+	unsigned int upgrades;
+	unsigned int evictions;
+	unsigned int starved;
+	std::vector<bool> changed;
+};
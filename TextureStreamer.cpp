@@ -0,0 +1,328 @@
+#include "TextureStreamer.h"
+#include <fstream>
+
+using namespace Microsoft::WRL;
+
+TextureStreamer::TextureStreamer(
+	ComPtr<ID3D11Device> device,
+	ComPtr<ID3D11DeviceContext> context,
+	unsigned long long budget,
+	unsigned int tailSize) :
+	device(device),
+	context(context),
+	tailSize(tailSize),
+	residency(budget),
+	residentBytes(0),
+	pendingLoads(0),
+	stopping(false)
+{
+	worker = std::thread(&TextureStreamer::ReadLoads, this);
+}
+
+TextureStreamer::~TextureStreamer()
+{
+	{
+		std::lock_guard<std::mutex> lock(loadMutex);
+		stopping = true;
+	}
+	loadReady.notify_all();
+	worker.join();
+}
+
+unsigned int TextureStreamer::Add(const std::wstring& ddsPath)
+{
+	Source source = {};
+	source.Path = ddsPath;
+	sources.push_back(source);
+	return (unsigned int)sources.size() - 1;
+}
+
+// --------------------------------------------------------
+// Groups the files by size, mip count & format (from their
+// headers alone), then creates each array with just the
+// mips up to tailSize pixels
+// --------------------------------------------------------
+void TextureStreamer::Build()
+{
+	TextureArrayPacker packer(D3D11_REQ_TEXTURE2D_ARRAY_AXIS_DIMENSION);
+	for (Source& s : sources)
+	{
+		if (!BlockCompression::ReadDDSLayout(s.Path, &s.Layout))
+			continue;
+
+		TextureArrayFormat format = {};
+		format.Width = s.Layout.Width;
+		format.Height = s.Layout.Height;
+		format.MipLevels = s.Layout.MipLevels;
+		format.Format = BlockCompression::GetDXGIFormat(s.Layout.Format);
+		s.Streamed = packer.Add(format, &s.Slot);
+	}
+
+	resources.resize(packer.GetArrayCount());
+	for (unsigned int i = 0; i < sources.size(); i++)
+	{
+		if (!sources[i].Streamed)
+			continue;
+
+		Resource& r = resources[sources[i].Slot.Array];
+		r.Format = packer.GetFormat(sources[i].Slot.Array);
+		r.BlockFormat = sources[i].Layout.Format;
+		r.Slices.push_back(i);
+	}
+
+	std::vector<TextureStreamerSwap> swaps;
+	for (unsigned int i = 0; i < resources.size(); i++)
+	{
+		Resource& r = resources[i];
+
+		unsigned int tail = 0;
+		while (tail + 1 < r.Format.MipLevels && max(r.Format.Width >> tail, r.Format.Height >> tail) > tailSize)
+			tail++;
+
+		std::vector<unsigned long long> levelBytes(r.Format.MipLevels);
+		for (unsigned int mip = 0; mip < r.Format.MipLevels; mip++)
+			levelBytes[mip] = GetBytes(r, mip) - (mip + 1 < r.Format.MipLevels ? GetBytes(r, mip + 1) : 0);
+		r.ResidencyId = residency.Add(levelBytes, tail);
+
+		// The tail is read right away, on this thread
+		Load load = {};
+		load.Resource = i;
+		load.FirstMip = tail;
+		load.EndMip = r.Format.MipLevels;
+		r.Resident = r.Format.MipLevels;
+		if (ReadMips(load))
+			Rebuild(r, tail, &load, swaps);
+	}
+
+	// Arrays that couldn't be read leave their textures unstreamed
+	for (Source& s : sources)
+		if (s.Streamed && !resources[s.Slot.Array].SRV)
+			s.Streamed = false;
+}
+
+bool TextureStreamer::IsStreamed(unsigned int handle)
+{
+	return handle < sources.size() && sources[handle].Streamed;
+}
+
+ComPtr<ID3D11ShaderResourceView> TextureStreamer::GetArray(unsigned int handle)
+{
+	if (!IsStreamed(handle))
+		return 0;
+	return resources[sources[handle].Slot.Array].SRV;
+}
+
+unsigned int TextureStreamer::GetSlice(unsigned int handle)
+{
+	if (!IsStreamed(handle))
+		return 0;
+	return sources[handle].Slot.Slice;
+}
+
+unsigned int TextureStreamer::GetWidth(unsigned int handle)
+{
+	if (!IsStreamed(handle))
+		return 0;
+	return sources[handle].Layout.Width;
+}
+
+void TextureStreamer::Request(unsigned int handle, float mip)
+{
+	if (!IsStreamed(handle))
+		return;
+	residency.Request(resources[sources[handle].Slot.Array].ResidencyId, (unsigned int)max(0.0f, mip));
+}
+
+// --------------------------------------------------------
+// Applies finished loads first, since the targets may have
+// moved while they were on disk, then follows the targets:
+// evictions happen immediately, while more detail means a
+// load (one per array at a time)
+// --------------------------------------------------------
+std::vector<TextureStreamerSwap> TextureStreamer::Update()
+{
+	std::vector<TextureStreamerSwap> swaps;
+
+	std::vector<Load> done;
+	{
+		std::lock_guard<std::mutex> lock(loadMutex);
+		done.swap(finished);
+	}
+	for (Load& load : done)
+	{
+		Resource& r = resources[load.Resource];
+		r.Loading = false;
+		pendingLoads--;
+
+		unsigned int target = residency.GetTarget(r.ResidencyId);
+		unsigned int top = max(load.FirstMip, target);
+		if (load.Succeeded && top < r.Resident)
+			Rebuild(r, top, &load, swaps);
+	}
+
+	residency.Update();
+
+	std::vector<Load> loads;
+	for (unsigned int i = 0; i < resources.size(); i++)
+	{
+		Resource& r = resources[i];
+		if (!r.SRV || r.Loading)
+			continue;
+
+		unsigned int target = residency.GetTarget(r.ResidencyId);
+		if (target > r.Resident)
+		{
+			Rebuild(r, target, 0, swaps);
+		}
+		else if (target < r.Resident)
+		{
+			Load load = {};
+			load.Resource = i;
+			load.FirstMip = target;
+			load.EndMip = r.Resident;
+			loads.push_back(load);
+			r.Loading = true;
+			pendingLoads++;
+		}
+	}
+
+	if (!loads.empty())
+	{
+		{
+			std::lock_guard<std::mutex> lock(loadMutex);
+			for (Load& load : loads)
+				requested.push_back(std::move(load));
+		}
+		loadReady.notify_one();
+	}
+
+	return swaps;
+}
+
+// Worker thread: reads requested mips from disk until stopped
+void TextureStreamer::ReadLoads()
+{
+	for (;;)
+	{
+		Load load;
+		{
+			std::unique_lock<std::mutex> lock(loadMutex);
+			loadReady.wait(lock, [&]() { return stopping || !requested.empty(); });
+			if (stopping)
+				return;
+			load = std::move(requested.front());
+			requested.pop_front();
+		}
+
+		load.Succeeded = ReadMips(load);
+
+		std::lock_guard<std::mutex> lock(loadMutex);
+		finished.push_back(std::move(load));
+	}
+}
+
+// Sources & slices are fixed after Build(), so this is safe on either thread
+bool TextureStreamer::ReadMips(Load& load)
+{
+	const Resource& r = resources[load.Resource];
+	load.Data.resize(r.Slices.size());
+	for (size_t slice = 0; slice < r.Slices.size(); slice++)
+	{
+		const Source& s = sources[r.Slices[slice]];
+		std::ifstream file(std::filesystem::path(s.Path), std::ios::binary);
+		if (!file)
+			return false;
+
+		load.Data[slice].resize(load.EndMip - load.FirstMip);
+		for (unsigned int mip = load.FirstMip; mip < load.EndMip; mip++)
+		{
+			std::vector<unsigned char>& data = load.Data[slice][mip - load.FirstMip];
+			data.resize(BlockCompression::GetCompressedSize(s.Layout.Format, max(1u, s.Layout.Width >> mip), max(1u, s.Layout.Height >> mip)));
+			file.seekg((std::streamoff)s.Layout.MipOffsets[mip]);
+			if (!file.read((char*)data.data(), (std::streamsize)data.size()))
+				return false;
+		}
+	}
+	return true;
+}
+
+// Bytes of every slice from firstMip down to 1x1
+unsigned long long TextureStreamer::GetBytes(const Resource& resource, unsigned int firstMip)
+{
+	unsigned long long bytes = 0;
+	for (unsigned int mip = firstMip; mip < resource.Format.MipLevels; mip++)
+	{
+		bytes += BlockCompression::GetCompressedSize(
+			resource.BlockFormat,
+			max(1u, resource.Format.Width >> mip),
+			max(1u, resource.Format.Height >> mip));
+	}
+	return bytes * resource.Slices.size();
+}
+
+// --------------------------------------------------------
+// Creates the array again with top as its first mip.  Mips
+// it already had are copied across on the GPU, and the rest
+// come from load.
+// --------------------------------------------------------
+void TextureStreamer::Rebuild(Resource& resource, unsigned int top, const Load* load, std::vector<TextureStreamerSwap>& swaps)
+{
+	unsigned int mipLevels = resource.Format.MipLevels - top;
+	unsigned int oldLevels = resource.Format.MipLevels - resource.Resident;
+
+	D3D11_TEXTURE2D_DESC desc = {};
+	desc.Width = max(1u, resource.Format.Width >> top);
+	desc.Height = max(1u, resource.Format.Height >> top);
+	desc.MipLevels = mipLevels;
+	desc.ArraySize = (unsigned int)resource.Slices.size();
+	desc.Format = (DXGI_FORMAT)resource.Format.Format;
+	desc.SampleDesc.Count = 1;
+	desc.Usage = D3D11_USAGE_DEFAULT;
+	desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+	ComPtr<ID3D11Texture2D> texture;
+	if (FAILED(device->CreateTexture2D(&desc, 0, texture.GetAddressOf())))
+		return;
+
+	unsigned int blockBytes = BlockCompression::GetBlockBytes(resource.BlockFormat);
+	for (unsigned int slice = 0; slice < desc.ArraySize; slice++)
+	{
+		for (unsigned int mip = top; mip < resource.Format.MipLevels; mip++)
+		{
+			unsigned int subresource = D3D11CalcSubresource(mip - top, slice, mipLevels);
+			if (mip >= resource.Resident)
+			{
+				context->CopySubresourceRegion(
+					texture.Get(), subresource, 0, 0, 0,
+					resource.Texture.Get(), D3D11CalcSubresource(mip - resource.Resident, slice, oldLevels),
+					0);
+			}
+			else
+			{
+				unsigned int pitch = max(1u, ((resource.Format.Width >> mip) + 3) / 4) * blockBytes;
+				context->UpdateSubresource(texture.Get(), subresource, 0, load->Data[slice][mip - load->FirstMip].data(), pitch, 0);
+			}
+		}
+	}
+
+	D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+	srvDesc.Format = desc.Format;
+	srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2DARRAY;
+	srvDesc.Texture2DArray.MostDetailedMip = 0;
+	srvDesc.Texture2DArray.MipLevels = (UINT)-1;
+	srvDesc.Texture2DArray.FirstArraySlice = 0;
+	srvDesc.Texture2DArray.ArraySize = desc.ArraySize;
+
+	ComPtr<ID3D11ShaderResourceView> srv;
+	if (FAILED(device->CreateShaderResourceView(texture.Get(), &srvDesc, srv.GetAddressOf())))
+		return;
+
+	if (resource.SRV)
+		swaps.push_back({ resource.SRV, srv });
+	residentBytes -= resource.Texture ? GetBytes(resource, resource.Resident) : 0;
+	residentBytes += GetBytes(resource, top);
+
+	resource.Texture = texture;
+	resource.SRV = srv;
+	resource.Resident = top;
+}
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <d3d11.h>
+#include <wrl/client.h>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "BlockCompression.h"
+#include "TextureArrayPacker.h"
+#include "TextureResidency.h"
+
+// --------------------------------------------------------
+// A view that streaming replaced, for anything that was
+// holding on to the old one
+// --------------------------------------------------------
+struct TextureStreamerSwap
+{
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> Old;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> New;
+};
+
+// --------------------------------------------------------
+// Streams block compressed textures from their .dds files
+// (see TextureDecodeQueue), keeping only the mips that are
+// needed on the GPU, within a fixed memory budget.
+//
+// Add() every file first, then Build() once: textures are
+// packed into arrays like TextureArrayImporter does, and
+// only each array's small mips (up to tailSize pixels) are
+// loaded.  After that, Request() the mip each texture needs
+// every frame and call Update(), which lets TextureResidency
+// decide what to keep.  Extra levels are read from disk on
+// a worker thread, then copied in on the render thread by a
+// later Update().
+//
+// Changing an array's mip count means creating it again, so
+// Update() returns the views it replaced.
+// --------------------------------------------------------
+class TextureStreamer
+{
+public:
+	TextureStreamer(
+		Microsoft::WRL::ComPtr<ID3D11Device> device,
+		Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
+		unsigned long long budget,
+		unsigned int tailSize);
+	~TextureStreamer();
+
+	// Queues a .dds file and returns its handle
+	unsigned int Add(const std::wstring& ddsPath);
+
+	// Creates the arrays and loads their tails
+	void Build();
+
+	// Unreadable files aren't streamed, and should be loaded some other way
+	bool IsStreamed(unsigned int handle);
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> GetArray(unsigned int handle);
+	unsigned int GetSlice(unsigned int handle);
+	unsigned int GetWidth(unsigned int handle);
+
+	// The texture will be sampled down to this mip this frame
+	void Request(unsigned int handle, float mip);
+
+	// Once per frame: finishes loads, applies residency changes
+	// and starts new loads
+	std::vector<TextureStreamerSwap> Update();
+
+	void SetBudget(unsigned long long budget) { residency.SetBudget(budget); }
+	TextureResidencyStats GetStats() const { return residency.GetStats(); }
+	unsigned long long GetResidentBytes() const { return residentBytes; }
+	unsigned int GetPendingLoads() const { return pendingLoads; }
+
+private:
+	Microsoft::WRL::ComPtr<ID3D11Device> device;
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context;
+	unsigned int tailSize;
+
+	struct Source
+	{
+		std::wstring Path;
+		BlockDDSLayout Layout;
+		bool Streamed;
+		TextureArraySlot Slot;
+	};
+
+	// One array: its slices' sources and what's on the GPU
+	struct Resource
+	{
+		TextureArrayFormat Format;
+		BlockCompressionFormat BlockFormat;
+		std::vector<unsigned int> Slices;	// Source per slice
+		unsigned int ResidencyId;
+		unsigned int Resident;				// Most detailed mip on the GPU
+		bool Loading;
+		Microsoft::WRL::ComPtr<ID3D11Texture2D> Texture;
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> SRV;
+	};
+
+	// Mips read from disk, [slice][mip - FirstMip]
+	struct Load
+	{
+		unsigned int Resource;
+		unsigned int FirstMip;
+		unsigned int EndMip;
+		bool Succeeded;
+		std::vector<std::vector<std::vector<unsigned char>>> Data;
+	};
+
+	std::vector<Source> sources;
+	std::vector<Resource> resources;
+	TextureResidency residency;
+	unsigned long long residentBytes;
+	unsigned int pendingLoads;
+
+	// Worker thread for disk reads
+	std::thread worker;
+	std::mutex loadMutex;
+	std::condition_variable loadReady;
+	std::deque<Load> requested;
+	std::vector<Load> finished;
+	bool stopping;
+	void ReadLoads();
+	bool ReadMips(Load& load);
+
+	unsigned long long GetBytes(const Resource& resource, unsigned int firstMip);
+	void Rebuild(Resource& resource, unsigned int top, const Load* load, std::vector<TextureStreamerSwap>& swaps);
+};
@@ -0,0 +1,111 @@
+// --------------------------------------------------------
+// Batch tool: bakes PNGs into atlas pages (see
+// TextureAtlas.h), writing each page as a block compressed
+// .dds with only its clean mips, plus a layout file of each
+// texture's UV scale & offset, and reports how well the
+// pages were filled.
+//
+// Nothing here needs Windows.  On Linux, with DirectXMath
+// (and its sal.h) on the include path:
+//
+//   g++ -std=c++17 -O2 -I.. BakeAtlas.cpp ../TextureAtlas.cpp
+//       ../PNGDecoder.cpp ../MipGenerator.cpp ../BlockCompression.cpp
+//       -lpthread -o BakeAtlas
+//
+// Usage: BakeAtlas [options] <output> <image.png>...
+//   -size N      Largest page, in pixels (default 2048)
+//   -mips N      Mips kept free of bleeding (default 5)
+//   -padding N   Gutter texels at the last of those mips (default 1)
+//   -wrap        Fill gutters for tiling textures
+//   -linear      Data rather than sRGB color, for mip filtering
+//   -bc1         BC1 instead of BC7
+//
+// Writes <output>_<page>.dds and <output>.txt.
+// --------------------------------------------------------
+#include "TextureAtlas.h"
+#include "MipGenerator.h"
+#include "PNGDecoder.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+
+int main(int argc, char* argv[])
+{
+	AtlasSettings settings = { 2048, 5, 1, ATLAS_GUTTER_CLAMP };
+	MipContent content = MIP_CONTENT_SRGB;
+	BlockCompressionFormat format = BLOCK_COMPRESSION_BC7;
+
+	int arg = 1;
+	for (; arg < argc && argv[arg][0] == '-'; arg++)
+	{
+		if (!strcmp(argv[arg], "-size") && arg + 1 < argc) settings.MaxSize = (unsigned int)atoi(argv[++arg]);
+		else if (!strcmp(argv[arg], "-mips") && arg + 1 < argc) settings.MipLevels = (unsigned int)atoi(argv[++arg]);
+		else if (!strcmp(argv[arg], "-padding") && arg + 1 < argc) settings.Padding = (unsigned int)atoi(argv[++arg]);
+		else if (!strcmp(argv[arg], "-wrap")) settings.Gutter = ATLAS_GUTTER_WRAP;
+		else if (!strcmp(argv[arg], "-linear")) content = MIP_CONTENT_LINEAR;
+		else if (!strcmp(argv[arg], "-bc1")) format = BLOCK_COMPRESSION_BC1;
+		else
+		{
+			printf("Unknown option %s\n", argv[arg]);
+			return 1;
+		}
+	}
+	if (argc - arg < 2 || settings.MipLevels == 0)
+	{
+		printf("Usage: %s [-size N] [-mips N] [-padding N] [-wrap] [-linear] [-bc1] <output> <image.png>...\n", argv[0]);
+		return 1;
+	}
+
+	std::string output = argv[arg++];
+	std::vector<BlockImage> images;
+	std::vector<std::wstring> names;
+	for (; arg < argc; arg++)
+	{
+		BlockImage image = {};
+		if (!PNGDecoder::Load(argv[arg], &image))
+		{
+			printf("Couldn't load %s\n", argv[arg]);
+			return 1;
+		}
+		images.push_back(image);
+		names.push_back(std::filesystem::path(argv[arg]).stem().wstring());
+	}
+
+	Atlas atlas = TextureAtlas::Build(images, names, settings);
+
+	unsigned int threadCount = std::max(1u, std::thread::hardware_concurrency());
+	MipSettings mipSettings = { MIP_FILTER_BOX, content, 0 };
+	for (unsigned int p = 0; p < atlas.Pages.size(); p++)
+	{
+		std::vector<BlockImage> levels = MipGenerator::Generate(atlas.Pages[p], mipSettings, threadCount);
+		levels.resize(std::min((size_t)settings.MipLevels, levels.size()));
+
+		std::vector<std::vector<unsigned char>> mips;
+		for (const BlockImage& level : levels)
+			mips.push_back(BlockCompression::CompressImage(format, level, threadCount));
+
+		std::string pagePath = output + "_" + std::to_string(p) + ".dds";
+		if (!BlockCompression::SaveDDS(pagePath, format, atlas.Pages[p].Width, atlas.Pages[p].Height, mips))
+		{
+			printf("Couldn't save %s\n", pagePath.c_str());
+			return 1;
+		}
+		printf("%s: %ux%u, %u mips\n", pagePath.c_str(), atlas.Pages[p].Width, atlas.Pages[p].Height, (unsigned int)mips.size());
+	}
+
+	if (!TextureAtlas::SaveLayout(output + ".txt", atlas))
+	{
+		printf("Couldn't save %s.txt\n", output.c_str());
+		return 1;
+	}
+
+	const AtlasStats& stats = atlas.Stats;
+	printf("%u textures on %u pages, %u too large\n", (unsigned int)images.size() - stats.Unplaced, stats.Pages, stats.Unplaced);
+	printf("Efficiency: %.1f%% textures, %.1f%% gutters, %.1f%% empty\n",
+		stats.Efficiency * 100,
+		stats.PageTexels ? 100.0 * stats.GutterTexels / stats.PageTexels : 0.0,
+		stats.PageTexels ? 100.0 * (stats.PageTexels - stats.TextureTexels - stats.GutterTexels) / stats.PageTexels : 0.0);
+	return stats.Unplaced ? 1 : 0;
+}
@@ -0,0 +1,108 @@
+// --------------------------------------------------------
+// Batch tool: bakes a sky's GGX prefiltered cube map and the
+// BRDF lookup table (see EnvironmentBaker.h) into the same
+// .dds files the game would write on its first run, and
+// skips the ones that are already current.
+//
+// Nothing here needs Windows.  On Linux, with DirectXMath
+// (and its sal.h) on the include path:
+//
+//   g++ -std=c++17 -O2 -I.. BakeEnvironment.cpp ../EnvironmentBaker.cpp
+//       ../PNGDecoder.cpp ../MipGenerator.cpp -lpthread -o BakeEnvironment
+//
+// Usage: BakeEnvironment [options] <environment.dds> <brdf.dds> <+x> <-x> <+y> <-y> <+z> <-z>
+//   -size N      Prefiltered face size (default 128)
+//   -mips N      Roughness levels (default 6)
+//   -samples N   GGX samples per texel (default 256)
+//   -lut N       BRDF lookup table size (default 128)
+//   -force       Bake even if the files are current
+//
+// Faces are PNGs, and any that are missing are black.
+// --------------------------------------------------------
+#include "EnvironmentBaker.h"
+#include "PNGDecoder.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+
+int main(int argc, char* argv[])
+{
+	EnvironmentSettings settings = { 128, 6, 256, 128 };
+	bool force = false;
+
+	int arg = 1;
+	for (; arg < argc && argv[arg][0] == '-'; arg++)
+	{
+		if (!strcmp(argv[arg], "-size") && arg + 1 < argc) settings.Size = (unsigned int)atoi(argv[++arg]);
+		else if (!strcmp(argv[arg], "-mips") && arg + 1 < argc) settings.MipLevels = (unsigned int)atoi(argv[++arg]);
+		else if (!strcmp(argv[arg], "-samples") && arg + 1 < argc) settings.SampleCount = (unsigned int)atoi(argv[++arg]);
+		else if (!strcmp(argv[arg], "-lut") && arg + 1 < argc) settings.LUTSize = (unsigned int)atoi(argv[++arg]);
+		else if (!strcmp(argv[arg], "-force")) force = true;
+		else
+		{
+			printf("Unknown option %s\n", argv[arg]);
+			return 1;
+		}
+	}
+	if (argc - arg != 8)
+	{
+		printf("Usage: %s [-size N] [-mips N] [-samples N] [-lut N] [-force] <environment.dds> <brdf.dds> <+x> <-x> <+y> <-y> <+z> <-z>\n", argv[0]);
+		return 1;
+	}
+
+	std::string environmentPath = argv[arg];
+	std::string brdfPath = argv[arg + 1];
+	std::vector<std::wstring> facePaths;
+	for (int f = 0; f < 6; f++)
+		facePaths.push_back(std::filesystem::path(argv[arg + 2 + f]).wstring());
+
+	unsigned int threadCount = std::max(1u, std::thread::hardware_concurrency());
+	auto start = std::chrono::high_resolution_clock::now();
+	auto elapsed = [&]() { return std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count(); };
+
+	if (force || !EnvironmentBaker::IsCurrent(environmentPath, facePaths))
+	{
+		BlockImage images[6] = {};
+		const BlockImage* faces[6] = {};
+		for (int f = 0; f < 6; f++)
+		{
+			if (PNGDecoder::Load(facePaths[f], &images[f]))
+				faces[f] = &images[f];
+			else
+				printf("Couldn't load %s, using black\n", argv[arg + 2 + f]);
+		}
+
+		start = std::chrono::high_resolution_clock::now();
+		PrefilteredEnvironment environment = EnvironmentBaker::Prefilter(faces, settings, threadCount);
+		if (!EnvironmentBaker::SaveEnvironment(environmentPath, environment))
+		{
+			printf("Couldn't save %s\n", environmentPath.c_str());
+			return 1;
+		}
+		printf("%s: %ux%u, %u mips in %.1f ms\n", environmentPath.c_str(), environment.Size, environment.Size, environment.MipLevels, elapsed());
+	}
+	else
+	{
+		printf("%s is current\n", environmentPath.c_str());
+	}
+
+	if (force || !EnvironmentBaker::IsCurrent(brdfPath, {}))
+	{
+		start = std::chrono::high_resolution_clock::now();
+		std::vector<unsigned short> lut = EnvironmentBaker::BakeBRDF(settings, threadCount);
+		if (!EnvironmentBaker::SaveBRDF(brdfPath, settings.LUTSize, lut))
+		{
+			printf("Couldn't save %s\n", brdfPath.c_str());
+			return 1;
+		}
+		printf("%s: %ux%u in %.1f ms\n", brdfPath.c_str(), settings.LUTSize, settings.LUTSize, elapsed());
+	}
+	else
+	{
+		printf("%s is current\n", brdfPath.c_str());
+	}
+	return 0;
+}
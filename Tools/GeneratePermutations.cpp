@@ -0,0 +1,165 @@
+// --------------------------------------------------------
+// Generator: writes the PixelShader_*.hlsl wrappers for
+// every variant in the feature table below, and the manifest
+// ShaderPermutations.cpp compiles in
+// (PixelShaderPermutations.inl), so the two always agree.
+// Run it again after changing the table or the scene's
+// lights, then add any new wrappers to the project's
+// FxCompile items (it lists the ones missing).
+//
+// Nothing here needs Windows:
+//
+//   g++ -std=c++17 -O2 -I.. GeneratePermutations.cpp
+//       ../ShaderPermutationTable.cpp -o GeneratePermutations
+//
+// Usage: GeneratePermutations [-lights D P S] <repo folder>
+//   -lights D P S   Directional, point & spot light counts
+//                   to specialize for (default 3 1 1, the
+//                   lights Game sets up)
+// --------------------------------------------------------
+#include "ShaderPermutationTable.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+	// --------------------------------------------------------
+	// Feature sets to build variants for.  Each is built for
+	// any lights, and for the scene's light counts.  Every
+	// feature with any lights is PixelShader.hlsl itself, and
+	// always comes first in the manifest.
+	// --------------------------------------------------------
+	const unsigned int featureTable[] =
+	{
+		SHADER_FEATURE_NORMAL_MAP | SHADER_FEATURE_PBR_MAPS | SHADER_FEATURE_SHADOWS,
+		SHADER_FEATURE_NORMAL_MAP | SHADER_FEATURE_PBR_MAPS,
+		SHADER_FEATURE_PBR_MAPS | SHADER_FEATURE_SHADOWS,
+		SHADER_FEATURE_SHADOWS,
+		SHADER_FEATURE_ALL | SHADER_FEATURE_TEXTURE_ARRAYS,
+	};
+
+	// Features as the manifest spells them
+	std::string FeatureExpression(unsigned int features)
+	{
+		const unsigned int bits[] = { SHADER_FEATURE_NORMAL_MAP, SHADER_FEATURE_PBR_MAPS, SHADER_FEATURE_SHADOWS, SHADER_FEATURE_TEXTURE_ARRAYS };
+		const char* names[] = { "SHADER_FEATURE_NORMAL_MAP", "SHADER_FEATURE_PBR_MAPS", "SHADER_FEATURE_SHADOWS", "SHADER_FEATURE_TEXTURE_ARRAYS" };
+		std::string text;
+		if ((features & SHADER_FEATURE_ALL) == SHADER_FEATURE_ALL)
+		{
+			text = "SHADER_FEATURE_ALL";
+			features &= ~SHADER_FEATURE_ALL;
+		}
+		for (int i = 0; i < 4; i++)
+		{
+			if (!(features & bits[i]))
+				continue;
+			if (!text.empty())
+				text += " | ";
+			text += names[i];
+		}
+		return text.empty() ? "0" : text;
+	}
+
+	std::string LightExpression(int count)
+	{
+		return count == SHADER_ANY_LIGHTS ? "SHADER_ANY_LIGHTS" : std::to_string(count);
+	}
+
+	// Only rewrites files whose contents change, so the shaders
+	// that didn't aren't rebuilt
+	bool WriteIfChanged(const std::filesystem::path& path, const std::string& text)
+	{
+		std::ifstream existing(path, std::ios::binary);
+		std::stringstream old;
+		old << existing.rdbuf();
+		if (existing && old.str() == text)
+			return true;
+
+		std::ofstream file(path, std::ios::binary | std::ios::trunc);
+		file << text;
+		return file.good();
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	int lights[3] = { 3, 1, 1 };
+
+	int arg = 1;
+	for (; arg < argc && argv[arg][0] == '-'; arg++)
+	{
+		if (!strcmp(argv[arg], "-lights") && arg + 3 < argc)
+		{
+			for (int i = 0; i < 3; i++)
+				lights[i] = atoi(argv[++arg]);
+		}
+		else
+		{
+			printf("Unknown option %s\n", argv[arg]);
+			return 1;
+		}
+	}
+	if (argc - arg != 1 || lights[0] < 0 || lights[1] < 0 || lights[2] < 0)
+	{
+		printf("Usage: %s [-lights D P S] <repo folder>\n", argv[0]);
+		return 1;
+	}
+	std::filesystem::path folder = argv[arg];
+
+	// The general variant, then each row for any and fixed lights
+	std::vector<ShaderPermutationKey> keys;
+	keys.push_back({ SHADER_FEATURE_ALL, SHADER_ANY_LIGHTS, SHADER_ANY_LIGHTS, SHADER_ANY_LIGHTS });
+	for (unsigned int features : featureTable)
+	{
+		ShaderPermutationKey anyLights = { features, SHADER_ANY_LIGHTS, SHADER_ANY_LIGHTS, SHADER_ANY_LIGHTS };
+		if (!ShaderPermutationTable::IsGeneral(anyLights))
+			keys.push_back(anyLights);
+		keys.push_back({ features, lights[0], lights[1], lights[2] });
+	}
+
+	std::string manifest =
+		"// Generated by Tools/GeneratePermutations.cpp: every compiled\n"
+		"// variant of PixelShader.hlsl, the general one first\n";
+	std::ifstream project(folder / "D3D11Starter.vcxproj");
+	std::stringstream projectText;
+	projectText << project.rdbuf();
+
+	int failed = 0;
+	for (const ShaderPermutationKey& key : keys)
+	{
+		std::string name = ShaderPermutationTable::GetName(key);
+		manifest += "{ { " + FeatureExpression(key.Features);
+		manifest += ", " + LightExpression(key.DirLights);
+		manifest += ", " + LightExpression(key.PointLights);
+		manifest += ", " + LightExpression(key.SpotLights);
+		manifest += " }, L\"" + name + ".cso\" },\n";
+
+		if (ShaderPermutationTable::IsGeneral(key))
+			continue;
+
+		std::string file = name + ".hlsl";
+		if (!WriteIfChanged(folder / file, ShaderPermutationTable::GetWrapper(key)))
+		{
+			printf("Couldn't write %s\n", file.c_str());
+			failed++;
+			continue;
+		}
+		printf("%s\n", file.c_str());
+		if (project && projectText.str().find("Include=\"" + file + "\"") == std::string::npos)
+			printf("  Not in D3D11Starter.vcxproj yet: add it as a pixel shader\n");
+	}
+
+	if (!WriteIfChanged(folder / "PixelShaderPermutations.inl", manifest))
+	{
+		printf("Couldn't write PixelShaderPermutations.inl\n");
+		failed++;
+	}
+	printf("%u variants\n", (unsigned int)keys.size());
+	return failed ? 1 : 0;
+}
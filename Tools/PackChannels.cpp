@@ -0,0 +1,67 @@
+// --------------------------------------------------------
+// Batch tool: builds every pack in a ChannelPacker manifest
+// ahead of time, writing the same block compressed .dds
+// files the game would write on its first run (and skipping
+// the ones that are already current).
+//
+// Nothing here needs Windows.  On Linux, with DirectXMath
+// (and its sal.h) on the include path:
+//
+//   g++ -std=c++17 -O2 -I.. PackChannels.cpp ../ChannelPacker.cpp
+//       ../PNGDecoder.cpp ../MipGenerator.cpp ../BlockCompression.cpp
+//       ../TextureDecodeQueue.cpp -lpthread -o PackChannels
+//
+// Usage: PackChannels <manifest> [normal map suffix]
+//
+// With a suffix (such as _normals.png), each pack's
+// roughness gets Toksvig adjusted by the normal map that
+// shares its roughness map's prefix.
+// --------------------------------------------------------
+#include "TextureDecodeQueue.h"
+#include <cstdio>
+#include <string>
+#include <thread>
+
+int main(int argc, char* argv[])
+{
+	if (argc < 2)
+	{
+		printf("Usage: %s <manifest> [normal map suffix]\n", argv[0]);
+		return 1;
+	}
+
+	std::vector<ChannelPack> packs = ChannelPacker::LoadManifest(argv[1]);
+	if (packs.empty())
+	{
+		printf("No packs in %s\n", argv[1]);
+		return 1;
+	}
+
+	std::wstring normalSuffix = argc > 2 ? std::filesystem::path(argv[2]).wstring() : L"";
+	TextureDecodeQueue queue;
+	for (const ChannelPack& pack : packs)
+	{
+		TextureImportSettings settings = { BLOCK_COMPRESSION_BC7, MIP_FILTER_KAISER, MIP_CONTENT_LINEAR, L"", true };
+
+		const std::wstring& roughness = pack.Sources[PACK_CHANNEL_ROUGHNESS];
+		size_t prefix = roughness.rfind(L'_');
+		if (!normalSuffix.empty() && prefix != std::wstring::npos)
+			settings.NormalMapPath = roughness.substr(0, prefix) + normalSuffix;
+
+		queue.AddPacked(pack, settings);
+	}
+
+	unsigned int threadCount = std::thread::hardware_concurrency();
+	queue.Decode(threadCount > 0 ? threadCount : 1);
+
+	int failed = 0;
+	for (unsigned int i = 0; i < queue.GetCount(); i++)
+	{
+		const DecodedTexture& texture = queue.Get(i);
+		printf("%s %s\n", texture.Decoded ? "ok    " : "FAILED", std::filesystem::path(texture.CachePath).string().c_str());
+		if (!texture.Decoded)
+			failed++;
+	}
+	printf("%u packs in %.1f ms\n", queue.GetCount(), queue.GetDecodeTime());
+	return failed ? 1 : 0;
+}
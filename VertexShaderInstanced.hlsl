@@ -0,0 +1,51 @@
+#include "ShaderBuffers.hlsli"
+
+// Per-vertex data from slot 0, per-instance rows from slot 1
+struct VertexShaderInput_Instanced
+{
+    float3 localPosition : POSITION;
+    float2 uv : TEXCOORD;
+    float3 normal : NORMAL;
+    float3 tangent : TANGENT;
+    float4 world0 : WORLD_PER_INSTANCE0;
+    float4 world1 : WORLD_PER_INSTANCE1;
+    float4 world2 : WORLD_PER_INSTANCE2;
+    float4 world3 : WORLD_PER_INSTANCE3;
+    float4 worldInvTrans0 : WORLD_INV_TRANS_PER_INSTANCE0;
+    float4 worldInvTrans1 : WORLD_INV_TRANS_PER_INSTANCE1;
+    float4 worldInvTrans2 : WORLD_INV_TRANS_PER_INSTANCE2;
+    float4 worldInvTrans3 : WORLD_INV_TRANS_PER_INSTANCE3;
+    float4 wvp0 : WVP_PER_INSTANCE0;
+    float4 wvp1 : WVP_PER_INSTANCE1;
+    float4 wvp2 : WVP_PER_INSTANCE2;
+    float4 wvp3 : WVP_PER_INSTANCE3;
+    float4 lightWVP0 : LIGHT_WVP_PER_INSTANCE0;
+    float4 lightWVP1 : LIGHT_WVP_PER_INSTANCE1;
+    float4 lightWVP2 : LIGHT_WVP_PER_INSTANCE2;
+    float4 lightWVP3 : LIGHT_WVP_PER_INSTANCE3;
+};
+
+VertexToPixel main(VertexShaderInput_Instanced input)
+{
+	// Set up output struct
+    VertexToPixel output;
+
+    // Rows arrive as they're stored on the CPU, so transpose to
+    // match the layout a matrix in a cbuffer would have.  These
+    // replace the PerObject matrices, which go unused here.
+    matrix instWorld = transpose(float4x4(input.world0, input.world1, input.world2, input.world3));
+    matrix instWorldInvTrans = transpose(float4x4(input.worldInvTrans0, input.worldInvTrans1, input.worldInvTrans2, input.worldInvTrans3));
+    matrix instWVP = transpose(float4x4(input.wvp0, input.wvp1, input.wvp2, input.wvp3));
+    matrix instLightWVP = transpose(float4x4(input.lightWVP0, input.lightWVP1, input.lightWVP2, input.lightWVP3));
+
+    output.screenPosition = mul(instWVP, float4(input.localPosition, 1.0f));
+
+    output.worldPos = mul(instWorld, float4((input.localPosition), 1.0f)).xyz;
+    output.uv = input.uv;
+    output.normal = mul((float3x3)instWorldInvTrans, input.normal);
+    output.tangent = mul((float3x3)instWorld, input.tangent);
+
+    output.shadowMapPos = mul(instLightWVP, float4(input.localPosition, 1.0f));
+
+    return output;
+}
@@ -1,27 +1,4 @@
-cbuffer ExternalData : register(b0)
-{
-    matrix world;
-    matrix view;
-    matrix proj;
-    float time;
-}
-
-struct VertexShaderInput
-{
-    float3 localPosition : POSITION; // XYZ position
-    float2 uv : TEXCOORD;
-    float3 normal : NORMAL;
-    float3 tangent : TANGENT;
-};
-
-struct VertexToPixel
-{
-    float4 screenPosition : SV_POSITION; // XYZW position (System Value Position)
-    float2 uv : TEXCOORD;
-    float3 normal : NORMAL;
-    float3 worldPos : POSITION;
-    float3 tangent : TANGENT;
-};
+#include "ShaderBuffers.hlsli"
 
 VertexToPixel main(VertexShaderInput input)
 {
@@ -31,8 +8,6 @@ VertexToPixel main(VertexShaderInput input)
     // Wobble the x value based on the y value
     float3 wobblePos = float3(input.localPosition.x + sin(input.localPosition.y * 3 + time * 5)/2, input.localPosition.yz);
 
-	// Create world-view-projection matrix from camera matrices
-    matrix wvp = mul(proj, mul(view, world));
     output.screenPosition = mul(wvp, float4(wobblePos, 1.0f));
 
 	// Send uv and normal to next stage unchanged
@@ -40,6 +15,7 @@ VertexToPixel main(VertexShaderInput input)
     output.uv = input.uv;
     output.normal = input.normal;
     output.tangent = input.tangent;
+    output.shadowMapPos = mul(lightWVP, float4(wobblePos, 1.0f));
     
 	// Whatever we return will make its way through the pipeline to the
 	// next programmable stage we're using (the pixel shader for now)